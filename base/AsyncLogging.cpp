@@ -3,152 +3,536 @@
 //
 
 #include "AsyncLogging.h"
+#include "BinaryLog.h"
 #include "LogFile.h"
 #include "Timestamp.h"
 
-#include <stdio.h>
+#include <assert.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#include <algorithm>
 #include <functional>
+#include <queue>
 
 using namespace muduo;
 
+/*
+ *      单生产者单消费者的环形缓冲区
+ *
+ *      1. 下标只增不减，对容量取模得到位置；writeIndex - readIndex 是已用的字节数。
+ *      2. 每条记录：| time 8 | len 4 | logline |，记录不跨越环的末尾：
+ *         末尾放不下时，写一个len = -1的跳过标记（末尾连标记都放不下时省略），从头开始写。
+ *      3. 前端写完记录后release写writeIndex，后端acquire读到之后才读取记录；
+ *         后端用完记录后release写readIndex，前端看到之后才覆盖。
+ *      4. 前端缓存readIndex，只有看起来空间不够时才重新读取，平时不碰后端的cache line。
+ *      5. headIndex之前的记录归后端：后端用CAS把headIndex推到writeIndex，取得这一段记录。
+ *         kDropOldest时前端在后端没有持有记录（readIndex == headIndex）时用CAS推进headIndex，丢掉最旧的记录，
+ *         两边只有一个能成功。
+ *      6. 超过内存上限后新线程共用一个环（shared），前端写入时加producerMutex。
+ */
+struct AsyncLogging::ThreadBuffer : noncopyable {
+    ThreadBuffer(size_t size, bool sharedBuffer)
+            : data(new char[size]),
+              capacity(size),
+              shared(sharedBuffer),
+              producerMutex(sharedBuffer ? new MutexLock : nullptr),
+              writeIndex(0),
+              cachedReadIndex(0),
+              sampleCount(0),
+              dropped(0),
+              waits(0),
+              headIndex(0),
+              readIndex(0),
+              abandoned(false) {
+    }
+
+    std::unique_ptr<char[]> data;
+    const uint64_t capacity;
+    const bool shared;
+    std::unique_ptr<MutexLock> producerMutex;
+
+    std::atomic<uint64_t> writeIndex;       // 前端写
+    uint64_t cachedReadIndex;               // 只有前端访问
+    uint64_t sampleCount;                   // 只有前端访问
+    std::atomic<int64_t> dropped;           // 前端写，stats()读
+    std::atomic<int64_t> waits;
+    char pad[64];
+    std::atomic<uint64_t> headIndex;        // 后端和kDropOldest的前端CAS
+    std::atomic<uint64_t> readIndex;        // 后端写，kDropOldest时前端也写
+    std::atomic<bool> abandoned;            // 线程已经退出
+};
+
+/*
+ *      线程局部的ThreadBuffer指针，线程退出时标记ThreadBuffer，由后端取空后释放。
+ *      AsyncLogging先析构时weak_ptr失效，不会访问已经释放的ThreadBuffer
+ */
+struct AsyncLogging::ThreadBufferHolder {
+    ThreadBufferHolder() : buffer(nullptr) {}
+
+    ~ThreadBufferHolder() {
+        ThreadBufferPtr owner = weakBuffer.lock();
+        if (owner && !owner->shared) {
+            owner->abandoned.store(true, std::memory_order_release);
+        }
+    }
+
+    ThreadBuffer *buffer;
+    std::weak_ptr<ThreadBuffer> weakBuffer;
+};
+
+namespace muduo {
+    namespace detail {
+
+        const size_t kRecordHeader = sizeof(int64_t) + sizeof(int32_t);
+        const int32_t kSkipRecord = -1;
+        const size_t kBatchRecords = 512;
+        const size_t kBatchBytes = 256 * 1024;
+
+        size_t roundUpToPowerOfTwo(size_t size) {
+            size_t n = 64 * 1024;
+            while (n < size) {
+                n <<= 1;
+            }
+            return n;
+        }
+
+        /*
+         *      粗粒度的时钟走vDSO，只要几ns，精度是一个tick（1~4ms），只用于归并排序，不写进日志
+         */
+        int64_t coarseMicroseconds() {
+            struct timespec ts;
+            ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        }
+
+        int64_t monotonicMicroseconds() {
+            struct timespec ts;
+            ::clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        }
+
+        // 只有一个线程写的计数器，不需要原子的加法
+        void increase(std::atomic<int64_t> *counter, int64_t n = 1) {
+            counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+    }  // namespace detail
+}  // namespace muduo
+
+const size_t AsyncLogging::kDefaultThreadBufferSize;
+
 AsyncLogging::AsyncLogging(const string &basename,
                            off_t rollSize,
-                           int flushInterval)
+                           int flushInterval,
+                           size_t threadBufferSize)
         : flushInterval_(flushInterval),
           running_(false),
           basename_(basename),
           rollSize_(rollSize),
+          threadBufferSize_(detail::roundUpToPowerOfTwo(threadBufferSize)),
+          decodeBinary_(false),
+          compressor_(nullptr),
+          compressOutput_(false),
+          policy_(kBlock),
+          sampleEvery_(10),
+          maxMemory_(0),
+          linesWritten_(0),
+          bytesWritten_(0),
+          writes_(0),
+          writeMicros_(0),
+          maxWriteMicros_(0),
           thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
           latch_(1),
           mutex_(),
           cond_(mutex_),
-          currentBuffer_(new Buffer),
-          nextBuffer_(new Buffer),
-          buffers_() {
-    currentBuffer_->bzero();
-    nextBuffer_->bzero();
-    buffers_.reserve(16);
+          wakeupPending_(false),
+          memoryBytes_(0),
+          bufferAllocations_(0),
+          retiredDropped_(0),
+          retiredWaits_(0) {
+}
+
+void AsyncLogging::stop() {
+    running_ = false;
+    wakeup();
+    thread_.join();
+}
+
+void AsyncLogging::setOverflowPolicy(OverflowPolicy policy, int sampleEvery) {
+    policy_.store(policy, std::memory_order_relaxed);
+    sampleEvery_.store(sampleEvery > 0 ? sampleEvery : 1, std::memory_order_relaxed);
 }
 
 /*
- *      前端维护两个buffer和一个bufferVector
- *
- *      1. append()整个函数体都是加锁的，同一时间只能由一个工作线程添加一条日志
- *      2. 当一个buffer被写满，则将其移到bufferVector里面等待后端线程取走
- *      3. 先写满currentBuffer，再写满nextBuffer，如果二者都写满了而后端还未就绪，则申请新的buffer
- *      4. currentBuffer写满时通知后端线程（cond_.notify()）
- *      5. 即便currentBuffer未写满，后端线程也会将其移到BufferVector，并取走
- *
+ *      至少要有一个共用的环，上限不足一个环时按一个环算
  */
+void AsyncLogging::setMaxMemory(size_t bytes) {
+    MutexLockGuard lock(mutex_);
+    maxMemory_ = bytes == 0 ? 0 : std::max(bytes, threadBufferSize_);
+}
+
+AsyncLogging::Stats AsyncLogging::stats() const {
+    Stats stats;
+    stats.linesWritten = linesWritten_.load(std::memory_order_relaxed);
+    stats.bytesWritten = bytesWritten_.load(std::memory_order_relaxed);
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.writeMicros = writeMicros_.load(std::memory_order_relaxed);
+    stats.maxWriteMicros = maxWriteMicros_.load(std::memory_order_relaxed);
+    MutexLockGuard lock(mutex_);
+    stats.linesDropped = retiredDropped_;
+    stats.producerWaits = retiredWaits_;
+    for (const ThreadBufferPtr &buffer : threadBuffers_) {
+        stats.linesDropped += buffer->dropped.load(std::memory_order_relaxed);
+        stats.producerWaits += buffer->waits.load(std::memory_order_relaxed);
+    }
+    stats.bufferAllocations = bufferAllocations_;
+    stats.memoryBytes = static_cast<int64_t>(memoryBytes_);
+    return stats;
+}
+
 void AsyncLogging::append(const char *logline, int len) {
-    muduo::MutexLockGuard lock(mutex_);
-    if (currentBuffer_->avail() > len) {
-        currentBuffer_->append(logline, len);
+    ThreadBuffer *buffer = threadBuffer();
+    if (buffer->producerMutex) {
+        MutexLockGuard lock(*buffer->producerMutex);
+        appendTo(buffer, logline, len);
     } else {
-        buffers_.push_back(std::move(currentBuffer_));
-
-        if (nextBuffer_) {
-            currentBuffer_ = std::move(nextBuffer_);
-        } else {
-            currentBuffer_.reset(new Buffer); // Rarely happens
-        }
-        currentBuffer_->append(logline, len);
-        cond_.notify();
+        appendTo(buffer, logline, len);
     }
 }
 
 /*
- *      后端线程也维护两个Buffer（newBuffer1/2）和一个BufferVector（BuffersToWrite）：
- *      两个Buffer是空闲的，用于置换前端的两个Buffer；BufferVector包含着所有要写入文件的Buffer
- *
- *
+ *      前端只访问自己线程的ThreadBuffer
  *
+ *      1. 写入一条记录只有memcpy和一次release store，不加锁
+ *      2. 已用空间越过一半时唤醒后端，不必等到flushInterval_
+ *      3. 越过3/4时重新读取readIndex：kSample时只保留每sampleEvery_条中的一条；空间不够时按溢出策略处理
  */
-void AsyncLogging::threadFunc() {
-    assert(running_ == true);
-    latch_.countDown();
-    LogFile output(basename_, rollSize_, false);
-    BufferPtr newBuffer1(new Buffer);
-    BufferPtr newBuffer2(new Buffer);
-    newBuffer1->bzero();
-    newBuffer2->bzero();
-    BufferVector buffersToWrite;
-    buffersToWrite.reserve(16);
-    while (running_) {
-        assert(newBuffer1 && newBuffer1->length() == 0);
-        assert(newBuffer2 && newBuffer2->length() == 0);
-        assert(buffersToWrite.empty());
+void AsyncLogging::appendTo(ThreadBuffer *buffer, const char *logline, int len) {
+    const uint64_t capacity = buffer->capacity;
+    size_t size = detail::kRecordHeader + static_cast<size_t>(len);
+    if (size > capacity / 2) {
+        len = static_cast<int>(capacity / 2 - detail::kRecordHeader);   // 不会发生：一条日志最长4000字节
+        size = capacity / 2;
+    }
 
-        /*
-         *      前后端的交互主要完成两个事件：
-         *      1. 将buffers_的内容转移到buffersToWrite
-         *      2. 将两个备用buffer替代前端的两个buffer
-         *
-         *      后续的写入文件和前端无关，所以只需要在这部分加锁
-         */
-        {
-            muduo::MutexLockGuard lock(mutex_);
-            /*
-             *  如果日志写入很频繁，那么cond_.notify()是有可能丢失的：即cond_.waitForSeconds()之后的代码在运行时，前端currentBuffer写满后又调用了cond_.notify()。
-             *  这里用if而不是while的原因正是为了应对这种情况————当while(running_)下一轮迭代运行到此处发现buffers_不空，还是会把待处理的日志写到文件中
-             *  见书本P119 情况4
-             */
-            if (buffers_.empty())  // unusual usage!
-            {
-                cond_.waitForSeconds(flushInterval_);
-            }
-            buffers_.push_back(std::move(currentBuffer_));
-            currentBuffer_ = std::move(newBuffer1);
-            buffersToWrite.swap(buffers_);
-            if (!nextBuffer_) {
-                nextBuffer_ = std::move(newBuffer2);
+    uint64_t write = buffer->writeIndex.load(std::memory_order_relaxed);
+    uint64_t offset = write & (capacity - 1);
+    uint64_t padding = capacity - offset < size ? capacity - offset : 0;
+    uint64_t writeEnd = write + padding + size;
+    if (writeEnd - buffer->cachedReadIndex > capacity / 4 * 3) {
+        buffer->cachedReadIndex = buffer->readIndex.load(std::memory_order_acquire);
+        if (writeEnd - buffer->cachedReadIndex > capacity && !makeRoom(buffer, write, writeEnd)) {
+            detail::increase(&buffer->dropped);
+            return;
+        }
+        if (policy_.load(std::memory_order_relaxed) == kSample &&
+            writeEnd - buffer->cachedReadIndex > capacity / 4 * 3 &&
+            ++buffer->sampleCount % static_cast<uint64_t>(sampleEvery_.load(std::memory_order_relaxed)) != 0) {
+            detail::increase(&buffer->dropped);
+            return;
+        }
+    }
+
+    char *p = buffer->data.get() + offset;
+    if (padding > 0) {
+        if (padding >= detail::kRecordHeader) {
+            ::memcpy(p + sizeof(int64_t), &detail::kSkipRecord, sizeof detail::kSkipRecord);
+        }
+        p = buffer->data.get();
+    }
+    int64_t now = detail::coarseMicroseconds();
+    int32_t length = len;
+    ::memcpy(p, &now, sizeof now);
+    ::memcpy(p + sizeof now, &length, sizeof length);
+    ::memcpy(p + detail::kRecordHeader, logline, static_cast<size_t>(len));
+    buffer->writeIndex.store(writeEnd, std::memory_order_release);
+
+    uint64_t used = writeEnd - buffer->cachedReadIndex;
+    if (used > capacity / 2 && used - (writeEnd - write) <= capacity / 2) {
+        wakeup();
+    }
+}
+
+bool AsyncLogging::makeRoom(ThreadBuffer *buffer, uint64_t write, uint64_t writeEnd) {
+    switch (policy_.load(std::memory_order_relaxed)) {
+        case kBlock:
+            detail::increase(&buffer->waits);
+            return waitForSpace(buffer, writeEnd);
+        case kDropOldest:
+            return evictOldest(buffer, write, writeEnd);
+        default:
+            wakeup();
+            return false;
+    }
+}
+
+/*
+ *      线程第一次写日志时创建ThreadBuffer并登记，只有这时才加锁。
+ *      设置了内存上限时给共用的环留出位置，再放不下一个环时，之后的线程都写共用的环
+ */
+AsyncLogging::ThreadBuffer *AsyncLogging::threadBuffer() {
+    ThreadBufferHolder &holder = holders_.value();
+    if (holder.buffer == nullptr) {
+        MutexLockGuard lock(mutex_);
+        size_t reserved = sharedBuffer_ ? 0 : threadBufferSize_;
+        if (maxMemory_ == 0 || memoryBytes_ + threadBufferSize_ + reserved <= maxMemory_) {
+            ThreadBufferPtr buffer = std::make_shared<ThreadBuffer>(threadBufferSize_, false);
+            holder.buffer = buffer.get();
+            holder.weakBuffer = buffer;
+            threadBuffers_.push_back(buffer);
+            memoryBytes_ += threadBufferSize_;
+            ++bufferAllocations_;
+        } else {
+            if (!sharedBuffer_) {
+                sharedBuffer_ = std::make_shared<ThreadBuffer>(threadBufferSize_, true);
+                threadBuffers_.push_back(sharedBuffer_);
+                memoryBytes_ += threadBufferSize_;
+                ++bufferAllocations_;
             }
+            holder.buffer = sharedBuffer_.get();
         }
+    }
+    return holder.buffer;
+}
 
-        /// ------------------------ 将日志写入文件，重置备用两个buffer -------------------------
+bool AsyncLogging::waitForSpace(ThreadBuffer *buffer, uint64_t writeEnd) {
+    int spins = 0;
+    while (writeEnd - buffer->cachedReadIndex > buffer->capacity) {
+        if (!running_) {
+            return false;
+        }
+        wakeup();
+        if (++spins < 16) {
+            ::sched_yield();
+        } else {
+            struct timespec ts = {0, 100 * 1000};
+            ::nanosleep(&ts, NULL);
+        }
+        buffer->cachedReadIndex = buffer->readIndex.load(std::memory_order_acquire);
+    }
+    return true;
+}
 
-        assert(!buffersToWrite.empty());
+/*
+ *      从headIndex开始跳过最旧的记录，直到放得下新的记录。
+ *      后端正在写这个环的记录（readIndex != headIndex）或者抢先取走了记录（CAS失败）时不能动，丢掉新的这条
+ */
+bool AsyncLogging::evictOldest(ThreadBuffer *buffer, uint64_t write, uint64_t writeEnd) {
+    const uint64_t capacity = buffer->capacity;
+    uint64_t head = buffer->headIndex.load(std::memory_order_acquire);
+    if (buffer->readIndex.load(std::memory_order_acquire) != head) {
+        wakeup();
+        return false;
+    }
+    uint64_t newHead = head;
+    int64_t evicted = 0;
+    while (writeEnd - newHead > capacity && newHead != write) {
+        uint64_t offset = newHead & (capacity - 1);
+        int32_t len = detail::kSkipRecord;
+        if (capacity - offset >= detail::kRecordHeader) {
+            ::memcpy(&len, buffer->data.get() + offset + sizeof(int64_t), sizeof len);
+        }
+        if (len == detail::kSkipRecord) {
+            newHead += capacity - offset;
+        } else {
+            newHead += detail::kRecordHeader + static_cast<uint64_t>(len);
+            ++evicted;
+        }
+    }
+    if (!buffer->headIndex.compare_exchange_strong(head, newHead, std::memory_order_acq_rel)) {
+        return false;
+    }
+    // CAS之后后端可能已经取走[newHead, writeIndex)并归还了readIndex，这时不能把它退回newHead
+    uint64_t read = head;
+    if (buffer->readIndex.compare_exchange_strong(read, newHead, std::memory_order_acq_rel)) {
+        read = newHead;
+    }
+    buffer->cachedReadIndex = read;
+    detail::increase(&buffer->dropped, evicted);
+    wakeup();
+    return true;
+}
 
-        /*
-         *      如果buffer过多了，那么判定很可能出现了异常（前端死循环不断发送日志）
-         *      这里的处理方法是直接丢弃这些日志（只保留前两个）
-         */
-        if (buffersToWrite.size() > 25) {
-            char buf[256];
-            snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
-                     Timestamp::now().toFormattedString().c_str(),
-                     buffersToWrite.size() - 2);
-            fputs(buf, stderr);
-            output.append(buf, static_cast<int>(strlen(buf)));
-            buffersToWrite.erase(buffersToWrite.begin() + 2, buffersToWrite.end());
+/*
+ *      wakeupPending_避免每次都加锁；notify在锁内，后端检查wakeupPending_和开始等待之间不会漏掉唤醒
+ */
+void AsyncLogging::wakeup() {
+    if (!wakeupPending_.exchange(true)) {
+        MutexLockGuard lock(mutex_);
+        cond_.notify();
+    }
+}
+
+/*
+ *      k路归并：每个ThreadBuffer中的记录已经按时间排好，用小顶堆每次取时间最早的一条。
+ *      时间只精确到一个tick，同一个tick内不同线程的日志顺序不确定
+ *
+ *      记录不拷贝，直接指向ThreadBuffer，攒够一批（kBatchRecords条或者kBatchBytes字节）用一次writev()写入，
+ *      写完之后才归还这一批占用的空间。还原成文本时一批是一段连续的文本
+ */
+void AsyncLogging::drain(const std::vector<ThreadBufferPtr> &buffers, LogFile *output, BinaryLogDecoder *decoder) {
+    struct Cursor {
+        ThreadBuffer *buffer;
+        uint64_t read;
+        uint64_t end;
+        uint64_t released;      // 已经归还到readIndex的位置
+    };
+    typedef std::pair<int64_t, size_t> HeapEntry;      // (时间, cursor下标)
+
+    // 跳过环末尾的跳过标记，返回指向记录的指针
+    auto recordAt = [](Cursor *cursor) -> const char * {
+        uint64_t capacity = cursor->buffer->capacity;
+        uint64_t offset = cursor->read & (capacity - 1);
+        const char *p = cursor->buffer->data.get() + offset;
+        int32_t len = detail::kSkipRecord;
+        if (capacity - offset >= detail::kRecordHeader) {
+            ::memcpy(&len, p + sizeof(int64_t), sizeof len);
+        }
+        if (len == detail::kSkipRecord) {
+            cursor->read += capacity - offset;
+            p = cursor->buffer->data.get();
         }
+        return p;
+    };
 
-        for (const auto &buffer: buffersToWrite) {
-            // FIXME: use unbuffered stdio FILE ? or use ::writev ?
-            output.append(buffer->data(), buffer->length());
+    string text;
+    std::vector<struct iovec> batch;
+    size_t batchRecords = 0;
+    size_t batchBytes = 0;
+    std::vector<Cursor> cursors;
+    cursors.reserve(buffers.size());
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    for (const ThreadBufferPtr &buffer : buffers) {
+        // 取得[head, end)；kDropOldest的前端同时在丢弃最旧的记录时重新读取
+        uint64_t head;
+        uint64_t end;
+        do {
+            head = buffer->headIndex.load(std::memory_order_acquire);
+            end = buffer->writeIndex.load(std::memory_order_acquire);
+        } while (head != end && !buffer->headIndex.compare_exchange_weak(head, end, std::memory_order_acq_rel));
+        Cursor cursor = {buffer.get(), head, end, head};
+        if (cursor.read != cursor.end) {
+            int64_t time;
+            ::memcpy(&time, recordAt(&cursor), sizeof time);
+            heap.push(HeapEntry(time, cursors.size()));
+            cursors.push_back(cursor);
         }
+    }
 
-        if (buffersToWrite.size() > 2) {
-            // drop non-bzero-ed buffers, avoid trashing
-            buffersToWrite.resize(2);
+    auto writeBatch = [&]() {
+        int64_t start = detail::monotonicMicroseconds();
+        if (decoder) {
+            struct iovec iov = {&text[0], text.size()};
+            bytesWritten_.fetch_add(static_cast<int64_t>(text.size()), std::memory_order_relaxed);
+            output->append(&iov, 1);
+            text.clear();
+        } else {
+            bytesWritten_.fetch_add(static_cast<int64_t>(batchBytes), std::memory_order_relaxed);
+            output->append(batch.data(), static_cast<int>(batch.size()));
+            batch.clear();
         }
+        int64_t micros = detail::monotonicMicroseconds() - start;
+        linesWritten_.fetch_add(static_cast<int64_t>(batchRecords), std::memory_order_relaxed);
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        writeMicros_.fetch_add(micros, std::memory_order_relaxed);
+        if (micros > maxWriteMicros_.load(std::memory_order_relaxed)) {
+            maxWriteMicros_.store(micros, std::memory_order_relaxed);
+        }
+        batchRecords = 0;
+        batchBytes = 0;
+        // 已经归还完的环不再写readIndex，kDropOldest的前端可能已经推进了它
+        for (Cursor &cursor : cursors) {
+            if (cursor.released != cursor.read) {
+                cursor.buffer->readIndex.store(cursor.read, std::memory_order_release);
+                cursor.released = cursor.read;
+            }
+        }
+    };
 
-        if (!newBuffer1) {
-            assert(!buffersToWrite.empty());
-            newBuffer1 = std::move(buffersToWrite.back());
-            buffersToWrite.pop_back();
-            newBuffer1->reset();
+    while (!heap.empty()) {
+        Cursor &cursor = cursors[heap.top().second];
+        heap.pop();
+        const char *p = recordAt(&cursor);
+        int32_t len;
+        ::memcpy(&len, p + sizeof(int64_t), sizeof len);
+        if (decoder) {
+            decoder->decode(p + detail::kRecordHeader, static_cast<size_t>(len), &text);
+        } else {
+            struct iovec iov = {const_cast<char *>(p) + detail::kRecordHeader, static_cast<size_t>(len)};
+            batch.push_back(iov);
         }
+        ++batchRecords;
+        batchBytes += static_cast<size_t>(len);
+        cursor.read = (cursor.read & ~(cursor.buffer->capacity - 1)) +
+                      static_cast<uint64_t>(p - cursor.buffer->data.get()) +
+                      detail::kRecordHeader + static_cast<uint64_t>(len);
+        if (cursor.read != cursor.end) {
+            int64_t time;
+            ::memcpy(&time, recordAt(&cursor), sizeof time);
+            heap.push(HeapEntry(time, static_cast<size_t>(&cursor - &cursors[0])));
+        }
+        // 攒够一批就写入并归还空间，等待中的前端可以尽早继续
+        if (batchRecords >= detail::kBatchRecords || batchBytes >= detail::kBatchBytes) {
+            writeBatch();
+        }
+    }
+    if (batchRecords > 0) {
+        writeBatch();
+    }
+}
 
-        if (!newBuffer2) {
-            assert(!buffersToWrite.empty());
-            newBuffer2 = std::move(buffersToWrite.back());
-            buffersToWrite.pop_back();
-            newBuffer2->reset();
+/*
+ *      后端线程：等待flushInterval_秒或者被前端唤醒，取走所有ThreadBuffer中的日志，
+ *      然后释放已经退出的线程的ThreadBuffer。
+ *      threadBuffers_只在登记和释放时加锁，写文件时不持有锁
+ */
+void AsyncLogging::threadFunc() {
+    assert(running_ == true);
+    latch_.countDown();
+    LogFile output(basename_, rollSize_, false, flushInterval_, 1024, compressOutput_);
+    output.setCompressor(compressor_);
+    // 调用点记录可能在别的线程的ThreadBuffer中排在后面，直接查本进程的调用点
+    std::unique_ptr<BinaryLogDecoder> decoder(decodeBinary_ ? new BinaryLogDecoder(true) : nullptr);
+    std::vector<ThreadBufferPtr> buffers;
+    while (running_) {
+        {
+            MutexLockGuard lock(mutex_);
+            if (!wakeupPending_) {
+                cond_.waitForSeconds(flushInterval_);
+            }
+            wakeupPending_ = false;
+            buffers = threadBuffers_;
         }
 
-        buffersToWrite.clear();
+        drain(buffers, &output, decoder.get());
         output.flush();
+
+        // 先看abandoned再看下标：线程退出前写入的记录一定已经取走
+        MutexLockGuard lock(mutex_);
+        for (size_t i = 0; i < threadBuffers_.size();) {
+            ThreadBuffer *buffer = threadBuffers_[i].get();
+            if (buffer->abandoned.load(std::memory_order_acquire) &&
+                buffer->readIndex.load(std::memory_order_relaxed) ==
+                buffer->writeIndex.load(std::memory_order_acquire)) {
+                memoryBytes_ -= static_cast<size_t>(buffer->capacity);
+                retiredDropped_ += buffer->dropped.load(std::memory_order_relaxed);
+                retiredWaits_ += buffer->waits.load(std::memory_order_relaxed);
+                threadBuffers_[i] = threadBuffers_.back();
+                threadBuffers_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        buffers.clear();
+    }
+
+    {
+        MutexLockGuard lock(mutex_);
+        buffers = threadBuffers_;
     }
+    drain(buffers, &output, decoder.get());
     output.flush();
-}
\ No newline at end of file
+}
@@ -5,14 +5,14 @@
 #ifndef MYMUDUO_ASYNCLOGGING_H
 #define MYMUDUO_ASYNCLOGGING_H
 
-#include "BlockingQueue.h"
-#include "BoundedBlockingQueue.h"
+#include "Condition.h"
 #include "CountDownLatch.h"
 #include "Mutex.h"
 #include "Thread.h"
-#include "LogStream.h"
+#include "ThreadLocal.h"
 
 #include <atomic>
+#include <memory>
 #include <vector>
 
 /*
@@ -23,16 +23,60 @@
  *
  *      2. 前端调用  AsyncLogging::append() 添加日志即可（准确来说是发送一条日志消息），而不用关心后端如何、何时写入文件。
  *      3. 后端则由线程函数 AsyncLogging::threadFunc() 将前端buffers转移到后端buffers，然后写入文件。
+ *
+ *      4. 前端不再共用一把锁：每个线程第一次append()时得到自己的ThreadBuffer，
+ *         这是一个单生产者单消费者的环形缓冲区，前端写、后端读，只通过两个原子的下标同步。
+ *         每条日志前面记录一个粗粒度的单调时间，后端按时间把各个线程的日志做k路归并，大致按时间顺序写入文件。
+ *      5. 后端每flushInterval_秒、或者有线程的ThreadBuffer超过一半时被唤醒，取走所有已经写入的日志，
+ *         不需要等ThreadBuffer写满。
+ *      6. ThreadBuffer满了时按溢出策略处理（setOverflowPolicy）：
+ *         kBlock       唤醒后端并等待腾出空间，不会丢日志；后端没有运行时丢弃这条日志（默认）
+ *         kDropNewest  丢弃这条日志，前端从不等待
+ *         kDropOldest  丢弃环中还没有被后端取走的最旧的日志；后端正在写这个环时丢弃这条日志
+ *         kSample      超过3/4时只保留每sampleEvery条中的一条，满了时丢弃这条日志
+ *         线程退出后它的ThreadBuffer在取空后释放。setMaxMemory限制ThreadBuffer占用的内存，
+ *         达到上限后新的线程共用一个加锁的ThreadBuffer。
+ *      7. 日志是二进制记录（Logger::setBinary）时，可以由后端线程还原成文本再写入文件（setDecodeBinary），
+ *         这样格式化的开销从前端移到了后端；否则原样写入，由logdecode离线还原。
+ *      8. 日志文件可以由LogCompressor在滚动后压缩（setCompressor），或者直接写成gzip流（setCompressOutput），
+ *         见LogFile。
+ *      9. stats()返回写入、丢弃的行数，分配的内存和后端写文件的耗时，可以在运行时读取。
  */
 
 namespace muduo {
 
+    class BinaryLogDecoder;
+    class LogCompressor;
+    class LogFile;
+
     class AsyncLogging : noncopyable {
     public:
-
+        static const size_t kDefaultThreadBufferSize = 1024 * 1024;
+
+        enum OverflowPolicy {
+            kBlock,
+            kDropNewest,
+            kDropOldest,
+            kSample,
+        };
+
+        struct Stats {
+            int64_t linesWritten;       // 写入文件的日志条数
+            int64_t bytesWritten;
+            int64_t linesDropped;       // 按溢出策略丢弃的日志条数
+            int64_t producerWaits;      // kBlock时前端等待腾出空间的次数
+            int64_t bufferAllocations;  // 分配ThreadBuffer的次数
+            int64_t memoryBytes;        // ThreadBuffer当前占用的内存
+            int64_t writes;             // 后端写文件的次数
+            int64_t writeMicros;        // 写文件的总耗时
+            int64_t maxWriteMicros;
+        };
+
+        /// threadBufferSize is rounded up to a power of two, at least 64KB.
         AsyncLogging(const string &basename,
                      off_t rollSize,
-                     int flushInterval = 3);
+                     int flushInterval = 3,
+                     size_t threadBufferSize = kDefaultThreadBufferSize);
 
         ~AsyncLogging() {
             if (running_) {
@@ -40,40 +84,97 @@ namespace muduo {
             }
         }
 
+        /// Thread safe, lock free unless the thread's buffer is full or shared.
         void append(const char *logline, int len);
 
+        /// Renders binary log records as text in the backend thread. Call before start().
+        void setDecodeBinary(bool on) {
+            decodeBinary_ = on;
+        }
+
+        /// Compresses rolled files in the background, not owned. Call before start().
+        void setCompressor(LogCompressor *compressor) {
+            compressor_ = compressor;
+        }
+
+        /// Writes the log file as a gzip stream with a sync point at every flush. Call before start().
+        void setCompressOutput(bool on) {
+            compressOutput_ = on;
+        }
+
+        /// Thread safe, takes effect for the next line that finds its buffer full (or 3/4 full for kSample).
+        void setOverflowPolicy(OverflowPolicy policy, int sampleEvery = 10);
+
+        /// Caps the memory of all thread buffers, 0 for unlimited. Threads beyond the cap share one buffer.
+        /// The cap is rounded up to one buffer, which is always needed. Call before the first line is logged.
+        void setMaxMemory(size_t bytes);
+
+        /// Thread safe.
+        Stats stats() const;
+
         void start() {
             running_ = true;
             thread_.start();
             latch_.wait();
         }
 
-        void stop()
-        {
-            running_ = false;
-            cond_.notify();
-            thread_.join();
-        }
+        void stop();
 
     private:
+        struct ThreadBuffer;
+
+        struct ThreadBufferHolder;
+
+        typedef std::shared_ptr<ThreadBuffer> ThreadBufferPtr;
 
         void threadFunc();
 
-        typedef muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer> Buffer;
-        typedef std::vector<std::unique_ptr<Buffer>> BufferVector;
-        typedef BufferVector::value_type BufferPtr;
+        ThreadBuffer *threadBuffer();
+
+        void appendTo(ThreadBuffer *buffer, const char *logline, int len);
+
+        /// Applies the overflow policy, returns false if the line should be dropped.
+        bool makeRoom(ThreadBuffer *buffer, uint64_t write, uint64_t writeEnd);
+
+        /// Returns false if the backend is not running and the line should be dropped.
+        bool waitForSpace(ThreadBuffer *buffer, uint64_t writeEnd);
+
+        /// Returns false if the backend holds records of this buffer and the line should be dropped.
+        bool evictOldest(ThreadBuffer *buffer, uint64_t write, uint64_t writeEnd);
+
+        void wakeup();
+
+        /// Writes everything appended so far, merged by time.
+        void drain(const std::vector<ThreadBufferPtr> &buffers, LogFile *output, BinaryLogDecoder *decoder);
 
         const int flushInterval_;
         std::atomic<bool> running_;
         const string basename_;
         const off_t rollSize_;
+        const size_t threadBufferSize_;
+        bool decodeBinary_;
+        LogCompressor *compressor_;
+        bool compressOutput_;
+        std::atomic<int> policy_;
+        std::atomic<int> sampleEvery_;
+        size_t maxMemory_;                                  // guarded by mutex_
+        std::atomic<int64_t> linesWritten_;                 // 后端写，stats()读
+        std::atomic<int64_t> bytesWritten_;
+        std::atomic<int64_t> writes_;
+        std::atomic<int64_t> writeMicros_;
+        std::atomic<int64_t> maxWriteMicros_;
         muduo::Thread thread_;
         muduo::CountDownLatch latch_;
-        muduo::MutexLock mutex_;
+        mutable muduo::MutexLock mutex_;
         muduo::Condition cond_;
-        BufferPtr currentBuffer_;
-        BufferPtr nextBuffer_;
-        BufferVector buffers_;
+        std::atomic<bool> wakeupPending_;
+        std::vector<ThreadBufferPtr> threadBuffers_;        // guarded by mutex_
+        ThreadBufferPtr sharedBuffer_;                      // guarded by mutex_
+        size_t memoryBytes_;                                // guarded by mutex_
+        int64_t bufferAllocations_;                         // guarded by mutex_
+        int64_t retiredDropped_;                            // 已释放的ThreadBuffer的计数，guarded by mutex_
+        int64_t retiredWaits_;
+        muduo::ThreadLocal<ThreadBufferHolder> holders_;
     };
 
 }  // namespace muduo
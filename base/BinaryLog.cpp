@@ -0,0 +1,310 @@
+//
+// Created by chen on 2022/12/02.
+//
+
+#include "BinaryLog.h"
+#include "Logging.h"
+#include "Mutex.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+namespace muduo {
+
+    extern Logger::OutputFunc g_output;
+    extern const char *LogLevelName[Logger::NUM_LOG_LEVELS];
+    extern TimeZone g_logTimeZone;
+
+    namespace detail {
+
+        const int kSiteHeaderLen = BinaryLog::kPrefixLen + 4 + 1 + 4;
+
+        // 函数内的静态变量，全局对象的构造函数中也可以写日志
+        MutexLock &siteMutex() {
+            static MutexLock mutex;
+            return mutex;
+        }
+
+        std::vector<const LogSite *> &registeredSites() {
+            static std::vector<const LogSite *> sites;
+            return sites;
+        }
+
+        template<class T>
+        T readAs(const char *p) {
+            T value;
+            ::memcpy(&value, p, sizeof value);
+            return value;
+        }
+
+        void appendString(string *record, const char *data, size_t len) {
+            uint16_t n = static_cast<uint16_t>(len);
+            record->append(reinterpret_cast<const char *>(&n), sizeof n);
+            record->append(data, n);
+        }
+
+    }  // namespace detail
+
+}  // namespace muduo
+
+using namespace muduo;
+
+/*
+ *      加锁分配编号，保证每个调用点只输出一次调用点记录；解锁之后再交给g_output。
+ *      g_output可能阻塞：AsyncLogging的kBlock策略在环满时等后端腾出空间，
+ *      而后端还原日志记录时会调用findSite()，持有锁输出就会互相等待。
+ *      因此其它线程可能先输出这个调用点的日志记录，还原时按编号查找调用点（见BinaryLogDecoder）
+ */
+uint32_t BinaryLog::registerSite(LogSite *site) {
+    uint32_t id;
+    {
+        MutexLockGuard lock(detail::siteMutex());
+        id = site->id.load(std::memory_order_relaxed);
+        if (id != 0) {
+            return id;
+        }
+        std::vector<const LogSite *> &sites = detail::registeredSites();
+        sites.push_back(site);
+        id = static_cast<uint32_t>(sites.size());
+        site->id.store(id, std::memory_order_release);
+    }
+
+    string record(detail::kSiteHeaderLen, '\0');
+    record[0] = static_cast<char>(kSiteRecord);
+    ::memcpy(&record[kPrefixLen], &id, sizeof id);
+    record[kPrefixLen + 4] = static_cast<char>(site->level);
+    int32_t line = site->line;
+    ::memcpy(&record[kPrefixLen + 5], &line, sizeof line);
+    detail::appendString(&record, site->basename, static_cast<size_t>(site->basenameSize));
+    detail::appendString(&record, site->func ? site->func : "", site->func ? ::strlen(site->func) : 0);
+    uint16_t len = static_cast<uint16_t>(record.size());
+    ::memcpy(&record[1], &len, sizeof len);
+
+    g_output(record.data(), static_cast<int>(record.size()));
+    return id;
+}
+
+const LogSite *BinaryLog::findSite(uint32_t id) {
+    MutexLockGuard lock(detail::siteMutex());
+    const std::vector<const LogSite *> &sites = detail::registeredSites();
+    return id > 0 && id <= sites.size() ? sites[id - 1] : NULL;
+}
+
+BinaryLogDecoder::BinaryLogDecoder(bool processSites)
+        : processSites_(processSites),
+          errors_(0),
+          lastSecond_(-1) {
+    timeBuf_[0] = '\0';
+}
+
+int BinaryLogDecoder::recordLength(const char *data, size_t len) {
+    if (len < static_cast<size_t>(BinaryLog::kPrefixLen)) {
+        return 0;
+    }
+    int minLength;
+    switch (static_cast<uint8_t>(data[0])) {
+        case BinaryLog::kSiteRecord:
+            minLength = detail::kSiteHeaderLen + 4;
+            break;
+        case BinaryLog::kLogRecord:
+            minLength = BinaryLog::kLogHeaderLen;
+            break;
+        case BinaryLog::kTextRecord:
+            minLength = BinaryLog::kPrefixLen;
+            break;
+        default:
+            return -1;
+    }
+    int length = detail::readAs<uint16_t>(data + 1);
+    if (length < minLength) {
+        return -1;
+    }
+    return static_cast<size_t>(length) <= len ? length : 0;
+}
+
+size_t BinaryLogDecoder::decode(const char *data, size_t len, string *text) {
+    size_t pos = 0;
+    while (pos < len) {
+        int n = recordLength(data + pos, len - pos);
+        if (n == 0) {
+            break;
+        } else if (n < 0) {
+            ++errors_;
+            ++pos;
+            continue;
+        }
+        const char *record = data + pos;
+        switch (static_cast<uint8_t>(record[0])) {
+            case BinaryLog::kSiteRecord:
+                addSite(record, n);
+                break;
+            case BinaryLog::kLogRecord:
+                renderLog(record, n, text);
+                break;
+            default:
+                text->append(record + BinaryLog::kPrefixLen, static_cast<size_t>(n - BinaryLog::kPrefixLen));
+                break;
+        }
+        pos += static_cast<size_t>(n);
+    }
+    return pos;
+}
+
+size_t BinaryLogDecoder::scanSites(const char *data, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        int n = recordLength(data + pos, len - pos);
+        if (n == 0) {
+            break;
+        } else if (n < 0) {
+            ++pos;
+            continue;
+        }
+        if (static_cast<uint8_t>(data[pos]) == BinaryLog::kSiteRecord) {
+            addSite(data + pos, n);
+        }
+        pos += static_cast<size_t>(n);
+    }
+    return pos;
+}
+
+/*
+ *      | 0xB7 | len 2 | id 4 | level 1 | line 4 | fileLen 2 | file | funcLen 2 | func |
+ */
+void BinaryLogDecoder::addSite(const char *record, int len) {
+    const char *p = record + BinaryLog::kPrefixLen;
+    const char *end = record + len;
+    uint32_t id = detail::readAs<uint32_t>(p);
+    Site site;
+    site.level = static_cast<uint8_t>(p[4]);
+    site.line = detail::readAs<int32_t>(p + 5);
+    p += 9;
+    for (string *field : {&site.file, &site.func}) {
+        if (end - p < 2 || end - p - 2 < detail::readAs<uint16_t>(p)) {
+            ++errors_;
+            return;
+        }
+        uint16_t n = detail::readAs<uint16_t>(p);
+        field->assign(p + 2, n);
+        p += 2 + n;
+    }
+    if (site.level >= Logger::NUM_LOG_LEVELS) {
+        ++errors_;
+        return;
+    }
+    sites_[id] = site;
+}
+
+const BinaryLogDecoder::Site *BinaryLogDecoder::findSite(uint32_t id) {
+    std::unordered_map<uint32_t, Site>::const_iterator it = sites_.find(id);
+    if (it != sites_.end()) {
+        return &it->second;
+    }
+    const LogSite *logSite = processSites_ ? BinaryLog::findSite(id) : NULL;
+    if (logSite == NULL) {
+        return NULL;
+    }
+    Site &site = sites_[id];
+    site.file.assign(logSite->basename, static_cast<size_t>(logSite->basenameSize));
+    site.line = logSite->line;
+    site.level = logSite->level;
+    site.func = logSite->func ? logSite->func : "";
+    return &site;
+}
+
+/*
+ *      和Logger::Impl的文本格式相同：日期 时间.微秒 线程 级别 [errno] [函数名] 正文 - 源文件名:行号
+ */
+void BinaryLogDecoder::renderLog(const char *record, int len, string *text) {
+    const char *p = record + BinaryLog::kPrefixLen;
+    const char *end = record + len;
+    uint32_t id = detail::readAs<uint32_t>(p);
+    int64_t microSecondsSinceEpoch = detail::readAs<int64_t>(p + 4);
+    int32_t tid = detail::readAs<int32_t>(p + 12);
+    int32_t savedErrno = detail::readAs<int32_t>(p + 16);
+    p += 20;
+
+    const Site *site = findSite(id);
+    if (site == NULL) {
+        ++errors_;
+    }
+
+    int64_t seconds = microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond;
+    int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+    if (seconds != lastSecond_) {
+        lastSecond_ = seconds;
+        time_t t = static_cast<time_t>(seconds);
+        struct tm tm_time;
+        if (g_logTimeZone.valid()) {
+            tm_time = g_logTimeZone.toLocalTime(t);
+        } else {
+            ::gmtime_r(&t, &tm_time);
+        }
+        snprintf(timeBuf_, sizeof timeBuf_, "%4d%02d%02d %02d:%02d:%02d",
+                 tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                 tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    }
+
+    LogStream stream;
+    stream << timeBuf_ << Fmt(g_logTimeZone.valid() ? ".%06d " : ".%06dZ ", microseconds);
+    stream << Fmt("%5d ", tid) << (site ? LogLevelName[site->level] : "?     ");
+    if (savedErrno != 0) {
+        stream << strerror_tl(savedErrno) << " (errno=" << savedErrno << ") ";
+    }
+    if (site && !site->func.empty()) {
+        stream << site->func << ' ';
+    }
+
+    // 参数：| 类型 1 | 值 |
+    while (p < end) {
+        char type = *p++;
+        size_t remain = static_cast<size_t>(end - p);
+        size_t size = type == BinaryLog::kChar || type == BinaryLog::kBool ? 1 : 8;
+        if (type == BinaryLog::kFloat) {
+            size = 4;
+        } else if (type == BinaryLog::kString) {
+            size = remain >= 2 ? 2 + detail::readAs<uint16_t>(p) : 2;
+        }
+        if (type < BinaryLog::kInt || type > BinaryLog::kFloat || size > remain) {
+            ++errors_;
+            break;
+        }
+        switch (type) {
+            case BinaryLog::kInt:
+                stream << detail::readAs<int64_t>(p);
+                break;
+            case BinaryLog::kUInt:
+                stream << detail::readAs<uint64_t>(p);
+                break;
+            case BinaryLog::kDouble:
+                stream << detail::readAs<double>(p);
+                break;
+            case BinaryLog::kFloat:
+                stream << detail::readAs<float>(p);
+                break;
+            case BinaryLog::kChar:
+                stream << *p;
+                break;
+            case BinaryLog::kBool:
+                stream << (*p != 0);
+                break;
+            case BinaryLog::kPointer:
+                stream << reinterpret_cast<const void *>(static_cast<uintptr_t>(detail::readAs<uint64_t>(p)));
+                break;
+            case BinaryLog::kString:
+                stream.append(p + 2, static_cast<int>(size - 2));
+                break;
+        }
+        p += size;
+    }
+
+    if (site) {
+        stream << " - " << site->file << ":" << site->line << "\n";
+    } else {
+        stream << " - site " << id << "\n";
+    }
+    text->append(stream.buffer().data(), static_cast<size_t>(stream.buffer().length()));
+}
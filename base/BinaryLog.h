@@ -0,0 +1,109 @@
+//
+// Created by chen on 2022/12/02.
+//
+
+/*
+ *      二进制日志：前端不格式化，只拷贝调用点的编号和参数的原始字节，由后端线程或者离线工具还原成文本
+ *
+ *      1. 每个LOG_*调用点有一个静态的LogSite（文件名、行号、级别、函数名），第一次以二进制输出时分配编号，
+ *         并输出一条调用点记录。之后的日志记录只包含编号。
+ *         其它线程的日志记录可能排在调用点记录前面，还原时先收集调用点（logdecode扫描两遍，后端从本进程查找）
+ *      2. 记录格式（本机字节序），每条记录以类型和总长度开头：
+ *         调用点记录 | 0xB7 | len 2 | id 4 | level 1 | line 4 | fileLen 2 | file | funcLen 2 | func |
+ *         日志记录   | 0xB8 | len 2 | id 4 | time 8 | tid 4 | errno 4 | 参数... |
+ *         文本记录   | 0xB9 | len 2 | 已经格式化的一行 |         （没有调用点的Logger，例如CHECK_NOTNULL）
+ *         参数：| 类型 1 | int64 / uint64 / double / 指针 8字节，float 4字节，char / bool 1字节，字符串 len 2 + 字节 |
+ *      3. 时间不格式化，整数、浮点数不转换成字符串。还原时用LogStream格式化，和文本模式的输出一样。
+ *      4. 日志文件滚动后，新文件中没有之前的调用点记录，离线还原时要按顺序给出同一个进程的所有文件。
+ */
+
+#ifndef MYMUDUO_BINARYLOG_H
+#define MYMUDUO_BINARYLOG_H
+
+#include "noncopyable.h"
+#include "Types.h"
+
+#include <stdint.h>
+
+#include <unordered_map>
+
+namespace muduo {
+
+    struct LogSite;
+
+    namespace BinaryLog {
+
+        enum RecordType {
+            kSiteRecord = 0xB7,
+            kLogRecord = 0xB8,
+            kTextRecord = 0xB9,
+        };
+
+        enum ArgType {
+            kInt = 1,
+            kUInt,
+            kDouble,
+            kChar,
+            kBool,
+            kPointer,
+            kString,
+            kFloat,
+        };
+
+        const int kPrefixLen = 3;                               // 类型 + 总长度
+        const int kLogHeaderLen = kPrefixLen + 4 + 8 + 4 + 4;
+
+        /// Assigns an id to site and outputs its site record, once per site.
+        uint32_t registerSite(LogSite *site);
+
+        /// Sites registered in this process, NULL if unknown.
+        const LogSite *findSite(uint32_t id);
+
+    }  // namespace BinaryLog
+
+    ///
+    /// Renders binary log records as the same text lines Logger writes in text mode.
+    ///
+    class BinaryLogDecoder : noncopyable {
+    public:
+        /// With processSites, unknown ids are looked up in this process,
+        /// so AsyncLogging's backend doesn't depend on the order of site records.
+        explicit BinaryLogDecoder(bool processSites = false);
+
+        /// Decodes the complete records at the front of [data, data + len),
+        /// appends the text and returns the bytes consumed. Garbage is skipped byte by byte.
+        size_t decode(const char *data, size_t len, string *text);
+
+        /// Only collects site records, for a first pass over the files.
+        size_t scanSites(const char *data, size_t len);
+
+        /// Skipped bytes and records with unknown sites.
+        int64_t errors() const { return errors_; }
+
+    private:
+        struct Site {
+            string file;
+            int line;
+            int level;
+            string func;
+        };
+
+        /// Returns the record length, 0 if incomplete, -1 if not a record.
+        static int recordLength(const char *data, size_t len);
+
+        void addSite(const char *record, int len);
+
+        const Site *findSite(uint32_t id);
+
+        void renderLog(const char *record, int len, string *text);
+
+        const bool processSites_;
+        std::unordered_map<uint32_t, Site> sites_;
+        int64_t errors_;
+        int64_t lastSecond_;
+        char timeBuf_[64];
+    };
+
+}  // namespace muduo
+
+#endif //MYMUDUO_BINARYLOG_H
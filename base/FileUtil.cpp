@@ -3,55 +3,180 @@
 //
 
 #include "FileUtil.h"
+#include "LogCompressor.h"
 #include "Logging.h"
 
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 using namespace muduo;
 
-FileUtil::AppendFile::AppendFile(StringArg filename)
-        : fp_(::fopen(filename.c_str(), "ae")),  // 'e' for O_CLOEXEC
+FileUtil::AppendFile::AppendFile(StringArg filename, off_t preallocateChunk, bool compress)
+        : fd_(::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)),
+          gzip_(compress ? new GzipEncoder : nullptr),
+          preallocateChunk_(preallocateChunk),
+          fileSize_(0),
+          allocatedEnd_(0),
+          buffered_(0),
           writtenBytes_(0) {
-    assert(fp_);
-    ::setbuffer(fp_, buffer_, sizeof buffer_);
+    assert(fd_ >= 0);
+    if (gzip_ && !gzip_->valid()) {
+        gzip_.reset();
+    }
+    struct stat statbuf;
+    if (::fstat(fd_, &statbuf) == 0) {
+        fileSize_ = statbuf.st_size;
+        allocatedEnd_ = fileSize_;
+    }
+    preallocate();
     // posix_fadvise POSIX_FADV_DONTNEED ?
 }
 
 FileUtil::AppendFile::~AppendFile() {
-    ::fclose(fp_);
+    flush();
+    if (gzip_) {
+        gzip_->finish();
+        writeCompressed(NULL, 0, false);
+    }
+    if (allocatedEnd_ > fileSize_) {
+        ::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, fileSize_, allocatedEnd_ - fileSize_);
+    }
+    ::close(fd_);
 }
 
 void FileUtil::AppendFile::append(const char *logline, const size_t len) {
-    size_t written = 0;
-
-    while (written != len) {
-        size_t remain = len - written;
-        size_t n = write(logline + written, remain);
-        if (n != remain) {
-            int err = ferror(fp_);
-            if (err) {
-                fprintf(stderr, "AppendFile::append() failed %s\n", strerror_tl(err));
-                break;
-            }
-        }
-        written += n;
+    if (len <= sizeof buffer_ - buffered_) {
+        ::memcpy(buffer_ + buffered_, logline, len);
+        buffered_ += len;
+        writtenBytes_ += static_cast<off_t>(len);
+    } else {
+        struct iovec iov;
+        iov.iov_base = const_cast<char *>(logline);
+        iov.iov_len = len;
+        append(&iov, 1);
     }
+}
 
-    writtenBytes_ += written;
+void FileUtil::AppendFile::append(const struct iovec *iov, int iovcnt) {
+    if (gzip_) {
+        writeCompressed(iov, iovcnt, false);
+        return;
+    }
+    // 第一块是缓冲中的数据，每次最多IOV_MAX块
+    struct iovec vec[IOV_MAX];
+    int n = 0;
+    if (buffered_ > 0) {
+        vec[n].iov_base = buffer_;
+        vec[n].iov_len = buffered_;
+        ++n;
+    }
+    for (int i = 0; i < iovcnt; ++i) {
+        if (n == IOV_MAX) {
+            writeAll(vec, n);
+            n = 0;
+        }
+        vec[n++] = iov[i];
+        writtenBytes_ += static_cast<off_t>(iov[i].iov_len);
+    }
+    writeAll(vec, n);
+    buffered_ = 0;
 }
 
 void FileUtil::AppendFile::flush() {
-    ::fflush(fp_);
+    if (gzip_) {
+        writeCompressed(NULL, 0, true);
+    } else if (buffered_ > 0) {
+        struct iovec iov;
+        iov.iov_base = buffer_;
+        iov.iov_len = buffered_;
+        writeAll(&iov, 1);
+        buffered_ = 0;
+    }
+}
+
+void FileUtil::AppendFile::sync() {
+    ::fdatasync(fd_);
 }
 
-size_t FileUtil::AppendFile::write(const char *logline, size_t len) {
-    // #undef fwrite_unlocked
-    return ::fwrite_unlocked(logline, 1, len, fp_);
+void FileUtil::AppendFile::writeCompressed(const struct iovec *iov, int iovcnt, bool syncFlush) {
+    gzip_->append(buffer_, buffered_);
+    buffered_ = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        gzip_->append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        writtenBytes_ += static_cast<off_t>(iov[i].iov_len);
+    }
+    if (syncFlush) {
+        gzip_->flush();
+    }
+    string *output = gzip_->output();
+    if (!output->empty()) {
+        struct iovec vec;
+        vec.iov_base = &(*output)[0];
+        vec.iov_len = output->size();
+        writeAll(&vec, 1);
+        output->clear();
+    }
+}
+
+/*
+ *      处理writev()只写了一部分的情况（会修改iov），出错时放弃剩下的数据
+ */
+void FileUtil::AppendFile::writeAll(struct iovec *iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += iov[i].iov_len;
+    }
+    if (fileSize_ + static_cast<off_t>(total) > allocatedEnd_) {
+        preallocate();
+    }
+
+    struct iovec *p = iov;
+    int count = iovcnt;
+    while (count > 0) {
+        ssize_t n = ::writev(fd_, p, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "AppendFile::append() failed %s\n", strerror_tl(errno));
+            break;
+        }
+        fileSize_ += n;
+        size_t written = static_cast<size_t>(n);
+        while (count > 0 && written >= p->iov_len) {
+            written -= p->iov_len;
+            ++p;
+            --count;
+        }
+        if (count > 0) {
+            p->iov_base = static_cast<char *>(p->iov_base) + written;
+            p->iov_len -= written;
+        }
+    }
+}
+
+/*
+ *      分配到当前位置之后一整块。文件系统不支持时（EOPNOTSUPP）不再尝试
+ */
+void FileUtil::AppendFile::preallocate() {
+    if (preallocateChunk_ <= 0 || allocatedEnd_ < 0) {
+        return;
+    }
+    off_t offset = std::max(fileSize_, allocatedEnd_);
+    if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, offset, preallocateChunk_) == 0) {
+        allocatedEnd_ = offset + preallocateChunk_;
+    } else {
+        allocatedEnd_ = -1;
+    }
 }
 
 // O_CLOEXEC 调用exec时关闭此fd
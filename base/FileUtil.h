@@ -9,7 +9,14 @@
 #include "StringPiece.h"
 #include <sys/types.h>  // for off_t
 
+#include <memory>
+
+struct iovec;
+
 namespace muduo {
+
+    class GzipEncoder;
+
     namespace FileUtil {
 
         // read small file < 64KB
@@ -71,28 +78,49 @@ namespace muduo {
         /*
          *      将日志行追加到文件尾
          *      logline不一定是一行日志，而是整个buffer。
-         *      AsyncLogging调用的是：output.append(buffer->data(), buffer->length());       output是LogFile类型，buffer是FixedBuffer类型
+         *      AsyncLogging调用的是：output.append(iov, iovcnt)，一批日志记录用一次writev()写入
          *
+         *      1. 不用stdio：append(logline, len)先拷贝到自己的64KB缓冲，写入时缓冲和iov一起交给writev()
+         *      2. preallocateChunk > 0时，用fallocate(FALLOC_FL_KEEP_SIZE)按块预先分配磁盘空间，
+         *         写入时不用再分配块，文件大小不变，tail -f看不到多余的0。关闭时释放文件末尾之后多分配的块
+         *      3. sync()只使用fd，可以在别的线程中调用
+         *      4. compress为true时写入的是gzip流，每次flush()是一个同步点，writtenBytes()仍然是压缩前的字节数
          */
         class AppendFile : noncopyable {
         public:
-            explicit AppendFile(StringArg filename);
+            explicit AppendFile(StringArg filename, off_t preallocateChunk = 0, bool compress = false);
 
             ~AppendFile();
 
             void append(const char *logline, size_t len);
 
+            /// Writes the buffered data and iov with one writev(), iovcnt may exceed IOV_MAX.
+            void append(const struct iovec *iov, int iovcnt);
+
+            /// Writes the buffered data to the kernel.
             void flush();
 
+            /// fdatasync(), thread safe.
+            void sync();
+
             off_t writtenBytes() const { return writtenBytes_; }
 
         private:
+            void writeAll(struct iovec *iov, int iovcnt);
+
+            void preallocate();
 
-            size_t write(const char *logline, size_t len);
+            // 把缓冲和iov交给gzip_，写入压缩后的数据
+            void writeCompressed(const struct iovec *iov, int iovcnt, bool syncFlush);
 
-            FILE *fp_;
+            const int fd_;
+            std::unique_ptr<GzipEncoder> gzip_;
+            const off_t preallocateChunk_;
+            off_t fileSize_;            // 文件原有的大小 + 写入的字节数
+            off_t allocatedEnd_;        // fallocate()分配到的位置
+            size_t buffered_;
+            off_t writtenBytes_;        // 包括还在缓冲中的
             char buffer_[64 * 1024];
-            off_t writtenBytes_;
         };
 
     }  // namespace FileUtil
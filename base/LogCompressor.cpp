@@ -0,0 +1,297 @@
+//
+// Created by chen on 2022/12/06.
+//
+
+#include "LogCompressor.h"
+#include "CurrentThread.h"
+#include "Logging.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+
+#ifdef MUDUO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace muduo;
+
+namespace muduo {
+    namespace detail {
+
+        const size_t kReadSize = 64 * 1024;
+
+        // linux/ioprio.h
+        const int kIoprioWhoProcess = 1;
+        const int kIoprioClassIdle = 3;
+        const int kIoprioClassShift = 13;
+
+        /*
+         *      把当前线程的CPU和IO优先级降到最低，失败时照常压缩
+         */
+        void lowerPriority() {
+            ::setpriority(PRIO_PROCESS, static_cast<id_t>(CurrentThread::tid()), 19);
+            ::syscall(SYS_ioprio_set, kIoprioWhoProcess, CurrentThread::tid(),
+                      kIoprioClassIdle << kIoprioClassShift);
+        }
+
+        bool writeAll(int fd, const char *data, size_t len) {
+            while (len > 0) {
+                ssize_t n = ::write(fd, data, len);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += n;
+                len -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+    }  // namespace detail
+}  // namespace muduo
+
+#ifdef MUDUO_HAVE_ZLIB
+
+struct GzipEncoder::Impl {
+    z_stream stream;
+};
+
+GzipEncoder::GzipEncoder(int level)
+        : impl_(new Impl) {
+    ::memset(&impl_->stream, 0, sizeof impl_->stream);
+    // 15 + 16：32KB窗口，gzip格式
+    if (deflateInit2(&impl_->stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        impl_.reset();
+    }
+}
+
+GzipEncoder::~GzipEncoder() {
+    if (impl_) {
+        deflateEnd(&impl_->stream);
+    }
+}
+
+void GzipEncoder::append(const char *data, size_t len) {
+    deflate(data, len, Z_NO_FLUSH);
+}
+
+void GzipEncoder::flush() {
+    deflate(NULL, 0, Z_SYNC_FLUSH);
+}
+
+void GzipEncoder::finish() {
+    deflate(NULL, 0, Z_FINISH);
+}
+
+/*
+ *      输出直接追加到output_的末尾，空间不够时扩大，直到deflate()不再填满输出
+ */
+void GzipEncoder::deflate(const char *data, size_t len, int flush) {
+    if (!impl_) {
+        return;
+    }
+    z_stream &stream = impl_->stream;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(len);
+    do {
+        size_t used = output_.size();
+        size_t avail = std::max(deflateBound(&stream, stream.avail_in), static_cast<uLong>(4096));
+        output_.resize(used + avail);
+        stream.next_out = reinterpret_cast<Bytef *>(&output_[used]);
+        stream.avail_out = static_cast<uInt>(avail);
+        ::deflate(&stream, flush);
+        output_.resize(used + avail - stream.avail_out);
+    } while (stream.avail_out == 0 || stream.avail_in > 0);
+}
+
+bool LogCompressor::available() {
+    return true;
+}
+
+#else
+
+struct GzipEncoder::Impl {
+};
+
+GzipEncoder::GzipEncoder(int level) {
+}
+
+GzipEncoder::~GzipEncoder() = default;
+
+void GzipEncoder::append(const char *data, size_t len) {
+}
+
+void GzipEncoder::flush() {
+}
+
+void GzipEncoder::finish() {
+}
+
+void GzipEncoder::deflate(const char *data, size_t len, int flush) {
+}
+
+bool LogCompressor::available() {
+    return false;
+}
+
+#endif
+
+LogCompressor::LogCompressor(size_t maxQueueSize, int64_t bytesPerSecond)
+        : maxQueueSize_(maxQueueSize),
+          bytesPerSecond_(bytesPerSecond),
+          mutex_(),
+          cond_(mutex_),
+          running_(false),
+          compressedFiles_(0),
+          thread_(std::bind(&LogCompressor::threadFunc, this), "LogCompressor") {
+}
+
+LogCompressor::~LogCompressor() {
+    if (running_) {
+        stop();
+    }
+}
+
+void LogCompressor::start() {
+    assert(!running_);
+    running_ = true;
+    thread_.start();
+}
+
+/*
+ *      不等队列中的文件，正在压缩的文件也放弃，原文件都保留
+ */
+void LogCompressor::stop() {
+    {
+        MutexLockGuard lock(mutex_);
+        running_ = false;
+        cond_.notifyAll();
+    }
+    thread_.join();
+}
+
+bool LogCompressor::compress(const string &filename) {
+    MutexLockGuard lock(mutex_);
+    if (!available() || !running_ || queue_.size() >= maxQueueSize_) {
+        return false;
+    }
+    queue_.push_back(filename);
+    cond_.notify();
+    return true;
+}
+
+int64_t LogCompressor::compressedFiles() const {
+    MutexLockGuard lock(mutex_);
+    return compressedFiles_;
+}
+
+void LogCompressor::threadFunc() {
+    detail::lowerPriority();
+    while (true) {
+        string filename;
+        {
+            MutexLockGuard lock(mutex_);
+            while (running_ && queue_.empty()) {
+                cond_.wait();
+            }
+            if (!running_) {
+                break;
+            }
+            filename = queue_.front();
+            queue_.pop_front();
+        }
+        if (compressFile(filename)) {
+            MutexLockGuard lock(mutex_);
+            ++compressedFiles_;
+        }
+    }
+}
+
+bool LogCompressor::throttle(Timestamp start, int64_t bytes) {
+    MutexLockGuard lock(mutex_);
+    if (bytesPerSecond_ > 0) {
+        double ahead = static_cast<double>(bytes) / static_cast<double>(bytesPerSecond_) -
+                       timeDifference(Timestamp::now(), start);
+        while (running_ && ahead > 0) {
+            cond_.waitForSeconds(ahead);
+            ahead = static_cast<double>(bytes) / static_cast<double>(bytesPerSecond_) -
+                    timeDifference(Timestamp::now(), start);
+        }
+    }
+    return running_;
+}
+
+/*
+ *      读入的部分用POSIX_FADV_DONTNEED从page cache中丢掉，压缩不会把业务的缓存挤出去
+ */
+bool LogCompressor::compressFile(const string &filename) {
+    int in = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        fprintf(stderr, "LogCompressor: cannot open %s: %s\n", filename.c_str(), strerror_tl(errno));
+        return false;
+    }
+    string gzName = filename + ".gz";
+    string tmpName = gzName + ".tmp";
+    int out = ::open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        fprintf(stderr, "LogCompressor: cannot create %s: %s\n", tmpName.c_str(), strerror_tl(errno));
+        ::close(in);
+        return false;
+    }
+
+    GzipEncoder encoder;
+    std::unique_ptr<char[]> buf(new char[detail::kReadSize]);
+    Timestamp start = Timestamp::now();
+    int64_t total = 0;
+    int err = 0;
+    bool ok = encoder.valid();
+    while (ok) {
+        ssize_t n = ::read(in, buf.get(), detail::kReadSize);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            err = n < 0 ? errno : 0;
+            break;
+        }
+        encoder.append(buf.get(), static_cast<size_t>(n));
+        ::posix_fadvise(in, total, n, POSIX_FADV_DONTNEED);
+        total += n;
+        string *output = encoder.output();
+        if (!detail::writeAll(out, output->data(), output->size())) {
+            err = errno;
+        }
+        output->clear();
+        ok = err == 0 && throttle(start, total);
+    }
+    if (ok && err == 0) {
+        encoder.finish();
+        string *output = encoder.output();
+        if (!detail::writeAll(out, output->data(), output->size()) || ::fdatasync(out) != 0) {
+            err = errno;
+        }
+    }
+    if (err != 0) {
+        fprintf(stderr, "LogCompressor: %s: %s\n", filename.c_str(), strerror_tl(err));
+    }
+    ok = ok && err == 0;
+    ::close(in);
+    ::close(out);
+
+    if (ok && ::rename(tmpName.c_str(), gzName.c_str()) == 0) {
+        ::unlink(filename.c_str());
+        return true;
+    }
+    ::unlink(tmpName.c_str());
+    return false;
+}
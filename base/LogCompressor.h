@@ -0,0 +1,101 @@
+//
+// Created by chen on 2022/12/06.
+//
+
+/*
+ *      日志压缩
+ *
+ *      1. GzipEncoder：流式deflate，输出gzip格式。
+ *         flush()产生一个同步点（Z_SYNC_FLUSH），同步点之前的数据都能解压出来，进程崩溃时只丢失最后一个同步点之后的日志
+ *
+ *      2. LogCompressor：后台线程压缩滚动掉的日志文件，xxx.log -> xxx.log.gz，完成后删除原文件
+ *         a. 线程的CPU和IO优先级都是最低的（nice 19，IOPRIO_CLASS_IDLE），只用空闲的CPU和磁盘
+ *         b. 队列有上限，满了时compress()返回false，这个文件保持不压缩，不会阻塞滚动日志的线程
+ *         c. 可以限制每秒读入的字节数
+ *         d. 先写到xxx.log.gz.tmp，fdatasync()之后再改名，不会留下不完整的.gz文件；stop()时放弃正在压缩的文件
+ *
+ *      3. 编译时没有zlib（MUDUO_HAVE_ZLIB）时available()返回false，不做任何压缩
+ */
+
+#ifndef MYMUDUO_LOGCOMPRESSOR_H
+#define MYMUDUO_LOGCOMPRESSOR_H
+
+#include "Condition.h"
+#include "Mutex.h"
+#include "Thread.h"
+#include "Timestamp.h"
+#include "Types.h"
+
+#include <deque>
+#include <memory>
+
+namespace muduo {
+
+    class GzipEncoder : noncopyable {
+    public:
+        explicit GzipEncoder(int level = 6);
+
+        ~GzipEncoder();
+
+        bool valid() const { return impl_ != nullptr; }
+
+        void append(const char *data, size_t len);
+
+        /// Makes everything appended so far decodable.
+        void flush();
+
+        /// Writes the gzip trailer, no append() afterwards.
+        void finish();
+
+        /// Compressed bytes not taken by the caller yet.
+        string *output() { return &output_; }
+
+    private:
+        struct Impl;
+
+        void deflate(const char *data, size_t len, int flush);
+
+        std::unique_ptr<Impl> impl_;
+        string output_;
+    };
+
+    class LogCompressor : noncopyable {
+    public:
+        /// bytesPerSecond == 0 means no limit.
+        explicit LogCompressor(size_t maxQueueSize = 16, int64_t bytesPerSecond = 0);
+
+        ~LogCompressor();
+
+        static bool available();
+
+        void start();
+
+        void stop();
+
+        /// Thread safe. Returns false if the queue is full, not running or zlib is unavailable.
+        bool compress(const string &filename);
+
+        /// Number of files compressed so far.
+        int64_t compressedFiles() const;
+
+    private:
+        void threadFunc();
+
+        bool compressFile(const string &filename);
+
+        // 从start开始读入了bytes字节，超过限速时等待。返回false表示已经stop()
+        bool throttle(Timestamp start, int64_t bytes);
+
+        const size_t maxQueueSize_;
+        const int64_t bytesPerSecond_;
+        mutable MutexLock mutex_;
+        Condition cond_;
+        bool running_;
+        std::deque<string> queue_;
+        int64_t compressedFiles_;
+        Thread thread_;
+    };
+
+}  // namespace muduo
+
+#endif //MYMUDUO_LOGCOMPRESSOR_H
@@ -4,34 +4,120 @@
 
 #include "LogFile.h"
 
+#include "Condition.h"
 #include "FileUtil.h"
+#include "LogCompressor.h"
 #include "ProcessInfo.h"
+#include "Thread.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <time.h>
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 using namespace muduo;
 
+/*
+ *      同步线程：对排队的文件执行fdatasync()，然后释放引用，滚动掉的旧文件在这里关闭。
+ *      同一个文件还在排队时不重复加入；析构时处理完所有排队的文件
+ */
+class LogFile::Syncer : noncopyable {
+public:
+    Syncer()
+            : cond_(mutex_),
+              running_(true),
+              thread_(std::bind(&Syncer::threadFunc, this), "LogSyncer") {
+        thread_.start();
+    }
+
+    ~Syncer() {
+        {
+            MutexLockGuard lock(mutex_);
+            running_ = false;
+            cond_.notify();
+        }
+        thread_.join();
+    }
+
+    void sync(const AppendFilePtr &file) {
+        MutexLockGuard lock(mutex_);
+        if (std::find(pending_.begin(), pending_.end(), file) == pending_.end()) {
+            pending_.push_back(file);
+            cond_.notify();
+        }
+    }
+
+private:
+    void threadFunc() {
+        std::vector<AppendFilePtr> files;
+        while (true) {
+            {
+                MutexLockGuard lock(mutex_);
+                while (running_ && pending_.empty()) {
+                    cond_.wait();
+                }
+                if (pending_.empty()) {
+                    break;
+                }
+                files.swap(pending_);
+            }
+            for (const AppendFilePtr &file : files) {
+                file->sync();
+            }
+            files.clear();
+        }
+    }
+
+    MutexLock mutex_;
+    Condition cond_;
+    bool running_;
+    std::vector<AppendFilePtr> pending_;
+    Thread thread_;
+};
+
+const off_t LogFile::kPreallocateChunk;
+
 LogFile::LogFile(const string &basename,
                  off_t rollSize,
                  bool threadSafe,
                  int flushInterval,
-                 int checkEveryN)
+                 int checkEveryN,
+                 bool compressOutput)
         : basename_(basename),
           rollSize_(rollSize),
           flushInterval_(flushInterval),
           checkEveryN_(checkEveryN),
           count_(0),
+          compressOutput_(compressOutput && LogCompressor::available()),
+          compressor_(nullptr),
           mutex_(threadSafe ? new MutexLock : nullptr),
           startOfPeriod_(0),
           lastRoll_(0),
-          lastFlush_(0) {
+          lastFlush_(0),
+          lastSync_(0),
+          syncer_(new Syncer) {
     assert(basename.find('/') == string::npos);
     rollFile();
 }
 
-LogFile::~LogFile() = default;
+LogFile::~LogFile() {
+    file_->flush();
+    syncer_->sync(file_);
+    file_.reset();
+    syncer_.reset();
+}
+
+void LogFile::setCompressor(LogCompressor *compressor) {
+    if (mutex_) {
+        MutexLockGuard lock(*mutex_);
+        compressor_ = compressor;
+    } else {
+        compressor_ = compressor;
+    }
+}
 
 void LogFile::append(const char *logline, int len) {
     if (mutex_) {
@@ -42,25 +128,42 @@ void LogFile::append(const char *logline, int len) {
     }
 }
 
+void LogFile::append(const struct iovec *iov, int iovcnt) {
+    if (mutex_) {
+        MutexLockGuard lock(*mutex_);
+        appendv_unlocked(iov, iovcnt);
+    } else {
+        appendv_unlocked(iov, iovcnt);
+    }
+}
+
 void LogFile::flush() {
     if (mutex_) {
         MutexLockGuard lock(*mutex_);
-        file_->flush();
+        flush_unlocked();
     } else {
-        file_->flush();
+        flush_unlocked();
     }
 }
 
-/*
- *      写满1GB或者跨天则进行文件滚动
- */
 void LogFile::append_unlocked(const char *logline, int len) {
     file_->append(logline, len);
+    afterAppend(1);
+}
+
+void LogFile::appendv_unlocked(const struct iovec *iov, int iovcnt) {
+    file_->append(iov, iovcnt);
+    afterAppend(iovcnt);
+}
 
+/*
+ *      写满1GB或者跨天则进行文件滚动
+ */
+void LogFile::afterAppend(int records) {
     if (file_->writtenBytes() > rollSize_) {
         rollFile();
     } else {
-        ++count_;
+        count_ += records;
         if (count_ >= checkEveryN_) {
             count_ = 0;
             time_t now = ::time(nullptr);
@@ -69,25 +172,51 @@ void LogFile::append_unlocked(const char *logline, int len) {
                 rollFile();
             } else if (now - lastFlush_ > flushInterval_) {
                 lastFlush_ = now;
-                file_->flush();
+                flush_unlocked();
             }
         }
     }
 }
 
+/*
+ *      缓冲交给内核；距离上一次fdatasync()超过flushInterval_秒时，让同步线程再做一次
+ */
+void LogFile::flush_unlocked() {
+    file_->flush();
+    time_t now = ::time(nullptr);
+    if (now - lastSync_ >= flushInterval_) {
+        lastSync_ = now;
+        syncer_->sync(file_);
+    }
+}
+
 /*
  *  rolling file的主要功能是将 file_ 指针指向新文件
+ *  旧文件的缓冲在这里写入内核，fdatasync()和关闭由同步线程完成，不阻塞当前线程。
+ *  旧文件的数据已经都在内核中，可以马上交给LogCompressor
  */
 bool LogFile::rollFile() {
     time_t now = 0;
     string filename = getLogFileName(basename_, &now);
+    if (compressOutput_) {
+        filename += ".gz";
+    }
     time_t start = now / kRollPerSeconds_ * kRollPerSeconds_;
 
     if (now > lastRoll_) {
         lastRoll_ = now;
         lastFlush_ = now;
         startOfPeriod_ = start;
-        file_.reset(new FileUtil::AppendFile(filename));    // 触发~AppendFile()关闭旧文件
+        AppendFilePtr old = file_;
+        file_.reset(new FileUtil::AppendFile(filename, std::min(rollSize_, kPreallocateChunk), compressOutput_));
+        if (old) {
+            old->flush();
+            syncer_->sync(old);
+            if (compressor_ && !compressOutput_ && !compressor_->compress(filename_)) {
+                fprintf(stderr, "LogFile: %s left uncompressed\n", filename_.c_str());
+            }
+        }
+        filename_ = filename;
         return true;
     }
     return false;
@@ -21,6 +21,15 @@
  *         才检查是否跨了一天，从而进行滚动
  *         /// FIXME 如果6月3日每写满checkEveryN，6月4日也未写满checkEveryN，知道6月5日才写满，
  *         /// FIXME 那么6月4日的日志会写在6月3日创建的日志文件里面
+ *
+ *      5. flush()把缓冲交给内核，fdatasync()由同步线程执行，每flushInterval秒最多一次，慢速磁盘不会拖住写日志的线程。
+ *         滚动时只在当前线程打开新文件，旧文件交给同步线程，由它fdatasync()之后关闭
+ *
+ *      6. 新文件用fallocate()按块预先分配空间（kPreallocateChunk，不超过rollSize）
+ *
+ *      7. 压缩（需要zlib，见LogCompressor）：
+ *         a. setCompressor()之后，滚动掉的文件交给LogCompressor在后台压缩，队列满时保持不压缩
+ *         b. compressOutput为true时直接写gzip流（.log.gz），flush()时产生同步点，rollSize按压缩前的大小计算
  */
 
 
@@ -32,31 +41,53 @@
 
 #include <memory>
 
+struct iovec;
+
 namespace muduo {
 
     namespace FileUtil {
         class AppendFile;
     }
 
+    class LogCompressor;
+
     class LogFile : noncopyable {
     public:
         LogFile(const string &basename,
                 off_t rollSize,
                 bool threadSafe = true,
                 int flushInterval = 3,
-                int checkEveryN = 1024);
+                int checkEveryN = 1024,
+                bool compressOutput = false);
 
         ~LogFile();
 
+        /// Compresses rolled files in the background, not owned.
+        void setCompressor(LogCompressor *compressor);
+
         void append(const char *logline, int len);
 
+        /// Appends iovcnt log records with one writev().
+        void append(const struct iovec *iov, int iovcnt);
+
         void flush();
 
         bool rollFile();
 
     private:
+        class Syncer;
+
+        typedef std::shared_ptr<FileUtil::AppendFile> AppendFilePtr;
+
         void append_unlocked(const char *logline, int len);
 
+        void appendv_unlocked(const struct iovec *iov, int iovcnt);
+
+        // 写入records条日志之后检查滚动和flush
+        void afterAppend(int records);
+
+        void flush_unlocked();
+
         static string getLogFileName(const string &basename, time_t *now);
 
         const string basename_;     // 程序名
@@ -67,14 +98,20 @@ namespace muduo {
         const int flushInterval_;
         const int checkEveryN_;
         int count_;
+        const bool compressOutput_;
+        LogCompressor *compressor_;
 
         std::unique_ptr<MutexLock> mutex_;
         time_t startOfPeriod_;  // 当天0点的时间
         time_t lastRoll_;
         time_t lastFlush_;
-        std::unique_ptr<FileUtil::AppendFile> file_;
+        time_t lastSync_;
+        std::unique_ptr<Syncer> syncer_;        // 先于file_构造，后于file_析构
+        AppendFilePtr file_;
+        string filename_;
 
         const static int kRollPerSeconds_ = 60 * 60 * 24;
+        const static off_t kPreallocateChunk = 16 * 1024 * 1024;
     };
 
 }  // namespace muduo
@@ -2,6 +2,7 @@
 // Created by chen on 2022/10/22.
 //
 #include "LogStream.h"
+#include "BinaryLog.h"
 
 #include <algorithm>
 #include <limits>
@@ -21,7 +22,7 @@
 using namespace muduo;
 using namespace muduo::detail;
 
-// TODO: better itoa.
+// convert()中的value < 0对无符号类型恒为false
 #if defined(__clang__)
 #pragma clang diagnostic ignored "-Wtautological-compare"
 #else
@@ -30,50 +31,374 @@ using namespace muduo::detail;
 
 namespace muduo{
     namespace detail{
-        const char digits[] = "9876543210123456789";
-        const char *zero = digits + 9;
-        static_assert(sizeof(digits) == 20, "wrong number of digits");
+        /*
+         *      整数转字符串
+         *
+         *      1. 先算出位数，数字直接写到最终位置，不需要std::reverse
+         *      2. 查表每次写两位：一次除以100得到两位数字，除法次数减半
+         *      3. 64位的值每次分出8位用32位运算写出，32位的除法更快
+         */
+        const char kDigitsLut[] =
+                "0001020304050607080910111213141516171819"
+                "2021222324252627282930313233343536373839"
+                "4041424344454647484950515253545556575859"
+                "6061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+        static_assert(sizeof kDigitsLut == 201, "wrong number of kDigitsLut");
+
+        const char kHexDigitsLut[] =
+                "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+                "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+                "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+                "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+                "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+                "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+                "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+                "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+        static_assert(sizeof kHexDigitsLut == 513, "wrong number of kHexDigitsLut");
+
+        // kPowersOf10[0]是0，这样value为0时也是1位
+        const uint64_t kPowersOf10[] = {
+                0, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+                10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+                100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+                100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+        };
+
+        // 十进制位数：由二进制位数估计（乘以log10(2) ≈ 1233 / 4096），再和10的幂比较一次修正
+        inline int countDigits(uint64_t value) {
+            int t = ((64 - __builtin_clzll(value | 1)) * 1233) >> 12;
+            return t + (value >= kPowersOf10[t]);
+        }
 
-        const char digitsHex[] = "0123456789ABCDEF";
-        static_assert(sizeof digitsHex == 17, "wrong number of digitsHex");
+        // 从end往前写，调用者保证位数正确
+        inline void writeDigits(char *end, uint32_t value) {
+            while (value >= 100) {
+                unsigned index = static_cast<unsigned>(value % 100) * 2;
+                value /= 100;
+                end -= 2;
+                memcpy(end, kDigitsLut + index, 2);
+            }
+            if (value < 10) {
+                *--end = static_cast<char>('0' + value);
+            } else {
+                end -= 2;
+                memcpy(end, kDigitsLut + value * 2, 2);
+            }
+        }
+
+        // 32位的类型在编译期就去掉了64位的循环
+        template<typename U>
+        inline size_t convertUnsigned(char buf[], U value) {
+            int len = countDigits(value);
+            char *end = buf + len;
+            uint64_t rest = value;
+            // 每次用一次64位除法分出低8位，这8位用32位运算写出
+            while (sizeof(U) > sizeof(uint32_t) && rest > UINT32_MAX) {
+                uint64_t high = rest / 100000000;
+                uint32_t low = static_cast<uint32_t>(rest - high * 100000000);
+                for (int i = 0; i < 4; ++i) {
+                    end -= 2;
+                    memcpy(end, kDigitsLut + (low % 100) * 2, 2);
+                    low /= 100;
+                }
+                rest = high;
+            }
+            writeDigits(end, static_cast<uint32_t>(rest));
+            buf[len] = '\0';
+            return static_cast<size_t>(len);
+        }
 
-        // Efficient Integer to String Conversions, by Matthew Wilson.
         // 整形转String，存储在buf中，返回长度
         template<typename T>
         size_t convert(char buf[], T value) {
-            T i = value;
-            char *p = buf;
+            typedef typename std::make_unsigned<T>::type U;
+            if (value < 0) {
+                *buf = '-';
+                // 先转成无符号再取负，最小的负数也不会溢出
+                return 1 + convertUnsigned(buf + 1, static_cast<U>(0 - static_cast<U>(value)));
+            }
+            return convertUnsigned(buf, static_cast<U>(value));
+        }
 
-            do {
-                int lsd = static_cast<int>(i % 10);
-                i /= 10;
-                *p++ = zero[lsd];
-            } while (i != 0);
+        // uint转16进制String，存储在buf中，返回长度。位数由最高的1位得出，每次写一个字节的两位
+        size_t convertHex(char buf[], uintptr_t value) {
+            int len = (64 - __builtin_clzll(static_cast<uint64_t>(value) | 1) + 3) / 4;
+            char *p = buf + len;
+            while (value >= 0x100) {
+                p -= 2;
+                memcpy(p, kHexDigitsLut + (value & 0xff) * 2, 2);
+                value >>= 8;
+            }
+            if (value < 0x10) {
+                *--p = kHexDigitsLut[value * 2 + 1];
+            } else {
+                p -= 2;
+                memcpy(p, kHexDigitsLut + value * 2, 2);
+            }
+            buf[len] = '\0';
+            return static_cast<size_t>(len);
+        }
 
-            if (value < 0) {
-                *p++ = '-';
+        /*
+         *      浮点数转最短的、能精确还原的十进制字符串：Grisu2，Florian Loitsch, Printing Floating-Point Numbers
+         *      Quickly and Accurately with Integers, PLDI 2010；实现参考milo yip的dtoa
+         *
+         *      1. 把v和它与相邻浮点数的中点m-、m+表示成 f * 2^e（64位f）
+         *      2. 乘以一个预先算好的10^-k，使指数落在[-60, -32]，之后只用64位整数运算
+         *      3. 逐位生成(m-, m+)之间的数字，位数足够区分时停止，最后一位向v靠近
+         *      结果可以精确还原，绝大多数情况下也是最短的
+         */
+        struct DiyFp {
+            DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+            DiyFp operator-(const DiyFp &rhs) const {
+                return DiyFp(f - rhs.f, e);
+            }
+
+            // 128位乘积的高64位，四舍五入
+            DiyFp operator*(const DiyFp &rhs) const {
+                unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+                uint64_t h = static_cast<uint64_t>(p >> 64);
+                uint64_t l = static_cast<uint64_t>(p);
+                if (l & (static_cast<uint64_t>(1) << 63)) {
+                    ++h;
+                }
+                return DiyFp(h, e + rhs.e + 64);
+            }
+
+            DiyFp normalize() const {
+                int shift = __builtin_clzll(f);
+                return DiyFp(f << shift, e - shift);
             }
-            *p = '\0';
-            std::reverse(buf, p);
 
-            return p - buf;
+            uint64_t f;
+            int e;
+        };
+
+        // 10^k，k = -348, -340, ..., 340，f规格化到最高位为1
+        const uint64_t kCachedPowersF[] = {
+                    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+                    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+                    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+                    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+                    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+                    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+                    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+                    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+                    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+                    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+                    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+                    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+                    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+                    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+                    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+                    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+                    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+                    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+                    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+                    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+                    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+                    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+                    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+                    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+                    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+                    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+                    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+                    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+                    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+        };
+
+        const int16_t kCachedPowersE[] = {
+                    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+                    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+                    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+                    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+                    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+                    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+                    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+                    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+                    907, 933, 960, 986, 1013, 1039, 1066,
+        };
+
+        const uint32_t kPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+        // 选一个10^-K，使 e + 10^-K的指数 落在[-60, -32]
+        DiyFp cachedPower(int e, int *K) {
+            double dk = (-61 - e) * 0.30102999566398114 + 347;
+            int k = static_cast<int>(dk);
+            if (dk - k > 0.0) {
+                ++k;
+            }
+            unsigned index = static_cast<unsigned>((k >> 3) + 1);
+            *K = -(-348 + static_cast<int>(index << 3));
+            return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
         }
 
-        // uint转16进制String，存储在buf中，返回长度
-        size_t convertHex(char buf[], uintptr_t value) {
-            uintptr_t i = value;
-            char *p = buf;
+        int countDecimalDigit(uint32_t n) {
+            int count = 1;
+            while (count < 10 && n >= kPow10[count]) {
+                ++count;
+            }
+            return count;
+        }
 
-            do {
-                int lsd = static_cast<int>(i % 16);
-                i /= 16;
-                *p++ = digitsHex[lsd];
-            } while (i != 0);
+        // 最后一位向v靠近，仍然在(m-, m+)之内
+        void grisuRound(char *buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance) {
+            while (rest < distance && delta - rest >= tenKappa &&
+                   (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+                buffer[len - 1]--;
+                rest += tenKappa;
+            }
+        }
+
+        void digitGen(const DiyFp &w, const DiyFp &mp, uint64_t delta, char *buffer, int *len, int *K) {
+            const DiyFp one(static_cast<uint64_t>(1) << -mp.e, mp.e);
+            const DiyFp distance = mp - w;
+            uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e);       // 整数部分
+            uint64_t p2 = mp.f & (one.f - 1);                           // 小数部分
+            int kappa = countDecimalDigit(p1);
+            *len = 0;
+
+            while (kappa > 0) {
+                uint32_t d = p1 / kPow10[kappa - 1];
+                p1 %= kPow10[kappa - 1];
+                if (d || *len) {
+                    buffer[(*len)++] = static_cast<char>('0' + d);
+                }
+                --kappa;
+                uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+                if (rest <= delta) {
+                    *K += kappa;
+                    grisuRound(buffer, *len, delta, rest, static_cast<uint64_t>(kPow10[kappa]) << -one.e, distance.f);
+                    return;
+                }
+            }
 
+            for (;;) {
+                p2 *= 10;
+                delta *= 10;
+                char d = static_cast<char>(p2 >> -one.e);
+                if (d || *len) {
+                    buffer[(*len)++] = static_cast<char>('0' + d);
+                }
+                p2 &= one.f - 1;
+                --kappa;
+                if (p2 < delta) {
+                    *K += kappa;
+                    int index = -kappa;
+                    grisuRound(buffer, *len, delta, p2, one.f, distance.f * (index < 10 ? kPow10[index] : 0));
+                    return;
+                }
+            }
+        }
+
+        /*
+         *      v = f * 2^e，f != 0；hiddenBit是规格化数的隐含位，f等于它时下面的相邻数更近
+         *      生成的数字是 buffer[0, len) * 10^K
+         */
+        void grisu2(uint64_t f, int e, uint64_t hiddenBit, char *buffer, int *len, int *K) {
+            DiyFp plus = DiyFp((f << 1) + 1, e - 1).normalize();
+            DiyFp minus = f == hiddenBit ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+            minus.f <<= minus.e - plus.e;
+            minus.e = plus.e;
+
+            const DiyFp cached = cachedPower(plus.e, K);
+            const DiyFp w = DiyFp(f, e).normalize() * cached;
+            DiyFp wp = plus * cached;
+            DiyFp wm = minus * cached;
+            ++wm.f;
+            --wp.f;
+            digitGen(w, wp, wp.f - wm.f, buffer, len, K);
+        }
+
+        /*
+         *      和%g相同的格式：第一位数字的指数在[-4, 17)之间时用小数，否则用科学计数法
+         */
+        size_t prettify(char *buf, const char *decimals, int len, int K) {
+            char *p = buf;
+            int exp10 = len + K - 1;
+            if (exp10 >= -4 && exp10 < 17) {
+                if (K >= 0) {
+                    memcpy(p, decimals, static_cast<size_t>(len));
+                    p += len;
+                    memset(p, '0', static_cast<size_t>(K));
+                    p += K;
+                } else if (exp10 >= 0) {
+                    memcpy(p, decimals, static_cast<size_t>(exp10 + 1));
+                    p += exp10 + 1;
+                    *p++ = '.';
+                    memcpy(p, decimals + exp10 + 1, static_cast<size_t>(len - exp10 - 1));
+                    p += len - exp10 - 1;
+                } else {
+                    *p++ = '0';
+                    *p++ = '.';
+                    memset(p, '0', static_cast<size_t>(-exp10 - 1));
+                    p += -exp10 - 1;
+                    memcpy(p, decimals, static_cast<size_t>(len));
+                    p += len;
+                }
+            } else {
+                *p++ = decimals[0];
+                if (len > 1) {
+                    *p++ = '.';
+                    memcpy(p, decimals + 1, static_cast<size_t>(len - 1));
+                    p += len - 1;
+                }
+                *p++ = 'e';
+                *p++ = exp10 < 0 ? '-' : '+';
+                int absExp = exp10 < 0 ? -exp10 : exp10;
+                if (absExp >= 100) {
+                    *p++ = static_cast<char>('0' + absExp / 100);
+                    absExp %= 100;
+                }
+                *p++ = static_cast<char>('0' + absExp / 10);
+                *p++ = static_cast<char>('0' + absExp % 10);
+            }
             *p = '\0';
-            std::reverse(buf, p);
+            return static_cast<size_t>(p - buf);
+        }
+
+        /*
+         *      拆出符号、有效数字和指数，处理0、无穷大和NaN，其它交给grisu2
+         *      SignificandBits是尾数的位数，ExponentBits是指数的位数
+         */
+        template<int SignificandBits, int ExponentBits>
+        size_t formatFloatingPoint(char buf[], uint64_t bits) {
+            const uint64_t hiddenBit = static_cast<uint64_t>(1) << SignificandBits;
+            const int exponentMask = (1 << ExponentBits) - 1;
+            const int exponentBias = exponentMask / 2 + SignificandBits;
 
-            return p - buf;
+            char *p = buf;
+            uint64_t significand = bits & (hiddenBit - 1);
+            int biasedExponent = static_cast<int>(bits >> SignificandBits) & exponentMask;
+            bool negative = (bits >> (SignificandBits + ExponentBits)) & 1;
+            if (biasedExponent == exponentMask) {
+                const char *s = significand ? "nan" : negative ? "-inf" : "inf";
+                size_t len = strlen(s);
+                memcpy(buf, s, len + 1);
+                return len;
+            }
+            if (negative) {
+                *p++ = '-';
+            }
+            if (biasedExponent == 0 && significand == 0) {
+                *p++ = '0';
+                *p = '\0';
+                return static_cast<size_t>(p - buf);
+            }
+
+            uint64_t f = significand;
+            int e = 1 - exponentBias;               // 非规格化数
+            if (biasedExponent != 0) {
+                f += hiddenBit;
+                e = biasedExponent - exponentBias;
+            }
+            char decimals[24];
+            int len = 0;
+            int K = 0;
+            grisu2(f, e, hiddenBit, decimals, &len, &K);
+            return static_cast<size_t>(p - buf) + prettify(p, decimals, len, K);
         }
 
         template class FixedBuffer<kSmallBuffer>;
@@ -197,6 +522,18 @@ namespace muduo{
         return buf;
     }
 
+    size_t formatDouble(char buf[], double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        return detail::formatFloatingPoint<52, 11>(buf, bits);
+    }
+
+    size_t formatFloat(char buf[], float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        return detail::formatFloatingPoint<23, 8>(buf, bits);
+    }
+
 }   // namespace muduo
 
 template<int SIZE>
@@ -215,7 +552,7 @@ void FixedBuffer<SIZE>::cookieEnd() {}
  *      检查kMaxNumericSize设置得够不够大。
  */
 void LogStream::staticCheck() {
-    static_assert(kMaxNumericSize - 10 > std::numeric_limits<double>::digits10,
+    static_assert(kMaxNumericSize >= kMaxDoubleSize,
                   "kMaxNumericSize is large enough");
     static_assert(kMaxNumericSize - 10 > std::numeric_limits<long double>::digits10,
                   "kMaxNumericSize is large enough");
@@ -230,6 +567,14 @@ void LogStream::staticCheck() {
  */
 template <class T>
 void LogStream::formatInteger(T v) {
+    if(binary_){
+        if(std::is_signed<T>::value){
+            appendArg(BinaryLog::kInt, static_cast<int64_t>(v));
+        }else{
+            appendArg(BinaryLog::kUInt, static_cast<uint64_t>(v));
+        }
+        return;
+    }
     if(buffer_.avail() >= kMaxNumericSize){
         size_t len = convert(buffer_.current(), v);
         buffer_.add(len);
@@ -237,22 +582,63 @@ void LogStream::formatInteger(T v) {
 }
 
 void LogStream::append(const char *data, int len) {
-    buffer_.append(data, len);
+    appendText(data, static_cast<size_t>(len));
 }
 
 const LogStream::Buffer& LogStream::buffer() const {
     return buffer_;
 }
 
+LogStream::Buffer& LogStream::buffer() {
+    return buffer_;
+}
+
 void LogStream::resetBuffer() {
     buffer_.reset();
 }
 
+void LogStream::appendText(const char *data, size_t len) {
+    if(binary_){
+        appendStringArg(data, len);
+    }else{
+        buffer_.append(data, len);
+    }
+}
+
+/*
+ *      二进制参数：| 类型 1 | 值 |，放不下时和文本模式一样丢弃
+ */
+template<class T>
+void LogStream::appendArg(char type, T value) {
+    if(implicit_cast<size_t>(buffer_.avail()) > 1 + sizeof value){
+        char *buf = buffer_.current();
+        buf[0] = type;
+        memcpy(buf + 1, &value, sizeof value);
+        buffer_.add(1 + sizeof value);
+    }
+}
+
+/*
+ *      字符串参数：| 类型 1 | 长度 2 | 字节 |，放不下时截断
+ */
+void LogStream::appendStringArg(const char *data, size_t len) {
+    int avail = buffer_.avail() - 4;
+    if(avail > 0){
+        len = std::min(len, static_cast<size_t>(avail));
+        uint16_t n = static_cast<uint16_t>(len);
+        char *buf = buffer_.current();
+        buf[0] = BinaryLog::kString;
+        memcpy(buf + 1, &n, sizeof n);
+        memcpy(buf + 1 + sizeof n, data, len);
+        buffer_.add(1 + sizeof n + len);
+    }
+}
+
 /// ------------------ LogStream::operator<<() -----------------------
 /*
  *      1. 对于整形，除了short和unsigned short外，直接用formatInteger格式化
  *      2. 对于short和unsigned short，将它们提升为 int / unsigned int 后再格式化
- *      3. 对于浮点数，float提升为double，按照double处理
+ *      3. 对于浮点数，输出能精确还原的最短十进制表示（formatDouble / formatFloat）
  *      4. 对于各种字符串，将其 const char * 形式添加到buffer中
  *      5. 对于 void*，转化为16进制字符串（应该是用于记录地址）
  *      6. 对于char，直接记录
@@ -299,24 +685,54 @@ LogStream &LogStream::operator<<(unsigned long long v) {
     return *this;
 }
 
+/*
+ *      指针以16进制形式记录，例如 0x7FFC1A2B
+ */
+LogStream &LogStream::operator<<(const void *p) {
+    uintptr_t v = reinterpret_cast<uintptr_t>(p);
+    if(binary_){
+        appendArg(BinaryLog::kPointer, static_cast<uint64_t>(v));
+        return *this;
+    }
+    if(buffer_.avail() >= kMaxNumericSize){
+        char *buf = buffer_.current();
+        buf[0] = '0';
+        buf[1] = 'x';
+        size_t len = convertHex(buf + 2, v);
+        buffer_.add(len + 2);
+    }
+    return *this;
+}
+
 LogStream &LogStream::operator<<(double v) {
+    if(binary_){
+        appendArg(BinaryLog::kDouble, v);
+        return *this;
+    }
     if(buffer_.avail() >= kMaxNumericSize){
-        int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
+        size_t len = formatDouble(buffer_.current(), v);
         buffer_.add(len);
     }
     return *this;
 }
 
 LogStream& LogStream::operator<<(float v) {
-    *this << static_cast<double>(v);
+    if(binary_){
+        appendArg(BinaryLog::kFloat, v);
+        return *this;
+    }
+    if(buffer_.avail() >= kMaxNumericSize){
+        size_t len = formatFloat(buffer_.current(), v);
+        buffer_.add(len);
+    }
     return *this;
 }
 
 LogStream& LogStream::operator<<(const char *str) {
     if(str) {
-        buffer_.append(str, strlen(str));
+        appendText(str, strlen(str));
     }else{
-        buffer_.append("(null)", 6);
+        appendText("(null)", 6);
     }
     return *this;
 }
@@ -326,12 +742,12 @@ LogStream& LogStream::operator<<(const unsigned char *str) {
 }
 
 LogStream& LogStream::operator<<(const string &v) {
-    buffer_.append(v.c_str(), v.size());
+    appendText(v.c_str(), v.size());
     return *this;
 }
 
 LogStream& LogStream::operator<<(const StringPiece &v) {
-    buffer_.append(v.data(), v.size());
+    appendText(v.data(), static_cast<size_t>(v.size()));
     return *this;
 }
 
@@ -341,11 +757,19 @@ LogStream& LogStream::operator<<(const Buffer &v) {
 }
 
 LogStream& LogStream::operator<<(bool v) {
+    if(binary_){
+        appendArg(BinaryLog::kBool, static_cast<char>(v));
+        return *this;
+    }
     buffer_.append(v ? "1" : "0", 1);
     return *this;
 }
 
 LogStream& LogStream::operator<<(char v) {
+    if(binary_){
+        appendArg(BinaryLog::kChar, v);
+        return *this;
+    }
     buffer_.append(&v, 1);
     return *this;
 }
@@ -55,6 +55,10 @@ namespace muduo{
                 return data_;
             }
 
+            char *data(){
+                return data_;
+            }
+
             // 已写入数据的长度
             int length() const{
                 return static_cast<int>(cur_ - data_);
@@ -130,6 +134,8 @@ namespace muduo{
     public:
         using Buffer = detail::FixedBuffer<detail::kSmallBuffer>;
 
+        LogStream(): binary_(false){}
+
         self& operator<<(bool);
         self& operator<<(short);
         self& operator<<(unsigned short);
@@ -152,16 +158,36 @@ namespace muduo{
         void append(const char *data, int len);
 
         const Buffer& buffer() const;
+        Buffer& buffer();
         void resetBuffer();
 
+        /*
+         *      二进制模式下operator<<不做格式化，写入 | 类型 | 原始字节 |，由BinaryLogDecoder还原，见BinaryLog.h
+         */
+        void setBinary(bool on){
+            binary_ = on;
+        }
+
+        bool binary() const{
+            return binary_;
+        }
+
     private:
         void staticCheck();
 
         template<class T>
         void formatInteger(T);
 
+        void appendText(const char *data, size_t len);
+
+        template<class T>
+        void appendArg(char type, T value);
+
+        void appendStringArg(const char *data, size_t len);
+
     private:
         Buffer buffer_;
+        bool binary_;
         static const int kMaxNumericSize = 48;  // 最大数值类型占用的空间大小
     };  // class LogStream
 
@@ -208,6 +234,15 @@ namespace muduo{
 
     string formatSI(int64_t n);
     string formatIEC(int64_t n);
+
+    /*
+     *      浮点数转成能精确还原的最短十进制字符串，不受locale影响，比snprintf快得多。
+     *      格式和%g相同（第一位数字的指数在[-4, 17)之间时用小数，否则用科学计数法），例如0.1、1e+20、-inf。
+     *      buf至少kMaxDoubleSize字节，以'\0'结尾，返回长度
+     */
+    const int kMaxDoubleSize = 32;
+    size_t formatDouble(char buf[], double value);
+    size_t formatFloat(char buf[], float value);
 }
 
 #endif //MYMUDUO_LOGSTREAM_H
@@ -3,14 +3,19 @@
 //
 
 #include "Logging.h"
+#include "BinaryLog.h"
 #include "CurrentThread.h"
+#include "Mutex.h"
 #include "Timestamp.h"
 #include "TimeZone.h"
 
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace muduo{
     __thread char t_errnobuf[512];
@@ -33,8 +38,98 @@ namespace muduo{
 
     Logger::LogLevel g_logLevel = initLogLevel();   // initialize global loglevel
 
+    bool g_logBinary = false;
+
+    int g_logRateLimit[Logger::NUM_LOG_LEVELS] = {0};
+
+    /*
+     *      每个级别的每秒预算：second是当前这一秒，used是这一秒已经输出的行数。
+     *      换秒时由CAS成功的线程清零，同时到达的几行可能多算或者少算，不影响限流的效果
+     */
+    struct RateWindow{
+        std::atomic<int64_t> second;
+        std::atomic<int> used;
+    };
+
+    RateWindow g_rateWindows[Logger::NUM_LOG_LEVELS];
+
+    /*
+     *      粗粒度的单调时钟走vDSO，只要几ns，精度是一个tick，用于采样和限流足够
+     */
+    int64_t coarseMilliseconds(){
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    /*
+     *      已登记的调用点和模块级别，只在调用点第一次执行和修改级别时加锁。
+     *      用函数内的静态变量，全局对象的构造函数中也可以写日志
+     */
+    struct SiteRegistry{
+        SiteRegistry(): head(NULL){
+        }
+
+        MutexLock mutex;
+        LogSite *head;
+        std::vector<std::pair<string, Logger::LogLevel>> modules;
+    };
+
+    SiteRegistry &siteRegistry(){
+        static SiteRegistry registry;
+        return registry;
+    }
+
+    // path中是否有名为dir的目录："dir/..."或者".../dir/..."
+    bool inDirectory(const char *path, const string &dir){
+        size_t len = dir.size();
+        if(len == 0){
+            return false;
+        }
+        for(const char *p = path; (p = strstr(p, dir.c_str())) != NULL; p += len){
+            if((p == path || p[-1] == '/') && p[len] == '/'){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     *      调用点的有效级别：源文件名匹配优先，其次是目录名，都不匹配时用全局的级别。调用者持有锁
+     */
+    Logger::LogLevel effectiveLogLevel(const SiteRegistry &registry, const LogSite *site){
+        const Logger::LogLevel *dirLevel = NULL;
+        for(const auto &module : registry.modules){
+            if(module.first.size() == static_cast<size_t>(site->basenameSize) &&
+               memcmp(module.first.data(), site->basename, module.first.size()) == 0){
+                return module.second;
+            }
+            if(dirLevel == NULL && inDirectory(site->path, module.first)){
+                dirLevel = &module.second;
+            }
+        }
+        return dirLevel ? *dirLevel : g_logLevel;
+    }
+
+    LogSite::State siteState(const SiteRegistry &registry, const LogSite *site){
+        bool on = site->level >= Logger::WARN || effectiveLogLevel(registry, site) <= site->level;
+        return on ? LogSite::kEnabled : LogSite::kDisabled;
+    }
+
+    // 级别改变后重新计算所有已登记的调用点。调用者持有锁
+    void refreshSites(const SiteRegistry &registry){
+        for(LogSite *site = registry.head; site != NULL; site = site->next){
+            site->state.store(siteState(registry, site), std::memory_order_release);
+        }
+    }
+
+    LogStream &nullLogStream(){
+        static LogStream stream;
+        return stream;
+    }
+
     const char *LogLevelName[Logger::LogLevel::NUM_LOG_LEVELS] = {
-            "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
+            "TRACE ", "DEBUG ", "INFO  ", "WARN  ", "ERROR ", "FATAL "
     };
 
     /*
@@ -89,12 +184,26 @@ using namespace muduo;
 /*
  *      Impl构造函数
  *      在构造阶段完成写入：日期、时间、线程id、日志级别，如果存在error，也要写入
+ *
+ *      二进制模式下：
+ *      1. 有调用点时写入日志记录的头部，之后的operator<<写入二进制参数
+ *      2. 没有调用点时（例如CHECK_NOTNULL）仍然格式化成文本，外面包一层文本记录
  */
-Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile &file, int line): time_(Timestamp::now()),
-                                                                                     stream_(),
-                                                                                     level_(level),
-                                                                                     line_(line),
-                                                                                     basename_(file){
+Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile &file, int line, LogSite *site)
+        : time_(Timestamp::now()),
+          stream_(),
+          level_(level),
+          line_(line),
+          basename_(file),
+          binary_(g_logBinary){
+    if(binary_){
+        if(site){
+            formatBinaryHeader(site, savedErrno);
+            return;
+        }
+        char prefix[BinaryLog::kPrefixLen] = {static_cast<char>(BinaryLog::kTextRecord)};
+        stream_.append(prefix, sizeof prefix);      // 长度在finish()中填写
+    }
     formatTime();
     CurrentThread::tid();
     stream_ << T(CurrentThread::tidString(), CurrentThread::tidStringLength());
@@ -140,30 +249,121 @@ void Logger::Impl::formatTime() {
     }
 }
 
+/*
+ *      日志记录的头部：| 0xB8 | len 2 | id 4 | time 8 | tid 4 | errno 4 |，len在finish()中填写
+ *      调用点第一次使用时先输出调用点记录
+ */
+void Logger::Impl::formatBinaryHeader(LogSite *site, int savedErrno) {
+    uint32_t id = site->id.load(std::memory_order_acquire);
+    if(id == 0){
+        id = BinaryLog::registerSite(site);
+    }
+    int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
+    int32_t tid = CurrentThread::tid();
+    int32_t err = savedErrno;
+
+    char header[BinaryLog::kLogHeaderLen];
+    char *p = header;
+    *p = static_cast<char>(BinaryLog::kLogRecord);
+    p += BinaryLog::kPrefixLen;
+    memcpy(p, &id, sizeof id);
+    p += sizeof id;
+    memcpy(p, &microSecondsSinceEpoch, sizeof microSecondsSinceEpoch);
+    p += sizeof microSecondsSinceEpoch;
+    memcpy(p, &tid, sizeof tid);
+    p += sizeof tid;
+    memcpy(p, &err, sizeof err);
+    stream_.append(header, sizeof header);
+    stream_.setBinary(true);
+}
+
 /*
  *  日志记录结束时，写入文件名和行号
- *
+ *  二进制模式下填写记录的总长度，日志记录的文件名和行号在调用点记录中
  */
 void Logger::Impl::finish() {
-    stream_ << " - " << basename_ << ":" << line_ << "\n";
+    if(!stream_.binary()){
+        stream_ << " - " << basename_ << ":" << line_ << "\n";
+    }
+    if(binary_){
+        LogStream::Buffer &buf = stream_.buffer();
+        uint16_t len = static_cast<uint16_t>(buf.length());
+        memcpy(buf.data() + 1, &len, sizeof len);
+    }
 }
 
-Logger::Logger(SourceFile file, int line): impl_(INFO, 0, file, line) {
+Logger::Logger(SourceFile file, int line): impl_(INFO, 0, file, line, NULL) {
 
 }
 
-Logger::Logger(SourceFile file, int line, LogLevel level, const char *func) : impl_(level, 0, file, line){
+Logger::Logger(SourceFile file, int line, LogLevel level, const char *func) : impl_(level, 0, file, line, NULL){
     impl_.stream_ << func << ' ';
 }
 
-Logger::Logger(SourceFile file, int line, LogLevel level) : impl_(level, 0, file, line){
+Logger::Logger(SourceFile file, int line, LogLevel level) : impl_(level, 0, file, line, NULL){
 
 }
 
-Logger::Logger(SourceFile file, int line, bool toAbort): impl_(toAbort ? FATAL : ERROR, errno, file, line){
+Logger::Logger(SourceFile file, int line, bool toAbort): impl_(toAbort ? FATAL : ERROR, errno, file, line, NULL){
 
 }
 
+Logger::Logger(LogSite *site, int savedErrno): impl_(site->level, savedErrno, SourceFile(site->basename, site->basenameSize), site->line, site){
+    if(site->func && !impl_.stream_.binary()){
+        impl_.stream_ << site->func << ' ';
+    }
+    // 平时只有一次relaxed load
+    if(site->suppressed.load(std::memory_order_relaxed) != 0){
+        uint64_t suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+        if(suppressed != 0){
+            impl_.stream_ << '[' << suppressed << " suppressed] ";
+        }
+    }
+}
+
+/*
+ *      调用点第一次执行：记下文件名和函数名，登记到链表，计算state。
+ *      多个线程同时第一次执行时，只有第一个拿到锁的线程登记
+ */
+bool LogSite::initialize(const char *funcName) {
+    SiteRegistry &registry = siteRegistry();
+    MutexLockGuard lock(registry.mutex);
+    int s = state.load(std::memory_order_relaxed);
+    if(s == kUnknown){
+        const char *slash = strrchr(path, '/');
+        basename = slash ? slash + 1 : path;
+        basenameSize = static_cast<int>(strlen(basename));
+        func = funcName;
+        next = registry.head;
+        registry.head = this;
+        s = siteState(registry, this);
+        state.store(s, std::memory_order_release);
+    }
+    return s == kEnabled;
+}
+
+bool LogSite::everyMs(int64_t ms) {
+    int64_t now = coarseMilliseconds();
+    int64_t deadline = nextMs.load(std::memory_order_relaxed);
+    if(now < deadline || !nextMs.compare_exchange_strong(deadline, now + ms, std::memory_order_relaxed)){
+        return suppress();
+    }
+    return admit();
+}
+
+bool LogSite::consumeBudget() {
+    RateWindow &window = g_rateWindows[level];
+    int64_t second = coarseMilliseconds() / 1000;
+    int64_t current = window.second.load(std::memory_order_relaxed);
+    if(second != current && window.second.compare_exchange_strong(current, second, std::memory_order_relaxed)){
+        window.used.store(0, std::memory_order_relaxed);
+    }
+    if(window.used.fetch_add(1, std::memory_order_relaxed) < g_logRateLimit[level]){
+        return true;
+    }
+    return suppress();
+}
+
 /*
  *  析构时调用 output()把日志写到目标位置（的缓冲区）
  */
@@ -179,7 +379,33 @@ Logger::~Logger() noexcept {
 
 
 void Logger::setLogLevel(Logger::LogLevel level) {
+    SiteRegistry &registry = siteRegistry();
+    MutexLockGuard lock(registry.mutex);
     g_logLevel = level;
+    refreshSites(registry);
+}
+
+void Logger::setModuleLogLevel(const string &module, LogLevel level) {
+    SiteRegistry &registry = siteRegistry();
+    MutexLockGuard lock(registry.mutex);
+    bool found = false;
+    for(auto &m : registry.modules){
+        if(m.first == module){
+            m.second = level;
+            found = true;
+        }
+    }
+    if(!found){
+        registry.modules.push_back(std::make_pair(module, level));
+    }
+    refreshSites(registry);
+}
+
+void Logger::clearModuleLogLevels() {
+    SiteRegistry &registry = siteRegistry();
+    MutexLockGuard lock(registry.mutex);
+    registry.modules.clear();
+    refreshSites(registry);
 }
 
 void Logger::setOutput(OutputFunc out) {
@@ -194,6 +420,14 @@ void Logger::setTimeZone(const TimeZone &tz) {
     g_logTimeZone = tz;
 }
 
+void Logger::setBinary(bool on) {
+    g_logBinary = on;
+}
+
+void Logger::setRateLimit(LogLevel level, int linesPerSecond) {
+    g_logRateLimit[level] = linesPerSecond;
+}
+
 
 
 
@@ -14,6 +14,9 @@
  *      日期 时间.微秒 线程 级别 正文 - 源文件名：行号
  *      20120603 08:02:46.125770Z 23261 INFO Hello - test.cpp:51
  *
+ *      二进制模式（Logger::setBinary(true)）下不格式化，只输出调用点编号、时间、线程和参数的原始字节，
+ *      由AsyncLogging的后端线程或者离线工具logdecode还原成上面的格式，见BinaryLog.h
+ *
  */
 
 
@@ -24,7 +27,13 @@
 #include "Timestamp.h"
 #include "TimeZone.h"
 
+#include <errno.h>
+
+#include <atomic>
+
 namespace muduo{
+    struct LogSite;
+
     class Logger{
     public:
         enum LogLevel{
@@ -56,6 +65,9 @@ namespace muduo{
                 }
             }
 
+            SourceFile(const char *data, int size): data_(data), size_(size){
+            }
+
             explicit SourceFile(const char *filename): data_(filename){
                 const char *slash = strrchr(data_, '/');
                 if(slash){
@@ -70,6 +82,7 @@ namespace muduo{
         Logger(SourceFile file, int line, LogLevel level);
         Logger(SourceFile file, int line, LogLevel level, const char *func);    // func是函数名
         Logger(SourceFile file, int line, bool toAbort);
+        explicit Logger(LogSite *site, int savedErrno = 0);        // LOG_*宏使用
         ~Logger();
 
         LogStream &stream() {
@@ -79,6 +92,13 @@ namespace muduo{
         static LogLevel logLevel();
         static void setLogLevel(LogLevel level);
 
+        /*
+         *      模块的日志级别，优先于全局的级别。module是源文件名（"EPollPoller.cpp"）或者目录名（"http"），
+         *      两者都匹配时源文件名优先。WARN / ERROR / FATAL不受影响
+         */
+        static void setModuleLogLevel(const string &module, LogLevel level);
+        static void clearModuleLogLevels();
+
         // 用户可以自定义output和flush
         // 默认是output到stdout，fflush(stdout)
         typedef void (*OutputFunc)(const char *msg, int len);
@@ -88,6 +108,14 @@ namespace muduo{
 
         static void setTimeZone(const TimeZone &tz);
 
+        // 二进制模式，默认关闭
+        static bool binary();
+        static void setBinary(bool on);
+
+        // 每个级别每秒最多输出的行数，0表示不限制（默认）。超出的行被丢弃，计入调用点下一次输出的行。FATAL不受限制
+        static int rateLimit(LogLevel level);
+        static void setRateLimit(LogLevel level, int linesPerSecond);
+
     private:
         /*
          *      Impl类负责输出日志（通过操作LogStream类）
@@ -96,9 +124,10 @@ namespace muduo{
         class Impl{
         public:
             using LogLevel = Logger::LogLevel;
-            Impl(LogLevel level, int old_error, const SourceFile &file, int line);
+            Impl(LogLevel level, int old_error, const SourceFile &file, int line, LogSite *site);
 
             void formatTime();
+            void formatBinaryHeader(LogSite *site, int savedErrno);
             void finish();
 
             Timestamp time_;
@@ -106,34 +135,181 @@ namespace muduo{
             LogLevel level_;
             int line_;
             SourceFile basename_;
+            bool binary_;       // 输出一条二进制记录
         };
 
         Impl impl_;
     };
 
-    extern Logger::LogLevel g_loglevel;     // global loglevel
+    extern Logger::LogLevel g_logLevel;     // global loglevel
     inline Logger::LogLevel Logger::logLevel() {
-        return g_loglevel;
+        return g_logLevel;
+    }
+
+    extern bool g_logBinary;
+    inline bool Logger::binary() {
+        return g_logBinary;
     }
 
+    extern int g_logRateLimit[Logger::NUM_LOG_LEVELS];
+    inline int Logger::rateLimit(LogLevel level) {
+        return g_logRateLimit[level];
+    }
+
+    /*
+     *      LOG_*宏的调用点，每个调用点一个静态对象
+     *      1. 构造函数是constexpr，静态对象在编译期初始化，没有线程安全的初始化检查
+     *      2. 是否输出缓存在state中，平时只读这一个字节，不读全局的级别。第一次执行时（kUnknown）计算并登记，
+     *         之后setLogLevel / setModuleLogLevel修改所有已登记的调用点
+     *      3. 二进制模式下日志记录只带调用点的编号，文件名、行号、级别和函数名在第一次使用时以调用点记录输出一次
+     *      4. 采样（LOG_EVERY_N / LOG_FIRST_N / LOG_EVERY_MS）和每秒预算的计数器，只用原子变量，不加锁。
+     *         被丢弃的行数记在suppressed中，由这个调用点下一次输出的行带出："[N suppressed] "
+     */
+    struct LogSite : noncopyable{
+        enum State{
+            kUnknown = -1,
+            kDisabled = 0,
+            kEnabled = 1,
+        };
+
+        constexpr LogSite(const char *sourcePath, int sourceLine, Logger::LogLevel logLevel)
+                : path(sourcePath), line(sourceLine), level(logLevel), state(kUnknown),
+                  basename(NULL), basenameSize(0), func(NULL), next(NULL),
+                  id(0), count(0), nextMs(0), suppressed(0){
+        }
+
+        // funcName只在第一次执行时记录
+        bool enabled(const char *funcName){
+            int s = state.load(std::memory_order_acquire);
+            return s == kEnabled || (s == kUnknown && initialize(funcName));
+        }
+
+        // 以下几个函数决定这一次是否输出，参数是宏的n / ms
+
+        bool always(int64_t){
+            return admit();
+        }
+
+        // 第1、n+1、2n+1 ...次输出
+        bool everyN(int64_t n){
+            uint64_t c = count.fetch_add(1, std::memory_order_relaxed);
+            if(n > 1 && c % static_cast<uint64_t>(n) != 0){
+                return suppress();
+            }
+            return admit();
+        }
+
+        // 只输出前n次，之后不再计数
+        bool firstN(int64_t n){
+            if(count.load(std::memory_order_relaxed) >= static_cast<uint64_t>(n) ||
+               count.fetch_add(1, std::memory_order_relaxed) >= static_cast<uint64_t>(n)){
+                return false;
+            }
+            return admit();
+        }
+
+        // 两次输出至少间隔ms毫秒，多个线程同时到达时只有CAS成功的一个输出
+        bool everyMs(int64_t ms);
+
+        bool admit(){
+            return level == Logger::FATAL || Logger::rateLimit(level) == 0 || consumeBudget();
+        }
+
+        bool suppress(){
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        bool consumeBudget();
+
+        // 登记调用点，计算state
+        bool initialize(const char *funcName);
+
+        const char *const path;         // __FILE__
+        const int line;
+        const Logger::LogLevel level;
+        std::atomic<int> state;
+
+        // 以下在initialize()中设置，state不是kUnknown之后才能读
+        const char *basename;
+        int basenameSize;
+        const char *func;               // 只有TRACE和DEBUG记录函数名
+        LogSite *next;                  // 所有已登记的调用点组成的链表
+
+        std::atomic<uint32_t> id;       // 0表示还没有分配编号
+        std::atomic<uint64_t> count;    // LOG_EVERY_N / LOG_FIRST_N 经过的次数
+        std::atomic<int64_t> nextMs;    // LOG_EVERY_MS 下一次可以输出的时间
+        std::atomic<uint64_t> suppressed;
+    };
+
+    // 编译期去掉的LOG_*，展开成从不执行的语句，参数仍然做类型检查
+    LogStream &nullLogStream();
+
+/*
+ *      编译期的最低级别：0 TRACE，1 DEBUG，2 INFO（可以用-DMUDUO_LOG_MIN_LEVEL=N或者cmake的同名变量设置）
+ *      低于它的LOG_*在预处理时就换成空语句，参数不会求值。WARN / ERROR / FATAL不能去掉，超过2按2处理
+ */
+#ifndef MUDUO_LOG_MIN_LEVEL
+#define MUDUO_LOG_MIN_LEVEL 0
+#endif
+
 /*
  *      定义一些 LOG_* 宏方便使用
  *      1. 用法： LOG_* << "..." << "......";
  *      2. 附带过滤功能，如果LOG_*比当前的loglevel低级，那么这些Log语句是空操作，不影响性能。
  *      3. WARN / ERROR / FATAL 这些级别的日志是很重要的，所以不能过滤
+ *      4. MUDUO_LOG_SITE用一个lambda的静态局部变量为每个调用点生成一个LogSite，由LogSite::state和sampler
+ *         决定这一次是否输出，不输出时返回NULL。__func__在lambda里面是"operator()"，所以从外面传进去
+ *      5. 用只执行一次的for代替if，宏后面的else不会和宏里面的if配对
  *
  */
-#define LOG_TRACE if (muduo::Logger::logLevel() <= muduo::Logger::TRACE) \
-  muduo::Logger(__FILE__, __LINE__, muduo::Logger::TRACE, __func__).stream()
-#define LOG_DEBUG if (muduo::Logger::logLevel() <= muduo::Logger::DEBUG) \
-  muduo::Logger(__FILE__, __LINE__, muduo::Logger::DEBUG, __func__).stream()
-#define LOG_INFO if (muduo::Logger::logLevel() <= muduo::Logger::INFO) \
-  muduo::Logger(__FILE__, __LINE__).stream()
-#define LOG_WARN muduo::Logger(__FILE__, __LINE__, muduo::Logger::WARN).stream()
-#define LOG_ERROR muduo::Logger(__FILE__, __LINE__, muduo::Logger::ERROR).stream()
-#define LOG_FATAL muduo::Logger(__FILE__, __LINE__, muduo::Logger::FATAL).stream()
-#define LOG_SYSERR muduo::Logger(__FILE__, __LINE__, false).stream()
-#define LOG_SYSFATAL muduo::Logger(__FILE__, __LINE__, true).stream()
+#define MUDUO_LOG_SITE(level, func, sampler, n) \
+  [](const char *muduoLogFunc, int64_t muduoLogN) -> muduo::LogSite * { \
+    static muduo::LogSite muduoStaticLogSite(__FILE__, __LINE__, level); \
+    if (level < MUDUO_LOG_MIN_LEVEL && level < muduo::Logger::WARN) return NULL; \
+    return muduoStaticLogSite.enabled(muduoLogFunc) && muduoStaticLogSite.sampler(muduoLogN) ? \
+        &muduoStaticLogSite : NULL; \
+  }(func, n)
+
+#define MUDUO_LOG_IF(level, func, sampler, n, savedErrno) \
+  for (muduo::LogSite *muduoLogSite = MUDUO_LOG_SITE(level, func, sampler, n); \
+       muduoLogSite != NULL; muduoLogSite = NULL) \
+    muduo::Logger(muduoLogSite, savedErrno).stream()
+
+#define MUDUO_LOG_DISCARD while (false) muduo::nullLogStream()
+
+#if MUDUO_LOG_MIN_LEVEL <= 0
+#define LOG_TRACE MUDUO_LOG_IF(muduo::Logger::TRACE, __func__, always, 0, 0)
+#else
+#define LOG_TRACE MUDUO_LOG_DISCARD
+#endif
+#if MUDUO_LOG_MIN_LEVEL <= 1
+#define LOG_DEBUG MUDUO_LOG_IF(muduo::Logger::DEBUG, __func__, always, 0, 0)
+#else
+#define LOG_DEBUG MUDUO_LOG_DISCARD
+#endif
+#if MUDUO_LOG_MIN_LEVEL <= 2
+#define LOG_INFO MUDUO_LOG_IF(muduo::Logger::INFO, NULL, always, 0, 0)
+#else
+#define LOG_INFO MUDUO_LOG_DISCARD
+#endif
+#define LOG_WARN MUDUO_LOG_IF(muduo::Logger::WARN, NULL, always, 0, 0)
+#define LOG_ERROR MUDUO_LOG_IF(muduo::Logger::ERROR, NULL, always, 0, 0)
+#define LOG_FATAL MUDUO_LOG_IF(muduo::Logger::FATAL, NULL, always, 0, 0)
+#define LOG_SYSERR MUDUO_LOG_IF(muduo::Logger::ERROR, NULL, always, 0, errno)
+#define LOG_SYSFATAL MUDUO_LOG_IF(muduo::Logger::FATAL, NULL, always, 0, errno)
+
+/*
+ *      采样的日志，level是TRACE / DEBUG / INFO / WARN / ERROR，计数器属于调用点：
+ *      LOG_EVERY_N(ERROR, 100) << ...;     第1、101、201 ...次输出
+ *      LOG_FIRST_N(WARN, 10) << ...;       只输出前10次
+ *      LOG_EVERY_MS(ERROR, 1000) << ...;   每秒最多输出一次
+ *      被丢弃的行数由下一次输出的行带出
+ */
+#define MUDUO_LOG_FUNC(level) (muduo::Logger::level <= muduo::Logger::DEBUG ? __func__ : NULL)
+#define LOG_EVERY_N(level, n) MUDUO_LOG_IF(muduo::Logger::level, MUDUO_LOG_FUNC(level), everyN, n, 0)
+#define LOG_FIRST_N(level, n) MUDUO_LOG_IF(muduo::Logger::level, MUDUO_LOG_FUNC(level), firstN, n, 0)
+#define LOG_EVERY_MS(level, ms) MUDUO_LOG_IF(muduo::Logger::level, MUDUO_LOG_FUNC(level), everyMs, ms, 0)
 
     /*
      *      根据errno返回相应的错误提示
@@ -0,0 +1,362 @@
+//
+// Created by chen on 2022/12/07.
+//
+
+#include "MmapRingLog.h"
+#include "Logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+using namespace muduo;
+
+struct MmapRingLog::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t capacity;
+    std::atomic<uint64_t> writeIndex;
+    std::atomic<uint64_t> nextSeq;
+};
+
+namespace muduo {
+    namespace detail {
+
+        static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "atomics in the mapped file must be lock free");
+
+        const char kRingMagic[8] = {'M', 'U', 'D', 'U', 'O', 'R', 'N', 'G'};
+        const uint32_t kRingVersion = 1;
+        const size_t kRingHeaderSize = 4096;
+        const size_t kRingRecordHeader = 4 + 4 + 8;
+        const uint32_t kRecordTag = 0xA5;           // 不是ASCII，文本日志中不会出现
+        const uint32_t kPaddingTag = 0x5A;
+        const uint32_t kMaxRecordLength = 0xFFFFFF;
+
+        uint64_t alignRecord(uint64_t size) {
+            return (size + 7) & ~static_cast<uint64_t>(7);
+        }
+
+        /*
+         *      CRC-32C（Castagnoli）。x86上有SSE4.2时用crc32指令，否则查表，每次处理8个字节（slicing-by-8）。
+         *      crc是前一段的结果，第一段传0
+         */
+        struct Crc32cTable {
+            Crc32cTable() {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t crc = i;
+                    for (int k = 0; k < 8; ++k) {
+                        crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+                    }
+                    table[0][i] = crc;
+                }
+                for (uint32_t i = 0; i < 256; ++i) {
+                    for (int k = 1; k < 8; ++k) {
+                        table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+                    }
+                }
+            }
+
+            uint32_t table[8][256];
+        };
+
+        uint32_t crc32cSoftware(uint32_t crc, const char *data, size_t len) {
+            static const Crc32cTable crcTable;
+            const uint32_t (*t)[256] = crcTable.table;
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+            crc = ~crc;
+            while (len >= 8) {
+                uint64_t word;
+                ::memcpy(&word, p, sizeof word);
+                word ^= crc;
+                crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^
+                      t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF] ^
+                      t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^
+                      t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+                p += 8;
+                len -= 8;
+            }
+            while (len-- > 0) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+            }
+            return ~crc;
+        }
+
+#if defined(__x86_64__)
+        __attribute__((target("sse4.2")))
+        uint32_t crc32cHardware(uint32_t crc, const char *data, size_t len) {
+            uint64_t c = ~crc;
+            while (len >= 8) {
+                uint64_t word;
+                ::memcpy(&word, data, sizeof word);
+                c = _mm_crc32_u64(c, word);
+                data += 8;
+                len -= 8;
+            }
+            uint32_t c32 = static_cast<uint32_t>(c);
+            while (len-- > 0) {
+                c32 = _mm_crc32_u8(c32, static_cast<unsigned char>(*data++));
+            }
+            return ~c32;
+        }
+#endif
+
+        typedef uint32_t (*Crc32cFunc)(uint32_t crc, const char *data, size_t len);
+
+        Crc32cFunc chooseCrc32c() {
+#if defined(__x86_64__)
+            if (__builtin_cpu_supports("sse4.2")) {
+                return crc32cHardware;
+            }
+#endif
+            return crc32cSoftware;
+        }
+
+        uint32_t crc32c(uint32_t crc, const char *data, size_t len) {
+            static const Crc32cFunc func = chooseCrc32c();
+            return func(crc, data, len);
+        }
+
+        // 记录的crc：tag和len，然后是seq和logline
+        uint32_t recordChecksum(uint32_t word, const char *record, size_t len) {
+            uint32_t crc = crc32c(0, reinterpret_cast<const char *>(&word), sizeof word);
+            return crc32c(crc, record + 8, 8 + len);
+        }
+
+        size_t roundUpCapacity(size_t capacity) {
+            size_t n = 64 * 1024;
+            while (n < capacity) {
+                n <<= 1;
+            }
+            return n;
+        }
+
+        enum RingFileState { kRingFile, kUninitialized, kNotRingFile };
+
+        /*
+         *      读文件头部：magic、版本正确，容量是构造函数能得到的值（64KB以上的2的幂）并且文件大小等于头部加容量时
+         *      是环形日志，capacity返回文件中的容量。magic全是0时文件还没有初始化（初始化的中途崩溃）
+         */
+        RingFileState checkRingHeader(int fd, off_t fileSize, uint64_t *capacity) {
+            // Header：magic 8 | version 4 | headerSize 4 | capacity 8
+            char magic[sizeof kRingMagic];
+            uint32_t version = 0;
+            uint64_t onDisk = 0;
+            if (::pread(fd, magic, sizeof magic, 0) != static_cast<ssize_t>(sizeof magic)) {
+                return kNotRingFile;
+            }
+            const char kZero[sizeof kRingMagic] = {};
+            if (::memcmp(magic, kZero, sizeof magic) == 0) {
+                return kUninitialized;
+            }
+            if (::memcmp(magic, kRingMagic, sizeof magic) != 0 ||
+                ::pread(fd, &version, sizeof version, 8) != static_cast<ssize_t>(sizeof version) ||
+                ::pread(fd, &onDisk, sizeof onDisk, 16) != static_cast<ssize_t>(sizeof onDisk)) {
+                return kNotRingFile;
+            }
+            if (version != kRingVersion || onDisk < 64 * 1024 || (onDisk & (onDisk - 1)) != 0 ||
+                static_cast<uint64_t>(fileSize) != kRingHeaderSize + onDisk) {
+                return kNotRingFile;
+            }
+            *capacity = onDisk;
+            return kRingFile;
+        }
+
+    }  // namespace detail
+}  // namespace muduo
+
+/*
+ *      文件中已经是环形日志时按文件头部的容量接着写，不管传入的capacity：
+ *      进程崩溃重启后容量配置变了，也不能在恢复之前覆盖上次崩溃留下的日志。
+ *      空文件或者从未初始化的文件（magic全是0）才重新初始化；其它文件不是环形日志，不覆盖，valid()返回false。
+ *      要改变容量，先用recover()取出日志，再删除文件。
+ *      整个文件先用posix_fallocate()分配好磁盘空间，写映射内存时不会因为磁盘满而收到SIGBUS；
+ *      MAP_POPULATE预先建立页表，写日志时没有缺页
+ */
+MmapRingLog::MmapRingLog(const string &filename, size_t capacity)
+        : header_(nullptr),
+          ring_(nullptr),
+          capacity_(detail::roundUpCapacity(capacity)),
+          mappedSize_(detail::kRingHeaderSize + capacity_) {
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "MmapRingLog: cannot open %s: %s\n", filename.c_str(), strerror_tl(errno));
+        return;
+    }
+    struct stat statbuf;
+    if (::fstat(fd, &statbuf) != 0) {
+        fprintf(stderr, "MmapRingLog: cannot stat %s: %s\n", filename.c_str(), strerror_tl(errno));
+        ::close(fd);
+        return;
+    }
+    bool reuse = false;
+    if (statbuf.st_size > 0) {
+        uint64_t onDisk = 0;
+        switch (detail::checkRingHeader(fd, statbuf.st_size, &onDisk)) {
+            case detail::kRingFile:
+                if (onDisk != capacity_) {
+                    fprintf(stderr, "MmapRingLog: %s keeps its capacity %llu instead of %zu\n",
+                            filename.c_str(), static_cast<unsigned long long>(onDisk), capacity_);
+                    capacity_ = static_cast<size_t>(onDisk);
+                    mappedSize_ = detail::kRingHeaderSize + capacity_;
+                }
+                reuse = true;
+                break;
+            case detail::kUninitialized:
+                break;
+            case detail::kNotRingFile:
+                fprintf(stderr, "MmapRingLog: %s is not a ring log file, not overwriting it\n", filename.c_str());
+                ::close(fd);
+                return;
+        }
+    }
+    int err = 0;
+    if (!reuse && ::ftruncate(fd, 0) != 0) {
+        err = errno;
+    } else if (!reuse) {
+        err = ::posix_fallocate(fd, 0, static_cast<off_t>(mappedSize_));
+    }
+    void *p = MAP_FAILED;
+    if (err == 0) {
+        p = ::mmap(NULL, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        err = p == MAP_FAILED ? errno : 0;
+    }
+    ::close(fd);
+    if (err != 0) {
+        fprintf(stderr, "MmapRingLog: cannot map %s: %s\n", filename.c_str(), strerror_tl(err));
+        return;
+    }
+
+    Header *header = static_cast<Header *>(p);
+    if (!reuse) {
+        ::memset(p, 0, detail::kRingHeaderSize);
+        ::memcpy(header->magic, detail::kRingMagic, sizeof header->magic);
+        header->version = detail::kRingVersion;
+        header->headerSize = static_cast<uint32_t>(detail::kRingHeaderSize);
+        header->capacity = capacity_;
+        header->writeIndex.store(0);
+        header->nextSeq.store(0);
+    }
+    header_ = header;
+    ring_ = static_cast<char *>(p) + detail::kRingHeaderSize;
+}
+
+MmapRingLog::~MmapRingLog() {
+    if (header_) {
+        ::munmap(header_, mappedSize_);
+    }
+}
+
+/*
+ *      先用CAS预留空间（末尾放不下时连同末尾的填充一起预留），再取序号。
+ *      慢的线程还没写完时，其它线程如果已经绕环一圈写到同一位置，两条记录都可能损坏，恢复时被crc发现
+ */
+void MmapRingLog::append(const char *logline, int len) {
+    if (header_ == nullptr) {
+        return;
+    }
+    size_t maxLength = std::min(capacity_ / 4, static_cast<size_t>(detail::kMaxRecordLength)) -
+                       detail::kRingRecordHeader;
+    size_t n = std::min(static_cast<size_t>(len), maxLength);
+    uint64_t size = detail::alignRecord(detail::kRingRecordHeader + n);
+    uint64_t mask = capacity_ - 1;
+
+    uint64_t pos = header_->writeIndex.load(std::memory_order_relaxed);
+    uint64_t start;
+    do {
+        uint64_t remain = capacity_ - (pos & mask);
+        start = remain < size ? pos + remain : pos;
+    } while (!header_->writeIndex.compare_exchange_weak(pos, start + size, std::memory_order_relaxed));
+    if (start != pos) {
+        writePadding(pos & mask, start - pos);
+    }
+    uint64_t seq = header_->nextSeq.fetch_add(1, std::memory_order_relaxed);
+
+    char *p = ring_ + (start & mask);
+    uint32_t word = detail::kRecordTag << 24 | static_cast<uint32_t>(n);
+    ::memcpy(p + 8, &seq, sizeof seq);
+    ::memcpy(p + detail::kRingRecordHeader, logline, n);
+    uint32_t crc = detail::recordChecksum(word, p, n);
+    ::memcpy(p + 4, &crc, sizeof crc);
+    reinterpret_cast<std::atomic<uint32_t> *>(p)->store(word, std::memory_order_release);
+}
+
+void MmapRingLog::writePadding(uint64_t offset, uint64_t size) {
+    uint32_t word = detail::kPaddingTag << 24 | static_cast<uint32_t>(size & detail::kMaxRecordLength);
+    reinterpret_cast<std::atomic<uint32_t> *>(ring_ + offset)->store(word, std::memory_order_release);
+}
+
+uint64_t MmapRingLog::nextSeq() const {
+    return header_ ? header_->nextSeq.load(std::memory_order_relaxed) : 0;
+}
+
+/*
+ *      按8字节对齐扫描：crc正确时跳过整条记录（完整的记录之间不会重叠），否则前进8字节
+ */
+bool MmapRingLog::recover(const string &ringFile, std::vector<Record> *records, int64_t *badRecords) {
+    *badRecords = 0;
+    int fd = ::open(ringFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat statbuf;
+    if (::fstat(fd, &statbuf) != 0 || statbuf.st_size < static_cast<off_t>(detail::kRingHeaderSize)) {
+        ::close(fd);
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(statbuf.st_size);
+    void *p = ::mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    const Header *header = static_cast<const Header *>(p);
+    uint64_t capacity = header->capacity;
+    if (::memcmp(header->magic, detail::kRingMagic, sizeof header->magic) != 0 ||
+        header->version != detail::kRingVersion || fileSize != detail::kRingHeaderSize + capacity) {
+        ::munmap(p, fileSize);
+        return false;
+    }
+
+    const char *ring = static_cast<const char *>(p) + detail::kRingHeaderSize;
+    uint64_t offset = 0;
+    while (offset + detail::kRingRecordHeader <= capacity) {
+        const char *record = ring + offset;
+        uint32_t word;
+        ::memcpy(&word, record, sizeof word);
+        size_t n = word & detail::kMaxRecordLength;
+        uint64_t size = detail::alignRecord(detail::kRingRecordHeader + n);
+        if (word >> 24 == detail::kRecordTag && size <= capacity - offset) {
+            uint32_t crc;
+            ::memcpy(&crc, record + 4, sizeof crc);
+            if (crc == detail::recordChecksum(word, record, n)) {
+                Record r;
+                ::memcpy(&r.seq, record + 8, sizeof r.seq);
+                r.logline.assign(record + detail::kRingRecordHeader, n);
+                records->push_back(std::move(r));
+                offset += size;
+                continue;
+            }
+            ++*badRecords;
+        }
+        offset += 8;
+    }
+    ::munmap(p, fileSize);
+
+    std::sort(records->begin(), records->end(), [](const Record &a, const Record &b) {
+        return a.seq < b.seq;
+    });
+    return true;
+}
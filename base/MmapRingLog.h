@@ -0,0 +1,78 @@
+//
+// Created by chen on 2022/12/07.
+//
+
+/*
+ *      MmapRingLog：写在内存映射文件中的环形日志
+ *
+ *      AsyncLogging的日志在缓冲中等待后端线程写入，进程崩溃时最后几秒的日志就丢了，而这恰恰是最需要的。
+ *      MmapRingLog把每条日志直接写进MAP_SHARED映射的文件，写完就在page cache中，进程崩溃后仍然可以读出来；
+ *      每条日志没有系统调用。机器掉电时不保证。
+ *
+ *      1. 文件：| 头部 4KB | 环 capacity |，头部保存容量、写入位置和下一个序号，重新打开同一个文件时接着写，
+ *         容量以文件中的为准。不是环形日志的文件不会被覆盖
+ *      2. 记录：| tag 1 + len 3 | crc32c 4 | seq 8 | logline | 补齐到8字节 |
+ *         crc覆盖tag、len、seq和logline。记录不跨越环的末尾，末尾放不下时写一个填充记录，从头开始写
+ *      3. 多个线程用CAS在环上预留空间，互不等待。tag和len最后写：进程在写一条记录的中途崩溃时，
+ *         这条记录的crc对不上，恢复时丢弃
+ *      4. 恢复（recover）不依赖头部的写入位置：按8字节对齐扫描整个环，取出crc正确的记录，按seq排序。
+ *         被新记录覆盖了一部分的旧记录crc对不上，同样丢弃
+ *      5. 一条日志最多capacity / 4字节，超过时截断
+ */
+
+#ifndef MYMUDUO_MMAPRINGLOG_H
+#define MYMUDUO_MMAPRINGLOG_H
+
+#include "noncopyable.h"
+#include "Types.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace muduo {
+
+    class MmapRingLog : noncopyable {
+    public:
+        static const size_t kDefaultCapacity = 64 * 1024 * 1024;
+
+        struct Record {
+            uint64_t seq;
+            string logline;
+        };
+
+        /// capacity is rounded up to a power of two, at least 64KB.
+        /// An existing ring file keeps its own capacity; recover() and remove it to resize.
+        explicit MmapRingLog(const string &filename, size_t capacity = kDefaultCapacity);
+
+        ~MmapRingLog();
+
+        /// False if the file could not be created or mapped, append() does nothing then.
+        bool valid() const { return header_ != nullptr; }
+
+        /// Thread safe, lock free.
+        void append(const char *logline, int len);
+
+        /// Sequence number of the next record.
+        uint64_t nextSeq() const;
+
+        /*
+         *      读出ringFile中所有完整的记录，按seq排序。
+         *      badRecords是tag正确但crc不对的记录数（写到一半或者被覆盖了一部分）。不是环形日志文件时返回false
+         */
+        static bool recover(const string &ringFile, std::vector<Record> *records, int64_t *badRecords);
+
+    private:
+        struct Header;
+
+        void writePadding(uint64_t offset, uint64_t size);
+
+        Header *header_;
+        char *ring_;
+        size_t capacity_;
+        size_t mappedSize_;
+    };
+
+}  // namespace muduo
+
+#endif //MYMUDUO_MMAPRINGLOG_H
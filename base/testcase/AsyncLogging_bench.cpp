@@ -0,0 +1,122 @@
+//
+// Created by chen on 2022/12/01.
+//
+
+/*
+ *      AsyncLogging压测：N个线程同时LOG_INFO，统计每秒行数和单次LOG_INFO延迟的p50、p99
+ *
+ *      每一轮共写kTotalLines行，平均分给各个线程；每8次LOG_INFO计时一次。
+ *      日志文件写在当前目录，最好在tmpfs中运行，避免测到磁盘。
+ *
+ *      用法：asynclogging_bench [最多线程数] [text | binary | decode | ring]
+ *      text：文本日志（默认）；binary：二进制日志原样写入文件；decode：二进制日志由后端线程还原成文本；
+ *      ring：文本日志不经过AsyncLogging，直接写入64MB的MmapRingLog（asynclogging_bench.ring）
+ */
+
+#include "../AsyncLogging.h"
+#include "../CountDownLatch.h"
+#include "../Logging.h"
+#include "../MmapRingLog.h"
+#include "../Thread.h"
+#include "../Timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace muduo;
+
+const int kTotalLines = 2 * 1000 * 1000;
+
+AsyncLogging *g_asyncLog = nullptr;
+MmapRingLog *g_ringLog = nullptr;
+
+void asyncOutput(const char *msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+void ringOutput(const char *msg, int len) {
+    g_ringLog->append(msg, len);
+}
+
+int64_t nowNanoseconds() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void producer(int lines, CountDownLatch *start, std::vector<int> *latencies) {
+    latencies->reserve(static_cast<size_t>(lines / 8 + 1));
+    start->wait();
+    for (int i = 0; i < lines; ++i) {
+        if (i % 8 == 0) {
+            int64_t begin = nowNanoseconds();
+            LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+            latencies->push_back(static_cast<int>(nowNanoseconds() - begin));
+        } else {
+            LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+        }
+    }
+}
+
+void bench(int numThreads) {
+    int linesPerThread = kTotalLines / numThreads;
+    CountDownLatch start(1);
+    std::vector<std::vector<int>> latencies(static_cast<size_t>(numThreads));
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(new Thread(std::bind(producer, linesPerThread, &start,
+                                                  &latencies[static_cast<size_t>(i)])));
+        threads.back()->start();
+    }
+    Timestamp begin = Timestamp::now();
+    start.countDown();
+    for (const auto &thread : threads) {
+        thread->join();
+    }
+    double seconds = timeDifference(Timestamp::now(), begin);
+
+    std::vector<int> all;
+    for (const auto &v : latencies) {
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    size_t n = all.size();
+    std::nth_element(all.begin(), all.begin() + n / 2, all.end());
+    int p50 = all[n / 2];
+    std::nth_element(all.begin(), all.begin() + n * 99 / 100, all.end());
+    int p99 = all[n * 99 / 100];
+    printf("%8d %12.0f %10d %10d\n", numThreads, linesPerThread * numThreads / seconds, p50, p99);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : 32;
+    const char *mode = argc > 2 ? argv[2] : "text";
+    bool ring = strcmp(mode, "ring") == 0;
+    AsyncLogging log("asynclogging_bench", 1024 * 1024 * 1024);
+    std::unique_ptr<MmapRingLog> ringLog(ring ? new MmapRingLog("asynclogging_bench.ring") : nullptr);
+    Logger::setBinary(strcmp(mode, "binary") == 0 || strcmp(mode, "decode") == 0);
+    log.setDecodeBinary(strcmp(mode, "decode") == 0);
+    g_asyncLog = &log;
+    g_ringLog = ringLog.get();
+    if (ring) {
+        Logger::setOutput(ringOutput);
+    } else {
+        log.start();
+        Logger::setOutput(asyncOutput);
+    }
+
+    printf("mode: %s\n", mode);
+    printf("%8s %12s %10s %10s\n", "threads", "lines/sec", "p50(ns)", "p99(ns)");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        bench(threads);
+    }
+    if (!ring) {
+        log.stop();
+    }
+}
@@ -0,0 +1,283 @@
+//
+// Created by chen on 2022/12/08.
+//
+
+/*
+ *      AsyncLogging溢出策略和统计测试（在当前目录下写文件）
+ *
+ *      后端启动之前往64KB的ThreadBuffer写5000行，必然写满，然后启动后端写入文件：
+ *      1. kDropNewest：保留最早的若干行
+ *      2. kDropOldest：保留最后的若干行
+ *      3. kSample：超过3/4之前的行全部保留，之后每10行保留一行
+ *      4. kBlock：后端运行时不丢日志，前端会等待
+ *      5. 内存上限：超过上限的线程共用一个ThreadBuffer，不丢日志，每个线程的日志保持顺序；
+ *         上限不足一个ThreadBuffer时所有线程共用一个
+ *      6. kDropOldest压力测试：后端运行时很多短命的线程写满自己的ThreadBuffer，丢弃最旧的日志和后端取走日志同时发生，
+ *         线程退出后ThreadBuffer都能取空释放（memoryBytes回到0），每个线程的日志保持顺序
+ *      每种情况都检查stats()的计数和文件内容一致
+ */
+
+#include "../AsyncLogging.h"
+#include "../CountDownLatch.h"
+#include "../Thread.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+using namespace muduo;
+
+const size_t kBufferSize = 64 * 1024;
+const int kLines = 5000;
+
+std::vector<string> filesWithPrefix(const string &prefix) {
+    std::vector<string> files;
+    DIR *dir = ::opendir(".");
+    assert(dir != NULL);
+    while (struct dirent *entry = ::readdir(dir)) {
+        string name = entry->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            files.push_back(name);
+        }
+    }
+    ::closedir(dir);
+    return files;
+}
+
+void removeFiles(const string &prefix) {
+    for (const string &name : filesWithPrefix(prefix)) {
+        ::unlink(name.c_str());
+    }
+}
+
+// 读出日志文件中每一行的行号
+std::vector<int> readLines(const string &prefix) {
+    std::vector<string> files = filesWithPrefix(prefix);
+    assert(files.size() == 1);
+    std::vector<int> lines;
+    FILE *fp = ::fopen(files[0].c_str(), "r");
+    assert(fp != NULL);
+    char buf[128];
+    while (::fgets(buf, sizeof buf, fp)) {
+        lines.push_back(::atoi(buf + 5));
+    }
+    ::fclose(fp);
+    return lines;
+}
+
+void appendLines(AsyncLogging *log, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        char line[32];
+        int n = snprintf(line, sizeof line, "line %05d\n", i);
+        log->append(line, n);
+    }
+}
+
+void checkStats(const AsyncLogging::Stats &stats, const std::vector<int> &lines, int total) {
+    assert(stats.linesWritten == static_cast<int64_t>(lines.size()));
+    assert(stats.linesWritten + stats.linesDropped == total);
+    assert(stats.bytesWritten == static_cast<int64_t>(lines.size()) * 11);
+    assert(stats.writes > 0);
+    assert(stats.maxWriteMicros <= stats.writeMicros);
+}
+
+std::vector<int> overflow(AsyncLogging::OverflowPolicy policy, AsyncLogging::Stats *stats) {
+    const string prefix = "asynclogging_test.";
+    removeFiles(prefix);
+    AsyncLogging log("asynclogging_test", 1000 * 1000 * 1000, 1, kBufferSize);
+    log.setOverflowPolicy(policy, 10);
+    appendLines(&log, 0, kLines);
+    log.start();
+    log.stop();
+    *stats = log.stats();
+    std::vector<int> lines = readLines(prefix);
+    removeFiles(prefix);
+    checkStats(*stats, lines, kLines);
+    assert(stats->bufferAllocations == 1);
+    assert(stats->memoryBytes == static_cast<int64_t>(kBufferSize));
+    return lines;
+}
+
+void testDropNewest() {
+    AsyncLogging::Stats stats;
+    std::vector<int> lines = overflow(AsyncLogging::kDropNewest, &stats);
+    assert(stats.linesDropped > 0);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        assert(lines[i] == static_cast<int>(i));
+    }
+    printf("drop newest ok, %zu written, %lld dropped\n", lines.size(), static_cast<long long>(stats.linesDropped));
+}
+
+void testDropOldest() {
+    AsyncLogging::Stats stats;
+    std::vector<int> lines = overflow(AsyncLogging::kDropOldest, &stats);
+    assert(stats.linesDropped > 0);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        assert(lines[i] == kLines - static_cast<int>(lines.size() - i));
+    }
+    printf("drop oldest ok, %zu written, %lld dropped\n", lines.size(), static_cast<long long>(stats.linesDropped));
+}
+
+void testSample() {
+    AsyncLogging::Stats stats;
+    std::vector<int> lines = overflow(AsyncLogging::kSample, &stats);
+    assert(stats.linesDropped > 0);
+    size_t kept = 0;
+    while (kept < lines.size() && lines[kept] == static_cast<int>(kept)) {
+        ++kept;
+    }
+    assert(kept > 0 && kept < lines.size());
+    for (size_t i = kept; i < lines.size(); ++i) {
+        assert(lines[i] - lines[i - 1] == 10 || (i == kept && lines[i] - lines[i - 1] <= 10));
+    }
+    assert(lines.back() >= kLines - 10);
+    printf("sample ok, %zu kept, %zu sampled\n", kept, lines.size() - kept);
+}
+
+void testBlock() {
+    const string prefix = "asynclogging_block.";
+    removeFiles(prefix);
+    AsyncLogging log("asynclogging_block", 1000 * 1000 * 1000, 1, kBufferSize);
+    log.start();
+    appendLines(&log, 0, kLines * 10);
+    log.stop();
+    AsyncLogging::Stats stats = log.stats();
+    std::vector<int> lines = readLines(prefix);
+    removeFiles(prefix);
+    checkStats(stats, lines, kLines * 10);
+    assert(stats.linesDropped == 0);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        assert(lines[i] == static_cast<int>(i));
+    }
+    printf("block ok, %lld waits\n", static_cast<long long>(stats.producerWaits));
+}
+
+void testMaxMemory() {
+    const string prefix = "asynclogging_mem.";
+    removeFiles(prefix);
+    AsyncLogging log("asynclogging_mem", 1000 * 1000 * 1000, 1, kBufferSize);
+    log.setMaxMemory(3 * kBufferSize);
+    log.start();
+    // 所有线程都写过一行之后再继续：前两个线程各有一个ThreadBuffer，其余线程共用留出的一个
+    const int kThreads = 6;
+    CountDownLatch ready(kThreads);
+    CountDownLatch go(1);
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back(new Thread([&log, &ready, &go, t]() {
+            appendLines(&log, t * kLines, 1);
+            ready.countDown();
+            go.wait();
+            appendLines(&log, t * kLines + 1, kLines - 1);
+        }));
+        threads.back()->start();
+    }
+    ready.wait();
+    AsyncLogging::Stats stats = log.stats();
+    assert(stats.bufferAllocations == 3);
+    assert(stats.memoryBytes == static_cast<int64_t>(3 * kBufferSize));
+    go.countDown();
+    for (const std::unique_ptr<Thread> &thread : threads) {
+        thread->join();
+    }
+    log.stop();
+    stats = log.stats();
+    std::vector<int> lines = readLines(prefix);
+    removeFiles(prefix);
+    checkStats(stats, lines, kThreads * kLines);
+    assert(stats.linesDropped == 0);
+    std::vector<int> next(kThreads);
+    for (int line : lines) {
+        int t = line / kLines;
+        assert(line == t * kLines + next[static_cast<size_t>(t)]);
+        ++next[static_cast<size_t>(t)];
+    }
+    printf("max memory ok, %lld buffers allocated\n", static_cast<long long>(stats.bufferAllocations));
+}
+
+void testTinyMaxMemory() {
+    const string prefix = "asynclogging_tiny.";
+    removeFiles(prefix);
+    AsyncLogging log("asynclogging_tiny", 1000 * 1000 * 1000, 1, kBufferSize);
+    log.setMaxMemory(1000);
+    log.start();
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back(new Thread([&log, t]() {
+            appendLines(&log, t * kLines, kLines);
+        }));
+        threads.back()->start();
+    }
+    for (const std::unique_ptr<Thread> &thread : threads) {
+        thread->join();
+    }
+    AsyncLogging::Stats stats = log.stats();
+    assert(stats.bufferAllocations == 1);
+    assert(stats.memoryBytes == static_cast<int64_t>(kBufferSize));
+    log.stop();
+    stats = log.stats();
+    std::vector<int> lines = readLines(prefix);
+    removeFiles(prefix);
+    checkStats(stats, lines, 3 * kLines);
+    assert(stats.linesDropped == 0);
+    printf("tiny max memory ok\n");
+}
+
+void testDropOldestRace() {
+    const string prefix = "asynclogging_race.";
+    removeFiles(prefix);
+    AsyncLogging log("asynclogging_race", 1000 * 1000 * 1000, 1, kBufferSize);
+    log.setOverflowPolicy(AsyncLogging::kDropOldest);
+    log.start();
+    const int kRounds = 5;          // 行号不超过5位
+    const int kThreads = 4;
+    for (int round = 0; round < kRounds; ++round) {
+        std::vector<std::unique_ptr<Thread>> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            int first = (round * kThreads + t) * kLines;
+            threads.emplace_back(new Thread([&log, first]() {
+                appendLines(&log, first, kLines);
+            }));
+            threads.back()->start();
+        }
+        for (const std::unique_ptr<Thread> &thread : threads) {
+            thread->join();
+        }
+    }
+    // 退出的线程的ThreadBuffer在后端下一次取空后释放
+    AsyncLogging::Stats stats = log.stats();
+    for (int i = 0; i < 50 && stats.memoryBytes != 0; ++i) {
+        ::usleep(100 * 1000);
+        stats = log.stats();
+    }
+    assert(stats.memoryBytes == 0);
+    assert(stats.bufferAllocations == kRounds * kThreads);
+    log.stop();
+    stats = log.stats();
+    std::vector<int> lines = readLines(prefix);
+    removeFiles(prefix);
+    checkStats(stats, lines, kRounds * kThreads * kLines);
+    std::vector<int> last(kRounds * kThreads, -1);
+    for (int line : lines) {
+        size_t t = static_cast<size_t>(line / kLines);
+        assert(line > last[t]);
+        last[t] = line;
+    }
+    printf("drop oldest race ok, %lld written, %lld dropped\n",
+           static_cast<long long>(stats.linesWritten), static_cast<long long>(stats.linesDropped));
+}
+
+int main() {
+    testDropNewest();
+    testDropOldest();
+    testSample();
+    testBlock();
+    testMaxMemory();
+    testTinyMaxMemory();
+    testDropOldestRace();
+}
@@ -0,0 +1,146 @@
+//
+// Created by chen on 2022/12/02.
+//
+
+/*
+ *      二进制日志测试
+ *
+ *      1. 同样的日志语句分别以文本模式和二进制模式输出，二进制记录还原后和文本相同（去掉时间）
+ *      2. 记录被任意切开时，decode()只消费完整的记录，拼起来的结果不变
+ *      3. 记录之间的垃圾字节被跳过并计数
+ *      4. 输出调用点记录时g_output等待另一个线程调用findSite()（AsyncLogging的环满、后端还原日志时就是这样），
+ *         不能死锁
+ */
+
+#include "../BinaryLog.h"
+#include "../Logging.h"
+#include "../Thread.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+using namespace muduo;
+
+string g_captured;
+
+void captureOutput(const char *msg, int len) {
+    g_captured.append(msg, static_cast<size_t>(len));
+}
+
+void logLines() {
+    for (int i = 0; i < 3; ++i) {
+        LOG_INFO << "int " << i << ' ' << -1234567890123LL << ' ' << 4000000000U
+                 << " short " << static_cast<short>(-7) << " double " << 3.14159 << ' ' << 1.5f
+                 << " bool " << true << " ptr " << &g_captured;
+        LOG_DEBUG << "string " << string(100, 'x') << " piece " << StringPiece("abc")
+                  << " fmt " << Fmt("%.3f", 2.0) << " null " << static_cast<const char *>(NULL);
+        LOG_WARN << "empty" << "";
+        errno = ENOENT;
+        LOG_SYSERR << "syserr " << i;
+        Logger(__FILE__, __LINE__, Logger::ERROR).stream() << "without site " << i;
+    }
+}
+
+std::atomic<bool> g_found(false);
+
+void findSiteInBackend() {
+    BinaryLog::findSite(1);
+    g_found = true;
+}
+
+// 像AsyncLogging的前端一样，等“后端”查找过调用点之后才返回
+void blockingOutput(const char *msg, int len) {
+    if (static_cast<uint8_t>(msg[0]) != BinaryLog::kSiteRecord) {
+        return;
+    }
+    g_found = false;
+    Thread backend(findSiteInBackend);
+    backend.start();
+    for (int i = 0; i < 200 && !g_found; ++i) {
+        ::usleep(10 * 1000);
+    }
+    if (!g_found) {
+        printf("deadlock: findSite() waits for registerSite()\n");
+        abort();
+    }
+    backend.join();
+}
+
+void testNoDeadlock() {
+    Logger::setOutput(blockingOutput);
+    Logger::setBinary(true);
+    LOG_INFO << "new site " << 1;
+    Logger::setBinary(false);
+    Logger::setOutput(captureOutput);
+    printf("no deadlock ok\n");
+}
+
+// 去掉每行开头的时间：20221202 12:00:00.123456Z
+string stripTime(const string &text) {
+    string result;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        assert(eol != string::npos);
+        result.append(text, pos + 26, eol + 1 - pos - 26);
+        pos = eol + 1;
+    }
+    return result;
+}
+
+int main() {
+    Logger::setLogLevel(Logger::DEBUG);
+    Logger::setOutput(captureOutput);
+
+    logLines();
+    string text = g_captured;
+
+    g_captured.clear();
+    Logger::setBinary(true);
+    logLines();
+    Logger::setBinary(false);
+    string binary = g_captured;
+    assert(binary.size() < text.size());
+
+    BinaryLogDecoder decoder;
+    string decoded;
+    assert(decoder.decode(binary.data(), binary.size(), &decoded) == binary.size());
+    assert(decoder.errors() == 0);
+    assert(stripTime(decoded) == stripTime(text));
+    printf("binary %zu bytes, text %zu bytes\n", binary.size(), text.size());
+
+    // 随机切开
+    for (int round = 0; round < 100; ++round) {
+        BinaryLogDecoder splitDecoder;
+        string pending;
+        string result;
+        size_t pos = 0;
+        while (pos < binary.size()) {
+            size_t n = std::min(binary.size() - pos, static_cast<size_t>(rand() % 200));
+            pending.append(binary, pos, n);
+            pos += n;
+            pending.erase(0, splitDecoder.decode(pending.data(), pending.size(), &result));
+        }
+        assert(pending.empty());
+        assert(result == decoded);
+        assert(splitDecoder.errors() == 0);
+    }
+
+    // 从中间开始并且前面有垃圾字节，调用点从本进程查找
+    string garbage = "garbage" + binary.substr(binary.size() / 2);
+    string tail;
+    BinaryLogDecoder freshDecoder(true);
+    assert(freshDecoder.decode(garbage.data(), garbage.size(), &tail) > 0);
+    assert(freshDecoder.errors() >= 7);
+    assert(decoded.find(tail.substr(tail.find('\n') + 1)) != string::npos);
+    printf("binary log ok\n");
+
+    testNoDeadlock();
+}
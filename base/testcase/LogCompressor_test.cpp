@@ -0,0 +1,156 @@
+//
+// Created by chen on 2022/12/06.
+//
+
+/*
+ *      日志压缩测试（在当前目录下写文件）
+ *
+ *      1. 直接写gzip流：flush()之后，文件还没有关闭也能解压出已经写入的全部日志
+ *      2. 后台压缩：限速1MB/s压缩1MB的文件，至少用1秒，解压后和原文件相同，原文件被删除
+ *      3. 队列满时compress()返回false；stop()放弃正在压缩的文件，不留下.gz和.tmp
+ */
+
+#include "../LogCompressor.h"
+#include "../LogFile.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <vector>
+
+#ifdef MUDUO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace muduo;
+
+#ifdef MUDUO_HAVE_ZLIB
+
+std::vector<string> filesWithPrefix(const string &prefix) {
+    std::vector<string> files;
+    DIR *dir = ::opendir(".");
+    assert(dir != NULL);
+    while (struct dirent *entry = ::readdir(dir)) {
+        string name = entry->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            files.push_back(name);
+        }
+    }
+    ::closedir(dir);
+    return files;
+}
+
+void removeFiles(const string &prefix) {
+    for (const string &name : filesWithPrefix(prefix)) {
+        ::unlink(name.c_str());
+    }
+}
+
+string gunzip(const string &filename) {
+    gzFile file = gzopen(filename.c_str(), "rb");
+    assert(file != NULL);
+    string content;
+    char buf[4096];
+    int n;
+    while ((n = gzread(file, buf, sizeof buf)) > 0) {
+        content.append(buf, static_cast<size_t>(n));
+    }
+    gzclose(file);
+    return content;
+}
+
+string makeContent(size_t size) {
+    string content;
+    for (int i = 0; content.size() < size; ++i) {
+        char line[128];
+        snprintf(line, sizeof line, "20221206 12:00:00.%06d 1234 INFO  line %d - LogCompressor_test.cpp:42\n",
+                 i % 1000000, i);
+        content += line;
+    }
+    return content;
+}
+
+void writeFile(const string &filename, const string &content) {
+    FILE *fp = ::fopen(filename.c_str(), "w");
+    assert(fp != NULL);
+    ::fwrite(content.data(), 1, content.size(), fp);
+    ::fclose(fp);
+}
+
+void testCompressOutput() {
+    removeFiles("logcompressor_test.");
+    string content = makeContent(200 * 1000);
+    {
+        LogFile file("logcompressor_test", 1000 * 1000 * 1000, false, 3, 1024, true);
+        file.append(content.data(), static_cast<int>(content.size()));
+        file.flush();
+        std::vector<string> files = filesWithPrefix("logcompressor_test.");
+        assert(files.size() == 1);
+        assert(files[0].find(".log.gz") != string::npos);
+        // 同步点之后没有gzip的结尾，gzread读到末尾时报错，但数据都在
+        string partial = gunzip(files[0]);
+        assert(partial == content);
+    }
+    std::vector<string> files = filesWithPrefix("logcompressor_test.");
+    assert(gunzip(files[0]) == content);
+    removeFiles("logcompressor_test.");
+    printf("compress output ok\n");
+}
+
+void testBackground() {
+    removeFiles("logcompressor_bg.");
+    string content = makeContent(1000 * 1000);
+    writeFile("logcompressor_bg.1.log", content);
+
+    LogCompressor compressor(4, 1000 * 1000);
+    compressor.start();
+    Timestamp start = Timestamp::now();
+    assert(compressor.compress("logcompressor_bg.1.log"));
+    while (compressor.compressedFiles() == 0) {
+        ::usleep(10 * 1000);
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    assert(seconds >= 0.9);
+    assert(::access("logcompressor_bg.1.log", F_OK) != 0);
+    assert(gunzip("logcompressor_bg.1.log.gz") == content);
+    compressor.stop();
+    removeFiles("logcompressor_bg.");
+    printf("background ok, %.2f seconds\n", seconds);
+}
+
+void testQueueFull() {
+    removeFiles("logcompressor_q.");
+    string content = makeContent(1000 * 1000);
+    writeFile("logcompressor_q.1.log", content);
+    writeFile("logcompressor_q.2.log", content);
+    writeFile("logcompressor_q.3.log", content);
+
+    LogCompressor compressor(1, 1000 * 1000);
+    compressor.start();
+    assert(compressor.compress("logcompressor_q.1.log"));
+    ::usleep(100 * 1000);           // 第一个文件已经开始压缩
+    assert(compressor.compress("logcompressor_q.2.log"));
+    assert(!compressor.compress("logcompressor_q.3.log"));
+    compressor.stop();
+    assert(compressor.compressedFiles() == 0);
+    assert(filesWithPrefix("logcompressor_q.").size() == 3);
+    assert(!compressor.compress("logcompressor_q.3.log"));
+    removeFiles("logcompressor_q.");
+    printf("queue full ok\n");
+}
+
+int main() {
+    testCompressOutput();
+    testBackground();
+    testQueueFull();
+}
+
+#else
+
+int main() {
+    printf("built without zlib, LogCompressor::available() = %d\n", LogCompressor::available());
+}
+
+#endif
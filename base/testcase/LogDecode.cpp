@@ -0,0 +1,84 @@
+//
+// Created by chen on 2022/12/02.
+//
+
+/*
+ *      logdecode：把二进制日志还原成文本，输出到stdout
+ *
+ *      日志文件滚动后，调用点记录只在之前的文件中，所以要按顺序给出同一个进程的所有文件。
+ *      第一遍只收集调用点记录，第二遍还原，这样也不依赖调用点记录和日志记录的先后顺序。
+ *
+ *      用法：logdecode 日志文件...
+ */
+
+#include "../BinaryLog.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <functional>
+
+using namespace muduo;
+
+const size_t kChunkSize = 1024 * 1024;
+
+/*
+ *      分块读文件，process返回消费的字节数，剩下的不完整记录和下一块拼在一起。
+ *      返回文件末尾剩下的字节数，-1表示打不开文件
+ */
+long forEachChunk(const char *path, const std::function<size_t(const char *, size_t)> &process) {
+    FILE *fp = ::fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "logdecode: cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    string buf;
+    char chunk[64 * 1024];
+    size_t n;
+    while ((n = ::fread(chunk, 1, sizeof chunk, fp)) > 0) {
+        buf.append(chunk, n);
+        if (buf.size() >= kChunkSize) {
+            buf.erase(0, process(buf.data(), buf.size()));
+        }
+    }
+    buf.erase(0, process(buf.data(), buf.size()));
+    ::fclose(fp);
+    return static_cast<long>(buf.size());
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s logfile...\n", argv[0]);
+        return 1;
+    }
+
+    BinaryLogDecoder decoder;
+    for (int i = 1; i < argc; ++i) {
+        forEachChunk(argv[i], [&decoder](const char *data, size_t len) {
+            return decoder.scanSites(data, len);
+        });
+    }
+
+    int ret = 0;
+    string text;
+    for (int i = 1; i < argc; ++i) {
+        long remain = forEachChunk(argv[i], [&decoder, &text](const char *data, size_t len) {
+            text.clear();
+            size_t consumed = decoder.decode(data, len, &text);
+            ::fwrite(text.data(), 1, text.size(), stdout);
+            return consumed;
+        });
+        if (remain != 0) {
+            if (remain > 0) {
+                fprintf(stderr, "logdecode: %s: %ld bytes of truncated record\n", argv[i], remain);
+            }
+            ret = 1;
+        }
+    }
+    if (decoder.errors() > 0) {
+        fprintf(stderr, "logdecode: %ld bad bytes or records\n", static_cast<long>(decoder.errors()));
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,317 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      AppendFile/LogFile测试（在当前目录下写文件）
+ *
+ *      测试程序自己定义writev()、fallocate()、fdatasync()和close()，记录调用并模拟内核的行为：
+ *      1. writev()每次只写一部分：剩下的继续写，文件内容完整、顺序不变
+ *      2. 一批超过IOV_MAX条记录：分成多次writev()，每次不超过IOV_MAX块，缓冲中的数据在最前面
+ *      3. fallocate()：写到已分配位置时再分配下一块，文件大小不变；析构时释放末尾多分配的部分；
+ *         文件系统不支持（EOPNOTSUPP）时不再尝试
+ *      4. LogFile滚动：旧文件的缓冲在滚动时写入，fdatasync()在同步线程中执行（慢速磁盘不阻塞写日志的线程），
+ *         之后旧文件才被关闭
+ */
+
+#include "../CurrentThread.h"
+#include "../FileUtil.h"
+#include "../LogFile.h"
+#include "../Mutex.h"
+#include "../Timestamp.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace muduo;
+
+size_t g_writeLimit = 0;                // 非0时writev()每次最多写的字节数
+std::vector<int> g_writevCounts;        // 每次writev()的iovcnt
+
+struct FallocateCall {
+    int mode;
+    off_t offset;
+    off_t len;
+};
+std::vector<FallocateCall> g_fallocates;
+bool g_fallocateUnsupported = false;
+
+struct SyncEvent {
+    bool sync;          // false表示close()
+    int fd;
+    int tid;
+    off_t size;         // fdatasync()时文件的大小
+};
+MutexLock g_mutex;
+std::vector<SyncEvent> g_events;        // 只记录被fdatasync()过的fd的close()
+int g_syncDelayMs = 0;
+
+extern "C" ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+    typedef ssize_t (*WritevFunc)(int, const struct iovec *, int);
+    static WritevFunc realWritev = reinterpret_cast<WritevFunc>(::dlsym(RTLD_NEXT, "writev"));
+    g_writevCounts.push_back(iovcnt);
+    if (g_writeLimit == 0) {
+        return realWritev(fd, iov, iovcnt);
+    }
+    std::vector<struct iovec> vec;
+    size_t total = 0;
+    for (int i = 0; i < iovcnt && total < g_writeLimit; ++i) {
+        struct iovec v = iov[i];
+        if (v.iov_len > g_writeLimit - total) {
+            v.iov_len = g_writeLimit - total;
+        }
+        total += v.iov_len;
+        vec.push_back(v);
+    }
+    return realWritev(fd, vec.data(), static_cast<int>(vec.size()));
+}
+
+extern "C" int fallocate(int fd, int mode, off_t offset, off_t len) {
+    typedef int (*FallocateFunc)(int, int, off_t, off_t);
+    static FallocateFunc realFallocate = reinterpret_cast<FallocateFunc>(::dlsym(RTLD_NEXT, "fallocate"));
+    FallocateCall call = {mode, offset, len};
+    g_fallocates.push_back(call);
+    if (g_fallocateUnsupported) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    return realFallocate(fd, mode, offset, len);
+}
+
+extern "C" int fdatasync(int fd) {
+    typedef int (*FdatasyncFunc)(int);
+    static FdatasyncFunc realFdatasync = reinterpret_cast<FdatasyncFunc>(::dlsym(RTLD_NEXT, "fdatasync"));
+    if (g_syncDelayMs > 0) {
+        ::usleep(g_syncDelayMs * 1000);
+    }
+    struct stat st;
+    ::fstat(fd, &st);
+    SyncEvent event = {true, fd, CurrentThread::tid(), st.st_size};
+    {
+        MutexLockGuard lock(g_mutex);
+        g_events.push_back(event);
+    }
+    return realFdatasync(fd);
+}
+
+extern "C" int close(int fd) {
+    typedef int (*CloseFunc)(int);
+    static CloseFunc realClose = reinterpret_cast<CloseFunc>(::dlsym(RTLD_NEXT, "close"));
+    {
+        MutexLockGuard lock(g_mutex);
+        for (const SyncEvent &e : g_events) {
+            if (e.sync && e.fd == fd) {
+                SyncEvent event = {false, fd, CurrentThread::tid(), 0};
+                g_events.push_back(event);
+                break;
+            }
+        }
+    }
+    return realClose(fd);
+}
+
+string readFile(const string &name) {
+    string content;
+    FILE *fp = ::fopen(name.c_str(), "r");
+    assert(fp);
+    char buf[65536];
+    size_t n;
+    while ((n = ::fread(buf, 1, sizeof buf, fp)) > 0) {
+        content.append(buf, n);
+    }
+    ::fclose(fp);
+    return content;
+}
+
+std::vector<string> filesWithPrefix(const string &prefix) {
+    std::vector<string> files;
+    DIR *dir = ::opendir(".");
+    assert(dir != NULL);
+    while (struct dirent *entry = ::readdir(dir)) {
+        string name = entry->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            files.push_back(name);
+        }
+    }
+    ::closedir(dir);
+    return files;
+}
+
+string record(int i) {
+    char buf[32];
+    snprintf(buf, sizeof buf, "record %d\n", i);
+    return buf;
+}
+
+// 1. 2.
+void testWritev() {
+    const char *name = "logfile_test.writev";
+    ::unlink(name);
+    const int kRecords = 3000;
+    std::vector<string> records;
+    for (int i = 0; i < kRecords; ++i) {
+        records.push_back(record(i));
+    }
+    std::vector<struct iovec> iov(kRecords);
+    for (int i = 0; i < kRecords; ++i) {
+        iov[i].iov_base = const_cast<char *>(records[i].data());
+        iov[i].iov_len = records[i].size();
+    }
+    string expected = "buffered\n";
+    for (const string &r : records) {
+        expected += r;
+    }
+    {
+        FileUtil::AppendFile file(name);
+        file.append("buffered\n", 9);
+        g_writevCounts.clear();
+        file.append(iov.data(), kRecords);
+        assert(g_writevCounts.size() == 3);     // 1 + 3000块，每次最多IOV_MAX(1024)块
+        for (int n : g_writevCounts) {
+            assert(n <= IOV_MAX);
+        }
+        assert(file.writtenBytes() == static_cast<off_t>(expected.size()));
+    }
+    assert(readFile(name) == expected);
+    printf("batch longer than IOV_MAX ok\n");
+
+    ::unlink(name);
+    {
+        FileUtil::AppendFile file(name);
+        file.append("buffered\n", 9);
+        g_writeLimit = 1000;
+        g_writevCounts.clear();
+        file.append(iov.data(), kRecords);
+        g_writeLimit = 0;
+        assert(g_writevCounts.size() >= expected.size() / 1000);
+    }
+    assert(readFile(name) == expected);
+    ::unlink(name);
+    printf("partial writev ok\n");
+}
+
+// 3.
+void testFallocate() {
+    const char *name = "logfile_test.fallocate";
+    ::unlink(name);
+    const off_t kChunk = 64 * 1024;
+    string data(40 * 1024, 'x');
+    g_fallocates.clear();
+    {
+        FileUtil::AppendFile file(name, kChunk);
+        assert(g_fallocates.size() == 1);
+        assert(g_fallocates[0].mode == FALLOC_FL_KEEP_SIZE);
+        assert(g_fallocates[0].offset == 0 && g_fallocates[0].len == kChunk);
+
+        file.append(data.data(), data.size());      // 在缓冲中
+        file.flush();                               // 40KB，在第一块之内
+        assert(g_fallocates.size() == 1);
+        file.append(data.data(), data.size());
+        file.flush();                               // 80KB，分配第二块
+        assert(g_fallocates.size() == 2);
+        assert(g_fallocates[1].offset == kChunk && g_fallocates[1].len == kChunk);
+
+        struct stat st;
+        assert(::stat(name, &st) == 0);
+        assert(st.st_size == 80 * 1024);            // KEEP_SIZE：文件大小只包括写入的数据
+    }
+    // 析构时释放写入位置之后多分配的部分
+    assert(g_fallocates.size() == 3);
+    assert(g_fallocates[2].mode == (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE));
+    assert(g_fallocates[2].offset == 80 * 1024 && g_fallocates[2].len == 2 * kChunk - 80 * 1024);
+    assert(readFile(name).size() == 80 * 1024);
+    ::unlink(name);
+
+    g_fallocates.clear();
+    g_fallocateUnsupported = true;
+    {
+        FileUtil::AppendFile file(name, kChunk);
+        for (int i = 0; i < 4; ++i) {
+            file.append(data.data(), data.size());
+            file.flush();
+        }
+    }
+    g_fallocateUnsupported = false;
+    assert(g_fallocates.size() == 1);               // 失败一次以后不再尝试
+    assert(readFile(name).size() == 4 * data.size());
+    ::unlink(name);
+    printf("fallocate ok\n");
+}
+
+// 4.
+void testRollSync() {
+    const string basename = "logfile_test_roll";
+    for (const string &f : filesWithPrefix(basename)) {
+        ::unlink(f.c_str());
+    }
+    string line(100, 'a');
+    line += '\n';
+    {
+        MutexLockGuard lock(g_mutex);
+        g_events.clear();
+    }
+    g_syncDelayMs = 300;
+    const int mainTid = CurrentThread::tid();
+    {
+        LogFile logFile(basename, 1000, false, 3, 1024);
+        for (int i = 0; i < 5; ++i) {
+            logFile.append(line.data(), static_cast<int>(line.size()));
+        }
+        ::sleep(1);                 // rollFile()每秒最多一次
+        Timestamp start(Timestamp::now());
+        for (int i = 0; i < 10; ++i) {   // 写到第10行时超过rollSize，滚动
+            logFile.append(line.data(), static_cast<int>(line.size()));
+        }
+        double elapsed = timeDifference(Timestamp::now(), start);
+        printf("roll took %.3f seconds with a %d ms fdatasync()\n", elapsed, g_syncDelayMs);
+        assert(elapsed < 0.2);       // 没有等待fdatasync()
+    }
+    g_syncDelayMs = 0;
+
+    std::vector<string> files = filesWithPrefix(basename);
+    assert(files.size() == 2);
+    MutexLockGuard lock(g_mutex);
+    // 第一个文件：滚动时交给同步线程，fdatasync()时数据已经全部写入，之后由同步线程关闭
+    assert(g_events.size() >= 2);
+    const SyncEvent &sync = g_events[0];
+    assert(sync.sync && sync.tid != mainTid);
+    assert(sync.size == static_cast<off_t>(line.size() * 10));
+    bool closedAfterSync = false;
+    for (size_t i = 1; i < g_events.size(); ++i) {
+        if (!g_events[i].sync && g_events[i].fd == sync.fd) {
+            closedAfterSync = true;
+            assert(g_events[i].tid == sync.tid);
+            break;
+        }
+    }
+    assert(closedAfterSync);
+    // 第二个文件：析构时同步，同样不在当前线程
+    int syncs = 0;
+    for (const SyncEvent &e : g_events) {
+        if (e.sync) {
+            assert(e.tid != mainTid);
+            ++syncs;
+        }
+    }
+    assert(syncs == 2);
+    for (const string &f : files) {
+        ::unlink(f.c_str());
+    }
+    printf("roll and off-thread fdatasync ok\n");
+}
+
+int main() {
+    testWritev();
+    testFallocate();
+    testRollSync();
+}
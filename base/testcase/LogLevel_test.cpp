@@ -0,0 +1,121 @@
+//
+// Created by chen on 2022/12/05.
+//
+
+/*
+ *      日志级别测试
+ *
+ *      1. 编译期的最低级别：本文件按MUDUO_LOG_MIN_LEVEL=2编译，LOG_TRACE / LOG_DEBUG的参数不会求值
+ *      2. 模块级别：按源文件名、按目录名设置，源文件名优先；已经执行过的调用点在修改级别后立即生效
+ *      3. WARN / ERROR不受模块级别影响
+ *      4. 关闭的LOG_INFO每次的开销
+ */
+
+#undef MUDUO_LOG_MIN_LEVEL
+#define MUDUO_LOG_MIN_LEVEL 2
+
+#include "../Logging.h"
+#include "../Timestamp.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <vector>
+
+using namespace muduo;
+
+std::vector<string> g_lines;
+int g_evaluated = 0;
+
+void captureOutput(const char *msg, int len) {
+    g_lines.push_back(string(msg, static_cast<size_t>(len)));
+}
+
+int evaluate() {
+    return ++g_evaluated;
+}
+
+void infoLine() {
+    LOG_INFO << "info";
+}
+
+void warnLine() {
+    LOG_WARN << "warn";
+}
+
+void lateInfoLine() {
+    LOG_INFO << "late info";
+}
+
+void testCompileTime() {
+    g_lines.clear();
+    Logger::setLogLevel(Logger::TRACE);
+    LOG_TRACE << "trace " << evaluate();
+    LOG_DEBUG << "debug " << evaluate();
+    assert(g_lines.empty() && g_evaluated == 0);
+    LOG_INFO << "info " << evaluate();
+    assert(g_lines.size() == 1 && g_evaluated == 1);
+    Logger::setLogLevel(Logger::INFO);
+    printf("compile time ok\n");
+}
+
+void testModule() {
+    g_lines.clear();
+    infoLine();
+    assert(g_lines.size() == 1);
+
+    // 已经执行过的调用点
+    Logger::setModuleLogLevel("LogLevel_test.cpp", Logger::WARN);
+    infoLine();
+    warnLine();
+    assert(g_lines.size() == 2);
+
+    // 第一次执行的调用点
+    lateInfoLine();
+    assert(g_lines.size() == 2);
+
+    // 源文件名优先于目录名
+    Logger::setModuleLogLevel("testcase", Logger::ERROR);
+    Logger::setModuleLogLevel("LogLevel_test.cpp", Logger::INFO);
+    infoLine();
+    assert(g_lines.size() == 3);
+
+    Logger::clearModuleLogLevels();
+    Logger::setModuleLogLevel("testcase", Logger::ERROR);
+    lateInfoLine();
+    warnLine();
+    assert(g_lines.size() == 4);
+
+    // 目录名要完整匹配
+    Logger::clearModuleLogLevels();
+    Logger::setModuleLogLevel("case", Logger::ERROR);
+    lateInfoLine();
+    assert(g_lines.size() == 5);
+
+    Logger::clearModuleLogLevels();
+    Logger::setLogLevel(Logger::WARN);
+    infoLine();
+    Logger::setLogLevel(Logger::INFO);
+    infoLine();
+    assert(g_lines.size() == 6);
+    printf("module ok\n");
+}
+
+void benchDisabled() {
+    Logger::setLogLevel(Logger::WARN);
+    const int kCount = 10000000;
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < kCount; ++i) {
+        LOG_INFO << "disabled " << i;
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    Logger::setLogLevel(Logger::INFO);
+    printf("disabled LOG_INFO %.2f ns\n", seconds * 1e9 / kCount);
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    testCompileTime();
+    testModule();
+    benchDisabled();
+}
@@ -0,0 +1,141 @@
+//
+// Created by chen on 2022/12/04.
+//
+
+/*
+ *      采样日志测试
+ *
+ *      1. LOG_EVERY_N：4个线程各执行1000次，正好输出 4000 / n 行，被丢弃的行数之和正确
+ *      2. LOG_FIRST_N只输出前n次
+ *      3. LOG_EVERY_MS：连续执行300ms，间隔100ms时输出3~4行
+ *      4. 每秒预算：INFO限制为每秒5行，其它级别不受影响
+ *      5. 宏后面的else和外面的if配对
+ */
+
+#include "../Logging.h"
+#include "../Thread.h"
+#include "../Timestamp.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+using namespace muduo;
+
+std::vector<string> g_lines;
+MutexLock g_mutex;
+
+void captureOutput(const char *msg, int len) {
+    MutexLockGuard lock(g_mutex);
+    g_lines.push_back(string(msg, static_cast<size_t>(len)));
+}
+
+// 返回"[N suppressed] "中的N
+long suppressedIn(const string &line) {
+    size_t pos = line.find('[');
+    return pos == string::npos ? 0 : atol(line.c_str() + pos + 1);
+}
+
+void everyNOnce() {
+    LOG_EVERY_N(ERROR, 100) << "every 100";
+}
+
+void everyN() {
+    for (int i = 0; i < 1000; ++i) {
+        everyNOnce();
+    }
+}
+
+void testEveryN() {
+    g_lines.clear();
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back(new Thread(everyN));
+        threads.back()->start();
+    }
+    for (const auto &thread : threads) {
+        thread->join();
+    }
+    assert(g_lines.size() == 40);
+    // 第4001次输出，带出剩下的
+    everyNOnce();
+    assert(g_lines.size() == 41);
+    long suppressed = 0;
+    for (const string &line : g_lines) {
+        suppressed += suppressedIn(line);
+    }
+    assert(suppressed == 4000 - 40);
+    (void) suppressed;
+    printf("every n ok\n");
+}
+
+void testFirstN() {
+    g_lines.clear();
+    for (int i = 0; i < 100; ++i) {
+        LOG_FIRST_N(WARN, 3) << "first " << i;
+    }
+    assert(g_lines.size() == 3);
+    assert(g_lines[2].find("first 2") != string::npos);
+    printf("first n ok\n");
+}
+
+void testEveryMs() {
+    g_lines.clear();
+    Timestamp start = Timestamp::now();
+    int calls = 0;
+    while (timeDifference(Timestamp::now(), start) < 0.3) {
+        LOG_EVERY_MS(INFO, 100) << "every 100ms";
+        ++calls;
+    }
+    assert(g_lines.size() >= 3 && g_lines.size() <= 4);
+    assert(suppressedIn(g_lines[1]) > 0);
+    printf("every ms ok, %zu of %d calls\n", g_lines.size(), calls);
+}
+
+void limited(int i) {
+    LOG_INFO << "limited " << i;
+}
+
+void testRateLimit() {
+    g_lines.clear();
+    Logger::setRateLimit(Logger::INFO, 5);
+    for (int i = 0; i < 100; ++i) {
+        limited(i);
+        LOG_WARN << "not limited " << i;
+    }
+    Logger::setRateLimit(Logger::INFO, 0);
+    size_t info = 0;
+    for (const string &line : g_lines) {
+        info += line.find("INFO") != string::npos;
+    }
+    // 循环可能跨过一秒的边界
+    assert(info >= 5 && info <= 10);
+    assert(g_lines.size() - info == 100);
+    limited(100);
+    assert(suppressedIn(g_lines.back()) == static_cast<long>(100 - info));
+    printf("rate limit ok\n");
+}
+
+void testElse() {
+    g_lines.clear();
+    bool branch = false;
+    if (branch)
+        LOG_ERROR << "not here";
+    else
+        branch = true;
+    assert(branch && g_lines.empty());
+    (void) branch;
+    printf("else ok\n");
+}
+
+int main() {
+    Logger::setOutput(captureOutput);
+    testEveryN();
+    testFirstN();
+    testEveryMs();
+    testRateLimit();
+    testElse();
+}
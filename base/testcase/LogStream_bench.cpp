@@ -0,0 +1,286 @@
+//
+// Created by chen on 2022/12/03.
+//
+
+/*
+ *      LogStream数值格式化压测
+ *
+ *      1. 特殊值、随机位模式和常见的小数：formatDouble / formatFloat的结果经strtod / strtof能精确还原，
+ *         统计比最短表示（逐个精度尝试%.Ng）更长的比例
+ *      2. 比较snprintf("%.12g")（原来的operator<<）、snprintf("%.17g")和formatDouble的速度，
+ *         以及LogStream << double的吞吐
+ *      3. 整数：小整数、均匀分布的32位整数、位数均匀分布的64位有符号整数、指针，
+ *         检查和snprintf的结果相同，比较原来逐位除法再std::reverse的实现、snprintf和LogStream <<
+ *
+ *      用法：logstream_bench [次数]
+ */
+
+#include "../LogStream.h"
+#include "../Timestamp.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace muduo;
+
+// 有效数字的个数：去掉符号、指数、小数点、开头和末尾的0
+int significantDigits(const char *s) {
+    string digits;
+    for (const char *p = s; *p && *p != 'e'; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            digits += *p;
+        }
+    }
+    size_t first = digits.find_first_not_of('0');
+    if (first == string::npos) {
+        return 1;
+    }
+    size_t last = digits.find_last_not_of('0');
+    return static_cast<int>(last - first + 1);
+}
+
+template<class T>
+T parse(const char *s);
+
+template<>
+double parse<double>(const char *s) {
+    return strtod(s, NULL);
+}
+
+template<>
+float parse<float>(const char *s) {
+    return strtof(s, NULL);
+}
+
+size_t format(char *buf, double v) {
+    return formatDouble(buf, v);
+}
+
+size_t format(char *buf, float v) {
+    return formatFloat(buf, v);
+}
+
+// 返回结果是否最短
+template<class T>
+bool check(T v) {
+    char buf[kMaxDoubleSize];
+    size_t len = format(buf, v);
+    assert(len == strlen(buf));
+    T back = parse<T>(buf);
+    if (isnan(v)) {
+        assert(strcmp(buf, "nan") == 0);
+        return true;
+    }
+    assert(memcmp(&back, &v, sizeof v) == 0);
+
+    char shortest[64];
+    for (int precision = 1; precision <= 17; ++precision) {
+        snprintf(shortest, sizeof shortest, "%.*g", precision, static_cast<double>(v));
+        if (parse<T>(shortest) == v) {
+            break;
+        }
+    }
+    (void) len;
+    (void) back;
+    return significantDigits(buf) <= significantDigits(shortest);
+}
+
+template<class T, class Bits>
+void verify(const char *name, int count) {
+    const T specials[] = {0, -static_cast<T>(0), 1, -1, static_cast<T>(0.1), static_cast<T>(1e23),
+                          std::numeric_limits<T>::min(), std::numeric_limits<T>::max(),
+                          std::numeric_limits<T>::denorm_min(), std::numeric_limits<T>::epsilon(),
+                          std::numeric_limits<T>::infinity(), -std::numeric_limits<T>::infinity(),
+                          std::numeric_limits<T>::quiet_NaN()};
+    for (T v : specials) {
+        check(v);
+    }
+
+    std::mt19937_64 rng(42);
+    int longer = 0;
+    for (int i = 0; i < count; ++i) {
+        Bits bits = static_cast<Bits>(rng());
+        T v;
+        memcpy(&v, &bits, sizeof v);
+        if (!check(v)) {
+            ++longer;
+        }
+        if (!check(static_cast<T>(static_cast<double>(rng() % 100000000) / 1000))) {
+            ++longer;
+        }
+    }
+    printf("%-6s %d values round trip, %d (%.3f%%) longer than shortest\n",
+           name, 2 * count, longer, 100.0 * longer / (2 * count));
+}
+
+template<class T, class Func>
+void timeIt(const char *name, const std::vector<T> &values, int rounds, Func func) {
+    char buf[64];
+    size_t total = 0;
+    Timestamp start = Timestamp::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (T v : values) {
+            total += func(buf, v);
+        }
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    double n = static_cast<double>(values.size()) * rounds;
+    printf("%-28s %8.1f ns/op %10.0f ops/sec   (%zu bytes)\n", name, seconds * 1e9 / n, n / seconds, total);
+}
+
+// 原来的实现：每次除以10（16）得到一位，最后反转
+template<typename T>
+size_t convertDivide(char buf[], T value) {
+    static const char digits[] = "9876543210123456789";
+    const char *zero = digits + 9;
+    T i = value;
+    char *p = buf;
+    do {
+        int lsd = static_cast<int>(i % 10);
+        i /= 10;
+        *p++ = zero[lsd];
+    } while (i != 0);
+    if (value < 0) {
+        *p++ = '-';
+    }
+    *p = '\0';
+    std::reverse(buf, p);
+    return static_cast<size_t>(p - buf);
+}
+
+size_t convertHexDivide(char buf[], uintptr_t value) {
+    static const char digitsHex[] = "0123456789ABCDEF";
+    uintptr_t i = value;
+    char *p = buf;
+    do {
+        int lsd = static_cast<int>(i % 16);
+        i /= 16;
+        *p++ = digitsHex[lsd];
+    } while (i != 0);
+    *p = '\0';
+    std::reverse(buf, p);
+    return static_cast<size_t>(p - buf);
+}
+
+template<typename T>
+void benchIntegers(const char *name, const std::vector<T> &values, const char *fmt, int rounds) {
+    LogStream os;
+    char expect[32];
+    for (T v : values) {
+        os.resetBuffer();
+        os << v;
+        snprintf(expect, sizeof expect, fmt, v);
+        assert(os.buffer().toString() == expect);
+    }
+    printf("%s\n", name);
+
+    timeIt("  snprintf", values, rounds, [fmt](char *buf, T v) {
+        return static_cast<size_t>(snprintf(buf, 64, fmt, v));
+    });
+    timeIt("  divide + reverse", values, rounds, [](char *buf, T v) {
+        return convertDivide(buf, v);
+    });
+    timeIt("  LogStream <<", values, rounds, [&os](char *, T v) {
+        os.resetBuffer();
+        os << v;
+        return static_cast<size_t>(os.buffer().length());
+    });
+}
+
+void benchPointers(const std::vector<uint64_t> &values, int rounds) {
+    LogStream os;
+    char expect[32];
+    for (uint64_t v : values) {
+        os.resetBuffer();
+        os << reinterpret_cast<const void *>(v);
+        snprintf(expect, sizeof expect, "0x%lX", static_cast<unsigned long>(v));
+        assert(os.buffer().toString() == expect);
+    }
+    printf("pointer\n");
+    timeIt("  snprintf", values, rounds, [](char *buf, uint64_t v) {
+        return static_cast<size_t>(snprintf(buf, 64, "0x%lX", static_cast<unsigned long>(v)));
+    });
+    timeIt("  divide + reverse", values, rounds, [](char *buf, uint64_t v) {
+        buf[0] = '0';
+        buf[1] = 'x';
+        return 2 + convertHexDivide(buf + 2, static_cast<uintptr_t>(v));
+    });
+    timeIt("  LogStream <<", values, rounds, [&os](char *, uint64_t v) {
+        os.resetBuffer();
+        os << reinterpret_cast<const void *>(v);
+        return static_cast<size_t>(os.buffer().length());
+    });
+}
+
+void integers(int count) {
+    std::mt19937_64 rng(9);
+    std::vector<int> small;
+    std::vector<unsigned> uniform;
+    std::vector<long long> digits;
+    std::vector<uint64_t> pointers;
+    for (int i = 0; i < 10000; ++i) {
+        small.push_back(static_cast<int>(rng() % 1000));
+        uniform.push_back(static_cast<unsigned>(rng()));
+        long long v = static_cast<long long>(rng() % static_cast<uint64_t>(pow(10.0, static_cast<double>(rng() % 19 + 1))));
+        digits.push_back(rng() % 2 ? v : -v);
+        pointers.push_back((rng() % 2 ? 0x7f0000000000ULL : 0x550000000000ULL) + (rng() & 0xffffffffff0ULL));
+    }
+    digits.push_back(std::numeric_limits<long long>::min());
+    digits.push_back(std::numeric_limits<long long>::max());
+    pointers.push_back(0);
+
+    int rounds = count / 10000 + 1;
+    benchIntegers("int [0, 1000)", small, "%d", rounds);
+    benchIntegers("unsigned uniform", uniform, "%u", rounds);
+    benchIntegers("long long, 1~19 digits", digits, "%lld", rounds);
+    benchPointers(pointers, rounds);
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    verify<double, uint64_t>("double", count);
+    verify<float, uint32_t>("float", count);
+
+    std::mt19937_64 rng(7);
+    std::vector<double> values;
+    for (int i = 0; i < 10000; ++i) {
+        double random;
+        uint64_t bits = rng() & ~(static_cast<uint64_t>(0x400) << 52);     // 避开nan和inf
+        memcpy(&random, &bits, sizeof random);
+        values.push_back(random);
+        values.push_back(static_cast<double>(rng() % 1000000) / 100);
+    }
+    int rounds = count / 10000 + 1;
+
+    timeIt("snprintf %.12g", values, rounds, [](char *buf, double v) {
+        return static_cast<size_t>(snprintf(buf, 64, "%.12g", v));
+    });
+    timeIt("snprintf %.17g", values, rounds, [](char *buf, double v) {
+        return static_cast<size_t>(snprintf(buf, 64, "%.17g", v));
+    });
+    timeIt("formatDouble", values, rounds, [](char *buf, double v) {
+        return formatDouble(buf, v);
+    });
+
+    LogStream os;
+    timeIt("LogStream << Fmt(%.12g)", values, rounds, [&os](char *, double v) {
+        os.resetBuffer();
+        os << Fmt("%.12g", v);
+        return static_cast<size_t>(os.buffer().length());
+    });
+    timeIt("LogStream << double", values, rounds, [&os](char *, double v) {
+        os.resetBuffer();
+        os << v;
+        return static_cast<size_t>(os.buffer().length());
+    });
+
+    integers(count);
+}
@@ -0,0 +1,184 @@
+//
+// Created by chen on 2022/12/07.
+//
+
+/*
+ *      MmapRingLog测试（在当前目录下写文件）
+ *
+ *      1. 4个线程写满几圈，恢复出的是最后的一段序号，内容正确。
+ *         写入位置前后的旧记录被覆盖了一部分，序号可能在那里断开一两次
+ *      2. 重新打开同一个文件，序号接着增长
+ *      3. 改坏一个字节，只丢这一条记录
+ *      4. 用不同的容量重新打开：按文件中的容量接着写，上次的日志还在
+ *      5. 不是环形日志的文件：不覆盖，valid()返回false
+ *      6. 子进程写完日志后abort()，父进程恢复出全部日志
+ */
+
+#include "../MmapRingLog.h"
+#include "../Thread.h"
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+
+using namespace muduo;
+
+const char *kRingFile = "mmapringlog_test.ring";
+
+void writeLines(MmapRingLog *ring, int thread, int count) {
+    for (int i = 0; i < count; ++i) {
+        char line[64];
+        int len = snprintf(line, sizeof line, "thread %d line %d\n", thread, i);
+        ring->append(line, len);
+    }
+}
+
+void checkTail(const std::vector<MmapRingLog::Record> &records, uint64_t nextSeq) {
+    assert(!records.empty());
+    assert(records.back().seq == nextSeq - 1);
+    int gaps = 0;
+    for (size_t i = 1; i < records.size(); ++i) {
+        assert(records[i].seq > records[i - 1].seq);
+        gaps += records[i].seq != records[i - 1].seq + 1;
+    }
+    assert(gaps <= 2);
+    (void) nextSeq;
+    (void) gaps;
+}
+
+void testThreads() {
+    ::unlink(kRingFile);
+    MmapRingLog ring(kRingFile, 64 * 1024);
+    assert(ring.valid());
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back(new Thread(std::bind(writeLines, &ring, i, 10000)));
+        threads.back()->start();
+    }
+    for (const auto &thread : threads) {
+        thread->join();
+    }
+    assert(ring.nextSeq() == 40000);
+
+    std::vector<MmapRingLog::Record> records;
+    int64_t bad = 0;
+    assert(MmapRingLog::recover(kRingFile, &records, &bad));
+    assert(bad == 0);
+    checkTail(records, 40000);
+    for (const MmapRingLog::Record &record : records) {
+        int thread, line;
+        assert(sscanf(record.logline.c_str(), "thread %d line %d", &thread, &line) == 2);
+        assert(thread >= 0 && thread < 4 && line >= 0 && line < 10000);
+    }
+    printf("threads ok, %zu records in the ring\n", records.size());
+}
+
+void testReopen() {
+    {
+        MmapRingLog ring(kRingFile, 64 * 1024);
+        assert(ring.nextSeq() == 40000);
+        ring.append("reopened\n", 9);
+    }
+    std::vector<MmapRingLog::Record> records;
+    int64_t bad = 0;
+    assert(MmapRingLog::recover(kRingFile, &records, &bad));
+    assert(records.back().seq == 40000 && records.back().logline == "reopened\n");
+    printf("reopen ok\n");
+}
+
+void testCorruption() {
+    std::vector<MmapRingLog::Record> before;
+    int64_t bad = 0;
+    MmapRingLog::recover(kRingFile, &before, &bad);
+
+    // 改坏第一条记录的logline
+    FILE *fp = ::fopen(kRingFile, "r+");
+    assert(fp != NULL);
+    ::fseek(fp, 4096 + 16, SEEK_SET);
+    int c = ::fgetc(fp);
+    ::fseek(fp, 4096 + 16, SEEK_SET);
+    ::fputc(c ^ 1, fp);
+    ::fclose(fp);
+
+    std::vector<MmapRingLog::Record> after;
+    assert(MmapRingLog::recover(kRingFile, &after, &bad));
+    assert(bad == 1 && after.size() == before.size() - 1);
+    printf("corruption ok\n");
+}
+
+off_t fileSize(const char *name) {
+    struct stat statbuf;
+    assert(::stat(name, &statbuf) == 0);
+    return statbuf.st_size;
+}
+
+void testCapacityChanged() {
+    assert(fileSize(kRingFile) == 4096 + 64 * 1024);
+    {
+        MmapRingLog ring(kRingFile, 1024 * 1024);
+        assert(ring.valid());
+        assert(ring.nextSeq() == 40001);
+        ring.append("capacity changed\n", 17);
+    }
+    assert(fileSize(kRingFile) == 4096 + 64 * 1024);
+    std::vector<MmapRingLog::Record> records;
+    int64_t bad = 0;
+    assert(MmapRingLog::recover(kRingFile, &records, &bad));
+    assert(records.size() >= 2);
+    assert(records[records.size() - 2].seq == 40000 && records[records.size() - 2].logline == "reopened\n");
+    assert(records.back().seq == 40001 && records.back().logline == "capacity changed\n");
+    printf("capacity changed ok\n");
+}
+
+void testNotRingFile() {
+    const char *name = "mmapringlog_test.txt";
+    FILE *fp = ::fopen(name, "w");
+    assert(fp != NULL);
+    ::fputs("not a ring log\n", fp);
+    ::fclose(fp);
+    {
+        MmapRingLog ring(name, 64 * 1024);
+        assert(!ring.valid());
+        ring.append("lost\n", 5);
+    }
+    assert(fileSize(name) == 15);
+    ::unlink(name);
+    printf("not a ring file ok\n");
+}
+
+void testCrash() {
+    ::unlink(kRingFile);
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        MmapRingLog ring(kRingFile, 1024 * 1024);
+        writeLines(&ring, 0, 1000);
+        ::signal(SIGABRT, SIG_DFL);
+        ::abort();
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    assert(WIFSIGNALED(status));
+
+    std::vector<MmapRingLog::Record> records;
+    int64_t bad = 0;
+    assert(MmapRingLog::recover(kRingFile, &records, &bad));
+    assert(bad == 0 && records.size() == 1000);
+    assert(records.back().logline == "thread 0 line 999\n");
+    ::unlink(kRingFile);
+    printf("crash ok\n");
+}
+
+int main() {
+    testThreads();
+    testReopen();
+    testCorruption();
+    testCapacityChanged();
+    testNotRingFile();
+    testCrash();
+}
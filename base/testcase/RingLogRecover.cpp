@@ -0,0 +1,56 @@
+//
+// Created by chen on 2022/12/07.
+//
+
+/*
+ *      ringlog_recover：从MmapRingLog的文件中取出完整的记录，按序号输出到stdout
+ *
+ *      进程崩溃后运行，可以只看最后N条。序号不连续的地方是被覆盖或者没写完的记录，统计输出到stderr
+ *
+ *      用法：ringlog_recover 环形日志文件 [最后N条]
+ */
+
+#include "../MmapRingLog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s ringfile [lines]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<MmapRingLog::Record> records;
+    int64_t badRecords = 0;
+    if (!MmapRingLog::recover(argv[1], &records, &badRecords)) {
+        fprintf(stderr, "ringlog_recover: %s is not a ring log file\n", argv[1]);
+        return 1;
+    }
+
+    size_t first = 0;
+    if (argc > 2) {
+        size_t lines = static_cast<size_t>(atol(argv[2]));
+        first = records.size() > lines ? records.size() - lines : 0;
+    }
+    int64_t gaps = 0;
+    for (size_t i = first; i < records.size(); ++i) {
+        if (i > first && records[i].seq != records[i - 1].seq + 1) {
+            ++gaps;
+        }
+        ::fwrite(records[i].logline.data(), 1, records[i].logline.size(), stdout);
+    }
+
+    if (records.empty()) {
+        fprintf(stderr, "ringlog_recover: no records, %ld bad\n", static_cast<long>(badRecords));
+    } else {
+        fprintf(stderr, "ringlog_recover: %zu records, seq %lu..%lu, %ld gaps, %ld bad\n",
+                records.size() - first,
+                static_cast<unsigned long>(records[first].seq),
+                static_cast<unsigned long>(records.back().seq),
+                static_cast<long>(gaps), static_cast<long>(badRecords));
+    }
+    return badRecords > 0 || gaps > 0 ? 2 : 0;
+}
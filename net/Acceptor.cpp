@@ -21,11 +21,25 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
           acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())),
           acceptChannel_(loop, acceptSocket_.fd()),
           listening_(false),
-          idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))        // 见handleRead()
+          maxAcceptsPerEvent_(1),
+          idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),       // 见handleRead()
+          unix_(listenAddr.family() == AF_UNIX),
+          unixPath_(listenAddr.isAbstractUnix() ? string() : listenAddr.path())
 {
     assert(idleFd_ >= 0);
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(reuseport);
+    if (listenAddr.family() == AF_UNIX)
+    {
+        // 上次进程退出时残留的socket文件会导致bind()失败（EADDRINUSE）；抽象命名空间没有文件
+        if (!unixPath_.empty())
+        {
+            ::unlink(unixPath_.c_str());
+        }
+    }
+    else
+    {
+        acceptSocket_.setReuseAddr(true);
+        acceptSocket_.setReusePort(reuseport);
+    }
     acceptSocket_.bindAddress(listenAddr);
     acceptChannel_.setReadCallback(
             std::bind(&Acceptor::handleRead, this));
@@ -36,6 +50,28 @@ Acceptor::~Acceptor()
     acceptChannel_.disableAll();
     acceptChannel_.remove();
     ::close(idleFd_);
+    if (!unixPath_.empty())
+    {
+        ::unlink(unixPath_.c_str());
+    }
+}
+
+void Acceptor::setTcpFastOpen(int qlen)
+{
+    assert(!listening_);
+    if (!unix_)
+    {
+        acceptSocket_.setTcpFastOpen(qlen);
+    }
+}
+
+void Acceptor::setDeferAccept(int seconds)
+{
+    assert(!listening_);
+    if (!unix_)
+    {
+        acceptSocket_.setDeferAccept(seconds);
+    }
 }
 
 void Acceptor::listen()
@@ -46,46 +82,89 @@ void Acceptor::listen()
     acceptChannel_.enableReading();
 }
 
+/*
+ *      一次可读事件最多accept maxAcceptsPerEvent_ 个连接，遇到EAGAIN提前结束；
+ *      ECONNABORTED/EINTR/EPROTO只跳过这一次，不结束这一批，否则剩下的连接要等下一次可读事件。
+ *      连接风暴时listening socket一直可读，每次只accept一个的话，每个连接都要付出一次epoll_wait()的代价。
+ *
+ *      accept到的连接攒成一批交给newConnectionsCallback_，TcpServer可以为每个IO loop只投递一个functor。
+ */
 void Acceptor::handleRead()
 {
     loop_->assertInLoopThread();
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    accepted_.clear();
+    for (int i = 0; i < maxAcceptsPerEvent_; ++i)
     {
-        if (newConnectionCallback_)
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
         {
-            newConnectionCallback_(connfd, peerAddr);
+            AcceptedConnection accepted = { connfd, peerAddr };
+            accepted_.push_back(accepted);
+        }
+        else if (errno == ECONNABORTED || errno == EINTR || errno == EPROTO)
+        {
+            // 只影响这一个连接（对方在accept之前就断开了），继续accept队列中其它的连接
+            continue;
         }
         else
         {
-            sockets::close(connfd);
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                handleAcceptError();
+            }
+            break;
+        }
+    }
+
+    if (newConnectionsCallback_)
+    {
+        if (!accepted_.empty())
+        {
+            newConnectionsCallback_(accepted_);
         }
     }
     else
     {
-        LOG_SYSERR << "in Acceptor::handleRead";
-
-        /*
-         *      EMFILE：文件描述符已经耗尽
-         *      既然没有一个fd能够用来表示这个连接，那么说明也无法close()这个连接。而listening socket上将会一直监听到连接，
-         *      handleRead()也会一直触发，系统CPU占用率飙升但其实什么也没做。
-         *
-         *      解决方法：
-         *      在Acceptor初始化的时候，向系统申请一个文件描述符，用来“占坑”：
-         *          idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
-         *      当accept()返回EMFILE错误的时候，通过close(idleFd_)来让出一个文件描述符，随后accept()一个连接，它将占用这个文件描述符。
-         *      此时就可以通过close()把这个连接关掉。随后又通过上述占坑的方式申请这个文件描述符，应对listening队列中的其它连接。
-         *
-         *      书本P238
-         *
-         */
-        if (errno == EMFILE)
+        for (const AcceptedConnection &accepted : accepted_)
         {
-            ::close(idleFd_);
-            idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
-            ::close(idleFd_);
-            idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (newConnectionCallback_)
+            {
+                newConnectionCallback_(accepted.sockfd, accepted.peerAddr);
+            }
+            else
+            {
+                sockets::close(accepted.sockfd);
+            }
         }
     }
-}
\ No newline at end of file
+}
+
+void Acceptor::handleAcceptError()
+{
+    // EMFILE时每次可读事件都会走到这里，每秒只记录一条
+    int savedErrno = errno;
+    LOG_EVERY_MS(ERROR, 1000) << strerror_tl(savedErrno) << " (errno=" << savedErrno << ") in Acceptor::handleRead";
+
+    /*
+     *      EMFILE：文件描述符已经耗尽
+     *      既然没有一个fd能够用来表示这个连接，那么说明也无法close()这个连接。而listening socket上将会一直监听到连接，
+     *      handleRead()也会一直触发，系统CPU占用率飙升但其实什么也没做。
+     *
+     *      解决方法：
+     *      在Acceptor初始化的时候，向系统申请一个文件描述符，用来“占坑”：
+     *          idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+     *      当accept()返回EMFILE错误的时候，通过close(idleFd_)来让出一个文件描述符，随后accept()一个连接，它将占用这个文件描述符。
+     *      此时就可以通过close()把这个连接关掉。随后又通过上述占坑的方式申请这个文件描述符，应对listening队列中的其它连接。
+     *
+     *      书本P238
+     *
+     */
+    if (savedErrno == EMFILE)
+    {
+        ::close(idleFd_);
+        idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+        ::close(idleFd_);
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+}
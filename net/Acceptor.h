@@ -5,6 +5,7 @@
 /*
  *      封装 socket(), bind(), listen(), accept() 一系列典型的连接流程。
  *
+ *      listenAddr 可以是 UnixAddress，此时监听的是 AF_UNIX stream socket
  */
 
 #ifndef MYMUDUO_ACCEPTOR_H
@@ -13,28 +14,58 @@
 #include <functional>
 
 #include "Channel.h"
+#include "InetAddress.h"
 #include "Socket.h"
 
+#include <vector>
+
 namespace muduo {
     namespace net {
 
         class EventLoop;
 
-        class InetAddress;
+        /// A connection accepted by Acceptor, not yet wrapped into TcpConnection.
+        struct AcceptedConnection {
+            int sockfd;
+            InetAddress peerAddr;
+        };
 
         ///
-        /// Acceptor of incoming TCP connections.
+        /// Acceptor of incoming TCP (or AF_UNIX stream) connections.
         ///
         class Acceptor : noncopyable {
         public:
             typedef std::function<void(int sockfd, const InetAddress &)> NewConnectionCallback;
 
+            typedef std::vector<AcceptedConnection> AcceptedConnectionList;
+            typedef std::function<void(const AcceptedConnectionList &)> NewConnectionsCallback;
+
             Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
 
             ~Acceptor();
 
             void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
 
+            /// Receives all connections accepted in one readiness event at once,
+            /// takes precedence over NewConnectionCallback.
+            void setNewConnectionsCallback(const NewConnectionsCallback &cb) { newConnectionsCallback_ = cb; }
+
+            /// Calls accept4() up to n times per readiness event, stops earlier on EAGAIN.
+            /// ECONNABORTED and EINTR only skip that attempt.
+            /// Default is 1.
+            void setMaxAcceptsPerEvent(int n) {
+                assert(n > 0);
+                maxAcceptsPerEvent_ = n;
+            }
+
+            /// Enables TCP Fast Open with the given pending queue length.
+            /// Must be called before @c listen
+            void setTcpFastOpen(int qlen);
+
+            /// Only wakes up when data arrives on a new connection, or after @c seconds.
+            /// Must be called before @c listen
+            void setDeferAccept(int seconds);
+
             void listen();
 
             bool listening() const { return listening_; }
@@ -42,12 +73,19 @@ namespace muduo {
         private:
             void handleRead();
 
+            void handleAcceptError();
+
             EventLoop *loop_;
             Socket acceptSocket_;       // listening socket
             Channel acceptChannel_;     // 用于观察acceptSocket的可读事件，然后在handleRead()中调用newConnectionCallback_回调
             NewConnectionCallback newConnectionCallback_;
+            NewConnectionsCallback newConnectionsCallback_;
             bool listening_;
+            int maxAcceptsPerEvent_;
+            AcceptedConnectionList accepted_;   // handleRead()中复用，避免每次分配
             int idleFd_;                // 见handleRead()
+            const bool unix_;           // AF_UNIX，没有TCP的选项
+            const string unixPath_;     // AF_UNIX的socket文件，析构时删除
         };
 
     }  // namespace net
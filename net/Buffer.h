@@ -65,6 +65,9 @@ namespace muduo {
 
             const char *peek() const { return begin() + readerIndex_; }     // readerIndex指向的位置
 
+            // 就地修改可读数据，例如WebSocket的unmask
+            char *mutablePeek() { return begin() + readerIndex_; }
+
             // 在可读数据范围内查找 \r\n 开始的位置
             const char *findCRLF() const {
                 // FIXME: replace with memmem()?
@@ -0,0 +1,346 @@
+//
+// Created by chen on 2022/11/23.
+//
+
+#include "ConnectionPool.h"
+
+#include "../base/Logging.h"
+#include "EventLoop.h"
+#include "TcpClient.h"
+
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            /*
+             *      在下一轮loop中析构，避免在TcpClient自己的回调里析构它。
+             *      要在functor运行时reset()，而不是等functor对象析构：
+             *      后者发生在doPendingFunctors()结束之后，TcpClient析构时queueInLoop()的forceClose()不会唤醒loop
+             */
+            void destroyClient(std::shared_ptr<TcpClient> &client) {
+                client.reset();
+            }
+
+            /*
+             *      TcpClient析构后，它创建的连接还会在关闭时调用回调，
+             *      所以先把指向ConnectionPool的回调换成默认的
+             */
+            void detachConnection(const TcpConnectionPtr &conn) {
+                conn->setConnectionCallback(defaultConnectionCallback);
+                conn->setMessageCallback(defaultMessageCallback);
+                conn->setWriteCompleteCallback(WriteCompleteCallback());
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+ConnectionPool::ConnectionPool(EventLoop *loop, const string &nameArg)
+        : loop_(CHECK_NOTNULL(loop)),
+          name_(nameArg),
+          minConnections_(1),
+          maxConnections_(4),
+          healthCheckInterval_(1.0),
+          idleTimeout_(60.0),
+          acquireTimeout_(3.0),
+          connectionCallback_(defaultConnectionCallback),
+          messageCallback_(defaultMessageCallback),
+          timerStarted_(false) {
+}
+
+ConnectionPool::~ConnectionPool() {
+    loop_->assertInLoopThread();
+    LOG_TRACE << "ConnectionPool::~ConnectionPool [" << name_ << "] destructing";
+    if (timerStarted_) {
+        loop_->cancel(healthCheckTimer_);
+    }
+    for (auto &item : backends_) {
+        Backend *backend = item.second.get();
+        while (!backend->slots.empty()) {
+            removeSlot(backend, backend->slots.size() - 1);
+        }
+        std::deque<Waiter> waiters;
+        waiters.swap(backend->waiters);
+        for (const Waiter &w : waiters) {
+            w.cb(TcpConnectionPtr());
+        }
+    }
+}
+
+void ConnectionPool::setMinConnections(int n) {
+    assert(0 <= n);
+    minConnections_ = n;
+    if (maxConnections_ < n) {
+        maxConnections_ = n;
+    }
+}
+
+void ConnectionPool::setMaxConnections(int n) {
+    assert(0 < n);
+    maxConnections_ = n;
+    if (minConnections_ > n) {
+        minConnections_ = n;
+    }
+}
+
+void ConnectionPool::addBackend(const InetAddress &addr) {
+    loop_->assertInLoopThread();
+    string key = addr.toIpPort();
+    if (backends_.find(key) != backends_.end()) {
+        return;
+    }
+    Backend *backend = new Backend(addr);
+    backends_[key].reset(backend);
+    LOG_INFO << "ConnectionPool::addBackend [" << name_ << "] - " << key;
+    for (int i = 0; i < minConnections_; ++i) {
+        addSlot(backend);
+    }
+    if (!timerStarted_) {
+        timerStarted_ = true;
+        healthCheckTimer_ = loop_->runEvery(healthCheckInterval_,
+                                            std::bind(&ConnectionPool::checkHealth, this));
+    }
+}
+
+void ConnectionPool::removeBackend(const InetAddress &addr) {
+    loop_->assertInLoopThread();
+    BackendMap::iterator it = backends_.find(addr.toIpPort());
+    if (it == backends_.end()) {
+        return;
+    }
+    std::unique_ptr<Backend> backend(std::move(it->second));
+    backends_.erase(it);
+    LOG_INFO << "ConnectionPool::removeBackend [" << name_ << "] - " << addr.toIpPort();
+    while (!backend->slots.empty()) {
+        removeSlot(get_pointer(backend), backend->slots.size() - 1);
+    }
+    for (const Waiter &w : backend->waiters) {
+        w.cb(TcpConnectionPtr());
+    }
+}
+
+TcpConnectionPtr ConnectionPool::tryAcquire(const InetAddress &addr) {
+    loop_->assertInLoopThread();
+    Backend *backend = findBackend(addr);
+    if (!backend) {
+        LOG_ERROR << "ConnectionPool::tryAcquire [" << name_ << "] - unknown backend " << addr.toIpPort();
+        return TcpConnectionPtr();
+    }
+    Slot *slot = pickSlot(backend);
+    return slot ? lease(backend, slot) : TcpConnectionPtr();
+}
+
+void ConnectionPool::acquire(const InetAddress &addr, AcquireCallback cb) {
+    loop_->assertInLoopThread();
+    Backend *backend = findBackend(addr);
+    if (!backend) {
+        LOG_ERROR << "ConnectionPool::acquire [" << name_ << "] - unknown backend " << addr.toIpPort();
+        cb(TcpConnectionPtr());
+        return;
+    }
+    Slot *slot = pickSlot(backend);
+    if (slot) {
+        cb(lease(backend, slot));
+    } else {
+        Waiter w = {std::move(cb), addTime(Timestamp::now(), acquireTimeout_)};
+        backend->waiters.push_back(std::move(w));
+        // 一条连接都没有（例如minConnections为0），开始连接
+        if (backend->slots.empty()) {
+            addSlot(backend);
+        }
+    }
+}
+
+void ConnectionPool::release(const TcpConnectionPtr &conn) {
+    loop_->assertInLoopThread();
+    Backend *backend = findBackend(conn->peerAddress());
+    if (!backend) {
+        return;
+    }
+    for (const auto &slot : backend->slots) {
+        if (slot->conn == conn) {
+            assert(slot->outstanding > 0);
+            --slot->outstanding;
+            slot->lastActive = Timestamp::now();
+            return;
+        }
+    }
+    // 连接已经断开，它的计数随Slot一起清零了
+}
+
+int ConnectionPool::numConnected(const InetAddress &addr) const {
+    loop_->assertInLoopThread();
+    Backend *backend = findBackend(addr);
+    int n = 0;
+    if (backend) {
+        for (const auto &slot : backend->slots) {
+            if (slot->conn) {
+                ++n;
+            }
+        }
+    }
+    return n;
+}
+
+int ConnectionPool::numOutstanding(const InetAddress &addr) const {
+    loop_->assertInLoopThread();
+    Backend *backend = findBackend(addr);
+    int n = 0;
+    if (backend) {
+        for (const auto &slot : backend->slots) {
+            n += slot->outstanding;
+        }
+    }
+    return n;
+}
+
+ConnectionPool::Backend *ConnectionPool::findBackend(const InetAddress &addr) const {
+    BackendMap::const_iterator it = backends_.find(addr.toIpPort());
+    return it == backends_.end() ? NULL : get_pointer(it->second);
+}
+
+/*
+ *      在已连接的连接中选outstanding最少的。
+ *      每个后端的连接数不超过maxConnections（通常是个位数），线性扫描即可
+ */
+ConnectionPool::Slot *ConnectionPool::pickSlot(Backend *backend) const {
+    Slot *best = NULL;
+    for (const auto &slot : backend->slots) {
+        if (slot->conn && slot->conn->connected() &&
+            (best == NULL || slot->outstanding < best->outstanding)) {
+            best = get_pointer(slot);
+        }
+    }
+    return best;
+}
+
+/*
+ *      所有连接都有未完成的请求，并且没有正在建立的连接时，再开一条（不超过maxConnections）。
+ *      这次请求仍然用当前负载最轻的连接，新连接留给之后的请求
+ */
+TcpConnectionPtr ConnectionPool::lease(Backend *backend, Slot *slot) {
+    if (slot->outstanding > 0 && static_cast<int>(backend->slots.size()) < maxConnections_) {
+        bool connecting = false;
+        for (const auto &s : backend->slots) {
+            if (!s->conn) {
+                connecting = true;
+                break;
+            }
+        }
+        if (!connecting) {
+            addSlot(backend);
+        }
+    }
+    ++slot->outstanding;
+    slot->lastActive = Timestamp::now();
+    return slot->conn;
+}
+
+void ConnectionPool::addSlot(Backend *backend) {
+    char buf[64];
+    snprintf(buf, sizeof buf, ":%s#%d", backend->addr.toIpPort().c_str(), backend->nextSlotId);
+    ++backend->nextSlotId;
+
+    Slot *slot = new Slot;
+    slot->client.reset(new TcpClient(loop_, backend->addr, name_ + buf));
+    slot->outstanding = 0;
+    slot->lastActive = Timestamp::now();
+    backend->slots.emplace_back(slot);
+
+    TcpClient *client = get_pointer(slot->client);
+    client->setConnectionCallback(
+            std::bind(&ConnectionPool::onConnection, this, backend, slot, _1));
+    client->setMessageCallback(messageCallback_);
+    client->setWriteCompleteCallback(writeCompleteCallback_);
+    client->enableRetry();
+    client->connect();
+}
+
+void ConnectionPool::removeSlot(Backend *backend, size_t index) {
+    assert(index < backend->slots.size());
+    std::unique_ptr<Slot> slot(std::move(backend->slots[index]));
+    backend->slots.erase(backend->slots.begin() + index);
+    if (slot->conn) {
+        detail::detachConnection(slot->conn);
+        // TcpClient析构时，只有它独占连接才会forceClose()
+        slot->conn.reset();
+    }
+    slot->client->stop();       // 不再重连
+    loop_->queueInLoop(std::bind(&detail::destroyClient, slot->client));
+}
+
+void ConnectionPool::onConnection(Backend *backend, Slot *slot, const TcpConnectionPtr &conn) {
+    loop_->assertInLoopThread();
+    if (conn->connected()) {
+        slot->conn = conn;
+        slot->outstanding = 0;
+        slot->lastActive = Timestamp::now();
+        connectionCallback_(conn);
+        serveWaiters(backend);
+    } else {
+        // TcpClient会重连，Slot保留
+        slot->conn.reset();
+        slot->outstanding = 0;
+        connectionCallback_(conn);
+    }
+}
+
+void ConnectionPool::serveWaiters(Backend *backend) {
+    while (!backend->waiters.empty()) {
+        Slot *slot = pickSlot(backend);
+        if (!slot) {
+            break;
+        }
+        Waiter w(std::move(backend->waiters.front()));
+        backend->waiters.pop_front();
+        w.cb(lease(backend, slot));
+    }
+}
+
+void ConnectionPool::checkHealth() {
+    loop_->assertInLoopThread();
+    Timestamp now = Timestamp::now();
+    for (auto &item : backends_) {
+        checkBackend(get_pointer(item.second), now);
+    }
+}
+
+/*
+ *      1. 健康检查失败的连接强制关闭，TcpClient负责重连
+ *      2. 超过minConnections的部分，空闲超过idleTimeout的关闭
+ *      3. 补足minConnections
+ *      4. 等待超时的acquire()以空指针回调
+ */
+void ConnectionPool::checkBackend(Backend *backend, Timestamp now) {
+    for (const auto &slot : backend->slots) {
+        if (slot->conn && healthCheckCallback_ && !healthCheckCallback_(slot->conn)) {
+            LOG_WARN << "ConnectionPool::checkBackend [" << name_ << "] - "
+                     << slot->conn->name() << " failed health check";
+            slot->conn->forceClose();
+        }
+    }
+
+    for (size_t i = backend->slots.size(); i > 0 && static_cast<int>(backend->slots.size()) > minConnections_; --i) {
+        Slot *slot = get_pointer(backend->slots[i - 1]);
+        if (slot->outstanding == 0 && timeDifference(now, slot->lastActive) > idleTimeout_) {
+            removeSlot(backend, i - 1);
+        }
+    }
+
+    while (static_cast<int>(backend->slots.size()) < minConnections_) {
+        addSlot(backend);
+    }
+
+    while (!backend->waiters.empty() && backend->waiters.front().deadline < now) {
+        Waiter w(std::move(backend->waiters.front()));
+        backend->waiters.pop_front();
+        LOG_WARN << "ConnectionPool::checkBackend [" << name_ << "] - acquire timeout "
+                 << backend->addr.toIpPort();
+        w.cb(TcpConnectionPtr());
+    }
+}
@@ -0,0 +1,168 @@
+//
+// Created by chen on 2022/11/23.
+//
+
+/*
+ *      ConnectionPool：到多个后端的出站连接池
+ *
+ *      TcpClient只管理一条连接，每次需要时再连接会多付出一次握手的延迟。
+ *      ConnectionPool为每个后端地址保持若干条长连接（每条由一个开启了重连的TcpClient维护）：
+ *
+ *      1. 一个ConnectionPool只属于一个EventLoop，所有操作都在这个loop线程中进行，不需要锁。
+ *         多个IO线程各自持有一个ConnectionPool，min/max都是针对单个loop而言的。
+ *      2. 连接是多路复用的：同一条连接上可以同时有多个未完成的请求（outstanding），
+ *         acquire()选择outstanding最少的那条已连接的连接，release()归还。
+ *      3. 每个后端至少保持minConnections条连接（热备），所有连接都忙时按需扩容到maxConnections条，
+ *         空闲超过idleTimeout的多余连接在健康检查时被关闭。
+ *      4. 健康检查定时运行：HealthCheckCallback返回false的连接被强制关闭，由TcpClient重连。
+ *      5. 没有可用连接时，acquire(addr, cb)把请求挂起，等连接建立后再交给cb；超过acquireTimeout则以空指针回调。
+ *
+ *      应答如何与请求对应由上层协议决定（例如请求id），ConnectionPool只负责挑选连接。
+ */
+
+#ifndef MYMUDUO_CONNECTIONPOOL_H
+#define MYMUDUO_CONNECTIONPOOL_H
+
+#include "../base/Timestamp.h"
+#include "TcpConnection.h"
+#include "TimerId.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class EventLoop;
+        class TcpClient;
+
+        ///
+        /// Pool of multiplexed outbound connections, keyed by backend address.
+        ///
+        /// Owned by one EventLoop, every member function must be called in its thread.
+        class ConnectionPool : noncopyable {
+        public:
+            /// conn is null if no connection became available within the acquire timeout.
+            typedef std::function<void(const TcpConnectionPtr &conn)> AcquireCallback;
+            /// Returns false to have the connection closed and re-established.
+            typedef std::function<bool(const TcpConnectionPtr &conn)> HealthCheckCallback;
+
+            ConnectionPool(EventLoop *loop, const string &nameArg);
+
+            ~ConnectionPool();  // force out-line dtor, for std::unique_ptr members.
+
+            EventLoop *getLoop() const { return loop_; }
+
+            const string &name() const { return name_; }
+
+            /// Connections kept open to every backend, default 1.
+            void setMinConnections(int n);
+
+            /// Upper bound of connections to one backend, default 4.
+            void setMaxConnections(int n);
+
+            /// Must be called before the first addBackend(), default 1 second.
+            void setHealthCheckInterval(double seconds) { healthCheckInterval_ = seconds; }
+
+            /// Connections above the minimum are closed after being idle this long, default 60 seconds.
+            void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+
+            /// How long acquire() waits for a connection, default 3 seconds.
+            /// Checked by the health check, so the actual wait may be one interval longer.
+            void setAcquireTimeout(double seconds) { acquireTimeout_ = seconds; }
+
+            void setHealthCheckCallback(HealthCheckCallback cb) { healthCheckCallback_ = std::move(cb); }
+
+            /// Callbacks of pooled connections, set them before addBackend().
+            void setConnectionCallback(ConnectionCallback cb) { connectionCallback_ = std::move(cb); }
+
+            void setMessageCallback(MessageCallback cb) { messageCallback_ = std::move(cb); }
+
+            void setWriteCompleteCallback(WriteCompleteCallback cb) { writeCompleteCallback_ = std::move(cb); }
+
+            /// Starts connecting the warm connections, does nothing if the backend exists.
+            void addBackend(const InetAddress &addr);
+
+            /// Closes all connections to addr, pending acquires get a null connection.
+            /// Must not be called from AcquireCallback or HealthCheckCallback.
+            void removeBackend(const InetAddress &addr);
+
+            /// Returns the connected connection with the fewest outstanding requests,
+            /// or null if there is none. A non-null result must be given back by release().
+            TcpConnectionPtr tryAcquire(const InetAddress &addr);
+
+            /// Like tryAcquire(), but waits for a connection if none is ready.
+            /// cb runs inside this call when a connection is ready.
+            void acquire(const InetAddress &addr, AcquireCallback cb);
+
+            void release(const TcpConnectionPtr &conn);
+
+            // 统计信息
+            int numConnected(const InetAddress &addr) const;
+
+            int numOutstanding(const InetAddress &addr) const;
+
+        private:
+            struct Slot {
+                std::shared_ptr<TcpClient> client;
+                TcpConnectionPtr conn;      // 未连接时为空
+                int outstanding;
+                Timestamp lastActive;
+            };
+
+            struct Waiter {
+                AcquireCallback cb;
+                Timestamp deadline;
+            };
+
+            struct Backend {
+                explicit Backend(const InetAddress &a) : addr(a), nextSlotId(1) {}
+
+                InetAddress addr;
+                std::vector<std::unique_ptr<Slot>> slots;
+                std::deque<Waiter> waiters;
+                int nextSlotId;
+            };
+
+            typedef std::map<string, std::unique_ptr<Backend>> BackendMap;
+
+            Backend *findBackend(const InetAddress &addr) const;
+
+            Slot *pickSlot(Backend *backend) const;
+
+            TcpConnectionPtr lease(Backend *backend, Slot *slot);
+
+            void addSlot(Backend *backend);
+
+            void removeSlot(Backend *backend, size_t index);
+
+            void onConnection(Backend *backend, Slot *slot, const TcpConnectionPtr &conn);
+
+            void serveWaiters(Backend *backend);
+
+            void checkHealth();
+
+            void checkBackend(Backend *backend, Timestamp now);
+
+            EventLoop *loop_;
+            const string name_;
+            int minConnections_;
+            int maxConnections_;
+            double healthCheckInterval_;
+            double idleTimeout_;
+            double acquireTimeout_;
+            HealthCheckCallback healthCheckCallback_;
+            ConnectionCallback connectionCallback_;
+            MessageCallback messageCallback_;
+            WriteCompleteCallback writeCompleteCallback_;
+            BackendMap backends_;
+            bool timerStarted_;
+            TimerId healthCheckTimer_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_CONNECTIONPOOL_H
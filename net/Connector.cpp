@@ -5,8 +5,10 @@
 #include "Connector.h"
 
 #include "../base/Logging.h"
+#include "../base/WeakCallback.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "Resolver.h"
 #include "SocketsOps.h"
 
 #include <errno.h>
@@ -19,13 +21,34 @@ const int Connector::kMaxRetryDelayMs;
 Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
         : loop_(loop),
           serverAddr_(serverAddr),
+          port_(serverAddr.port()),
           connect_(false),
           state_(kDisconnected),
-          retryDelayMs_(kInitRetryDelayMs)
+          retryDelayMs_(kInitRetryDelayMs),
+          fastOpen_(false)
 {
     LOG_DEBUG << "ctor[" << this << "]";
 }
 
+Connector::Connector(EventLoop* loop, const string& hostname, uint16_t port)
+        : loop_(loop),
+          serverAddr_(port),
+          hostname_(hostname),
+          port_(port),
+          connect_(false),
+          state_(kDisconnected),
+          retryDelayMs_(kInitRetryDelayMs),
+          fastOpen_(false)
+{
+    LOG_DEBUG << "ctor[" << this << "] " << hostname_ << ":" << port_;
+}
+
+void Connector::setServerAddress(const InetAddress& serverAddr)
+{
+    loop_->assertInLoopThread();
+    serverAddr_ = serverAddr;
+}
+
 Connector::~Connector()
 {
     LOG_DEBUG << "dtor[" << this << "]";
@@ -45,7 +68,13 @@ void Connector::startInLoop()
 {
     loop_->assertInLoopThread();
     assert(state_ == kDisconnected);
-    if (connect_)
+    if (connect_ && !hostname_.empty())
+    {
+        // 不能在IO线程里阻塞地解析，交给Resolver，结果在onResolved()中返回
+        Resolver::instance().resolve(loop_, hostname_, port_,
+                                     makeWeakCallback(shared_from_this(), &Connector::onResolved));
+    }
+    else if (connect_)
     {
         connect();
     }
@@ -90,8 +119,39 @@ void Connector::stopInLoop()
 void Connector::connect()
 {
     int sockfd = sockets::createNonblockingOrDie(serverAddr_.family());
-    int ret = sockets::connect(sockfd, serverAddr_.getSockAddr());
+    bool fastOpen = false;
+    if (fastOpen_ && serverAddr_.family() != AF_UNIX)
+    {
+        fastOpen = sockets::setTcpFastOpenConnect(sockfd, true);
+        if (!fastOpen)
+        {
+            // 内核不支持，退化为普通的connect()
+            LOG_DEBUG << "TCP_FASTOPEN_CONNECT is not supported";
+        }
+    }
+    int ret = sockets::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.addrLength());
     int savedErrno = (ret == 0) ? 0 : errno;
+    if (ret == 0 && fastOpen)
+    {
+        /*
+         *      有cookie时内核推迟了握手，SYN要等第一次write()才和数据一起发出去。
+         *      此时socket已经可写，但可写不代表连接成功，handleWrite()里的SO_ERROR检查没有意义，
+         *      所以直接当作连接成功交给用户，让连接回调里的第一次send()带上数据；
+         *      回调里没有发送时由TcpClient::newConnection()发出SYN，见sockets::startDeferredConnect()。
+         *      此时还没有对端地址，也就无法检查自连接（TFO只用于连接远端的服务端，不会自连接）。
+         *      握手失败的话会在TcpConnection上以读错误的形式出现，而不是重连。
+         */
+        setState(kConnected);
+        if (connect_)
+        {
+            newConnectionCallback_(sockfd);
+        }
+        else
+        {
+            sockets::close(sockfd);
+        }
+        return;
+    }
     switch (savedErrno)
     {
         case 0:                     // 成功
@@ -106,6 +166,7 @@ void Connector::connect()
         case EADDRNOTAVAIL:         // Cannot assign requested address
         case ECONNREFUSED:          // Connection refused
         case ENETUNREACH:           // Network is unreachable
+        case ENOENT:                // No such file or directory（AF_UNIX的socket文件还没创建）
             retry(sockfd);
             break;
 
@@ -238,6 +299,29 @@ void Connector::handleError()
     }
 }
 
+/*
+ *      Resolver在loop线程中回调：解析成功后开始连接，失败按重连的间隔稍后再解析
+ */
+void Connector::onResolved(bool ok, const InetAddress& serverAddr)
+{
+    loop_->assertInLoopThread();
+    if (!connect_ || state_ != kDisconnected)
+    {
+        LOG_DEBUG << "do not connect";
+        return;
+    }
+    if (ok)
+    {
+        serverAddr_ = serverAddr;
+        connect();
+    }
+    else
+    {
+        LOG_ERROR << "Connector::onResolved - can't resolve " << hostname_;
+        scheduleRetry();
+    }
+}
+
 /*
  *      重新连接
  */
@@ -245,6 +329,11 @@ void Connector::retry(int sockfd)
 {
     sockets::close(sockfd);
     setState(kDisconnected);
+    scheduleRetry();
+}
+
+void Connector::scheduleRetry()
+{
     if (connect_)
     {
         LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
@@ -6,6 +6,7 @@
 #define MYMUDUO_CONNECTOR_H
 
 #include "../base/noncopyable.h"
+#include "../base/Types.h"
 #include "InetAddress.h"
 
 #include <functional>
@@ -26,6 +27,9 @@ namespace muduo
             typedef std::function<void (int sockfd)> NewConnectionCallback;
 
             Connector(EventLoop* loop, const InetAddress& serverAddr);
+            /// Resolves hostname with Resolver::instance() before every connection attempt,
+            /// so the address follows DNS changes (subject to the resolver cache).
+            Connector(EventLoop* loop, const string& hostname, uint16_t port);
             ~Connector();
 
             void setNewConnectionCallback(const NewConnectionCallback& cb)
@@ -37,6 +41,16 @@ namespace muduo
 
             const InetAddress& serverAddress() const { return serverAddr_; }
 
+            const string& hostname() const { return hostname_; }
+
+            /// Used by the next connection attempt, must be called in loop thread.
+            void setServerAddress(const InetAddress& serverAddr);
+
+            // 见 sockets::setTcpFastOpenConnect()
+            void setTcpFastOpen(bool on) { fastOpen_ = on; }
+
+            bool tcpFastOpen() const { return fastOpen_; }
+
         private:
             enum States { kDisconnected, kConnecting, kConnected };     // 未连接；正在连接；已连接
             static const int kMaxRetryDelayMs = 30*1000;
@@ -50,16 +64,21 @@ namespace muduo
             void handleWrite();
             void handleError();
             void retry(int sockfd);
+            void scheduleRetry();
+            void onResolved(bool ok, const InetAddress& serverAddr);
             int removeAndResetChannel();
             void resetChannel();
 
             EventLoop* loop_;
             InetAddress serverAddr_;
+            const string hostname_;     // 非空时每次连接前先解析
+            const uint16_t port_;
             bool connect_; // atomic
             States state_;  // FIXME: use atomic variable
             std::unique_ptr<Channel> channel_;                  // 监听可写事件（但不意味着连接成功，见handleWrite()）
             NewConnectionCallback newConnectionCallback_;
             int retryDelayMs_;
+            bool fastOpen_;
         };
 
     }  // namespace net
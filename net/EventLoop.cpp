@@ -7,6 +7,7 @@
 #include "../base/Logging.h"
 #include "../base/Mutex.h"
 #include "Channel.h"
+#include "PipePool.h"
 #include "poller/Poller.h"
 #include "SocketsOps.h"
 #include "TimerQueue.h"
@@ -116,7 +117,7 @@ void EventLoop::loop() {
         activeChannels_.clear();
         pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
         ++iteration_;
-        if (Logger::logLevel() <= Logger::TRACE) {
+        if (MUDUO_LOG_MIN_LEVEL <= 0 && Logger::logLevel() <= Logger::TRACE) {
             printActiveChannels();
         }
 
@@ -241,6 +242,14 @@ bool EventLoop::hasChannel(Channel *channel) {
     return poller_->hasChannel(channel);
 }
 
+PipePool *EventLoop::pipePool() {
+    assertInLoopThread();
+    if (!pipePool_) {
+        pipePool_.reset(new PipePool);
+    }
+    return pipePool_.get();
+}
+
 void EventLoop::abortNotInLoopThread() {
     LOG_FATAL << "EventLoop::abortNotInLoopThread - EventLoop " << this
               << " was created in threadId_ = " << threadId_
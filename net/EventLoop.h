@@ -22,6 +22,8 @@ namespace muduo {
 
         class Channel;
 
+        class PipePool;
+
         class Poller;
 
         class TimerQueue;
@@ -126,6 +128,10 @@ namespace muduo {
 
             static EventLoop *getEventLoopOfCurrentThread();
 
+            /// Pipes for splice(2), created on first use.
+            /// Must be called in loop thread.
+            PipePool *pipePool();
+
         private:
             void abortNotInLoopThread();
 
@@ -144,6 +150,7 @@ namespace muduo {
             Timestamp pollReturnTime_;
             std::unique_ptr<Poller> poller_;
             std::unique_ptr<TimerQueue> timerQueue_;
+            std::unique_ptr<PipePool> pipePool_;
 
             // 为queueInLoop()而设计
             int wakeupFd_;
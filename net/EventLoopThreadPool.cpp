@@ -4,20 +4,62 @@
 
 #include "EventLoopThreadPool.h"
 
+#include "../base/Logging.h"
 #include "EventLoop.h"
 #include "EventLoopThread.h"
 
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            // 本进程允许运行的CPU（可能被taskset/cgroup限制）
+            std::vector<int> allowedCpus() {
+                std::vector<int> cpus;
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                if (::sched_getaffinity(0, sizeof set, &set) == 0) {
+                    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                        if (CPU_ISSET(cpu, &set)) {
+                            cpus.push_back(cpu);
+                        }
+                    }
+                }
+                return cpus;
+            }
+
+            // 在IO线程中运行，先绑定CPU再调用用户的ThreadInitCallback
+            void pinThread(int cpu, const EventLoopThreadPool::ThreadInitCallback &cb, EventLoop *loop) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+                if (ret != 0) {
+                    errno = ret;
+                    LOG_SYSERR << "pthread_setaffinity_np cpu " << cpu;
+                }
+                if (cb) {
+                    cb(loop);
+                }
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const string &nameArg)
         : baseLoop_(baseLoop),
           name_(nameArg),
           started_(false),
           numThreads_(0),
-          next_(0) {
+          next_(0),
+          cpuAffinity_(false) {
 }
 
 EventLoopThreadPool::~EventLoopThreadPool() {
@@ -30,13 +72,38 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
 
     started_ = true;
 
+    std::vector<int> cpus(detail::allowedCpus());
     for (int i = 0; i < numThreads_; ++i) {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-        EventLoopThread *t = new EventLoopThread(cb, buf);
+        ThreadInitCallback init(cb);
+        if (cpuAffinity_ && !cpus.empty()) {
+            init = std::bind(&detail::pinThread, cpus[i % cpus.size()], cb, _1);
+        }
+        EventLoopThread *t = new EventLoopThread(init, buf);
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop());
     }
+
+    /*
+     *      cpu --> loop 的映射：
+     *      绑定在该cpu上的loop；没有的话（没有开启绑定，或者loop比cpu少）固定映射到 loops_[cpu % n]，
+     *      保证同一个cpu来的连接总是落在同一个loop上
+     */
+    if (!loops_.empty() && !cpus.empty()) {
+        cpuToLoop_.assign(static_cast<size_t>(cpus.back()) + 1, -1);
+        for (int i = 0; i < numThreads_ && cpuAffinity_; ++i) {
+            int cpu = cpus[i % cpus.size()];
+            if (cpuToLoop_[cpu] < 0) {
+                cpuToLoop_[cpu] = i;
+            }
+        }
+        for (size_t cpu = 0; cpu < cpuToLoop_.size(); ++cpu) {
+            if (cpuToLoop_[cpu] < 0) {
+                cpuToLoop_[cpu] = static_cast<int>(cpu % loops_.size());
+            }
+        }
+    }
     if (numThreads_ == 0 && cb) {
         cb(baseLoop_);
     }
@@ -68,6 +135,19 @@ EventLoop *EventLoopThreadPool::getLoopForHash(size_t hashCode) {
     return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForCpu(int cpu) {
+    baseLoop_->assertInLoopThread();
+    assert(started_);
+    EventLoop *loop = baseLoop_;
+
+    if (!loops_.empty() && cpu >= 0) {
+        size_t index = implicit_cast<size_t>(cpu) < cpuToLoop_.size() ? cpuToLoop_[cpu]
+                                                                     : cpu % loops_.size();
+        loop = loops_[index];
+    }
+    return loop;
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops() {
     baseLoop_->assertInLoopThread();
     assert(started_);
@@ -30,6 +30,10 @@ namespace muduo {
 
             void setThreadNum(int numThreads) { numThreads_ = numThreads; }
 
+            /// Pins the i-th IO thread on the i-th CPU this process may run on (wraps around).
+            /// Must be called before @c start
+            void setCpuAffinity(bool on) { cpuAffinity_ = on; }
+
             void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
             // valid after calling start()
@@ -39,6 +43,9 @@ namespace muduo {
             /// with the same hash code, it will always return the same EventLoop
             EventLoop *getLoopForHash(size_t hashCode);
 
+            /// the loop pinned on cpu, or a fixed loop for cpu if none is pinned there
+            EventLoop *getLoopForCpu(int cpu);
+
             std::vector<EventLoop *> getAllLoops();
 
             bool started() const { return started_; }
@@ -52,6 +59,8 @@ namespace muduo {
             bool started_;
             int numThreads_;
             int next_;
+            bool cpuAffinity_;
+            std::vector<int> cpuToLoop_;        // cpu --> loops_的下标，见start()
             std::vector<std::unique_ptr<EventLoopThread>> threads_;
             std::vector<EventLoop *> loops_;
         };
@@ -10,6 +10,8 @@
 #include <netdb.h>
 #include <netinet/in.h>
 
+#include <algorithm>
+
 
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 
@@ -25,8 +27,8 @@ static const in_addr_t kInaddrLoopback = INADDR_LOOPBACK;
 using namespace muduo;
 using namespace muduo::net;
 
-static_assert(sizeof(InetAddress) == sizeof(struct sockaddr_in6),
-              "InetAddress is same size as sockaddr_in6");
+static_assert(sizeof(UnixAddress) == sizeof(InetAddress),
+              "UnixAddress has no extra member");
 
 
 /*
@@ -36,15 +38,16 @@ InetAddress::InetAddress(uint16_t port, bool loopbackOnly, bool ipv6) {
     // InetAddress要么是sockaddr_in，要么是sockaddr_in6
     static_assert(offsetof(InetAddress, addr6_) == 0, "addr6_ offset 0");
     static_assert(offsetof(InetAddress, addr_) == 0, "addr_ offset 0");
+    static_assert(offsetof(InetAddress, addrUn_) == 0, "addrUn_ offset 0");
 
+    memZero(&addrUn_, sizeof addrUn_);
+    unixLen_ = 0;
     if(ipv6){
-        memZero(&addr6_, sizeof addr6_);
         addr6_.sin6_family = AF_INET6;
         in6_addr ip = loopbackOnly ? in6addr_loopback : in6addr_any;
         addr6_.sin6_addr = ip;
         addr6_.sin6_port = sockets::hostToNetwork16(port);
     }else{
-        memZero(&addr_, sizeof addr_);
         addr_.sin_family = AF_INET;
         in_addr_t ip = loopbackOnly ? kInaddrLoopback : kInaddrAny;
         addr_.sin_addr.s_addr = sockets::hostToNetwork32(ip);
@@ -52,23 +55,99 @@ InetAddress::InetAddress(uint16_t port, bool loopbackOnly, bool ipv6) {
     }
 }
 
-InetAddress::InetAddress(StringArg ip, uint16_t port, bool ipv6) {
+InetAddress::InetAddress(StringArg ip, uint16_t port, bool ipv6): unixLen_(0) {
+    memZero(&addrUn_, sizeof addrUn_);
     if(ipv6 || strchr(ip.c_str(), ':')){
-        memZero(&addr6_, sizeof addr6_);
         sockets::fromIpPort(ip.c_str(), port, &addr6_);
     }else{
-        memZero(&addr_, sizeof addr_);
         sockets::fromIpPort(ip.c_str(), port, &addr_);
     }
 }
 
+/*
+ *      union中没有被覆盖到的部分清零
+ */
+InetAddress::InetAddress(const struct sockaddr_in &addr): unixLen_(0) {
+    memZero(&addrUn_, sizeof addrUn_);
+    addr_ = addr;
+}
+
+InetAddress::InetAddress(const struct sockaddr_in6 &addr): unixLen_(0) {
+    memZero(&addrUn_, sizeof addrUn_);
+    addr6_ = addr;
+}
+
+InetAddress::InetAddress(const struct sockaddr *addr, socklen_t addrlen): unixLen_(0) {
+    memZero(&addrUn_, sizeof addrUn_);
+    if(addr->sa_family == AF_UNIX){
+        unixLen_ = std::min(addrlen, static_cast<socklen_t>(sizeof addrUn_));
+        memcpy(&addrUn_, addr, unixLen_);
+    }else{
+        memcpy(&addrUn_, addr, std::min(addrlen, static_cast<socklen_t>(sizeof addr6_)));
+    }
+}
+
+/*
+ *      路径形式的地址长度包括末尾的'\0'；抽象命名空间的地址是'\0'加上名字，没有结尾的'\0'
+ */
+UnixAddress::UnixAddress(StringArg path, bool abstract) {
+    struct sockaddr_un addr;
+    memZero(&addr, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    size_t len = strlen(path.c_str());
+    size_t offset = abstract ? 1 : 0;
+    if(offset + len >= sizeof addr.sun_path){
+        LOG_ERROR << "UnixAddress - path too long: " << path.c_str();
+        len = sizeof addr.sun_path - 1 - offset;
+    }
+    memcpy(addr.sun_path + offset, path.c_str(), len);
+    socklen_t addrlen = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + offset + len
+                                               + (abstract ? 0 : 1));
+    *static_cast<InetAddress *>(this) = InetAddress(reinterpret_cast<const struct sockaddr *>(&addr), addrlen);
+}
+
+socklen_t InetAddress::addrLength() const {
+    switch (family()) {
+        case AF_INET:
+            return static_cast<socklen_t>(sizeof addr_);
+        case AF_UNIX:
+            return unixLen_;
+        default:
+            return static_cast<socklen_t>(sizeof addr6_);
+    }
+}
+
+string InetAddress::path() const {
+    if(family() != AF_UNIX || unixLen_ <= offsetof(struct sockaddr_un, sun_path)){
+        return string();
+    }
+    size_t len = unixLen_ - offsetof(struct sockaddr_un, sun_path);
+    if(addrUn_.sun_path[0] == '\0'){
+        return string(addrUn_.sun_path, len);
+    }
+    return string(addrUn_.sun_path, ::strnlen(addrUn_.sun_path, len));
+}
+
+bool InetAddress::isAbstractUnix() const {
+    return family() == AF_UNIX && unixLen_ > offsetof(struct sockaddr_un, sun_path) && addrUn_.sun_path[0] == '\0';
+}
+
+/*
+ *      AF_UNIX 形如 unix:/tmp/foo.sock，抽象命名空间的地址用'@'代替开头的'\0'，和ss(8)一样
+ */
 string InetAddress::toIpPort() const {
+    if(family() == AF_UNIX){
+        return isAbstractUnix() ? "unix:@" + path().substr(1) : "unix:" + path();
+    }
     char buf[64] = "";
     sockets::toIpPort(buf, sizeof buf, getSockAddr());
     return buf;
 }
 
 string InetAddress::toIp() const {
+    if(family() == AF_UNIX){
+        return path();
+    }
     char buf[64] = "";
     sockets::toIp(buf, sizeof buf, getSockAddr());
     return buf;
@@ -83,6 +162,9 @@ uint32_t InetAddress::ipv4NetEndian() const {
 }
 
 uint16_t InetAddress::port() const {
+    if(family() == AF_UNIX){
+        return 0;
+    }
     return sockets::networkToHost16(portNetEndian());
 }
 
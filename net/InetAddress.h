@@ -4,8 +4,13 @@
 
 /*
  *      InetAddress
- *      封装了sockaddr_in/sockaddr_in6
+ *      封装了sockaddr_in/sockaddr_in6/sockaddr_un
  *
+ *      sockaddr_un 用于同一台主机上的 AF_UNIX stream socket，见UnixAddress。
+ *      Acceptor/Connector/TcpConnection 只认InetAddress，所以Unix domain socket可以直接复用TCP的那一套。
+ *
+ *      sockaddr_un和另外两种sockaddr放在同一个union中，另外记录AF_UNIX地址的实际长度：
+ *      accept()/getsockname()得到的路径不会被截断，抽象命名空间的地址（sun_path以'\0'开头）也能表示。
  */
 
 #ifndef MYMUDUO_INETADDRESS_H
@@ -14,6 +19,7 @@
 #include "../base/copyable.h"
 #include "../base/StringPiece.h"
 #include <netinet/in.h>
+#include <sys/un.h>
 
 namespace muduo{
     namespace net{
@@ -31,14 +37,25 @@ namespace muduo{
             InetAddress(StringArg ip, uint16_t port = 0, bool ipv6 = false);
 
             // 使用sockaddr_in / sockaddr_in6直接创建
-            explicit InetAddress(const struct sockaddr_in &addr): addr_(addr){}
-            explicit InetAddress(const struct sockaddr_in6 &addr): addr6_(addr){}
+            explicit InetAddress(const struct sockaddr_in &addr);
+            explicit InetAddress(const struct sockaddr_in6 &addr);
+            // accept()/getsockname()/getpeername()的结果，addrlen是内核返回的实际长度
+            InetAddress(const struct sockaddr *addr, socklen_t addrlen);
 
-            /// FIXME 如果是ipv6怎么处理？
+            // 三种sockaddr的family字段偏移量相同
             sa_family_t family() const {
                 return addr_.sin_family;
             }
 
+            // bind()/connect() 时使用的地址长度
+            socklen_t addrLength() const;
+
+            // AF_UNIX的路径，抽象命名空间的地址以'\0'开头；其它family和没有绑定地址的AF_UNIX socket返回空串
+            string path() const;
+
+            // AF_UNIX抽象命名空间的地址，没有对应的socket文件
+            bool isAbstractUnix() const;
+
             string toIp() const;
             string toIpPort() const;
             uint16_t port() const;
@@ -48,7 +65,7 @@ namespace muduo{
             }
 
             void setSockAddrInet6(const struct sockaddr_in6 &addr6){
-                addr6_ = addr6;
+                *this = InetAddress(addr6);
             }
 
             uint32_t ipv4NetEndian() const;
@@ -66,7 +83,18 @@ namespace muduo{
             union{
                 struct sockaddr_in addr_;
                 struct sockaddr_in6 addr6_;
+                struct sockaddr_un addrUn_;
             };
+            socklen_t unixLen_;     // AF_UNIX地址的实际长度
+        };
+
+        ///
+        /// Address of an AF_UNIX stream socket, a path or a name in the abstract namespace.
+        ///
+        /// It has no member of its own, so passing it by value as InetAddress is fine.
+        class UnixAddress : public InetAddress {
+        public:
+            explicit UnixAddress(StringArg path, bool abstract = false);
         };
 
     }   // net
@@ -0,0 +1,157 @@
+//
+// Created by chen on 2022/11/25.
+//
+
+#include "LengthHeaderCodec.h"
+
+#include "../base/Logging.h"
+
+#include <endian.h>
+#include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            void defaultFrameErrorCallback(const TcpConnectionPtr &conn, uint64_t length) {
+                LOG_ERROR << "LengthHeaderCodec - " << conn->name() << " invalid frame length " << length;
+                conn->forceClose();
+            }
+
+            // headerLen字节能表示的最大长度
+            uint64_t maxLengthOfHeader(int headerLen) {
+                return headerLen == 8 ? UINT64_MAX : (static_cast<uint64_t>(1) << (headerLen * 8)) - 1;
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+const size_t LengthHeaderCodec::kDefaultMaxFrameSize;
+
+/*
+ *      maxFrameSize同时受长度头能表示的范围和StringPiece的int长度限制
+ */
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback &cb,
+                                     int headerLen,
+                                     ByteOrder byteOrder,
+                                     size_t maxFrameSize)
+        : frameCallback_(cb),
+          errorCallback_(detail::defaultFrameErrorCallback),
+          headerLen_(headerLen),
+          byteOrder_(byteOrder),
+          maxFrameSize_(static_cast<size_t>(std::min<uint64_t>(
+                  std::min<uint64_t>(maxFrameSize, INT_MAX),
+                  detail::maxLengthOfHeader(headerLen)))) {
+    assert(headerLen == 1 || headerLen == 2 || headerLen == 4 || headerLen == 8);
+}
+
+uint64_t LengthHeaderCodec::readHeader(const char *data) const {
+    switch (headerLen_) {
+        case 1:
+            return static_cast<uint8_t>(*data);
+        case 2: {
+            uint16_t x;
+            ::memcpy(&x, data, sizeof x);
+            return byteOrder_ == kBigEndian ? be16toh(x) : le16toh(x);
+        }
+        case 4: {
+            uint32_t x;
+            ::memcpy(&x, data, sizeof x);
+            return byteOrder_ == kBigEndian ? be32toh(x) : le32toh(x);
+        }
+        default: {
+            uint64_t x;
+            ::memcpy(&x, data, sizeof x);
+            return byteOrder_ == kBigEndian ? be64toh(x) : le64toh(x);
+        }
+    }
+}
+
+/*
+ *      用指针扫过所有完整的帧，最后一次retrieve()。
+ *      回调里可能关闭连接，但Buffer属于TcpConnection，在本函数返回前不会被释放
+ */
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *p = begin;
+    const size_t headerLen = implicit_cast<size_t>(headerLen_);
+    while (static_cast<size_t>(end - p) >= headerLen) {
+        uint64_t length = readHeader(p);
+        if (length > maxFrameSize_) {
+            errorCallback_(conn, length);
+            buf->retrieveAll();
+            return;
+        }
+        if (static_cast<uint64_t>(end - p) - headerLen < length) {
+            break;
+        }
+        frameCallback_(conn, StringPiece(p + headerLen, static_cast<int>(length)), receiveTime);
+        p += headerLen + length;
+    }
+    buf->retrieve(static_cast<size_t>(p - begin));
+}
+
+void LengthHeaderCodec::writeHeader(size_t length, char *header) const {
+    switch (headerLen_) {
+        case 1: {
+            uint8_t x = static_cast<uint8_t>(length);
+            ::memcpy(header, &x, sizeof x);
+            break;
+        }
+        case 2: {
+            uint16_t x = static_cast<uint16_t>(length);
+            x = byteOrder_ == kBigEndian ? htobe16(x) : htole16(x);
+            ::memcpy(header, &x, sizeof x);
+            break;
+        }
+        case 4: {
+            uint32_t x = static_cast<uint32_t>(length);
+            x = byteOrder_ == kBigEndian ? htobe32(x) : htole32(x);
+            ::memcpy(header, &x, sizeof x);
+            break;
+        }
+        default: {
+            uint64_t x = length;
+            x = byteOrder_ == kBigEndian ? htobe64(x) : htole64(x);
+            ::memcpy(header, &x, sizeof x);
+            break;
+        }
+    }
+}
+
+bool LengthHeaderCodec::encode(Buffer *buf) const {
+    size_t length = buf->readableBytes();
+    if (length > maxFrameSize_) {
+        LOG_ERROR << "LengthHeaderCodec::encode - frame too large " << length;
+        return false;
+    }
+    char header[sizeof(uint64_t)];
+    writeHeader(length, header);
+    buf->prepend(header, static_cast<size_t>(headerLen_));
+    return true;
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *buf) const {
+    if (encode(buf)) {
+        conn->send(buf);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const StringPiece &message) const {
+    size_t length = static_cast<size_t>(message.size());
+    if (length > maxFrameSize_) {
+        LOG_ERROR << "LengthHeaderCodec::send - frame too large " << length;
+        return;
+    }
+    char header[sizeof(uint64_t)];
+    writeHeader(length, header);
+    conn->send(StringPiece(header, headerLen_), message);
+}
@@ -0,0 +1,79 @@
+//
+// Created by chen on 2022/11/25.
+//
+
+/*
+ *      LengthHeaderCodec：长度头 + 消息体 的分帧编解码
+ *
+ *      1. 长度头宽度可以是1/2/4/8字节，字节序可选，长度不包括头本身。
+ *      2. 解码：onMessage()一次遍历inputBuffer中所有完整的帧，以指向Buffer内部的StringPiece交给FrameCallback，
+ *         不拷贝到string。最后一次性retrieve()，不完整的帧留在Buffer里等下次。
+ *         StringPiece只在回调期间有效，需要保留的话由回调自己拷贝。
+ *      3. 超过maxFrameSize的长度视为协议错误，调用ErrorCallback（默认记录日志并关闭连接）。
+ *      4. 编码：消息体已经在Buffer里时，把长度头写进Buffer的prepend区域（kCheapPrepend = 8），消息体不用移动。
+ */
+
+#ifndef MYMUDUO_LENGTHHEADERCODEC_H
+#define MYMUDUO_LENGTHHEADERCODEC_H
+
+#include "../base/StringPiece.h"
+#include "TcpConnection.h"
+
+namespace muduo {
+    namespace net {
+
+        class LengthHeaderCodec : noncopyable {
+        public:
+            enum ByteOrder { kBigEndian, kLittleEndian };
+
+            /// frame points into the input buffer, valid only during the callback.
+            typedef std::function<void(const TcpConnectionPtr &,
+                                       StringPiece frame,
+                                       Timestamp)> FrameCallback;
+            /// Called when a header announces more than maxFrameSize bytes.
+            typedef std::function<void(const TcpConnectionPtr &, uint64_t length)> ErrorCallback;
+
+            static const size_t kDefaultMaxFrameSize = 64 * 1024 * 1024;
+
+            /// headerLen is 1, 2, 4 or 8.
+            explicit LengthHeaderCodec(const FrameCallback &cb,
+                                       int headerLen = 4,
+                                       ByteOrder byteOrder = kBigEndian,
+                                       size_t maxFrameSize = kDefaultMaxFrameSize);
+
+            void setErrorCallback(const ErrorCallback &cb) { errorCallback_ = cb; }
+
+            int headerLen() const { return headerLen_; }
+
+            size_t maxFrameSize() const { return maxFrameSize_; }
+
+            /// Use as the MessageCallback of TcpServer/TcpClient, or call it from one.
+            void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+            /// Prepends the header for all readable bytes of buf.
+            /// Returns false if the frame is larger than maxFrameSize.
+            bool encode(Buffer *buf) const;
+
+            /// Encodes buf in place and sends it, buf is consumed.
+            void send(const TcpConnectionPtr &conn, Buffer *buf) const;
+
+            /// The header is built on the stack and sent with message in one writev(), message is not copied.
+            void send(const TcpConnectionPtr &conn, const StringPiece &message) const;
+
+        private:
+            uint64_t readHeader(const char *data) const;
+
+            /// Writes the header for length to header[0, headerLen_).
+            void writeHeader(size_t length, char *header) const;
+
+            const FrameCallback frameCallback_;
+            ErrorCallback errorCallback_;
+            const int headerLen_;
+            const ByteOrder byteOrder_;
+            const size_t maxFrameSize_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_LENGTHHEADERCODEC_H
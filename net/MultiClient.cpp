@@ -0,0 +1,382 @@
+//
+// Created by chen on 2022/11/24.
+//
+
+#include "MultiClient.h"
+
+#include "../base/CountDownLatch.h"
+#include "../base/Logging.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "SocketsOps.h"
+
+#include <errno.h>
+#include <stdio.h>  // snprintf
+#include <stdlib.h>  // rand_r
+
+#include <algorithm>
+#include <deque>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            // 不能在Channel自己的handleEvent()里析构它
+            void deleteChannel(Channel *channel) {
+                delete channel;
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+/*
+ *      管理一个loop上的所有对端，除了构造函数之外都在这个loop的线程中运行
+ */
+class MultiClient::Shard : noncopyable {
+public:
+    Shard(MultiClient *owner, EventLoop *loop, double connectsPerTick)
+            : owner_(owner),
+              loop_(loop),
+              connectsPerTick_(connectsPerTick),
+              credits_(0),
+              connecting_(0),
+              wheelPos_(0),
+              seed_(static_cast<unsigned int>(reinterpret_cast<uintptr_t>(this))),
+              shutdown_(false) {
+        size_t ticks = static_cast<size_t>(owner->maxRetryDelay_ * (1 + owner->retryJitter_) / kTickSeconds);
+        wheel_.resize(ticks + 2);
+    }
+
+    EventLoop *getLoop() const { return loop_; }
+
+    void addPeer(uint32_t id) {
+        Peer peer;
+        peer.channel = NULL;
+        peer.id = id;
+        peer.attempts = 0;
+        peer.state = kPending;
+        peers_.push_back(peer);
+    }
+
+    void startInLoop() {
+        loop_->assertInLoopThread();
+        for (uint32_t i = 0; i < peers_.size(); ++i) {
+            pending_.push_back(i);
+        }
+        tickTimer_ = loop_->runEvery(kTickSeconds, std::bind(&Shard::tick, this));
+        tick();
+    }
+
+    // latch非空时完成后countDown()
+    void shutdownInLoop(CountDownLatch *latch);
+
+private:
+    enum PeerState { kPending, kConnecting, kConnected, kWaiting, kIdle };   // 待连接；握手中；已连接；等待重连；放弃
+
+    struct Peer {
+        TcpConnectionPtr conn;
+        Channel *channel;       // 只在kConnecting时非空
+        uint32_t id;            // MultiClient::peers_的下标
+        uint16_t attempts;      // 连续失败的次数
+        uint8_t state;
+    };
+
+    void tick();
+
+    void connectPeer(uint32_t index);
+
+    void handleConnect(uint32_t index);
+
+    void newConnection(uint32_t index, int sockfd);
+
+    void removeConnection(uint32_t index, const TcpConnectionPtr &conn);
+
+    void retry(uint32_t index, int sockfd);
+
+    void scheduleRetry(uint32_t index);
+
+    int removeChannel(Peer *peer);
+
+    MultiClient *owner_;
+    EventLoop *loop_;
+    const double connectsPerTick_;
+    double credits_;                    // 本tick还能发起的连接数，小数部分累积到下一个tick
+    int connecting_;
+    std::vector<Peer> peers_;
+    std::deque<uint32_t> pending_;      // 待连接的对端，peers_的下标
+    std::vector<std::vector<uint32_t>> wheel_;      // 重连时间轮，每格kTickSeconds
+    size_t wheelPos_;
+    unsigned int seed_;
+    TimerId tickTimer_;
+    bool shutdown_;
+};
+
+/*
+ *      1. 时间轮前进一格，到期的对端放入待连接队列
+ *      2. 在速率和握手数的限制内发起连接
+ */
+void MultiClient::Shard::tick() {
+    loop_->assertInLoopThread();
+    wheelPos_ = (wheelPos_ + 1) % wheel_.size();
+    std::vector<uint32_t> &expired = wheel_[wheelPos_];
+    for (uint32_t index : expired) {
+        peers_[index].state = kPending;
+        pending_.push_back(index);
+    }
+    expired.clear();
+
+    credits_ = std::min(credits_ + connectsPerTick_, std::max(connectsPerTick_, 1.0));
+    while (credits_ >= 1 && connecting_ < owner_->maxConnecting_ && !pending_.empty()) {
+        uint32_t index = pending_.front();
+        pending_.pop_front();
+        credits_ -= 1;
+        connectPeer(index);
+    }
+}
+
+/*
+ *      和Connector::connect()相同的错误分类
+ */
+void MultiClient::Shard::connectPeer(uint32_t index) {
+    Peer &peer = peers_[index];
+    const InetAddress &addr = owner_->peers_[peer.id];
+    owner_->numAttempts_.increment();
+    int sockfd = sockets::createNonblockingOrDie(addr.family());
+    int ret = sockets::connect(sockfd, addr.getSockAddr(), addr.addrLength());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno) {
+        case 0:
+        case EINPROGRESS:
+        case EINTR:
+        case EISCONN:
+            peer.state = kConnecting;
+            peer.channel = new Channel(loop_, sockfd);
+            peer.channel->setWriteCallback(std::bind(&Shard::handleConnect, this, index));
+            peer.channel->setErrorCallback(std::bind(&Shard::handleConnect, this, index));
+            peer.channel->enableWriting();
+            ++connecting_;
+            owner_->numConnecting_.increment();
+            break;
+
+        case EAGAIN:
+        case EADDRINUSE:
+        case EADDRNOTAVAIL:
+        case ECONNREFUSED:
+        case ENETUNREACH:
+        case ENOENT:
+            retry(index, sockfd);
+            break;
+
+        default:
+            LOG_SYSERR << "MultiClient::connectPeer " << addr.toIpPort() << " error " << savedErrno;
+            sockets::close(sockfd);
+            peer.state = kIdle;
+            break;
+    }
+}
+
+int MultiClient::Shard::removeChannel(Peer *peer) {
+    Channel *channel = peer->channel;
+    peer->channel = NULL;
+    channel->disableAll();
+    channel->remove();
+    --connecting_;
+    owner_->numConnecting_.decrement();
+    int sockfd = channel->fd();
+    loop_->queueInLoop(std::bind(&detail::deleteChannel, channel));
+    return sockfd;
+}
+
+/*
+ *      可写不代表连接成功，要检查SO_ERROR和自连接，见Connector::handleWrite()
+ */
+void MultiClient::Shard::handleConnect(uint32_t index) {
+    Peer &peer = peers_[index];
+    if (peer.state != kConnecting) {
+        return;
+    }
+    int sockfd = removeChannel(&peer);
+    int err = sockets::getSocketError(sockfd);
+    if (err) {
+        LOG_DEBUG << "MultiClient::handleConnect - SO_ERROR = " << err << " " << strerror_tl(err);
+        retry(index, sockfd);
+    } else if (sockets::isSelfConnect(sockfd)) {
+        LOG_WARN << "MultiClient::handleConnect - Self connect";
+        retry(index, sockfd);
+    } else {
+        newConnection(index, sockfd);
+    }
+}
+
+void MultiClient::Shard::newConnection(uint32_t index, int sockfd) {
+    Peer &peer = peers_[index];
+    const InetAddress &peerAddr = owner_->peers_[peer.id];
+    char buf[64];
+    snprintf(buf, sizeof buf, ":%s#%u", peerAddr.toIpPort().c_str(), peer.id);
+    struct sockaddr_storage local;
+    socklen_t localLen = sockets::getLocalAddr(sockfd, &local);
+    InetAddress localAddr(sockets::sockaddr_cast(&local), localLen);
+    TcpConnectionPtr conn(new TcpConnection(loop_, owner_->name_ + buf, sockfd, localAddr, peerAddr));
+    conn->setConnectionCallback(owner_->connectionCallback_);
+    conn->setMessageCallback(owner_->messageCallback_);
+    conn->setWriteCompleteCallback(owner_->writeCompleteCallback_);
+    conn->setCloseCallback(std::bind(&Shard::removeConnection, this, index, _1));
+    peer.conn = conn;
+    peer.state = kConnected;
+    peer.attempts = 0;
+    owner_->numConnected_.increment();
+    conn->connectEstablished();
+}
+
+void MultiClient::Shard::removeConnection(uint32_t index, const TcpConnectionPtr &conn) {
+    loop_->assertInLoopThread();
+    Peer &peer = peers_[index];
+    assert(peer.conn == conn);
+    peer.conn.reset();
+    owner_->numConnected_.decrement();
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (owner_->retry_ && !shutdown_) {
+        scheduleRetry(index);
+    } else {
+        peer.state = kIdle;
+    }
+}
+
+void MultiClient::Shard::retry(uint32_t index, int sockfd) {
+    sockets::close(sockfd);
+    Peer &peer = peers_[index];
+    if (peer.attempts < UINT16_MAX) {
+        ++peer.attempts;
+    }
+    if (owner_->retry_) {
+        scheduleRetry(index);
+    } else {
+        peer.state = kIdle;
+    }
+}
+
+/*
+ *      delay = min(initial * 2^attempts, max) * (1 ± jitter)，按kTickSeconds取整放进时间轮
+ */
+void MultiClient::Shard::scheduleRetry(uint32_t index) {
+    Peer &peer = peers_[index];
+    double delay = owner_->initRetryDelay_;
+    for (int i = 0; i < peer.attempts && delay < owner_->maxRetryDelay_; ++i) {
+        delay *= 2;
+    }
+    delay = std::min(delay, owner_->maxRetryDelay_);
+    double r = static_cast<double>(rand_r(&seed_)) / RAND_MAX;
+    delay *= 1 + owner_->retryJitter_ * (2 * r - 1);
+
+    size_t ticks = static_cast<size_t>(delay / kTickSeconds + 0.5);
+    ticks = std::max<size_t>(1, std::min(ticks, wheel_.size() - 1));
+    wheel_[(wheelPos_ + ticks) % wheel_.size()].push_back(index);
+    peer.state = kWaiting;
+}
+
+/*
+ *      在MultiClient析构时运行，之后这个Shard不会再访问owner_：
+ *      定时器被取消，握手中的Channel被移除，已建立的连接被销毁（之后不会再调用closeCallback）
+ */
+void MultiClient::Shard::shutdownInLoop(CountDownLatch *latch) {
+    loop_->assertInLoopThread();
+    shutdown_ = true;
+    loop_->cancel(tickTimer_);
+    for (Peer &peer : peers_) {
+        if (peer.channel) {
+            sockets::close(removeChannel(&peer));
+        }
+        if (peer.conn) {
+            // 和TcpServer析构时一样，直接销毁连接
+            owner_->numConnected_.decrement();
+            peer.conn->connectDestroyed();
+            peer.conn.reset();
+        }
+        peer.state = kIdle;
+    }
+    if (latch) {
+        latch->countDown();
+    }
+}
+
+const double MultiClient::kTickSeconds = 0.1;
+
+MultiClient::MultiClient(EventLoop *baseLoop, const string &nameArg)
+        : baseLoop_(CHECK_NOTNULL(baseLoop)),
+          name_(nameArg),
+          threadPool_(new EventLoopThreadPool(baseLoop, name_)),
+          connectRate_(1000),
+          maxConnecting_(256),
+          retry_(false),
+          initRetryDelay_(0.5),
+          maxRetryDelay_(30.0),
+          retryJitter_(0.2),
+          connectionCallback_(defaultConnectionCallback),
+          messageCallback_(defaultMessageCallback),
+          started_(false) {
+}
+
+/*
+ *      Shard持有owner_，所以要等每个Shard在自己的loop中关闭之后才能返回（和UdpServer析构时一样），
+ *      否则IO线程中的tick()/连接回调可能访问已经析构的MultiClient。
+ */
+MultiClient::~MultiClient() {
+    baseLoop_->assertInLoopThread();
+    LOG_TRACE << "MultiClient::~MultiClient [" << name_ << "] destructing";
+    for (const std::shared_ptr<Shard> &shard : shards_) {
+        EventLoop *ioLoop = shard->getLoop();
+        if (ioLoop == baseLoop_) {
+            shard->shutdownInLoop(NULL);
+        } else {
+            CountDownLatch latch(1);
+            ioLoop->runInLoop(std::bind(&Shard::shutdownInLoop, shard, &latch));
+            latch.wait();
+        }
+    }
+}
+
+void MultiClient::setThreadNum(int numThreads) {
+    assert(0 <= numThreads);
+    threadPool_->setThreadNum(numThreads);
+}
+
+void MultiClient::setRetryDelay(double initialSeconds, double maxSeconds) {
+    assert(0 < initialSeconds && initialSeconds <= maxSeconds);
+    initRetryDelay_ = initialSeconds;
+    maxRetryDelay_ = maxSeconds;
+}
+
+int MultiClient::addPeer(const InetAddress &peerAddr) {
+    assert(!started_);
+    peers_.push_back(peerAddr);
+    return static_cast<int>(peers_.size() - 1);
+}
+
+/*
+ *      对端按id轮流分给各个loop，速率也平均分配
+ */
+void MultiClient::start() {
+    baseLoop_->assertInLoopThread();
+    assert(!started_);
+    started_ = true;
+    threadPool_->start(threadInitCallback_);
+
+    std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+    double connectsPerTick = connectRate_ * kTickSeconds / static_cast<double>(loops.size());
+    for (EventLoop *loop : loops) {
+        shards_.push_back(std::make_shared<Shard>(this, loop, connectsPerTick));
+    }
+    for (size_t i = 0; i < peers_.size(); ++i) {
+        shards_[i % shards_.size()]->addPeer(static_cast<uint32_t>(i));
+    }
+    LOG_INFO << "MultiClient::start [" << name_ << "] - " << peers_.size() << " peers on "
+             << loops.size() << " loops";
+    for (const std::shared_ptr<Shard> &shard : shards_) {
+        shard->getLoop()->runInLoop(std::bind(&Shard::startInLoop, shard));
+    }
+}
@@ -0,0 +1,121 @@
+//
+// Created by chen on 2022/11/24.
+//
+
+/*
+ *      MultiClient：大量出站连接（压测客户端、mesh代理）
+ *
+ *      每个对端一个TcpClient + Connector太重了：各有一把mutex、一组shared_ptr，
+ *      每次重连还要runAfter()一个新的定时器。MultiClient把对端平均分到EventLoopThreadPool的各个loop上，
+ *      每个loop上的对端由一个Shard管理：
+ *
+ *      1. 对端的状态很紧凑（见MultiClient.cpp中的Peer），地址只在MultiClient里存一份，
+ *         Channel只在连接进行中时存在。
+ *      2. 分批连接：每个loop有一个周期为kTickSeconds的定时器，每次最多发起connectRate * kTickSeconds / loops个连接，
+ *         同时处于握手中的连接不超过maxConnecting，避免SYN风暴和对端的accept队列溢出。
+ *      3. 重连用每个loop共享的时间轮，而不是每次runAfter()：延迟按指数退避，再加上±jitter的随机抖动，
+ *         避免同一时刻断开的大量连接同时重连。到期的对端回到待连接队列，同样受速率限制。
+ *
+ *      对端在start()之前通过addPeer()加入，之后不能再增减。
+ */
+
+#ifndef MYMUDUO_MULTICLIENT_H
+#define MYMUDUO_MULTICLIENT_H
+
+#include "../base/Atomic.h"
+#include "TcpConnection.h"
+
+#include <memory>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class EventLoop;
+        class EventLoopThreadPool;
+
+        ///
+        /// Manages many outbound connections across an EventLoopThreadPool.
+        ///
+        /// Setters and addPeer() must be called before start(), in the base loop thread.
+        class MultiClient : noncopyable {
+        public:
+            typedef std::function<void(EventLoop *)> ThreadInitCallback;
+
+            static const double kTickSeconds;
+
+            MultiClient(EventLoop *baseLoop, const string &nameArg);
+
+            ~MultiClient();  // force out-line dtor, for std::unique_ptr members.
+
+            const string &name() const { return name_; }
+
+            EventLoop *getLoop() const { return baseLoop_; }
+
+            /// Same as TcpServer::setThreadNum().
+            void setThreadNum(int numThreads);
+
+            void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+
+            /// New connection attempts per second over all loops, retries included, default 1000.
+            void setConnectRate(int perSecond) { connectRate_ = perSecond; }
+
+            /// In-flight handshakes per loop, default 256.
+            void setMaxConnecting(int n) { maxConnecting_ = n; }
+
+            /// Reconnects failed and closed connections.
+            void enableRetry() { retry_ = true; }
+
+            /// Retry delay doubles from initial up to max, multiplied by a random factor in [1 - jitter, 1 + jitter].
+            void setRetryDelay(double initialSeconds, double maxSeconds);
+
+            void setRetryJitter(double jitter) { retryJitter_ = jitter; }
+
+            void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+
+            void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+
+            void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+
+            /// Returns the peer id, which is also the suffix of the connection name.
+            int addPeer(const InetAddress &peerAddr);
+
+            void start();
+
+            // 统计信息，可以在任意线程调用
+            size_t numPeers() const { return peers_.size(); }
+
+            int numConnected() { return numConnected_.get(); }
+
+            int numConnecting() { return numConnecting_.get(); }
+
+            int64_t numAttempts() { return numAttempts_.get(); }
+
+        private:
+            class Shard;
+
+            EventLoop *baseLoop_;
+            const string name_;
+            std::unique_ptr<EventLoopThreadPool> threadPool_;
+            ThreadInitCallback threadInitCallback_;
+            int connectRate_;
+            int maxConnecting_;
+            bool retry_;
+            double initRetryDelay_;
+            double maxRetryDelay_;
+            double retryJitter_;
+            ConnectionCallback connectionCallback_;
+            MessageCallback messageCallback_;
+            WriteCompleteCallback writeCompleteCallback_;
+            std::vector<InetAddress> peers_;        // start()之后只读
+            std::vector<std::shared_ptr<Shard>> shards_;
+            bool started_;
+            AtomicInt32 numConnected_;
+            AtomicInt32 numConnecting_;
+            AtomicInt64 numAttempts_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_MULTICLIENT_H
@@ -0,0 +1,55 @@
+//
+// Created by chen on 2022/11/21.
+//
+
+#include "PipePool.h"
+
+#include "../base/Logging.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t PipePool::kDefaultMaxIdle;
+
+PipePool::PipePool(size_t maxIdle)
+        : maxIdle_(maxIdle) {
+}
+
+PipePool::~PipePool() {
+    for (const Pipe &pipe: idle_) {
+        closePipe(pipe);
+    }
+}
+
+bool PipePool::acquire(Pipe *pipe) {
+    if (!idle_.empty()) {
+        *pipe = idle_.back();
+        idle_.pop_back();
+        return true;
+    }
+
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        LOG_SYSERR << "PipePool::acquire";
+        return false;
+    }
+    pipe->readFd = fds[0];
+    pipe->writeFd = fds[1];
+    return true;
+}
+
+void PipePool::release(const Pipe &pipe, bool empty) {
+    if (empty && idle_.size() < maxIdle_) {
+        idle_.push_back(pipe);
+    } else {
+        closePipe(pipe);
+    }
+}
+
+void PipePool::closePipe(const Pipe &pipe) {
+    ::close(pipe.readFd);
+    ::close(pipe.writeFd);
+}
@@ -0,0 +1,59 @@
+//
+// Created by chen on 2022/11/21.
+//
+
+/*
+ *      PipePool
+ *
+ *      splice(2)只能在pipe和其它fd之间搬运数据，所以socket到socket的零拷贝转发需要一个中转pipe。
+ *      每个EventLoop持有一个PipePool，缓存用完的空pipe，避免每个连接都pipe2()/close()一次。
+ *
+ *      只能在所属的loop线程中使用。
+ */
+
+#ifndef MYMUDUO_PIPEPOOL_H
+#define MYMUDUO_PIPEPOOL_H
+
+#include "../base/noncopyable.h"
+
+#include <stddef.h>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        ///
+        /// Cache of non-blocking pipes used by splice(2), one per EventLoop.
+        ///
+        class PipePool : noncopyable {
+        public:
+            struct Pipe {
+                int readFd;
+                int writeFd;
+            };
+
+            static const size_t kDefaultMaxIdle = 64;
+
+            explicit PipePool(size_t maxIdle = kDefaultMaxIdle);
+
+            ~PipePool();
+
+            /// Returns false if no pipe is available (e.g. EMFILE).
+            bool acquire(Pipe *pipe);
+
+            /// Gives the pipe back, a pipe still holding data can't be reused and is closed.
+            void release(const Pipe &pipe, bool empty);
+
+            size_t idleSize() const { return idle_.size(); }
+
+        private:
+            static void closePipe(const Pipe &pipe);
+
+            const size_t maxIdle_;
+            std::vector<Pipe> idle_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_PIPEPOOL_H
@@ -0,0 +1,239 @@
+//
+// Created by chen on 2022/11/22.
+//
+
+#include "Resolver.h"
+
+#include "../base/Logging.h"
+#include "../base/Singleton.h"
+#include "EventLoop.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int Resolver::kDefaultThreads;
+const size_t Resolver::kDefaultMaxCacheEntries;
+
+namespace {
+
+    // 缓存中的地址不带端口，交给调用者时再填上
+    InetAddress withPort(const InetAddress &addr, uint16_t port) {
+        struct sockaddr_in6 addr6;
+        memZero(&addr6, sizeof addr6);
+        if (addr.family() == AF_INET6) {
+            memcpy(&addr6, addr.getSockAddr(), sizeof addr6);
+            addr6.sin6_port = htons(port);
+            return InetAddress(addr6);
+        } else {
+            struct sockaddr_in addr4;
+            memcpy(&addr4, addr.getSockAddr(), sizeof addr4);
+            addr4.sin_port = htons(port);
+            return InetAddress(addr4);
+        }
+    }
+
+    // 数字形式的IPv4/IPv6地址
+    bool parseNumericHost(const string &hostname, InetAddress *result) {
+        struct in_addr addr4;
+        struct in6_addr addr6;
+        if (::inet_pton(AF_INET, hostname.c_str(), &addr4) == 1 ||
+            ::inet_pton(AF_INET6, hostname.c_str(), &addr6) == 1) {
+            *result = InetAddress(hostname, 0);
+            return true;
+        }
+        return false;
+    }
+
+}  // namespace
+
+Resolver::Resolver(int numThreads, double ttlSeconds, double negativeTtlSeconds, size_t maxCacheEntries)
+        : ttl_(ttlSeconds),
+          negativeTtl_(negativeTtlSeconds),
+          maxCacheEntries_(maxCacheEntries),
+          mutex_(),
+          lookups_(0),
+          cacheHits_(0),
+          cacheEvictions_(0),
+          pool_("Resolver") {
+    assert(numThreads > 0);
+    assert(maxCacheEntries > 0);
+    pool_.start(numThreads);
+}
+
+Resolver::~Resolver() {
+    pool_.stop();
+}
+
+Resolver &Resolver::instance() {
+    return Singleton<Resolver>::getInstance();
+}
+
+/*
+ *      1. 数字IP：直接返回
+ *      2. 缓存命中且未过期：直接返回
+ *      3. 已经有同名查询在进行：挂在pending_上等待
+ *      4. 否则提交一个lookup()到线程池
+ *
+ *      都通过queueInLoop()回调，保证回调不会在resolve()内部发生
+ */
+void Resolver::resolve(EventLoop *loop, const string &hostname, uint16_t port, const ResolveCallback &cb) {
+    InetAddress addr;
+    if (parseNumericHost(hostname, &addr)) {
+        loop->queueInLoop(std::bind(cb, true, withPort(addr, port)));
+        return;
+    }
+
+    bool startLookup = false;
+    {
+        MutexLockGuard lock(mutex_);
+        CacheEntry entry;
+        if (findInCache(hostname, Timestamp::now(), &entry)) {
+            ++cacheHits_;
+            loop->queueInLoop(std::bind(cb, entry.ok, withPort(entry.addr, port)));
+            return;
+        }
+        std::vector<Waiter> &waiters = pending_[hostname];
+        startLookup = waiters.empty();
+        Waiter waiter = {loop, port, cb};
+        waiters.push_back(waiter);
+    }
+
+    if (startLookup) {
+        pool_.run(std::bind(&Resolver::lookup, this, hostname));
+    }
+}
+
+bool Resolver::resolveFromCache(const string &hostname, uint16_t port, InetAddress *result) {
+    InetAddress addr;
+    if (parseNumericHost(hostname, &addr)) {
+        *result = withPort(addr, port);
+        return true;
+    }
+
+    MutexLockGuard lock(mutex_);
+    CacheEntry entry;
+    if (findInCache(hostname, Timestamp::now(), &entry) && entry.ok) {
+        ++cacheHits_;
+        *result = withPort(entry.addr, port);
+        return true;
+    }
+    return false;
+}
+
+/*
+ *      命中时移到LRU表头；过期的项直接删除
+ */
+bool Resolver::findInCache(const string &hostname, Timestamp now, CacheEntry *entry) {
+    mutex_.assertLocked();
+    auto it = cache_.find(hostname);
+    if (it == cache_.end()) {
+        return false;
+    }
+    if (!(now < it->second.expiration)) {
+        lru_.erase(it->second.lruPos);
+        cache_.erase(it);
+        ++cacheEvictions_;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+    *entry = it->second;
+    return true;
+}
+
+/*
+ *      插入或者替换，超过maxCacheEntries_时淘汰最久没有使用的项
+ */
+void Resolver::insertToCache(const string &hostname, const CacheEntry &entry) {
+    mutex_.assertLocked();
+    auto it = cache_.find(hostname);
+    if (it != cache_.end()) {
+        lru_.erase(it->second.lruPos);
+        cache_.erase(it);
+    }
+    lru_.push_front(hostname);
+    CacheEntry &inserted = cache_[hostname];
+    inserted = entry;
+    inserted.lruPos = lru_.begin();
+
+    while (lru_.size() > maxCacheEntries_) {
+        cache_.erase(lru_.back());
+        lru_.pop_back();
+        ++cacheEvictions_;
+    }
+}
+
+/*
+ *      在线程池中调用阻塞的getaddrinfo()，取第一个结果（已按RFC 6724排好序）
+ */
+void Resolver::lookup(const string &hostname) {
+    struct addrinfo hints;
+    memZero(&hints, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    CacheEntry entry;
+    entry.ok = false;
+    struct addrinfo *res = nullptr;
+    int ret = ::getaddrinfo(hostname.c_str(), nullptr, &hints, &res);
+    if (ret == 0) {
+        for (struct addrinfo *ai = res; ai != nullptr && !entry.ok; ai = ai->ai_next) {
+            if (ai->ai_family == AF_INET) {
+                entry.addr = InetAddress(*reinterpret_cast<struct sockaddr_in *>(ai->ai_addr));
+                entry.ok = true;
+            } else if (ai->ai_family == AF_INET6) {
+                entry.addr = InetAddress(*reinterpret_cast<struct sockaddr_in6 *>(ai->ai_addr));
+                entry.ok = true;
+            }
+        }
+        ::freeaddrinfo(res);
+    } else {
+        LOG_ERROR << "Resolver::lookup " << hostname << " - " << ::gai_strerror(ret);
+    }
+    entry.expiration = addTime(Timestamp::now(), entry.ok ? ttl_ : negativeTtl_);
+
+    std::vector<Waiter> waiters;
+    {
+        MutexLockGuard lock(mutex_);
+        ++lookups_;
+        insertToCache(hostname, entry);
+        waiters.swap(pending_[hostname]);
+        pending_.erase(hostname);
+    }
+
+    LOG_DEBUG << "Resolver::lookup " << hostname << " -> "
+              << (entry.ok ? entry.addr.toIp() : "failed") << ", " << waiters.size() << " waiter(s)";
+    for (const Waiter &waiter: waiters) {
+        waiter.loop->queueInLoop(std::bind(waiter.cb, entry.ok, withPort(entry.addr, waiter.port)));
+    }
+}
+
+void Resolver::clearCache() {
+    MutexLockGuard lock(mutex_);
+    cache_.clear();
+    lru_.clear();
+}
+
+size_t Resolver::cacheSize() const {
+    MutexLockGuard lock(mutex_);
+    return cache_.size();
+}
+
+int64_t Resolver::lookups() const {
+    MutexLockGuard lock(mutex_);
+    return lookups_;
+}
+
+int64_t Resolver::cacheHits() const {
+    MutexLockGuard lock(mutex_);
+    return cacheHits_;
+}
+
+int64_t Resolver::cacheEvictions() const {
+    MutexLockGuard lock(mutex_);
+    return cacheEvictions_;
+}
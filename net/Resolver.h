@@ -0,0 +1,118 @@
+//
+// Created by chen on 2022/11/22.
+//
+
+/*
+ *      Resolver：异步DNS解析
+ *
+ *      InetAddress::resolve() 是阻塞的，在IO线程里调用会卡住这个loop上的所有连接。
+ *      Resolver把getaddrinfo()放到一个小线程池里执行，结果通过runInLoop()送回调用者的EventLoop。
+ *
+ *      1. 缓存：所有loop共享一份缓存（mutex保护），成功的结果缓存ttl秒，失败的结果缓存negativeTtl秒。
+ *         getaddrinfo()拿不到DNS记录本身的TTL，所以TTL是可配置的上限。
+ *         过期的项在下一次查找时删除；项数超过maxCacheEntries时按LRU淘汰，主机名很多（比如爬虫）时内存也有上限。
+ *      2. 合并：同一个主机名同时只有一个查询在进行，后来的请求挂在它上面等结果。
+ *      3. 数字形式的IP地址不经过线程池，直接返回。
+ *
+ *      getaddrinfo()遵循/etc/nsswitch.conf，所以/etc/hosts中的名字也能解析。
+ */
+
+#ifndef MYMUDUO_RESOLVER_H
+#define MYMUDUO_RESOLVER_H
+
+#include "../base/Mutex.h"
+#include "../base/ThreadPool.h"
+#include "../base/Timestamp.h"
+#include "InetAddress.h"
+
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class EventLoop;
+
+        ///
+        /// Asynchronous hostname resolver backed by a thread pool, with a shared cache.
+        ///
+        /// Thread safe, usually used through Resolver::instance().
+        class Resolver : noncopyable {
+        public:
+            /// ok is false if the hostname can't be resolved.
+            typedef std::function<void(bool ok, const InetAddress &addr)> ResolveCallback;
+
+            static const int kDefaultThreads = 2;
+            static const size_t kDefaultMaxCacheEntries = 1024;
+
+            explicit Resolver(int numThreads = kDefaultThreads,
+                              double ttlSeconds = 60.0,
+                              double negativeTtlSeconds = 5.0,
+                              size_t maxCacheEntries = kDefaultMaxCacheEntries);
+
+            ~Resolver();
+
+            /// The process-wide resolver shared by all loops.
+            static Resolver &instance();
+
+            /// Resolves hostname and runs cb in loop's thread, never inside this call.
+            /// loop must outlive the lookup.
+            void resolve(EventLoop *loop, const string &hostname, uint16_t port, const ResolveCallback &cb);
+
+            /// Looks up the cache only, returns false on miss or expired entry.
+            bool resolveFromCache(const string &hostname, uint16_t port, InetAddress *result);
+
+            void clearCache();
+
+            size_t cacheSize() const;
+
+            // 统计信息
+            int64_t lookups() const;
+
+            int64_t cacheHits() const;
+
+            // 过期删除和LRU淘汰的项数之和
+            int64_t cacheEvictions() const;
+
+        private:
+            typedef std::list<string> KeyList;      // 表头是最近使用的
+
+            struct CacheEntry {
+                bool ok;
+                InetAddress addr;       // port为0
+                Timestamp expiration;
+                KeyList::iterator lruPos;
+            };
+
+            struct Waiter {
+                EventLoop *loop;
+                uint16_t port;
+                ResolveCallback cb;
+            };
+
+            // 在线程池中运行
+            void lookup(const string &hostname);
+
+            bool findInCache(const string &hostname, Timestamp now, CacheEntry *entry);
+
+            void insertToCache(const string &hostname, const CacheEntry &entry);
+
+            const double ttl_;
+            const double negativeTtl_;
+            const size_t maxCacheEntries_;
+            mutable MutexLock mutex_;
+            std::map<string, CacheEntry> cache_;
+            KeyList lru_;
+            std::map<string, std::vector<Waiter>> pending_;     // 正在查询的主机名 --> 等待结果的请求
+            int64_t lookups_;
+            int64_t cacheHits_;
+            int64_t cacheEvictions_;
+            ThreadPool pool_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_RESOLVER_H
@@ -55,7 +55,7 @@ bool Socket::getTcpInfoString(char *buf, int len) const {
 }
 
 void Socket::bindAddress(const InetAddress &localaddr) {
-    sockets::bindOrDie(sockfd_, localaddr.getSockAddr());
+    sockets::bindOrDie(sockfd_, localaddr.getSockAddr(), localaddr.addrLength());
 }
 
 void Socket::listen() {
@@ -63,11 +63,12 @@ void Socket::listen() {
 }
 
 int Socket::accept(InetAddress *peeraddr) {
-    struct sockaddr_in6 addr;
+    struct sockaddr_storage addr;
     memZero(&addr, sizeof addr);
-    int connfd = sockets::accept(sockfd_, &addr);   // 这里会把sockaddr_in6进行转换
+    socklen_t addrlen = 0;
+    int connfd = sockets::accept(sockfd_, &addr, &addrlen);   // AF_UNIX的路径长度不固定，按实际长度构造
     if(connfd >= 0){
-        peeraddr->setSockAddrInet6(addr);
+        *peeraddr = InetAddress(sockets::sockaddr_cast(&addr), addrlen);
     }
     return connfd;
 }
@@ -121,3 +122,21 @@ void Socket::setKeepAlive(bool on) {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, static_cast<socklen_t>(sizeof optval));
 }
+
+/*
+ *  TCP_FASTOPEN: 允许客户端在SYN中携带数据（凭上一次连接拿到的cookie），省去一个RTT。
+ *  服务端还需要 net.ipv4.tcp_fastopen 的第2位（0x2）打开，否则内核会退化为普通的三次握手。
+ */
+void Socket::setTcpFastOpen(int qlen) {
+    int ret = ::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN, &qlen, static_cast<socklen_t>(sizeof qlen));
+    if (ret < 0 && qlen > 0) {
+        LOG_SYSERR << "TCP_FASTOPEN failed.";
+    }
+}
+
+void Socket::setDeferAccept(int seconds) {
+    int ret = ::setsockopt(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, static_cast<socklen_t>(sizeof seconds));
+    if (ret < 0 && seconds > 0) {
+        LOG_SYSERR << "TCP_DEFER_ACCEPT failed.";
+    }
+}
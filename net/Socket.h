@@ -45,6 +45,12 @@ namespace muduo{
             void setReusePort(bool on);
             void setKeepAlive(bool on);
 
+            // TCP Fast Open，qlen是还没完成三次握手就带数据的连接的队列长度，0表示关闭。必须在listen()之前调用
+            void setTcpFastOpen(int qlen);
+
+            // TCP_DEFER_ACCEPT：握手完成后等客户端的数据到达（最多seconds秒）才让accept()返回这个连接
+            void setDeferAccept(int seconds);
+
         private:
             const int sockfd_;
         };
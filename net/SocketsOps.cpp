@@ -9,9 +9,12 @@
 
 #include <error.h>
 #include <fcntl.h>
+#include <netinet/tcp.h>    // for TCP_FASTOPEN_CONNECT
 #include <stdio.h>          // for snprintf
+#include <sys/sendfile.h>
 #include <sys/socket.h>
-#include <sys/uio.h>        // for readv
+#include <sys/uio.h>        // for readv, writev
+#include <sys/un.h>         // for sockaddr_un
 #include <unistd.h>         // for read, write, close...
 
 using namespace muduo;
@@ -54,6 +57,14 @@ struct sockaddr *sockets::sockaddr_cast(struct sockaddr_in6 *addr){
     return static_cast<struct sockaddr *>(implicit_cast<void *>(addr));
 }
 
+const struct sockaddr *sockets::sockaddr_cast(const struct sockaddr_storage *addr){
+    return static_cast<const struct sockaddr *>(implicit_cast<const void *>(addr));
+}
+
+struct sockaddr *sockets::sockaddr_cast(struct sockaddr_storage *addr){
+    return static_cast<struct sockaddr *>(implicit_cast<void *>(addr));
+}
+
 const struct sockaddr_in *sockets::sockaddr_in_cast(const struct sockaddr *addr){
     return static_cast<const struct sockaddr_in *>(implicit_cast<const void *>(addr));
 }
@@ -65,20 +76,22 @@ const struct sockaddr_in6 *sockets::sockaddr_in6_cast(const struct sockaddr *add
 /*
  *      创建一个NonBlocking和Close-on-exec的socket
  *
- *      family: IPv4 / IPv6 协议族
+ *      family: IPv4 / IPv6 / Unix domain 协议族
+ *      AF_UNIX 不能指定IPPROTO_TCP，协议号用0
  *
  *      前后两个::socket的区别————能否间接/直接设置flag
  *      后面的accept和accept4的区别亦是如此
  */
 int sockets::createNonblockingOrDie(sa_family_t family) {
+    int protocol = family == AF_UNIX ? 0 : IPPROTO_TCP;
 #if VALGRIND
-    int sockfd = ::sockfd(family, SOKC_STREAM, IPPROTO_TCP);
+    int sockfd = ::socket(family, SOCK_STREAM, protocol);
     if(sockfd < 0){
         LOG_SYSFATAL << "sockets::createNonblockingOrDie fail.";
     }
     setNonBlockAndCloseOnExec(sockfd);
 #else
-    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
     if(sockfd < 0){
         LOG_SYSFATAL << "sockets::createNonblockingOrDie fail.";
     }
@@ -87,11 +100,31 @@ int sockets::createNonblockingOrDie(sa_family_t family) {
     return sockfd;
 }
 
+/*
+ *      创建一个NonBlocking和Close-on-exec的UDP socket
+ */
+int sockets::createUdpNonblockingOrDie(sa_family_t family) {
+#if VALGRIND
+    int sockfd = ::socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    if(sockfd < 0){
+        LOG_SYSFATAL << "sockets::createUdpNonblockingOrDie fail.";
+    }
+    setNonBlockAndCloseOnExec(sockfd);
+#else
+    int sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if(sockfd < 0){
+        LOG_SYSFATAL << "sockets::createUdpNonblockingOrDie fail.";
+    }
+#endif
+
+    return sockfd;
+}
+
 /*
  *      bind以及返回值检查
  */
-void sockets::bindOrDie(int sockfd, const struct sockaddr *addr) {
-    int ret = ::bind(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+void sockets::bindOrDie(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
+    int ret = ::bind(sockfd, addr, addrlen);
     if(ret < 0){
         LOG_SYSFATAL << "sockets::bindOrDie";
     }
@@ -110,18 +143,21 @@ void sockets::listenOrDie(int sockfd) {
 /*
  *      accept以及根据errno处理不同错误
  */
-int sockets::accept(int sockfd, struct sockaddr_in6 *addr) {
-    socklen_t addrlen = static_cast<socklen_t>(sizeof(*addr));
+int sockets::accept(int sockfd, struct sockaddr_storage *addr, socklen_t *addrlen) {
+    *addrlen = static_cast<socklen_t>(sizeof(*addr));
 #if VALGRIND || defined (NO_ACCEPT4)
-    int connfd = ::accept(sockfd, sockaddr_cast(addr), &addrlen);
+    int connfd = ::accept(sockfd, sockaddr_cast(addr), addrlen);
     setNonBlockAndCloseOnExec(connfd);
 #else
-    int connfd = ::accept4(sockfd, sockaddr_cast(addr), &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    int connfd = ::accept4(sockfd, sockaddr_cast(addr), addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
 #endif
 
     if(connfd < 0){
         int saved_errno = errno;
-        LOG_SYSERR << "Socket::accept";
+        if(saved_errno != EAGAIN && saved_errno != ECONNABORTED && saved_errno != EINTR){
+            // Acceptor一次可读事件里会循环accept直到EAGAIN，这不是错误；后两个只影响一个连接，由Acceptor跳过
+            LOG_SYSERR << "Socket::accept";
+        }
         switch (saved_errno) {
             case EAGAIN:            /* Try again */
             case ECONNABORTED:      /* Software caused connection abort */
@@ -150,8 +186,8 @@ int sockets::accept(int sockfd, struct sockaddr_in6 *addr) {
     return connfd;
 }
 
-int sockets::connect(int sockfd, const struct sockaddr *addr) {
-    return ::connect(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+int sockets::connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
+    return ::connect(sockfd, addr, addrlen);
 }
 
 ssize_t sockets::read(int sockfd, void *buf, size_t count) {
@@ -166,6 +202,36 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count) {
     return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt) {
+    return ::writev(sockfd, iov, iovcnt);
+}
+
+/*
+ *      一次系统调用收/发多个datagram
+ *      sockfd是非阻塞的，所以没有数据可读（或者发送缓冲区满）时返回-1，errno为EAGAIN
+ */
+int sockets::recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen) {
+    return ::recvmmsg(sockfd, msgvec, vlen, 0, nullptr);
+}
+
+int sockets::sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen) {
+    return ::sendmmsg(sockfd, msgvec, vlen, 0);
+}
+
+ssize_t sockets::sendto(int sockfd, const void *buf, size_t count, const struct sockaddr *addr) {
+    socklen_t addrlen = static_cast<socklen_t>(addr->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6)
+                                                                          : sizeof(struct sockaddr_in));
+    return ::sendto(sockfd, buf, count, 0, addr, addrlen);
+}
+
+ssize_t sockets::splice(int fdIn, int fdOut, size_t count) {
+    return ::splice(fdIn, NULL, fdOut, NULL, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+}
+
+ssize_t sockets::sendfile(int sockfd, int fileFd, off_t *offset, size_t count) {
+    return ::sendfile(sockfd, fileFd, offset, count);
+}
+
 void sockets::close(int sockfd) {
     if(::close(sockfd) < 0){
         LOG_SYSERR << "sockets::close";
@@ -181,6 +247,31 @@ void sockets::shutdownWrite(int sockfd) {
     }
 }
 
+/*
+ *      TCP_FASTOPEN_CONNECT（Linux 4.11）：connect()立即返回而不发送SYN，
+ *      第一次write()时SYN和数据一起发出去。没有cookie时内核自动退化为普通的三次握手，对调用者透明。
+ */
+bool sockets::setTcpFastOpenConnect(int sockfd, bool on) {
+#ifdef TCP_FASTOPEN_CONNECT
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                        &optval, static_cast<socklen_t>(sizeof optval)) == 0;
+#else
+    return !on;
+#endif
+}
+
+/*
+ *      0字节的send()：推迟了握手的socket会在这里发出SYN；已经连接或者正在握手的socket返回0或EAGAIN，不发送任何东西。
+ *      握手的结果和普通的非阻塞connect()一样，失败时在之后的读/写上以错误的形式出现。
+ */
+void sockets::startDeferredConnect(int sockfd) {
+    if (::send(sockfd, NULL, 0, MSG_NOSIGNAL | MSG_DONTWAIT) < 0
+        && errno != EAGAIN && errno != EINPROGRESS) {
+        LOG_SYSERR << "sockets::startDeferredConnect";
+    }
+}
+
 /*
  *      IPv4/IPv6 网络字节转字符串形式
  */
@@ -217,7 +308,7 @@ void sockets::toIpPort(char *buf, size_t size, const struct sockaddr *addr) {
     const struct sockaddr_in *addr4 = sockaddr_in_cast(addr);
     uint16_t port = sockets::networkToHost16(addr4->sin_port);
     assert(size > end);
-    snprintf(buf + end, size - end, "]:%u", port);
+    snprintf(buf + end, size - end, ":%u", port);
 }
 
 /*
@@ -252,6 +343,19 @@ int sockets::getSocketError(int sockfd) {
     }
 }
 
+int sockets::getIncomingCpu(int sockfd) {
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t optlen = static_cast<socklen_t>(sizeof cpu);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &optlen) < 0) {
+        return -1;
+    }
+    return cpu;
+#else
+    return -1;
+#endif
+}
+
 /*
  *    获取本地地址
  *    返回的是ipv6地址，在使用的时候自行转换成ipv4（如果需要）
@@ -280,6 +384,29 @@ struct sockaddr_in6 sockets::getPeerAddr(int sockfd) {
     return peeraddr;
 }
 
+/*
+ *      完整的本地/对方地址和实际长度，AF_UNIX的路径放不进sockaddr_in6
+ */
+socklen_t sockets::getLocalAddr(int sockfd, struct sockaddr_storage *addr) {
+    memZero(addr, sizeof *addr);
+    socklen_t addrlen = static_cast<socklen_t>(sizeof *addr);
+    if(::getsockname(sockfd, sockaddr_cast(addr), &addrlen) < 0){
+        LOG_SYSERR << "sockets::getLocalAddr";
+        addrlen = 0;
+    }
+    return addrlen;
+}
+
+socklen_t sockets::getPeerAddr(int sockfd, struct sockaddr_storage *addr) {
+    memZero(addr, sizeof *addr);
+    socklen_t addrlen = static_cast<socklen_t>(sizeof *addr);
+    if(::getpeername(sockfd, sockaddr_cast(addr), &addrlen) < 0){
+        LOG_SYSERR << "sockets::getPeerAddr";
+        addrlen = 0;
+    }
+    return addrlen;
+}
+
 /*
  *      检查是否存在自连接的情况
  */
@@ -18,23 +18,45 @@ namespace muduo{
             // 创建一个带 SOCK_NONBLOCK, SOCK_CLOEXEC flag的socket
             int createNonblockingOrDie(sa_family_t family);
 
-            int connect(int sockfd, const struct sockaddr *addr);
+            // 创建一个带 SOCK_NONBLOCK, SOCK_CLOEXEC flag的UDP socket
+            int createUdpNonblockingOrDie(sa_family_t family);
 
-            void bindOrDie(int sockfd, const struct sockaddr *addr);
+            // addrlen见InetAddress::addrLength()，AF_UNIX的地址长度不固定
+            int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+            void bindOrDie(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 
             void listenOrDie(int sockfd);
 
-            int accept(int sockfd, struct sockaddr_in6 *addr);
+            // *addrlen返回对方地址的实际长度
+            int accept(int sockfd, struct sockaddr_storage *addr, socklen_t *addrlen);
 
             ssize_t read(int sockfd, void *buf, size_t count);
             ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 
             ssize_t write(int sockfd, const void *buf, size_t count);
+            ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+
+            // 批量收发datagram，返回值同recvmmsg(2) / sendmmsg(2)
+            int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen);
+            int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen);
+            ssize_t sendto(int sockfd, const void *buf, size_t count, const struct sockaddr *addr);
+
+            // 在两个fd之间搬运数据（其中一个必须是pipe），不经过用户态，非阻塞
+            ssize_t splice(int fdIn, int fdOut, size_t count);
+
+            // 从文件的*offset处发送count字节到socket，并更新*offset，不改变文件自身的偏移
+            ssize_t sendfile(int sockfd, int fileFd, off_t *offset, size_t count);
 
             void close(int sockfd);
 
             void shutdownWrite(int sockfd);
 
+            // 在connect()之前调用，返回false表示内核不支持TCP_FASTOPEN_CONNECT
+            bool setTcpFastOpenConnect(int sockfd, bool on);
+            // TCP_FASTOPEN_CONNECT推迟了握手而还没有write()时，发出SYN（不带数据）；已经开始握手时什么也不做
+            void startDeferredConnect(int sockfd);
+
             void toIpPort(char *buf, size_t size, const struct sockaddr *addr);
 
             void toIp(char *buf, size_t size, const struct sockaddr *addr);
@@ -44,15 +66,23 @@ namespace muduo{
 
             int getSocketError(int sockfd);
 
+            // 处理这个连接的软中断的CPU（SO_INCOMING_CPU），失败返回-1
+            int getIncomingCpu(int sockfd);
+
             // sockaddr, sockaddr_in, sockaddr_in6之间的转换
             const struct sockaddr *sockaddr_cast(const struct sockaddr_in *addr);
             const struct sockaddr *sockaddr_cast(const struct sockaddr_in6 *addr);
             struct sockaddr *sockaddr_cast(struct sockaddr_in6 *addr);
+            const struct sockaddr *sockaddr_cast(const struct sockaddr_storage *addr);
+            struct sockaddr *sockaddr_cast(struct sockaddr_storage *addr);
             const struct sockaddr_in *sockaddr_in_cast(const struct sockaddr *addr);
             const struct sockaddr_in6 *sockaddr_in6_cast(const struct sockaddr *addr);
 
             struct sockaddr_in6 getLocalAddr(int sockfd);
             struct sockaddr_in6 getPeerAddr(int sockfd);
+            // 返回地址的实际长度，失败返回0
+            socklen_t getLocalAddr(int sockfd, struct sockaddr_storage *addr);
+            socklen_t getPeerAddr(int sockfd, struct sockaddr_storage *addr);
 
             bool isSelfConnect(int sockfd);     // 检查有没有发生自连接的情况
         }
@@ -59,6 +59,24 @@ TcpClient::TcpClient(EventLoop *loop,
              << "] - connector " << get_pointer(connector_);
 }
 
+TcpClient::TcpClient(EventLoop *loop,
+                     const string &hostname,
+                     uint16_t port,
+                     const string &nameArg)
+        : loop_(CHECK_NOTNULL(loop)),
+          connector_(new Connector(loop, hostname, port)),
+          name_(nameArg),
+          connectionCallback_(defaultConnectionCallback),
+          messageCallback_(defaultMessageCallback),
+          retry_(false),
+          connect_(true),
+          nextConnId_(1) {
+    connector_->setNewConnectionCallback(
+            std::bind(&TcpClient::newConnection, this, _1));
+    LOG_INFO << "TcpClient::TcpClient[" << name_
+             << "] - connector " << get_pointer(connector_) << " to " << hostname << ":" << port;
+}
+
 TcpClient::~TcpClient() {
     LOG_INFO << "TcpClient::~TcpClient[" << name_
              << "] - connector " << get_pointer(connector_);
@@ -85,10 +103,15 @@ TcpClient::~TcpClient() {
     }
 }
 
+void TcpClient::enableTcpFastOpen() {
+    connector_->setTcpFastOpen(true);
+}
+
 void TcpClient::connect() {
     // FIXME: check state
     LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
-             << connector_->serverAddress().toIpPort();
+             << (connector_->hostname().empty() ? connector_->serverAddress().toIpPort()
+                                                : connector_->hostname());
     connect_ = true;
     connector_->start();
 }
@@ -111,13 +134,21 @@ void TcpClient::stop() {
 
 void TcpClient::newConnection(int sockfd) {
     loop_->assertInLoopThread();
-    InetAddress peerAddr(sockets::getPeerAddr(sockfd));
+    // TCP Fast Open推迟了握手，此时getpeername()返回ENOTCONN，直接用服务端地址
+    InetAddress peerAddr = connector_->serverAddress();
+    if (!connector_->tcpFastOpen()) {
+        struct sockaddr_storage peer;
+        socklen_t peerLen = sockets::getPeerAddr(sockfd, &peer);
+        peerAddr = InetAddress(sockets::sockaddr_cast(&peer), peerLen);
+    }
     char buf[32];
     snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
     ++nextConnId_;
     string connName = name_ + buf;
 
-    InetAddress localAddr(sockets::getLocalAddr(sockfd));
+    struct sockaddr_storage local;
+    socklen_t localLen = sockets::getLocalAddr(sockfd, &local);
+    InetAddress localAddr(sockets::sockaddr_cast(&local), localLen);
     // FIXME poll with zero timeout to double confirm the new connection
     // FIXME use make_shared if necessary
     TcpConnectionPtr conn(new TcpConnection(loop_,
@@ -136,6 +167,12 @@ void TcpClient::newConnection(int sockfd) {
         connection_ = conn;
     }
     conn->connectEstablished();
+    if (connector_->tcpFastOpen())
+    {
+        // 连接回调里发送的数据已经和SYN一起发出去了；没有发送（服务端先说话的协议）时由这里开始握手，
+        // 否则在第一次write()之前SYN永远不会发出
+        sockets::startDeferredConnect(sockfd);
+    }
 }
 
 void TcpClient::removeConnection(const TcpConnectionPtr &conn) {
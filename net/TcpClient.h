@@ -23,6 +23,12 @@ namespace muduo {
                       const InetAddress &serverAddr,
                       const string &nameArg);
 
+            /// hostname is resolved asynchronously by Resolver::instance() on each connection attempt.
+            TcpClient(EventLoop *loop,
+                      const string &hostname,
+                      uint16_t port,
+                      const string &nameArg);
+
             ~TcpClient();  // force out-line dtor, for std::unique_ptr members.
 
             void connect();
@@ -42,6 +48,17 @@ namespace muduo {
 
             void enableRetry() { retry_ = true; }
 
+            /// Sends the first message together with SYN when the server supports TCP Fast Open,
+            /// falls back to a normal handshake otherwise.
+            /// Must be called before @c connect
+            ///
+            /// With a cached cookie the kernel defers the handshake, so the connection callback
+            /// runs BEFORE any SYN is sent: peerAddress() is the server address given to the client,
+            /// and handshake failures show up later as a read error instead of a retry.
+            /// Only data sent inside the connection callback rides on the SYN; if the callback
+            /// sends nothing (server-speaks-first protocols) the handshake starts right after it.
+            void enableTcpFastOpen();
+
             const string &name() const { return name_; }
 
             /// Set connection callback.
@@ -12,10 +12,25 @@
 #include "SocketsOps.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>        // for struct iovec
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            // 拷贝的relay：目的连接积压超过高水位时源连接停止读，低于低水位时恢复
+            const size_t kRelayCopyHighWater = 1024 * 1024;
+            const size_t kRelayCopyLowWater = 256 * 1024;
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
 /*
  *      默认的连接建立/关闭回调，什么也不做
  */
@@ -49,7 +64,14 @@ TcpConnection::TcpConnection(EventLoop *loop,
           channel_(new Channel(loop, sockfd)),
           localAddr_(localAddr),
           peerAddr_(peerAddr),
-          highWaterMark_(64 * 1024 * 1024) {
+          highWaterMark_(64 * 1024 * 1024),
+          pendingAfterBytes_(0),
+          relayPipeBytes_(0),
+          relayCopyBytes_(0),
+          relayCopyBlocked_(false),
+          relayCopyPaused_(false) {
+    relayPipe_.readFd = -1;
+    relayPipe_.writeFd = -1;
     channel_->setReadCallback(
             std::bind(&TcpConnection::handleRead, this, _1));
     channel_->setWriteCallback(
@@ -68,6 +90,12 @@ TcpConnection::~TcpConnection() {
               << " fd=" << channel_->fd()
               << " state=" << stateToString();
     assert(state_ == kDisconnected);
+    if (hasRelayPipe()) {
+        // 可能不在loop线程中析构，不能归还给PipePool
+        ::close(relayPipe_.readFd);
+        ::close(relayPipe_.writeFd);
+    }
+    closePendingFiles();
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info *tcpi) const {
@@ -122,6 +150,40 @@ void TcpConnection::send(Buffer *buf) {
     }
 }
 
+void TcpConnection::send(const StringPiece &head, const StringPiece &body) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendInLoop(head, body);
+        } else {
+            string message;
+            message.reserve(implicit_cast<size_t>(head.size() + body.size()));
+            message.append(head.data(), implicit_cast<size_t>(head.size()));
+            message.append(body.data(), implicit_cast<size_t>(body.size()));
+            void (TcpConnection::*fp)(const StringPiece &message) = &TcpConnection::sendInLoop;
+            loop_->runInLoop(std::bind(fp, this, std::move(message)));     // FIXME
+        }
+    }
+}
+
+/*
+ *      sendFile() --> sendFileInLoop()
+ *      在调用线程dup()，调用者可以立即关闭自己的fd
+ */
+void TcpConnection::sendFile(int fd, off_t offset, size_t count) {
+    if (state_ == kConnected) {
+        int fileFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (fileFd < 0) {
+            LOG_SYSERR << "TcpConnection::sendFile";
+            return;
+        }
+        if (loop_->isInLoopThread()) {
+            sendFileInLoop(fileFd, offset, count);
+        } else {
+            loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileFd, offset, count));
+        }
+    }
+}
+
 void TcpConnection::sendInLoop(const StringPiece &message) {
     sendInLoop(message.data(), message.size());
 }
@@ -136,6 +198,10 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
         LOG_WARN << "disconnected, give up writing";
         return;
     }
+    if (!pendingFiles_.empty()) {
+        appendAfterPendingFiles(static_cast<const char *>(data), len);
+        return;
+    }
 
     /*
      *      a. 如果outputBuffer里面没有东西，那么会直接发送数据给对方。发送后有三种情况：
@@ -166,22 +232,166 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
         }
     }
 
-    /*
-     *      将待发送数据存入outputBuffer。
-     *      1. 如果存入后数据量超过设置的高水位，则触发highWaterMarkCallback_()
-     *      2. 监听writable事件，然后以后的handlewrite()处理发送事件
-     */
+    // 没发送完的部分存入outputBuffer
     assert(remaining <= len);
     if (!faultError && remaining > 0) {
-        size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_) {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+        appendToOutputBuffer(static_cast<const char *>(data) + nwrote, remaining);
+    }
+}
+
+/*
+ *      和sendInLoop(data, len)相同，只是直接发送时用writev()一次发出head和body
+ */
+void TcpConnection::sendInLoop(const StringPiece &head, const StringPiece &body) {
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected) {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    if (!pendingFiles_.empty()) {
+        appendAfterPendingFiles(head.data(), implicit_cast<size_t>(head.size()));
+        appendAfterPendingFiles(body.data(), implicit_cast<size_t>(body.size()));
+        return;
+    }
+    size_t headLen = implicit_cast<size_t>(head.size());
+    size_t bodyLen = implicit_cast<size_t>(body.size());
+    size_t nwrote = 0;
+    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
+        struct iovec vec[2];
+        vec[0].iov_base = const_cast<char *>(head.data());
+        vec[0].iov_len = headLen;
+        vec[1].iov_base = const_cast<char *>(body.data());
+        vec[1].iov_len = bodyLen;
+        ssize_t n = sockets::writev(channel_->fd(), vec, 2);
+        if (n >= 0) {
+            nwrote = implicit_cast<size_t>(n);
+            if (nwrote == headLen + bodyLen && writeCompleteCallback_) {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+        } else if (errno != EWOULDBLOCK) {
+            LOG_SYSERR << "TcpConnection::sendInLoop";
+            if (errno == EPIPE || errno == ECONNRESET) {
+                return;
+            }
+        }
+    }
+
+    if (nwrote < headLen) {
+        appendToOutputBuffer(head.data() + nwrote, headLen - nwrote);
+        nwrote = headLen;
+    }
+    if (nwrote < headLen + bodyLen) {
+        appendToOutputBuffer(body.data() + (nwrote - headLen), headLen + bodyLen - nwrote);
+    }
+}
+
+/*
+ *      将待发送数据存入outputBuffer。
+ *      1. 如果存入后数据量超过设置的高水位，则触发highWaterMarkCallback_()
+ *      2. 监听writable事件，然后以后的handlewrite()处理发送事件
+ */
+void TcpConnection::appendToOutputBuffer(const char *data, size_t len) {
+    size_t oldLen = bufferedBytes();
+    if (oldLen + len >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_) {
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+    }
+    outputBuffer_.append(data, len);
+    if (!channel_->isWriting()) {
+        channel_->enableWriting();
+    }
+}
+
+/*
+ *      有文件还没发完时，数据存到队尾文件的after里。这些数据和outputBuffer_一样占内存，同样计入高水位，
+ *      否则排在大文件后面的流水线应答不受highWaterMarkCallback_的约束
+ */
+void TcpConnection::appendAfterPendingFiles(const char *data, size_t len) {
+    assert(!pendingFiles_.empty());
+    size_t oldLen = bufferedBytes();
+    if (oldLen + len >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_) {
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+    }
+    pendingFiles_.back().after.append(data, len);
+    pendingAfterBytes_ += len;
+}
+
+/*
+ *      和sendInLoop(data, len)的思路相同：前面没有待发送的数据就直接sendfile()，
+ *      没发完的部分排进pendingFiles_，在handleWrite()里继续
+ */
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t count) {
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected) {
+        LOG_WARN << "disconnected, give up writing";
+        ::close(fd);
+        return;
+    }
+    if (pendingFiles_.empty() && !channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
+        ssize_t n = sockets::sendfile(channel_->fd(), fd, &offset, count);
+        if (n >= 0) {
+            count -= static_cast<size_t>(n);
+            if (count == 0 || n == 0) {
+                if (count > 0) {
+                    LOG_ERROR << "TcpConnection::sendFileInLoop [" << name_ << "] - file shorter than expected";
+                }
+                ::close(fd);
+                if (writeCompleteCallback_) {
+                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                }
+                return;
+            }
+        } else if (errno != EAGAIN) {
+            LOG_SYSERR << "TcpConnection::sendFileInLoop";
+            ::close(fd);
+            return;
         }
-        outputBuffer_.append(static_cast<const char *>(data) + nwrote, remaining);
-        if (!channel_->isWriting()) {
-            channel_->enableWriting();
+    }
+
+    pendingFiles_.push_back(PendingFile());
+    PendingFile &file = pendingFiles_.back();
+    file.fd = fd;
+    file.offset = offset;
+    file.remaining = count;
+    if (!channel_->isWriting()) {
+        channel_->enableWriting();
+    }
+}
+
+/*
+ *      outputBuffer_空了以后发送队首的文件。一个文件发完后，把排在它后面的数据换入outputBuffer_，
+ *      由下一次handleWrite()发送
+ */
+void TcpConnection::writePendingFiles() {
+    while (outputBuffer_.readableBytes() == 0 && !pendingFiles_.empty()) {
+        PendingFile &file = pendingFiles_.front();
+        while (file.remaining > 0) {
+            ssize_t n = sockets::sendfile(channel_->fd(), file.fd, &file.offset, file.remaining);
+            if (n > 0) {
+                file.remaining -= static_cast<size_t>(n);
+            } else if (n < 0 && errno == EAGAIN) {
+                return;
+            } else if (n < 0) {
+                // 连接出错，交给handleClose()/handleError()
+                LOG_SYSERR << "TcpConnection::writePendingFiles";
+                return;
+            } else {
+                LOG_ERROR << "TcpConnection::writePendingFiles [" << name_ << "] - file shorter than expected";
+                file.remaining = 0;
+            }
         }
+        ::close(file.fd);
+        pendingAfterBytes_ -= file.after.readableBytes();
+        outputBuffer_.swap(file.after);
+        pendingFiles_.pop_front();
+    }
+}
+
+void TcpConnection::closePendingFiles() {
+    for (const PendingFile &file : pendingFiles_) {
+        ::close(file.fd);
     }
+    pendingFiles_.clear();
+    pendingAfterBytes_ = 0;
 }
 
 /*
@@ -273,6 +483,189 @@ void TcpConnection::stopReadInLoop() {
     }
 }
 
+/*
+ *      relayTo() --> relayToInLoop()
+ */
+void TcpConnection::relayTo(const TcpConnectionPtr &destination) {
+    loop_->runInLoop(std::bind(&TcpConnection::relayToInLoop, shared_from_this(), destination));
+}
+
+/*
+ *      1. 同一个loop：从loop的PipePool借一个pipe，之后handleRead()走handleRelayRead()，
+ *         socket --splice--> pipe --splice--> socket
+ *      2. 不同loop（或者拿不到pipe）：handleRead()把inputBuffer_中的数据交给目的连接的loop发送（relayCopy()），
+ *         需要两次用户态拷贝，但不用跨线程访问对方的Buffer
+ *
+ *      已经在inputBuffer_中的数据先转发，保证顺序。
+ *      再次调用时先结束和原目的连接的relay：pipe中剩下的数据尽量写给原目的连接，写不完的丢弃，
+ *      原目的连接不再把本连接当作源连接。
+ */
+void TcpConnection::relayToInLoop(const TcpConnectionPtr &destination) {
+    loop_->assertInLoopThread();
+    TcpConnectionPtr oldDestination(relayDestination_.lock());
+    if (oldDestination && oldDestination != destination) {
+        if (hasRelayPipe()) {
+            flushRelayPipe(oldDestination.get());
+            if (relayPipeBytes_ > 0) {
+                LOG_WARN << "TcpConnection::relayTo [" << name_ << "] - drop " << relayPipeBytes_
+                         << " bytes to [" << oldDestination->name() << "]";
+            }
+            releaseRelayPipe();
+            resumeRelayRead();
+        }
+        oldDestination->getLoop()->runInLoop(
+                std::bind(&TcpConnection::clearRelaySource, oldDestination, shared_from_this()));
+    }
+
+    relayDestination_ = destination;
+    if (destination->getLoop() == loop_ && !hasRelayPipe() &&
+        loop_->pipePool()->acquire(&relayPipe_)) {
+        destination->relaySource_ = shared_from_this();
+    }
+    if (inputBuffer_.readableBytes() > 0) {
+        relayCopy(destination);
+    }
+}
+
+// 在目的连接的loop中调用
+void TcpConnection::clearRelaySource(const TcpConnectionPtr &source) {
+    loop_->assertInLoopThread();
+    if (relaySource_.lock() == source) {
+        relaySource_.reset();
+    }
+    if (relayCopySource_.lock() == source) {
+        relayCopySource_.reset();
+        resumeRelayCopySource(source);
+    }
+}
+
+/*
+ *      拷贝的relay的背压，和零拷贝时一样是停止读源socket，让内核的接收窗口把压力传回给发送方：
+ *      1. 交给目的loop还没处理的字节数超过高水位时停止读，目的loop处理完（relayCopyInLoop()）后恢复
+ *      2. 目的连接的outputBuffer_超过高水位时由目的连接设置relayCopyBlocked_，
+ *         低于低水位（handleWrite()）或者目的连接断开时清除并恢复读
+ *
+ *      relayCopyPaused_在交出数据之前设置，目的loop处理这批数据时一定能看到，不会漏掉恢复
+ */
+void TcpConnection::relayCopy(const TcpConnectionPtr &destination) {
+    if (destination->getLoop() == loop_) {
+        // 拿不到pipe时同一个loop也走拷贝，直接发送，不要排在之后splice的数据后面
+        destination->relayCopyInLoop(shared_from_this(), inputBuffer_.retrieveAllAsString());
+        return;
+    }
+    size_t len = inputBuffer_.readableBytes();
+    size_t inFlight = relayCopyBytes_.fetch_add(len) + len;
+    if (inFlight >= detail::kRelayCopyHighWater || relayCopyBlocked_.load()) {
+        relayCopyPaused_.store(true);
+        channel_->disableReading();
+    }
+    destination->getLoop()->queueInLoop(
+            std::bind(&TcpConnection::relayCopyInLoop, destination, shared_from_this(),
+                      inputBuffer_.retrieveAllAsString()));
+}
+
+void TcpConnection::relayCopyInLoop(const TcpConnectionPtr &source, const string &data) {
+    loop_->assertInLoopThread();
+    relayCopySource_ = source;
+    sendInLoop(data.data(), data.size());
+    source->relayCopyBytes_.fetch_sub(data.size());
+    if (!disconnected() && bufferedBytes() >= detail::kRelayCopyHighWater) {
+        source->relayCopyBlocked_.store(true);
+    }
+    resumeRelayCopySource(source);
+}
+
+// 在目的连接的loop中调用，两个背压条件都解除时让源连接在它自己的loop中恢复读
+void TcpConnection::resumeRelayCopySource(const TcpConnectionPtr &source) {
+    if (!source->relayCopyBlocked_.load() &&
+        source->relayCopyBytes_.load() < detail::kRelayCopyHighWater &&
+        source->relayCopyPaused_.exchange(false)) {
+        source->getLoop()->runInLoop(std::bind(&TcpConnection::resumeRelayRead, source));
+    }
+}
+
+/*
+ *      零拷贝relay的背压：
+ *      1. 只在pipe为空、目的连接的outputBuffer_也为空的时候从源socket读，
+ *         所以pipe中的数据总是比目的连接outputBuffer_中的数据先到，见handleWrite()
+ *      2. pipe中的数据没有全部写到目的socket（对方的发送缓冲区满了），就停止读源socket，
+ *         让内核的接收窗口把压力传回给发送方，等目的连接可写时在handleWrite()中继续
+ */
+void TcpConnection::handleRelayRead(Timestamp receiveTime) {
+    TcpConnectionPtr destination(relayDestination_.lock());
+    if (!destination || destination->disconnected()) {
+        // 目的连接已经断开，结束relay，之后的数据照常交给messageCallback_
+        releaseRelayPipe();
+        relayDestination_.reset();
+        destination.reset();
+        handleRead(receiveTime);
+        return;
+    }
+    if (relayPipeBytes_ > 0 || destination->outputBuffer_.readableBytes() > 0) {
+        channel_->disableReading();
+        return;
+    }
+
+    const size_t kRelayChunk = 64 * 1024;   // pipe的默认容量
+    ssize_t n = sockets::splice(channel_->fd(), relayPipe_.writeFd, kRelayChunk);
+    if (n > 0) {
+        relayPipeBytes_ = static_cast<size_t>(n);
+        flushRelayPipe(destination.get());
+        if (relayPipeBytes_ > 0) {
+            channel_->disableReading();
+            if (!destination->channel_->isWriting()) {
+                destination->channel_->enableWriting();
+            }
+        }
+        return;
+    }
+
+    // 同handleClose()，回调期间不持有目的连接
+    destination.reset();
+    if (n == 0) {
+        handleClose();
+    } else if (errno != EAGAIN) {
+        LOG_SYSERR << "TcpConnection::handleRelayRead";
+        handleError();
+    }
+}
+
+/*
+ *      把pipe中的数据写到目的socket，直到pipe空了或者EAGAIN
+ *      目的socket出错时丢弃pipe中的数据并结束relay，错误由目的连接自己处理
+ */
+void TcpConnection::flushRelayPipe(TcpConnection *destination) {
+    while (relayPipeBytes_ > 0) {
+        ssize_t n = sockets::splice(relayPipe_.readFd, destination->channel_->fd(), relayPipeBytes_);
+        if (n > 0) {
+            relayPipeBytes_ -= static_cast<size_t>(n);
+        } else if (n < 0 && errno == EAGAIN) {
+            break;
+        } else {
+            LOG_SYSERR << "TcpConnection::flushRelayPipe [" << name_ << "] -> [" << destination->name() << "]";
+            releaseRelayPipe();
+            relayDestination_.reset();
+            resumeRelayRead();
+            break;
+        }
+    }
+}
+
+void TcpConnection::resumeRelayRead() {
+    if (reading_ && !disconnected() && !channel_->isReading()) {
+        channel_->enableReading();
+    }
+}
+
+void TcpConnection::releaseRelayPipe() {
+    if (hasRelayPipe()) {
+        loop_->pipePool()->release(relayPipe_, relayPipeBytes_ == 0);
+        relayPipe_.readFd = -1;
+        relayPipe_.writeFd = -1;
+        relayPipeBytes_ = 0;
+    }
+}
+
 /*
  *     当连接建立之后，监听该连接的可读事件
  *
@@ -303,6 +696,7 @@ void TcpConnection::connectDestroyed() {
 
         connectionCallback_(shared_from_this());
     }
+    releaseRelayPipe();
     channel_->remove();
 }
 
@@ -314,10 +708,22 @@ void TcpConnection::connectDestroyed() {
  */
 void TcpConnection::handleRead(Timestamp receiveTime) {
     loop_->assertInLoopThread();
+    if (hasRelayPipe()) {
+        handleRelayRead(receiveTime);
+        return;
+    }
     int savedErrno = 0;
     ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
     if (n > 0) {
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        TcpConnectionPtr destination(relayDestination_.lock());
+        if (destination && !destination->disconnected()) {
+            relayCopy(destination);             // 跨loop的relay，退化为拷贝
+        } else {
+            // 目的连接已经断开，结束relay，之后的数据照常交给messageCallback_
+            relayDestination_.reset();
+            destination.reset();
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        }
     } else if (n == 0) {
         handleClose();
     } else {
@@ -330,26 +736,50 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
 /*
  *      将outputBuffer的数据发送给客户端。与Channel_::writeCallback_绑定
  *      只有outputBuffer清空时才会触发writeCompleteCallback_()；否则poller会一直监听可写事件，handleWrite()一直被调用直到数据被发完。
+ *      sendFile()排队的文件在outputBuffer清空后发送，见writePendingFiles()。
+ *
+ *      如果本连接是零拷贝relay的目的连接，源连接pipe中的数据比outputBuffer中的先到，要先发送（见handleRelayRead()），
+ *      全部发完后再让源连接恢复读。
  */
 void TcpConnection::handleWrite() {
     loop_->assertInLoopThread();
     if (channel_->isWriting()) {
-        ssize_t n = sockets::write(channel_->fd(),
-                                   outputBuffer_.peek(),
-                                   outputBuffer_.readableBytes());
-        if (n > 0) {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0) {
-                channel_->disableWriting();
-                if (writeCompleteCallback_) {
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                if (state_ == kDisconnecting) {
-                    shutdownInLoop();
-                }
+        TcpConnectionPtr source(relaySource_.lock());
+        if (source && source->relayPipeBytes_ > 0) {
+            source->flushRelayPipe(this);
+            if (source->relayPipeBytes_ > 0) {
+                return;
+            }
+        }
+        if (outputBuffer_.readableBytes() > 0) {
+            ssize_t n = sockets::write(channel_->fd(),
+                                       outputBuffer_.peek(),
+                                       outputBuffer_.readableBytes());
+            if (n > 0) {
+                outputBuffer_.retrieve(n);
+            } else {
+                LOG_SYSERR << "TcpConnection::handleWrite";
+                return;
+            }
+        }
+        if (bufferedBytes() < detail::kRelayCopyLowWater) {
+            TcpConnectionPtr copySource(relayCopySource_.lock());
+            if (copySource && copySource->relayCopyBlocked_.exchange(false)) {
+                resumeRelayCopySource(copySource);
+            }
+        }
+        writePendingFiles();
+        if (outputBuffer_.readableBytes() == 0 && pendingFiles_.empty()) {
+            channel_->disableWriting();
+            if (writeCompleteCallback_) {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            if (state_ == kDisconnecting) {
+                shutdownInLoop();
+            }
+            if (source) {
+                source->resumeRelayRead();
             }
-        } else {
-            LOG_SYSERR << "TcpConnection::handleWrite";
         }
     } else {
         LOG_TRACE << "Connection fd = " << channel_->fd()
@@ -372,6 +802,22 @@ void TcpConnection::handleClose() {
     // we don't close fd, leave it to dtor, so we can find leaks easily.
     setState(kDisconnected);
     channel_->disableAll();
+    releaseRelayPipe();
+    closePendingFiles();
+
+    // 源连接可能正因为背压停止了读，让它发现目的连接已经断开。
+    // 不要在回调期间持有源连接，否则TcpClient等拥有者析构时会误以为它还有其它引用
+    {
+        TcpConnectionPtr source(relaySource_.lock());
+        if (source) {
+            source->resumeRelayRead();
+        }
+        TcpConnectionPtr copySource(relayCopySource_.lock());
+        if (copySource) {
+            copySource->relayCopyBlocked_.store(false);
+            resumeRelayCopySource(copySource);
+        }
+    }
 
     TcpConnectionPtr guardThis(shared_from_this());
     connectionCallback_(guardThis);
@@ -381,9 +827,10 @@ void TcpConnection::handleClose() {
 
 /*
  *      与Channel::errorCallback_绑定
+ *      大量连接同时出错时每秒只记录一条，被丢弃的条数由下一条带出
  */
 void TcpConnection::handleError() {
     int err = sockets::getSocketError(channel_->fd());
-    LOG_ERROR << "TcpConnection::handleError [" << name_
+    LOG_EVERY_MS(ERROR, 1000) << "TcpConnection::handleError [" << name_
               << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
\ No newline at end of file
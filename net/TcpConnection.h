@@ -18,7 +18,10 @@
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "InetAddress.h"
+#include "PipePool.h"
 
+#include <atomic>
+#include <deque>
 #include <memory>
 
 #include <boost/any.hpp>
@@ -77,6 +80,13 @@ namespace muduo {
 
             // void send(Buffer&& message); // C++11
             void send(Buffer *message);  // this one will swap data
+            /// Sends head followed by body with one writev(2), without concatenating them first.
+            void send(const StringPiece &head, const StringPiece &body);
+
+            /// Sends count bytes of a regular file from offset with sendfile(2), in order with other sends.
+            /// fd is dup()ed, the caller may close it right after this call.
+            void sendFile(int fd, off_t offset, size_t count);
+
             void shutdown(); // NOT thread safe, no simultaneous calling
             // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
             void forceClose();
@@ -92,6 +102,17 @@ namespace muduo {
 
             bool isReading() const { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
 
+            /// Forwards all bytes received from now on to destination, one direction only.
+            /// Call it on both connections for a bidirectional proxy.
+            ///
+            /// If both connections live in the same loop, bytes are moved with splice(2)
+            /// through a pipe of the loop's PipePool, never entering user space,
+            /// otherwise it falls back to copying through Buffer.
+            /// Either way reading stops while destination can't keep up and resumes once it drains.
+            /// MessageCallback is not called while relaying.
+            /// Calling it again switches to the new destination.
+            void relayTo(const TcpConnectionPtr &destination);
+
             void setContext(const boost::any &context) { context_ = context; }
 
             const boost::any &getContext() const { return context_; }
@@ -140,6 +161,21 @@ namespace muduo {
 
             void sendInLoop(const void *message, size_t len);
 
+            void sendInLoop(const StringPiece &head, const StringPiece &body);
+
+            void appendToOutputBuffer(const char *data, size_t len);
+
+            void appendAfterPendingFiles(const char *data, size_t len);
+
+            // 计入高水位的字节数：outputBuffer_和排在文件后面的数据
+            size_t bufferedBytes() const { return outputBuffer_.readableBytes() + pendingAfterBytes_; }
+
+            void sendFileInLoop(int fd, off_t offset, size_t count);
+
+            void writePendingFiles();
+
+            void closePendingFiles();
+
             void shutdownInLoop();
 
             // void shutdownAndForceCloseInLoop(double seconds);
@@ -153,6 +189,26 @@ namespace muduo {
 
             void stopReadInLoop();
 
+            void relayToInLoop(const TcpConnectionPtr &destination);
+
+            void clearRelaySource(const TcpConnectionPtr &source);
+
+            void relayCopy(const TcpConnectionPtr &destination);
+
+            void relayCopyInLoop(const TcpConnectionPtr &source, const string &data);
+
+            void resumeRelayCopySource(const TcpConnectionPtr &source);
+
+            void handleRelayRead(Timestamp receiveTime);
+
+            void flushRelayPipe(TcpConnection *destination);
+
+            void resumeRelayRead();
+
+            void releaseRelayPipe();
+
+            bool hasRelayPipe() const { return relayPipe_.readFd >= 0; }
+
             EventLoop *loop_;
             const string name_;
             StateE state_;  // FIXME: use atomic variable
@@ -171,7 +227,31 @@ namespace muduo {
             Buffer inputBuffer_;
             Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
 
+            /*
+             *      sendFile()的文件按顺序排队。文件还没发完时send()的数据存到队尾文件的after里，
+             *      该文件发完后再换入outputBuffer_，保证和调用顺序一致
+             */
+            struct PendingFile {
+                int fd;             // dup()出来的，发完后关闭
+                off_t offset;
+                size_t remaining;
+                Buffer after;
+            };
+            std::deque<PendingFile> pendingFiles_;
+            size_t pendingAfterBytes_;                      // 所有after中的字节数
+
             boost::any context_;    // 用来存储用户自定义任意变量，希望该变量的生命周期由TcpConnection来管理。
+
+            // relay，见relayTo()
+            std::weak_ptr<TcpConnection> relayDestination_; // 本连接收到的数据转发给谁
+            std::weak_ptr<TcpConnection> relaySource_;      // 谁的数据splice到本连接（同一个loop）
+            PipePool::Pipe relayPipe_;                      // 中转pipe，readFd < 0 表示没有
+            size_t relayPipeBytes_;                         // pipe中还没写到目的连接的字节数
+            // 拷贝的relay，见relayCopy()
+            std::weak_ptr<TcpConnection> relayCopySource_;  // 谁的数据拷贝到本连接，只在本连接的loop中访问
+            std::atomic<size_t> relayCopyBytes_;            // 已经交给目的loop、还没放进目的outputBuffer_的字节数
+            std::atomic<bool> relayCopyBlocked_;            // 目的连接的outputBuffer_超过了高水位
+            std::atomic<bool> relayCopyPaused_;             // 因为背压停止了读
         };
 
         typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
@@ -15,17 +15,33 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            void establishConnections(const std::vector<TcpConnectionPtr> &conns) {
+                for (const TcpConnectionPtr &conn: conns) {
+                    conn->connectEstablished();
+                }
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
 TcpServer::TcpServer(EventLoop *loop,
                      const InetAddress &listenAddr,
                      const string &nameArg,
                      Option option)
         : loop_(CHECK_NOTNULL(loop)),
+          listenAddr_(listenAddr),
           ipPort_(listenAddr.toIpPort()),
           name_(nameArg),
           acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
           threadPool_(new EventLoopThreadPool(loop, name_)),
           connectionCallback_(defaultConnectionCallback),
           messageCallback_(defaultMessageCallback),
+          placeByIncomingCpu_(false),
           nextConnId_(1) {
     acceptor_->setNewConnectionCallback(
             std::bind(&TcpServer::newConnection, this, _1, _2));
@@ -48,6 +64,46 @@ void TcpServer::setThreadNum(int numThreads) {
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setMaxAcceptsPerEvent(int n) {
+    assert(!acceptor_->listening());
+    acceptor_->setMaxAcceptsPerEvent(n);
+    if (n > 1) {
+        acceptor_->setNewConnectionsCallback(
+                std::bind(&TcpServer::newConnections, this, _1));
+    } else {
+        // 回到一次只accept一个连接，不再走批量的路径
+        acceptor_->setNewConnectionsCallback(Acceptor::NewConnectionsCallback());
+    }
+}
+
+void TcpServer::setTcpFastOpen(int qlen) {
+    assert(!acceptor_->listening());
+    acceptor_->setTcpFastOpen(qlen);
+}
+
+void TcpServer::setDeferAccept(int seconds) {
+    assert(!acceptor_->listening());
+    acceptor_->setDeferAccept(seconds);
+}
+
+void TcpServer::setThreadCpuAffinity(bool on) {
+    threadPool_->setCpuAffinity(on);
+}
+
+/*
+ *      默认用round-robin方式选一个EventLoop；
+ *      placeByIncomingCpu_时选择处理该连接网络包的CPU对应的EventLoop，让协议栈和业务处理在同一个核上（cache友好）
+ */
+EventLoop *TcpServer::selectLoop(int sockfd) {
+    if (placeByIncomingCpu_) {
+        int cpu = sockets::getIncomingCpu(sockfd);
+        if (cpu >= 0) {
+            return threadPool_->getLoopForCpu(cpu);
+        }
+    }
+    return threadPool_->getNextLoop();
+}
+
 void TcpServer::start() {
     if (started_.getAndSet(1) == 0) {
         threadPool_->start(threadInitCallback_);
@@ -60,7 +116,39 @@ void TcpServer::start() {
 
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
     loop_->assertInLoopThread();
-    EventLoop *ioLoop = threadPool_->getNextLoop(); // 用round-robin方式选一个EventLoop
+    EventLoop *ioLoop = selectLoop(sockfd);
+    TcpConnectionPtr conn(createConnection(ioLoop, sockfd, peerAddr));
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+}
+
+/*
+ *      Acceptor一次可读事件accept到的一批连接
+ *      按所属的IO loop分组，每个loop只投递一个functor（也就只wakeup一次），而不是每个连接一个
+ */
+void TcpServer::newConnections(const std::vector<AcceptedConnection> &accepted) {
+    loop_->assertInLoopThread();
+    std::vector<std::pair<EventLoop *, std::vector<TcpConnectionPtr>>> batches;
+    for (const AcceptedConnection &item: accepted) {
+        EventLoop *ioLoop = selectLoop(item.sockfd);
+        TcpConnectionPtr conn(createConnection(ioLoop, item.sockfd, item.peerAddr));
+
+        // loop的数量通常很少，线性查找就够了
+        size_t i = 0;
+        while (i < batches.size() && batches[i].first != ioLoop) {
+            ++i;
+        }
+        if (i == batches.size()) {
+            batches.push_back(std::make_pair(ioLoop, std::vector<TcpConnectionPtr>()));
+        }
+        batches[i].second.push_back(conn);
+    }
+
+    for (auto &batch: batches) {
+        batch.first->runInLoop(std::bind(&detail::establishConnections, std::move(batch.second)));
+    }
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr) {
     char buf[64];
     snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
     ++nextConnId_;
@@ -69,7 +157,9 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
     LOG_INFO << "TcpServer::newConnection [" << name_
              << "] - new connection [" << connName
              << "] from " << peerAddr.toIpPort();
-    InetAddress localAddr(sockets::getLocalAddr(sockfd));
+    struct sockaddr_storage local;
+    socklen_t localLen = sockets::getLocalAddr(sockfd, &local);
+    InetAddress localAddr(sockets::sockaddr_cast(&local), localLen);
     // FIXME poll with zero timeout to double confirm the new connection
     // FIXME use make_shared if necessary
     TcpConnectionPtr conn(new TcpConnection(ioLoop,
@@ -83,7 +173,7 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
     conn->setWriteCompleteCallback(writeCompleteCallback_);
     conn->setCloseCallback(
             std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    return conn;
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
@@ -14,12 +14,15 @@
 #include "TcpConnection.h"
 
 #include <map>
+#include <vector>
 
 namespace muduo {
     namespace net {
 
         class Acceptor;
 
+        struct AcceptedConnection;
+
         class EventLoop;
 
         class EventLoopThreadPool;
@@ -37,6 +40,7 @@ namespace muduo {
             };
 
             //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
+            /// listenAddr may be a UnixAddress, then it serves AF_UNIX stream connections.
             TcpServer(EventLoop *loop,
                       const InetAddress &listenAddr,
                       const string &nameArg,
@@ -64,6 +68,31 @@ namespace muduo {
 
             void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
 
+            /// Accepts up to n connections per readiness of the listening socket,
+            /// they are handed to IO loops with one functor per loop.
+            /// Default is 1. Must be called before @c start
+            void setMaxAcceptsPerEvent(int n);
+
+            /// Enables TCP Fast Open on the listening socket, clients may send data in SYN.
+            /// Needs bit 0x2 of net.ipv4.tcp_fastopen.
+            /// Must be called before @c start
+            void setTcpFastOpen(int qlen);
+
+            /// Wakes up the acceptor only when data has arrived on a new connection (TCP_DEFER_ACCEPT),
+            /// or after @c seconds.
+            /// Must be called before @c start
+            void setDeferAccept(int seconds);
+
+            /// Pins IO threads on CPUs, see EventLoopThreadPool::setCpuAffinity.
+            /// Must be called before @c start
+            void setThreadCpuAffinity(bool on);
+
+            /// Puts each new connection on the IO loop pinned on (or mapped to) the CPU
+            /// which handles its packets (SO_INCOMING_CPU), instead of round-robin.
+            /// Best used with setThreadCpuAffinity(true) and RSS/RPS spreading flows over those CPUs.
+            /// Must be called before @c start
+            void setPlaceByIncomingCpu(bool on) { placeByIncomingCpu_ = on; }
+
             /// valid after calling start()
             std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
 
@@ -89,6 +118,15 @@ namespace muduo {
             /// Not thread safe, but in loop
             void newConnection(int sockfd, const InetAddress &peerAddr);
 
+            /// Not thread safe, but in loop
+            void newConnections(const std::vector<AcceptedConnection> &accepted);
+
+            /// Not thread safe, but in loop
+            TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+
+            /// Not thread safe, but in loop
+            EventLoop *selectLoop(int sockfd);
+
             /// Thread safe.
             void removeConnection(const TcpConnectionPtr &conn);
 
@@ -98,6 +136,7 @@ namespace muduo {
             typedef std::map<string, TcpConnectionPtr> ConnectionMap;
 
             EventLoop *loop_;  // the acceptor loop
+            const InetAddress listenAddr_;
             const string ipPort_;
             const string name_;
             std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor
@@ -107,6 +146,7 @@ namespace muduo {
             WriteCompleteCallback writeCompleteCallback_;
             ThreadInitCallback threadInitCallback_;
             AtomicInt32 started_;
+            bool placeByIncomingCpu_;
             // always in loop thread
             int nextConnId_;
             ConnectionMap connections_;
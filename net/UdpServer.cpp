@@ -0,0 +1,92 @@
+//
+// Created by chen on 2022/11/20.
+//
+
+#include "UdpServer.h"
+
+#include "../base/CountDownLatch.h"
+#include "../base/Logging.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            // UdpSocket的析构必须在它所属的loop线程中进行
+            void releaseUdpSocket(UdpSocketPtr *socket, CountDownLatch *latch) {
+                socket->reset();
+                latch->countDown();
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+UdpServer::UdpServer(EventLoop *loop,
+                     const InetAddress &listenAddr,
+                     const string &nameArg,
+                     Option option)
+        : loop_(CHECK_NOTNULL(loop)),
+          listenAddr_(listenAddr),
+          ipPort_(listenAddr.toIpPort()),
+          name_(nameArg),
+          option_(option),
+          threadPool_(new EventLoopThreadPool(loop, name_)),
+          maxDatagramSize_(UdpSocket::kDefaultDatagramSize) {
+}
+
+UdpServer::~UdpServer() {
+    loop_->assertInLoopThread();
+    LOG_TRACE << "UdpServer::~UdpServer [" << name_ << "] destructing";
+
+    for (UdpSocketPtr &socket: sockets_) {
+        EventLoop *ioLoop = socket->getLoop();
+        if (ioLoop == loop_) {
+            socket.reset();
+        } else {
+            CountDownLatch latch(1);
+            ioLoop->runInLoop(std::bind(&detail::releaseUdpSocket, &socket, &latch));
+            latch.wait();
+        }
+    }
+}
+
+void UdpServer::setThreadNum(int numThreads) {
+    assert(0 <= numThreads);
+    if (option_ != kReusePort && numThreads > 0) {
+        LOG_WARN << "UdpServer::setThreadNum [" << name_
+                 << "] - IO threads are useless without kReusePort";
+    }
+    threadPool_->setThreadNum(numThreads);
+}
+
+/*
+ *      创建UdpSocket：
+ *      kReusePort时每个IO loop一个socket，否则只在baseLoop创建一个
+ */
+void UdpServer::start() {
+    if (started_.getAndSet(1) == 0) {
+        loop_->assertInLoopThread();
+        threadPool_->start(threadInitCallback_);
+
+        std::vector<EventLoop *> loops;
+        if (option_ == kReusePort) {
+            loops = threadPool_->getAllLoops();
+        } else {
+            loops.push_back(loop_);
+        }
+
+        for (EventLoop *ioLoop: loops) {
+            UdpSocketPtr socket(new UdpSocket(ioLoop, listenAddr_, option_ == kReusePort, maxDatagramSize_));
+            socket->setMessageCallback(messageCallback_);
+            sockets_.push_back(socket);
+            socket->start();
+        }
+        LOG_INFO << "UdpServer::start [" << name_ << "] - listening on " << ipPort_
+                 << " with " << sockets_.size() << " socket(s)";
+    }
+}
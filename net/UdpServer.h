@@ -0,0 +1,94 @@
+//
+// Created by chen on 2022/11/20.
+//
+
+/*
+ *      UdpServer
+ *
+ *      1. kNoReusePort：只有一个UdpSocket，绑定在baseLoop上
+ *      2. kReusePort：每个IO loop各自创建一个设置了SO_REUSEPORT的UdpSocket并绑定同一个地址，
+ *         由内核按四元组hash把datagram分发到不同的socket（也就是不同的loop），实现多线程接收
+ */
+
+#ifndef MYMUDUO_UDPSERVER_H
+#define MYMUDUO_UDPSERVER_H
+
+#include "../base/Atomic.h"
+#include "../base/Types.h"
+#include "UdpSocket.h"
+
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class EventLoop;
+
+        class EventLoopThreadPool;
+
+        ///
+        /// UDP server, supports single socket and SO_REUSEPORT sharding across a thread pool.
+        ///
+        class UdpServer : noncopyable {
+        public:
+            typedef std::function<void(EventLoop *)> ThreadInitCallback;
+            enum Option {
+                kNoReusePort,
+                kReusePort,
+            };
+
+            UdpServer(EventLoop *loop,
+                      const InetAddress &listenAddr,
+                      const string &nameArg,
+                      Option option = kNoReusePort);
+
+            ~UdpServer();  // force out-line dtor, for std::unique_ptr members.
+
+            const string &ipPort() const { return ipPort_; }
+
+            const string &name() const { return name_; }
+
+            EventLoop *getLoop() const { return loop_; }
+
+            /// Set the number of IO threads.
+            /// Only meaningful with kReusePort, otherwise all datagrams are received in loop's thread.
+            /// Must be called before @c start
+            void setThreadNum(int numThreads);
+
+            void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+
+            /// Must be called before @c start
+            void setMaxDatagramSize(size_t size) { maxDatagramSize_ = size; }
+
+            /// valid after calling start()
+            std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
+
+            /// valid after calling start()
+            const std::vector<UdpSocketPtr> &sockets() const { return sockets_; }
+
+            /// Starts the server, harmless to call it multiple times.
+            /// Must be called in loop's thread.
+            void start();
+
+            /// Set message callback, it's called in the loop which received the datagram.
+            /// Not thread safe.
+            void setMessageCallback(const UdpSocket::MessageCallback &cb) { messageCallback_ = cb; }
+
+        private:
+            EventLoop *loop_;  // the base loop
+            const InetAddress listenAddr_;
+            const string ipPort_;
+            const string name_;
+            const Option option_;
+            std::shared_ptr<EventLoopThreadPool> threadPool_;
+            UdpSocket::MessageCallback messageCallback_;
+            ThreadInitCallback threadInitCallback_;
+            size_t maxDatagramSize_;
+            AtomicInt32 started_;
+            std::vector<UdpSocketPtr> sockets_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_UDPSERVER_H
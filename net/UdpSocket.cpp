@@ -0,0 +1,275 @@
+//
+// Created by chen on 2022/11/20.
+//
+
+#include "UdpSocket.h"
+
+#include "../base/Logging.h"
+#include "EventLoop.h"
+#include "SocketsOps.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int UdpSocket::kMaxBatch;
+const size_t UdpSocket::kDefaultDatagramSize;
+
+/*
+ *      预先分配好的datagram arena
+ *
+ *      slot i 的数据在 arena[i * slotSize, (i + 1) * slotSize)，
+ *      msgs[i] 通过 iovecs[i] 指向它，对端地址存放在 addrs[i]。
+ *      这些指针关系在构造时就建立好了，收发的时候只需要填长度。
+ */
+struct UdpSocket::DatagramBatch {
+    explicit DatagramBatch(size_t size)
+            : slotSize(size),
+              arena(size * kMaxBatch),
+              msgs(kMaxBatch),
+              iovecs(kMaxBatch),
+              addrs(kMaxBatch) {
+        for (int i = 0; i < kMaxBatch; ++i) {
+            iovecs[i].iov_base = slot(i);
+            iovecs[i].iov_len = slotSize;
+            memZero(&msgs[i], sizeof msgs[i]);
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(sizeof addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    char *slot(int i) { return &arena[i * slotSize]; }
+
+    // 把slot from的内容（数据、长度、地址）移动到slot to
+    void moveSlot(int from, int to) {
+        memcpy(slot(to), slot(from), iovecs[from].iov_len);
+        iovecs[to].iov_len = iovecs[from].iov_len;
+        addrs[to] = addrs[from];
+        msgs[to].msg_hdr.msg_namelen = msgs[from].msg_hdr.msg_namelen;
+    }
+
+    const size_t slotSize;
+    std::vector<char> arena;
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec> iovecs;
+    std::vector<struct sockaddr_in6> addrs;     // sockaddr_in6 足够放下 sockaddr_in
+};
+
+UdpSocket::UdpSocket(EventLoop *loop,
+                     const InetAddress &bindAddr,
+                     bool reuseport,
+                     size_t maxDatagramSize)
+        : loop_(CHECK_NOTNULL(loop)),
+          socket_(sockets::createUdpNonblockingOrDie(bindAddr.family())),
+          channel_(loop, socket_.fd()),
+          maxDatagramSize_(maxDatagramSize),
+          recvBatch_(new DatagramBatch(maxDatagramSize)),
+          sendBatch_(new DatagramBatch(maxDatagramSize)),
+          sendHead_(0),
+          sendTail_(0),
+          flushQueued_(false),
+          truncatedDatagrams_(0),
+          droppedDatagrams_(0) {
+    socket_.setReuseAddr(true);
+    socket_.setReusePort(reuseport);
+    socket_.bindAddress(bindAddr);
+    channel_.setReadCallback(
+            std::bind(&UdpSocket::handleRead, this, _1));
+    channel_.setWriteCallback(
+            std::bind(&UdpSocket::handleWrite, this));
+}
+
+UdpSocket::~UdpSocket() {
+    loop_->assertInLoopThread();
+    flushInLoop();
+    channel_.disableAll();
+    channel_.remove();
+}
+
+void UdpSocket::start() {
+    loop_->runInLoop(std::bind(&UdpSocket::startInLoop, shared_from_this()));
+}
+
+void UdpSocket::startInLoop() {
+    loop_->assertInLoopThread();
+    if (!channel_.isReading()) {
+        channel_.tie(shared_from_this());
+        channel_.enableReading();
+    }
+}
+
+/*
+ *      一次可读事件里反复调用recvmmsg()，直到EAGAIN或者收到的datagram不足一个batch。
+ *      为了不饿死同一个loop上的其它Channel，最多收 kMaxReadRounds 个batch。
+ */
+void UdpSocket::handleRead(Timestamp receiveTime) {
+    loop_->assertInLoopThread();
+    const int kMaxReadRounds = 16;
+    DatagramBatch &batch = *recvBatch_;
+    for (int round = 0; round < kMaxReadRounds; ++round) {
+        for (int i = 0; i < kMaxBatch; ++i) {
+            // recvmmsg() 会改写namelen，每次都要复位
+            batch.msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(sizeof batch.addrs[i]);
+            batch.msgs[i].msg_hdr.msg_flags = 0;
+        }
+
+        int n = sockets::recvmmsg(channel_.fd(), batch.msgs.data(), kMaxBatch);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_SYSERR << "UdpSocket::handleRead";
+            }
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (batch.msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                ++truncatedDatagrams_;
+            }
+            if (messageCallback_) {
+                InetAddress peerAddr(batch.addrs[i]);
+                messageCallback_(this, batch.slot(i), batch.msgs[i].msg_len, peerAddr, receiveTime);
+            }
+        }
+
+        if (n < kMaxBatch) {
+            break;
+        }
+    }
+}
+
+void UdpSocket::send(const StringPiece &message, const InetAddress &peerAddr) {
+    send(message.data(), message.size(), peerAddr);
+}
+
+/*
+ *      send() --> sendInLoop()
+ */
+void UdpSocket::send(const void *data, size_t len, const InetAddress &peerAddr) {
+    if (loop_->isInLoopThread()) {
+        sendInLoop(data, len, peerAddr);
+    } else {
+        loop_->runInLoop(
+                std::bind(&UdpSocket::sendStringInLoop,
+                          shared_from_this(),
+                          string(static_cast<const char *>(data), len),
+                          peerAddr));
+    }
+}
+
+void UdpSocket::sendStringInLoop(const string &message, const InetAddress &peerAddr) {
+    sendInLoop(message.data(), message.size(), peerAddr);
+}
+
+/*
+ *      把datagram放入发送batch
+ *
+ *      1. 超过slot大小的datagram无法放入batch，先把batch发出去保证顺序，然后直接sendto()
+ *      2. batch满了立即flush
+ *      3. 否则通过queueInLoop()安排在本轮迭代末尾flush，这样同一轮迭代中的send()合并成一次sendmmsg()
+ */
+void UdpSocket::sendInLoop(const void *data, size_t len, const InetAddress &peerAddr) {
+    loop_->assertInLoopThread();
+    if (len > maxDatagramSize_) {
+        flushInLoop();
+        if (sendHead_ != sendTail_ ||
+            sockets::sendto(channel_.fd(), data, len, peerAddr.getSockAddr()) < 0) {
+            LOG_SYSERR << "UdpSocket::sendInLoop - drop " << len << " bytes to " << peerAddr.toIpPort();
+            ++droppedDatagrams_;
+        }
+        return;
+    }
+
+    DatagramBatch &batch = *sendBatch_;
+    if (sendTail_ == kMaxBatch && sendHead_ > 0) {
+        // 发送缓冲区曾经满过，把没发出去的datagram挪到batch前面
+        for (int i = sendHead_; i < sendTail_; ++i) {
+            batch.moveSlot(i, i - sendHead_);
+        }
+        sendTail_ -= sendHead_;
+        sendHead_ = 0;
+    }
+    if (sendTail_ == kMaxBatch) {
+        // 正在等待可写事件且batch已满，UDP本身不可靠，直接丢弃
+        ++droppedDatagrams_;
+        return;
+    }
+
+    int i = sendTail_++;
+    memcpy(batch.slot(i), data, len);
+    batch.iovecs[i].iov_len = len;
+    const struct sockaddr *addr = peerAddr.getSockAddr();
+    socklen_t addrlen = static_cast<socklen_t>(addr->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6)
+                                                                          : sizeof(struct sockaddr_in));
+    memcpy(&batch.addrs[i], addr, addrlen);
+    batch.msgs[i].msg_hdr.msg_namelen = addrlen;
+
+    if (channel_.isWriting()) {
+        return;     // 等handleWrite()发送
+    }
+    if (sendTail_ == kMaxBatch) {
+        flushInLoop();
+    } else if (!flushQueued_) {
+        flushQueued_ = true;
+        loop_->queueInLoop(std::bind(&UdpSocket::flushPending, shared_from_this()));
+    }
+}
+
+void UdpSocket::flush() {
+    if (loop_->isInLoopThread()) {
+        flushInLoop();
+    } else {
+        loop_->runInLoop(std::bind(&UdpSocket::flushInLoop, shared_from_this()));
+    }
+}
+
+// sendInLoop()安排在本轮迭代末尾的flush
+void UdpSocket::flushPending() {
+    flushQueued_ = false;
+    flushInLoop();
+}
+
+/*
+ *      用sendmmsg()发送 [sendHead_, sendTail_) 中的datagram
+ *
+ *      1. EAGAIN：发送缓冲区满，剩下的datagram留在batch中，监听可写事件
+ *      2. 其它错误（例如之前的datagram引起的ECONNREFUSED）只影响当前这一个datagram，丢弃它后继续发送
+ */
+void UdpSocket::flushInLoop() {
+    loop_->assertInLoopThread();
+    DatagramBatch &batch = *sendBatch_;
+    while (sendHead_ < sendTail_) {
+        int n = sockets::sendmmsg(channel_.fd(),
+                                  &batch.msgs[sendHead_],
+                                  static_cast<unsigned int>(sendTail_ - sendHead_));
+        if (n > 0) {
+            sendHead_ += n;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (!channel_.isWriting()) {
+                channel_.enableWriting();
+            }
+            return;
+        } else if (errno != EINTR) {
+            LOG_SYSERR << "UdpSocket::flushInLoop";
+            ++droppedDatagrams_;
+            ++sendHead_;
+        }
+    }
+
+    sendHead_ = 0;
+    sendTail_ = 0;
+    if (channel_.isWriting()) {
+        channel_.disableWriting();
+    }
+}
+
+void UdpSocket::handleWrite() {
+    loop_->assertInLoopThread();
+    flushInLoop();
+}
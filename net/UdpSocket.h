@@ -0,0 +1,121 @@
+//
+// Created by chen on 2022/11/20.
+//
+
+/*
+ *      UdpSocket
+ *      绑定在某个EventLoop上的UDP socket，用Channel监听可读/可写事件。
+ *
+ *      1. 读：可读时用recvmmsg()一次收取多个datagram，datagram直接落在预先分配好的arena里面（不需要每次都申请内存），
+ *         然后逐个调用messageCallback_。
+ *      2. 写：send()并不立即发送，而是先把datagram拷贝到发送batch里，
+ *         在本轮loop迭代的末尾（doPendingFunctors()）用一次sendmmsg()把batch发出去。
+ *         batch满了也会立即发送。
+ *
+ *      UDP是不可靠的，所以发送缓冲区满（EAGAIN）且batch也满的时候直接丢弃新的datagram，并计数。
+ */
+
+#ifndef MYMUDUO_UDPSOCKET_H
+#define MYMUDUO_UDPSOCKET_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "../base/Timestamp.h"
+#include "Channel.h"
+#include "InetAddress.h"
+#include "Socket.h"
+
+#include <functional>
+#include <memory>
+
+namespace muduo {
+    namespace net {
+
+        class EventLoop;
+
+        ///
+        /// UDP socket driven by a Channel, with batched recvmmsg/sendmmsg.
+        ///
+        /// Managed by shared_ptr, the last reference must be released in the loop thread.
+        class UdpSocket : noncopyable,
+                          public std::enable_shared_from_this<UdpSocket> {
+        public:
+            typedef std::function<void(UdpSocket *,
+                                       const char *data,
+                                       size_t len,
+                                       const InetAddress &peerAddr,
+                                       Timestamp receiveTime)> MessageCallback;
+
+            static const int kMaxBatch = 64;                    // 一次recvmmsg/sendmmsg最多处理的datagram个数
+            static const size_t kDefaultDatagramSize = 2048;    // arena中每个slot的大小，超过的datagram会被截断(MSG_TRUNC)
+
+            UdpSocket(EventLoop *loop,
+                      const InetAddress &bindAddr,
+                      bool reuseport,
+                      size_t maxDatagramSize = kDefaultDatagramSize);
+
+            ~UdpSocket();
+
+            void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+
+            /// Starts reading, can be called in any thread.
+            void start();
+
+            /// Queues a datagram into the per-iteration send batch.
+            /// Thread safe.
+            void send(const void *data, size_t len, const InetAddress &peerAddr);
+
+            void send(const StringPiece &message, const InetAddress &peerAddr);
+
+            /// Sends out the pending batch right now.
+            /// Thread safe, runs in the loop thread (later) if called from another thread.
+            void flush();
+
+            EventLoop *getLoop() const { return loop_; }
+
+            int fd() const { return socket_.fd(); }
+
+            size_t maxDatagramSize() const { return maxDatagramSize_; }
+
+            // 统计信息，只在loop线程读取是准确的
+            int64_t truncatedDatagrams() const { return truncatedDatagrams_; }
+
+            int64_t droppedDatagrams() const { return droppedDatagrams_; }
+
+        private:
+            struct DatagramBatch;   // 见UdpSocket.cpp
+
+            void startInLoop();
+
+            void handleRead(Timestamp receiveTime);
+
+            void handleWrite();
+
+            void sendInLoop(const void *data, size_t len, const InetAddress &peerAddr);
+
+            void sendStringInLoop(const string &message, const InetAddress &peerAddr);
+
+            void flushPending();
+
+            void flushInLoop();
+
+            EventLoop *loop_;
+            Socket socket_;
+            Channel channel_;
+            const size_t maxDatagramSize_;
+            MessageCallback messageCallback_;
+            std::unique_ptr<DatagramBatch> recvBatch_;
+            std::unique_ptr<DatagramBatch> sendBatch_;
+            int sendHead_;              // sendBatch_中 [sendHead_, sendTail_) 是待发送的datagram
+            int sendTail_;
+            bool flushQueued_;          // 是否已经通过queueInLoop()安排了本轮迭代的flush
+            int64_t truncatedDatagrams_;
+            int64_t droppedDatagrams_;
+        };
+
+        typedef std::shared_ptr<UdpSocket> UdpSocketPtr;
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_UDPSOCKET_H
@@ -0,0 +1,294 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+#include "HttpContext.h"
+
+#include "../Buffer.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t HttpContext::kMaxHeaderSize;
+const size_t HttpContext::kMaxBodySize;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            bool equalsIgnoreCase(const char *s, size_t len, const char *lower) {
+                return len == ::strlen(lower) && ::strncasecmp(s, lower, len) == 0;
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+void HttpContext::reset() {
+    state_ = kExpectRequestLine;
+    scanned_ = 0;
+    headers_.clear();
+    bodyBegin_ = 0;
+    bodyLength_ = 0;
+    requestLength_ = 0;
+    chunked_ = false;
+    request_.reset();
+}
+
+/*
+ *      请求行：  METHOD SP path[?query] SP HTTP/1.x
+ */
+bool HttpContext::processRequestLine(const char *base, const char *begin, const char *end) {
+    const char *space = std::find(begin, end, ' ');
+    if (space == end || !request_.setMethod(StringPiece(begin, static_cast<int>(space - begin)))) {
+        return false;
+    }
+    const char *start = space + 1;
+    space = std::find(start, end, ' ');
+    if (space == end || start == space) {
+        return false;
+    }
+    const char *question = std::find(start, space, '?');
+    path_.offset = static_cast<uint32_t>(start - base);
+    path_.length = static_cast<uint32_t>(question - start);
+    if (question != space) {
+        query_.offset = static_cast<uint32_t>(question + 1 - base);
+        query_.length = static_cast<uint32_t>(space - question - 1);
+    } else {
+        query_.offset = query_.length = 0;
+    }
+
+    start = space + 1;
+    if (end - start != 8 || !std::equal(start, end - 1, "HTTP/1.")) {
+        return false;
+    }
+    if (*(end - 1) == '1') {
+        request_.setVersion(HttpRequest::kHttp11);
+    } else if (*(end - 1) == '0') {
+        request_.setVersion(HttpRequest::kHttp10);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ *      field: value，去掉value前后的空白
+ */
+bool HttpContext::processHeader(const char *base, const char *begin, const char *end) {
+    const char *colon = std::find(begin, end, ':');
+    if (colon == end || colon == begin) {
+        return false;
+    }
+    const char *valueBegin = colon + 1;
+    while (valueBegin < end && (*valueBegin == ' ' || *valueBegin == '\t')) {
+        ++valueBegin;
+    }
+    const char *valueEnd = end;
+    while (valueEnd > valueBegin && (*(valueEnd - 1) == ' ' || *(valueEnd - 1) == '\t')) {
+        --valueEnd;
+    }
+    Range field = {static_cast<uint32_t>(begin - base), static_cast<uint32_t>(colon - begin)};
+    Range value = {static_cast<uint32_t>(valueBegin - base), static_cast<uint32_t>(valueEnd - valueBegin)};
+    headers_.push_back(std::make_pair(field, value));
+    return true;
+}
+
+/*
+ *      header结束，根据Transfer-Encoding和Content-Length决定怎样读body
+ *
+ *      body长度有歧义的请求一律拒绝（RFC 7230 3.3.3），否则前面的代理和这里可能对请求边界有不同的理解（request smuggling）：
+ *      1. 多个Content-Length，即使值相同
+ *      2. Transfer-Encoding和Content-Length同时出现
+ */
+bool HttpContext::processHeadersEnd(const char *base) {
+    bool hasLength = false;
+    size_t length = 0;
+    for (const auto &h : headers_) {
+        const char *field = base + h.first.offset;
+        StringPiece value(base + h.second.offset, static_cast<int>(h.second.length));
+        if (detail::equalsIgnoreCase(field, h.first.length, "transfer-encoding")) {
+            // 只支持chunked，它总是最后一个编码
+            if (value.size() >= 7 &&
+                ::strncasecmp(value.end() - 7, "chunked", 7) == 0) {
+                chunked_ = true;
+            } else {
+                return false;
+            }
+        } else if (detail::equalsIgnoreCase(field, h.first.length, "content-length")) {
+            if (value.empty() || hasLength) {
+                return false;
+            }
+            length = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9' || length > kMaxBodySize) {
+                    return false;
+                }
+                length = length * 10 + static_cast<size_t>(c - '0');
+            }
+            hasLength = true;
+        }
+    }
+
+    if (chunked_ && hasLength) {
+        return false;
+    }
+    if (chunked_) {
+        state_ = kExpectChunkSize;
+    } else if (hasLength && length > 0) {
+        if (length > kMaxBodySize) {
+            return false;
+        }
+        bodyBegin_ = scanned_;
+        bodyLength_ = length;
+        state_ = kExpectBody;
+    } else {
+        finish(base);
+    }
+    return true;
+}
+
+/*
+ *      请求完整了，把偏移量转换成HttpRequest中的StringPiece
+ */
+void HttpContext::finish(const char *base) {
+    state_ = kGotAll;
+    requestLength_ = scanned_;
+    request_.setPath(StringPiece(base + path_.offset, static_cast<int>(path_.length)));
+    request_.setQuery(StringPiece(base + query_.offset, static_cast<int>(query_.length)));
+    for (const auto &h : headers_) {
+        request_.addHeader(StringPiece(base + h.first.offset, static_cast<int>(h.first.length)),
+                           StringPiece(base + h.second.offset, static_cast<int>(h.second.length)));
+    }
+    if (chunked_) {
+        request_.setBody(*request_.mutableBodyStorage());
+    } else {
+        request_.setBody(StringPiece(base + bodyBegin_, static_cast<int>(bodyLength_)));
+    }
+}
+
+HttpContext::ParseResult HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime) {
+    const char *base = buf->peek();
+    const size_t readable = buf->readableBytes();
+    bool hasMore = true;
+    while (hasMore) {
+        const char *crlf = NULL;
+        switch (state_) {
+            case kExpectRequestLine:
+                crlf = buf->findCRLF(base + scanned_);
+                if (crlf) {
+                    if (!processRequestLine(base, base + scanned_, crlf)) {
+                        return kError;
+                    }
+                    request_.setReceiveTime(receiveTime);
+                    scanned_ = static_cast<size_t>(crlf + 2 - base);
+                    state_ = kExpectHeaders;
+                } else {
+                    hasMore = false;
+                }
+                break;
+
+            case kExpectHeaders:
+                crlf = buf->findCRLF(base + scanned_);
+                if (!crlf) {
+                    hasMore = false;
+                } else if (crlf == base + scanned_) {
+                    scanned_ += 2;
+                    if (!processHeadersEnd(base)) {
+                        return kError;
+                    }
+                } else {
+                    if (!processHeader(base, base + scanned_, crlf)) {
+                        return kError;
+                    }
+                    scanned_ = static_cast<size_t>(crlf + 2 - base);
+                }
+                break;
+
+            case kExpectBody:
+                if (readable >= bodyBegin_ + bodyLength_) {
+                    scanned_ = bodyBegin_ + bodyLength_;
+                    finish(base);
+                } else {
+                    hasMore = false;
+                }
+                break;
+
+            case kExpectChunkSize:
+                crlf = buf->findCRLF(base + scanned_);
+                if (crlf) {
+                    // chunk-size [;chunk-ext] CRLF
+                    size_t size = 0;
+                    const char *p = base + scanned_;
+                    const char *sizeEnd = std::find(p, crlf, ';');
+                    if (p == sizeEnd) {
+                        return kError;
+                    }
+                    for (; p < sizeEnd; ++p) {
+                        int digit = isxdigit(*p) ? (isdigit(*p) ? *p - '0' : (*p | 0x20) - 'a' + 10) : -1;
+                        if (digit < 0 || size > kMaxBodySize) {
+                            return kError;
+                        }
+                        size = size * 16 + static_cast<size_t>(digit);
+                    }
+                    if (request_.mutableBodyStorage()->size() + size > kMaxBodySize) {
+                        return kError;
+                    }
+                    scanned_ = static_cast<size_t>(crlf + 2 - base);
+                    if (size == 0) {
+                        state_ = kExpectTrailers;
+                    } else {
+                        bodyBegin_ = scanned_;
+                        bodyLength_ = size;
+                        state_ = kExpectChunkData;
+                    }
+                } else {
+                    hasMore = false;
+                }
+                break;
+
+            case kExpectChunkData:
+                if (readable >= bodyBegin_ + bodyLength_ + 2) {
+                    const char *data = base + bodyBegin_;
+                    if (data[bodyLength_] != '\r' || data[bodyLength_ + 1] != '\n') {
+                        return kError;
+                    }
+                    request_.mutableBodyStorage()->append(data, bodyLength_);
+                    scanned_ = bodyBegin_ + bodyLength_ + 2;
+                    state_ = kExpectChunkSize;
+                } else {
+                    hasMore = false;
+                }
+                break;
+
+            case kExpectTrailers:
+                crlf = buf->findCRLF(base + scanned_);
+                if (!crlf) {
+                    hasMore = false;
+                } else if (crlf == base + scanned_) {
+                    scanned_ += 2;
+                    finish(base);
+                } else {
+                    scanned_ = static_cast<size_t>(crlf + 2 - base);      // 忽略trailer
+                }
+                break;
+
+            case kGotAll:
+                hasMore = false;
+                break;
+        }
+    }
+
+    if (state_ == kGotAll) {
+        return kComplete;
+    }
+    if ((state_ == kExpectRequestLine || state_ == kExpectHeaders) && readable > kMaxHeaderSize) {
+        return kError;
+    }
+    return kIncomplete;
+}
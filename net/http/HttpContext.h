@@ -0,0 +1,97 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+/*
+ *      HttpContext：每个连接一个的增量式HTTP请求解析器
+ *
+ *      1. 数据不完整时记住已经扫描到的位置，下次从那里继续找\r\n，不会从头重新扫描。
+ *      2. 请求完整之前，各个字段以相对于buf->peek()的偏移量保存：Buffer扩容时会搬移数据，指针会失效，偏移量不会。
+ *         请求完整后再一次性转换成HttpRequest中的StringPiece。
+ *      3. 支持Content-Length和chunked两种body。
+ *      4. parseRequest()不retrieve()，由调用者处理完请求后retrieve(requestLength())并reset()，
+ *         这样同一个Buffer中后面的流水线请求可以接着解析。
+ */
+
+#ifndef MYMUDUO_HTTPCONTEXT_H
+#define MYMUDUO_HTTPCONTEXT_H
+
+#include "HttpRequest.h"
+
+namespace muduo {
+    namespace net {
+
+        class Buffer;
+
+        class HttpContext : public muduo::copyable {
+        public:
+            enum ParseResult {
+                kIncomplete, kComplete, kError
+            };
+
+            static const size_t kMaxHeaderSize = 64 * 1024;
+            static const size_t kMaxBodySize = 64 * 1024 * 1024;
+
+            HttpContext()
+                    : state_(kExpectRequestLine),
+                      scanned_(0),
+                      bodyBegin_(0),
+                      bodyLength_(0),
+                      requestLength_(0),
+                      chunked_(false) {
+            }
+
+            /// Parses the request at the front of buf, doesn't retrieve from buf.
+            ParseResult parseRequest(Buffer *buf, Timestamp receiveTime);
+
+            bool gotAll() const { return state_ == kGotAll; }
+
+            /// Valid after kComplete, until buf is modified.
+            const HttpRequest &request() const { return request_; }
+
+            /// Bytes of the complete request, including its body.
+            size_t requestLength() const { return requestLength_; }
+
+            void reset();
+
+        private:
+            enum HttpRequestParseState {
+                kExpectRequestLine,
+                kExpectHeaders,
+                kExpectBody,
+                kExpectChunkSize,
+                kExpectChunkData,
+                kExpectTrailers,
+                kGotAll,
+            };
+
+            struct Range {
+                uint32_t offset;        // 相对于buf->peek()
+                uint32_t length;
+            };
+
+            bool processRequestLine(const char *base, const char *begin, const char *end);
+
+            bool processHeader(const char *base, const char *begin, const char *end);
+
+            bool processHeadersEnd(const char *base);
+
+            void finish(const char *base);
+
+            HttpRequestParseState state_;
+            size_t scanned_;                // 下一次从这里开始解析
+            Range method_;
+            Range path_;
+            Range query_;
+            std::vector<std::pair<Range, Range>> headers_;
+            size_t bodyBegin_;
+            size_t bodyLength_;             // Content-Length，或当前chunk的长度
+            size_t requestLength_;
+            bool chunked_;
+            HttpRequest request_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_HTTPCONTEXT_H
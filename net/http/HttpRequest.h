@@ -0,0 +1,159 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+/*
+ *      HttpRequest：解析好的HTTP请求
+ *
+ *      请求行、header和（非chunked的）body都是指向TcpConnection的inputBuffer的StringPiece，不拷贝。
+ *      所以HttpRequest只在HttpCallback执行期间有效，需要保留的内容由回调自己拷贝。
+ *      chunked编码的body要去掉分块的头，只能拷贝到bodyStorage_中。
+ */
+
+#ifndef MYMUDUO_HTTPREQUEST_H
+#define MYMUDUO_HTTPREQUEST_H
+
+#include "../../base/copyable.h"
+#include "../../base/StringPiece.h"
+#include "../../base/Timestamp.h"
+#include "../../base/Types.h"
+
+#include <assert.h>
+#include <strings.h>  // strncasecmp
+
+#include <utility>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class HttpRequest : public muduo::copyable {
+        public:
+            enum Method {
+                kInvalid, kGet, kPost, kHead, kPut, kDelete, kOptions
+            };
+            enum Version {
+                kUnknown, kHttp10, kHttp11
+            };
+
+            typedef std::pair<StringPiece, StringPiece> Header;
+
+            HttpRequest()
+                    : method_(kInvalid),
+                      version_(kUnknown) {
+            }
+
+            void setVersion(Version v) { version_ = v; }
+
+            Version getVersion() const { return version_; }
+
+            bool setMethod(const StringPiece &m) {
+                assert(method_ == kInvalid);
+                if (m == "GET") {
+                    method_ = kGet;
+                } else if (m == "POST") {
+                    method_ = kPost;
+                } else if (m == "HEAD") {
+                    method_ = kHead;
+                } else if (m == "PUT") {
+                    method_ = kPut;
+                } else if (m == "DELETE") {
+                    method_ = kDelete;
+                } else if (m == "OPTIONS") {
+                    method_ = kOptions;
+                } else {
+                    method_ = kInvalid;
+                }
+                return method_ != kInvalid;
+            }
+
+            Method method() const { return method_; }
+
+            const char *methodString() const {
+                const char *result = "UNKNOWN";
+                switch (method_) {
+                    case kGet:
+                        result = "GET";
+                        break;
+                    case kPost:
+                        result = "POST";
+                        break;
+                    case kHead:
+                        result = "HEAD";
+                        break;
+                    case kPut:
+                        result = "PUT";
+                        break;
+                    case kDelete:
+                        result = "DELETE";
+                        break;
+                    case kOptions:
+                        result = "OPTIONS";
+                        break;
+                    default:
+                        break;
+                }
+                return result;
+            }
+
+            void setPath(const StringPiece &path) { path_ = path; }
+
+            const StringPiece &path() const { return path_; }
+
+            void setQuery(const StringPiece &query) { query_ = query; }
+
+            const StringPiece &query() const { return query_; }
+
+            void setReceiveTime(Timestamp t) { receiveTime_ = t; }
+
+            Timestamp receiveTime() const { return receiveTime_; }
+
+            void addHeader(const StringPiece &field, const StringPiece &value) {
+                headers_.push_back(Header(field, value));
+            }
+
+            /// Field names are case-insensitive, returns an empty piece if absent.
+            StringPiece getHeader(const StringPiece &field) const {
+                for (const Header &h : headers_) {
+                    if (h.first.size() == field.size() &&
+                        ::strncasecmp(h.first.data(), field.data(), static_cast<size_t>(field.size())) == 0) {
+                        return h.second;
+                    }
+                }
+                return StringPiece();
+            }
+
+            const std::vector<Header> &headers() const { return headers_; }
+
+            void setBody(const StringPiece &body) { body_ = body; }
+
+            const StringPiece &body() const { return body_; }
+
+            /// For the decoded chunked body.
+            string *mutableBodyStorage() { return &bodyStorage_; }
+
+            void reset() {
+                method_ = kInvalid;
+                version_ = kUnknown;
+                path_.clear();
+                query_.clear();
+                headers_.clear();       // 保留capacity，下一个请求复用
+                body_.clear();
+                bodyStorage_.clear();
+            }
+
+        private:
+            Method method_;
+            Version version_;
+            StringPiece path_;
+            StringPiece query_;
+            Timestamp receiveTime_;
+            std::vector<Header> headers_;
+            StringPiece body_;
+            string bodyStorage_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_HTTPREQUEST_H
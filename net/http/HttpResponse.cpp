@@ -0,0 +1,99 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+#include "HttpResponse.h"
+
+#include "../Buffer.h"
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void HttpResponse::setStatusCode(HttpStatusCode code) {
+    statusCode_ = code;
+    switch (code) {
+        case k200Ok:
+            statusMessage_ = "OK";
+            break;
+        case k204NoContent:
+            statusMessage_ = "No Content";
+            break;
+        case k301MovedPermanently:
+            statusMessage_ = "Moved Permanently";
+            break;
+        case k304NotModified:
+            statusMessage_ = "Not Modified";
+            break;
+        case k400BadRequest:
+            statusMessage_ = "Bad Request";
+            break;
+        case k403Forbidden:
+            statusMessage_ = "Forbidden";
+            break;
+        case k404NotFound:
+            statusMessage_ = "Not Found";
+            break;
+        case k405MethodNotAllowed:
+            statusMessage_ = "Method Not Allowed";
+            break;
+        case k500InternalServerError:
+            statusMessage_ = "Internal Server Error";
+            break;
+        default:
+            statusMessage_.clear();
+            break;
+    }
+}
+
+/*
+ *      chunk = chunk-size(hex) CRLF chunk-data CRLF
+ */
+void HttpResponse::appendChunk(const StringPiece &data) {
+    if (data.empty()) {
+        return;         // 长度为0的chunk是结束标记
+    }
+    if (!chunked_) {
+        // 之前setBody()等设置的内容不再发送
+        clearBody();
+        chunked_ = true;
+    }
+    char buf[32];
+    snprintf(buf, sizeof buf, "%x\r\n", static_cast<unsigned>(data.size()));
+    body_.append(buf);
+    body_.append(data.data(), static_cast<size_t>(data.size()));
+    body_.append("\r\n");
+    bodyView_ = body_;
+}
+
+void HttpResponse::appendHeadersToBuffer(Buffer *output) const {
+    char buf[32];
+    snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
+    output->append(buf);
+    output->append(statusMessage_);
+    output->append("\r\n");
+
+    if (chunked_) {
+        output->append("Transfer-Encoding: chunked\r\n");
+    } else {
+        snprintf(buf, sizeof buf, "Content-Length: %zu\r\n",
+                 hasBodyFile() ? bodyFileLength_ : implicit_cast<size_t>(bodyView_.size()));
+        output->append(buf);
+    }
+    if (closeConnection_) {
+        output->append("Connection: close\r\n");
+    } else {
+        output->append("Connection: Keep-Alive\r\n");
+    }
+
+    for (const auto &header : headers_) {
+        output->append(header.first);
+        output->append(": ");
+        output->append(header.second);
+        output->append("\r\n");
+    }
+    output->append(rawHeaders_);
+
+    output->append("\r\n");
+}
@@ -0,0 +1,153 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+/*
+ *      HttpResponse：由HttpCallback填写，HttpServer负责编码和发送
+ *
+ *      1. body可以是拷贝进来的string（setBody），也可以是外部内存的StringPiece（setBodyView），
+ *         例如缓存中的文件内容，这时不需要拷贝。外部内存要保持有效直到HttpServer发送完应答，
+ *         可能被其它线程释放的内存（如共享的缓存），通过owner让应答持有一份引用。
+ *      2. 较大的body不拷贝进输出Buffer，而是和状态行、header一起用writev()发送，见HttpServer::onRequest()。
+ *      3. appendChunk()使用chunked编码，每次调用追加一个chunk，结束标记由HttpServer添加。
+ *      4. setBodyFile()：body是文件的一段，由HttpServer用sendfile()发送，不经过用户态。
+ *      5. addRawHeaders()追加预先编码好的header行（每行以CRLF结尾），例如缓存中的ETag、Content-Type。
+ */
+
+#ifndef MYMUDUO_HTTPRESPONSE_H
+#define MYMUDUO_HTTPRESPONSE_H
+
+#include "../../base/copyable.h"
+#include "../../base/StringPiece.h"
+#include "../../base/Types.h"
+
+#include <sys/types.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class Buffer;
+
+        class HttpResponse : public muduo::copyable {
+        public:
+            enum HttpStatusCode {
+                kUnknown,
+                k200Ok = 200,
+                k204NoContent = 204,
+                k301MovedPermanently = 301,
+                k304NotModified = 304,
+                k400BadRequest = 400,
+                k403Forbidden = 403,
+                k404NotFound = 404,
+                k405MethodNotAllowed = 405,
+                k500InternalServerError = 500,
+            };
+
+            /// The status defaults to 200 OK, so a callback that only sets the body still sends a valid status line.
+            explicit HttpResponse(bool close)
+                    : statusCode_(k200Ok),
+                      statusMessage_("OK"),
+                      closeConnection_(close),
+                      chunked_(false),
+                      bodyFd_(-1),
+                      bodyFileOffset_(0),
+                      bodyFileLength_(0) {
+            }
+
+            /// Also sets the standard status message, override it with setStatusMessage().
+            void setStatusCode(HttpStatusCode code);
+
+            HttpStatusCode statusCode() const { return statusCode_; }
+
+            void setStatusMessage(const string &message) { statusMessage_ = message; }
+
+            void setCloseConnection(bool on) { closeConnection_ = on; }
+
+            bool closeConnection() const { return closeConnection_; }
+
+            void setContentType(const string &contentType) { addHeader("Content-Type", contentType); }
+
+            // FIXME: replace string with StringPiece
+            void addHeader(const string &key, const string &value) { headers_.push_back(std::make_pair(key, value)); }
+
+            /// Appends pre-formatted header lines, each ending with CRLF.
+            void addRawHeaders(const StringPiece &lines) {
+                rawHeaders_.append(lines.data(), static_cast<size_t>(lines.size()));
+            }
+
+            void setBody(const string &body) {
+                clearBody();
+                body_ = body;
+                bodyView_ = body_;
+            }
+
+            /// body must stay valid until HttpServer has sent the response,
+            /// owner (if any) is held until then.
+            void setBodyView(const StringPiece &body, const std::shared_ptr<void> &owner = std::shared_ptr<void>()) {
+                clearBody();
+                bodyView_ = body;
+                bodyOwner_ = owner;
+            }
+
+            /// Sends length bytes of fd from offset with sendfile(2).
+            /// fd must stay open until HttpServer has sent the response, owner (if any) is held until then.
+            void setBodyFile(int fd, off_t offset, size_t length,
+                             const std::shared_ptr<void> &owner = std::shared_ptr<void>()) {
+                clearBody();
+                bodyFd_ = fd;
+                bodyFileOffset_ = offset;
+                bodyFileLength_ = length;
+                bodyOwner_ = owner;
+            }
+
+            /// Switches to chunked transfer encoding and appends one chunk,
+            /// a body set before is dropped.
+            void appendChunk(const StringPiece &data);
+
+            bool chunked() const { return chunked_; }
+
+            const StringPiece &body() const { return bodyView_; }
+
+            bool hasBodyFile() const { return bodyFd_ >= 0; }
+
+            int bodyFile() const { return bodyFd_; }
+
+            off_t bodyFileOffset() const { return bodyFileOffset_; }
+
+            size_t bodyFileLength() const { return bodyFileLength_; }
+
+            /// Appends the status line and headers.
+            void appendHeadersToBuffer(Buffer *output) const;
+
+        private:
+            void clearBody() {
+                chunked_ = false;
+                body_.clear();
+                bodyView_.clear();
+                bodyFd_ = -1;
+                bodyOwner_.reset();
+            }
+
+            HttpStatusCode statusCode_;
+            // FIXME: add http version
+            string statusMessage_;
+            bool closeConnection_;
+            bool chunked_;
+            std::vector<std::pair<string, string>> headers_;
+            string rawHeaders_;
+            string body_;
+            StringPiece bodyView_;      // 指向body_或外部内存
+            int bodyFd_;                // >= 0 表示body是文件的一段
+            off_t bodyFileOffset_;
+            size_t bodyFileLength_;
+            std::shared_ptr<void> bodyOwner_;   // 让外部内存或fd在发送之前保持有效
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_HTTPRESPONSE_H
@@ -0,0 +1,200 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+#include "HttpServer.h"
+
+#include "../../base/Logging.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "WebSocketContext.h"
+
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            bool equalsIgnoreCase(const StringPiece &s, const char *lower) {
+                return static_cast<size_t>(s.size()) == ::strlen(lower) &&
+                       ::strncasecmp(s.data(), lower, static_cast<size_t>(s.size())) == 0;
+            }
+
+            /*
+             *      Connection可以是逗号分隔的列表，例如 "keep-alive, Upgrade"
+             */
+            bool containsTokenIgnoreCase(const StringPiece &s, const char *lower) {
+                size_t len = ::strlen(lower);
+                const char *p = s.data();
+                const char *end = s.data() + s.size();
+                while (p < end) {
+                    while (p < end && (*p == ' ' || *p == ',')) {
+                        ++p;
+                    }
+                    const char *start = p;
+                    while (p < end && *p != ',') {
+                        ++p;
+                    }
+                    const char *tokenEnd = p;
+                    while (tokenEnd > start && tokenEnd[-1] == ' ') {
+                        --tokenEnd;
+                    }
+                    if (static_cast<size_t>(tokenEnd - start) == len && ::strncasecmp(start, lower, len) == 0) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void defaultHttpCallback(const HttpRequest &, HttpResponse *resp) {
+                resp->setStatusCode(HttpResponse::k404NotFound);
+                resp->setCloseConnection(true);
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const string &name,
+                       TcpServer::Option option)
+        : server_(loop, listenAddr, name, option),
+          httpCallback_(detail::defaultHttpCallback),
+          webSocketMaxMessageSize_(WebSocketContext::kDefaultMaxMessageSize) {
+    server_.setConnectionCallback(
+            std::bind(&HttpServer::onConnection, this, _1));
+    server_.setMessageCallback(
+            std::bind(&HttpServer::onMessage, this, _1, _2, _3));
+}
+
+void HttpServer::start() {
+    LOG_WARN << "HttpServer[" << server_.name()
+             << "] starts listening on " << server_.ipPort();
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        conn->setContext(HttpContext());
+    }
+}
+
+/*
+ *      解析出一个请求就处理一个，直到剩下的数据不够一个完整的请求。
+ *      请求中的StringPiece指向buf，所以处理完才retrieve()
+ */
+void HttpServer::onMessage(const TcpConnectionPtr &conn,
+                           Buffer *buf,
+                           Timestamp receiveTime) {
+    WebSocketContext *webSocket = boost::any_cast<WebSocketContext>(conn->getMutableContext());
+    if (webSocket) {
+        webSocket->onMessage(conn, buf, webSocketCallback_);
+        return;
+    }
+
+    HttpContext *context = boost::any_cast<HttpContext>(conn->getMutableContext());
+    Buffer output;
+    bool keepAlive = true;
+    bool upgraded = false;
+    bool accepted = false;
+    while (keepAlive) {
+        HttpContext::ParseResult result = context->parseRequest(buf, receiveTime);
+        if (result == HttpContext::kIncomplete) {
+            break;
+        }
+        if (result == HttpContext::kError) {
+            output.append("HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+            buf->retrieveAll();
+            keepAlive = false;
+            break;
+        }
+        const HttpRequest &req = context->request();
+        if (webSocketCallback_ && detail::equalsIgnoreCase(req.getHeader("Upgrade"), "websocket")) {
+            upgraded = onUpgrade(conn, req, &output, &accepted);
+            keepAlive = upgraded;
+            buf->retrieve(context->requestLength());
+            break;
+        }
+        keepAlive = onRequest(conn, req, &output);
+        buf->retrieve(context->requestLength());
+        context->reset();
+    }
+
+    if (upgraded) {
+        // 握手应答已经发出，context换成WebSocketContext之后HttpContext和其中的请求不再可用
+        conn->setContext(WebSocketContext(webSocketMaxMessageSize_));
+        webSocket = boost::any_cast<WebSocketContext>(conn->getMutableContext());
+        if (!accepted) {
+            webSocket->close(conn, WebSocketContext::kPolicyViolation);
+        }
+        webSocket->onMessage(conn, buf, webSocketCallback_);
+        return;
+    }
+
+    if (output.readableBytes() > 0) {
+        conn->send(&output);
+    }
+    if (!keepAlive) {
+        buf->retrieveAll();     // 关闭之后的流水线请求不再处理
+        conn->shutdown();
+    }
+}
+
+bool HttpServer::onRequest(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output) {
+    StringPiece connection = req.getHeader("Connection");
+    bool close = detail::equalsIgnoreCase(connection, "close") ||
+                 (req.getVersion() == HttpRequest::kHttp10 && !detail::equalsIgnoreCase(connection, "keep-alive"));
+    HttpResponse response(close);
+    httpCallback_(req, &response);
+
+    response.appendHeadersToBuffer(output);
+    if (req.method() != HttpRequest::kHead) {
+        const StringPiece &body = response.body();
+        if (response.hasBodyFile()) {
+            // 前面攒下的数据先发出去，文件排在它们后面
+            conn->send(output);
+            conn->sendFile(response.bodyFile(), response.bodyFileOffset(), response.bodyFileLength());
+        } else if (body.size() >= kGatherThreshold) {
+            conn->send(output->toStringPiece(), body);
+            output->retrieveAll();
+        } else {
+            output->append(body);
+        }
+        if (response.chunked()) {
+            output->append("0\r\n\r\n");
+        }
+    }
+    return !response.closeConnection();
+}
+
+/*
+ *      RFC 6455 4.2：GET，Connection包含Upgrade，Sec-WebSocket-Version: 13，有Sec-WebSocket-Key。
+ *      握手失败回复400并关闭连接
+ */
+bool HttpServer::onUpgrade(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output, bool *accepted) {
+    StringPiece key = req.getHeader("Sec-WebSocket-Key");
+    if (req.method() != HttpRequest::kGet ||
+        !detail::containsTokenIgnoreCase(req.getHeader("Connection"), "upgrade") ||
+        req.getHeader("Sec-WebSocket-Version") != "13" ||
+        key.empty()) {
+        output->append("HTTP/1.1 400 Bad Request\r\nSec-WebSocket-Version: 13\r\n"
+                       "Connection: close\r\nContent-Length: 0\r\n\r\n");
+        return false;
+    }
+    output->append("HTTP/1.1 101 Switching Protocols\r\n"
+                   "Upgrade: websocket\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Sec-WebSocket-Accept: ");
+    output->append(WebSocketCodec::acceptKey(key));
+    output->append("\r\n\r\n");
+    // 之前的流水线应答和101先发出去，open回调中发送的帧排在后面
+    conn->send(output);
+    *accepted = !webSocketOpenCallback_ || webSocketOpenCallback_(conn, req);
+    return true;
+}
@@ -0,0 +1,94 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+/*
+ *      HttpServer：基于TcpServer的HTTP/1.1服务器
+ *
+ *      1. keep-alive：HTTP/1.1默认保持连接，HTTP/1.0需要Connection: Keep-Alive。
+ *      2. 流水线：一次onMessage()解析inputBuffer中所有完整的请求，依次调用HttpCallback，
+ *         HttpCallback是同步的，所以应答的顺序就是请求的顺序。
+ *         这些应答先攒在一个Buffer里，最后一次send()，流水线请求只需要一次write()。
+ *      3. 较大的body（>= kGatherThreshold）不拷贝进Buffer，和前面攒下的数据一起writev()。
+ *      4. 无法解析的请求回复400并关闭连接。
+ *      5. body是文件时（HttpResponse::setBodyFile），先发送攒下的数据，再用TcpConnection::sendFile()发送文件。
+ *      6. 设置了WebSocketCallback时支持升级到WebSocket：回复101之后连接的context换成WebSocketContext，
+ *         之后的数据（包括和握手请求一起到达的）都按WebSocket帧处理。
+ */
+
+#ifndef MYMUDUO_HTTPSERVER_H
+#define MYMUDUO_HTTPSERVER_H
+
+#include "../TcpServer.h"
+#include "WebSocketContext.h"
+
+namespace muduo {
+    namespace net {
+
+        class HttpRequest;
+
+        class HttpResponse;
+
+        ///
+        /// HTTP/1.1 server with keep-alive and pipelining.
+        ///
+        /// HttpCallback runs synchronously in the IO thread of the connection.
+        class HttpServer : noncopyable {
+        public:
+            typedef std::function<void(const HttpRequest &,
+                                       HttpResponse *)> HttpCallback;
+
+            /// Called after the handshake response is queued, frames sent from it follow the handshake.
+            /// Returning false closes the WebSocket with 1008 (policy violation).
+            typedef std::function<bool(const TcpConnectionPtr &,
+                                       const HttpRequest &)> WebSocketOpenCallback;
+
+            static const int kGatherThreshold = 16 * 1024;
+
+            HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const string &name,
+                       TcpServer::Option option = TcpServer::kNoReusePort);
+
+            EventLoop *getLoop() const { return server_.getLoop(); }
+
+            /// Not thread safe, callback be registered before calling start().
+            void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+
+            /// Enables WebSocket upgrades, not thread safe.
+            void setWebSocketCallback(const WebSocketCallback &cb) { webSocketCallback_ = cb; }
+
+            /// Not thread safe, optional.
+            void setWebSocketOpenCallback(const WebSocketOpenCallback &cb) { webSocketOpenCallback_ = cb; }
+
+            /// Limit of a (reassembled) WebSocket message, larger ones close with 1009. Not thread safe.
+            void setWebSocketMaxMessageSize(size_t bytes) { webSocketMaxMessageSize_ = bytes; }
+
+            void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+            void start();
+
+        private:
+            void onConnection(const TcpConnectionPtr &conn);
+
+            void onMessage(const TcpConnectionPtr &conn,
+                           Buffer *buf,
+                           Timestamp receiveTime);
+
+            /// Returns false if the connection should be closed.
+            bool onRequest(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output);
+
+            /// Returns true if the connection switches to WebSocket.
+            bool onUpgrade(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output, bool *accepted);
+
+            TcpServer server_;
+            HttpCallback httpCallback_;
+            WebSocketCallback webSocketCallback_;
+            WebSocketOpenCallback webSocketOpenCallback_;
+            size_t webSocketMaxMessageSize_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_HTTPSERVER_H
@@ -0,0 +1,563 @@
+//
+// Created by chen on 2022/11/27.
+//
+
+#include "StaticFileHandler.h"
+
+#include "../../base/Logging.h"
+#include "../Channel.h"
+#include "../EventLoop.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            const uint32_t kWatchMask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                        IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF | IN_DELETE_SELF |
+                                        IN_ONLYDIR;
+
+            int createInotifyFd() {
+                int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (fd < 0) {
+                    LOG_SYSFATAL << "Failed in inotify_init1";
+                }
+                return fd;
+            }
+
+            int hexValue(char c) {
+                if (c >= '0' && c <= '9') {
+                    return c - '0';
+                } else if (c >= 'a' && c <= 'f') {
+                    return c - 'a' + 10;
+                } else if (c >= 'A' && c <= 'F') {
+                    return c - 'A' + 10;
+                }
+                return -1;
+            }
+
+            /*
+             *      把请求的path转换成缓存的key：解码%XX，去掉空的和"."的路径段，以'/'结尾的补上index.html。
+             *      含有".."或者'\0'的路径返回false，不能访问root之外的文件
+             */
+            bool normalizePath(const StringPiece &path, string *key) {
+                if (path.empty() || path[0] != '/') {
+                    return false;
+                }
+                string decoded;
+                decoded.reserve(static_cast<size_t>(path.size()));
+                for (int i = 0; i < path.size(); ++i) {
+                    char c = path[i];
+                    if (c == '%' && i + 2 < path.size() && hexValue(path[i + 1]) >= 0 && hexValue(path[i + 2]) >= 0) {
+                        c = static_cast<char>(hexValue(path[i + 1]) * 16 + hexValue(path[i + 2]));
+                        i += 2;
+                    }
+                    if (c == '\0') {
+                        return false;
+                    }
+                    decoded.push_back(c);
+                }
+
+                key->clear();
+                size_t start = 0;
+                while (start < decoded.size()) {
+                    size_t end = decoded.find('/', start);
+                    if (end == string::npos) {
+                        end = decoded.size();
+                    }
+                    size_t len = end - start;
+                    if (len == 2 && decoded.compare(start, 2, "..") == 0) {
+                        return false;
+                    }
+                    if (len > 0 && !(len == 1 && decoded[start] == '.')) {
+                        key->push_back('/');
+                        key->append(decoded, start, len);
+                    }
+                    start = end + 1;
+                }
+                if (decoded[decoded.size() - 1] == '/' || key->empty()) {
+                    key->append("/index.html");
+                }
+                return true;
+            }
+
+            const char *contentType(const string &key) {
+                static const struct {
+                    const char *ext;
+                    const char *type;
+                } kTypes[] = {
+                        {".html", "text/html; charset=utf-8"},
+                        {".htm",  "text/html; charset=utf-8"},
+                        {".css",  "text/css"},
+                        {".js",   "application/javascript"},
+                        {".json", "application/json"},
+                        {".txt",  "text/plain; charset=utf-8"},
+                        {".xml",  "application/xml"},
+                        {".png",  "image/png"},
+                        {".jpg",  "image/jpeg"},
+                        {".jpeg", "image/jpeg"},
+                        {".gif",  "image/gif"},
+                        {".svg",  "image/svg+xml"},
+                        {".ico",  "image/x-icon"},
+                        {".pdf",  "application/pdf"},
+                        {".wasm", "application/wasm"},
+                };
+                size_t dot = key.rfind('.');
+                if (dot != string::npos && key.find('/', dot) == string::npos) {
+                    for (const auto &t : kTypes) {
+                        if (::strcasecmp(key.c_str() + dot, t.ext) == 0) {
+                            return t.type;
+                        }
+                    }
+                }
+                return "application/octet-stream";
+            }
+
+            /*
+             *      从root开始逐级openat()，每一级都带O_NOFOLLOW，路径中有符号链接就失败（ELOOP/ENOTDIR），
+             *      root中指向外面的链接不能用来读root之外的文件。root本身是配置的，可以是符号链接。
+             *      key已经由normalizePath()去掉了"."和".."；O_NONBLOCK避免在FIFO上阻塞，对普通文件没有影响
+             */
+            int openBeneath(const string &root, const string &key) {
+                int dirfd = ::open(root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+                size_t start = 1;
+                while (dirfd >= 0) {
+                    size_t end = key.find('/', start);
+                    int fd = -1;
+                    if (end == string::npos) {
+                        fd = ::openat(dirfd, key.c_str() + start, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+                        ::close(dirfd);
+                        return fd;
+                    }
+                    string name(key, start, end - start);
+                    fd = ::openat(dirfd, name.c_str(), O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    ::close(dirfd);
+                    dirfd = fd;
+                    start = end + 1;
+                }
+                return -1;
+            }
+
+            /*
+             *      把文件的前size字节读进*data。文件在fstat()之后被截断时只得到实际读到的部分，
+             *      inotify事件随后会让这个缓存项失效
+             */
+            bool readFile(int fd, size_t size, string *data) {
+                data->resize(size);
+                size_t nread = 0;
+                while (nread < size) {
+                    ssize_t n = ::pread(fd, &(*data)[nread], size - nread, static_cast<off_t>(nread));
+                    if (n < 0 && errno == EINTR) {
+                        continue;
+                    } else if (n < 0) {
+                        return false;
+                    } else if (n == 0) {
+                        break;
+                    }
+                    nread += static_cast<size_t>(n);
+                }
+                data->resize(nread);
+                return true;
+            }
+
+            /*
+             *      dir（相对root，root本身是空串）是否是ancestor或者在ancestor之下
+             */
+            bool inSubtree(const string &dir, const string &ancestor) {
+                return ancestor.empty() || dir == ancestor ||
+                       (dir.size() > ancestor.size() && dir.compare(0, ancestor.size(), ancestor) == 0 &&
+                        dir[ancestor.size()] == '/');
+            }
+
+            string parentDir(const string &dir) {
+                return dir.substr(0, dir.rfind('/'));
+            }
+
+            /*
+             *      If-None-Match可能是逗号分隔的多个ETag，也可能是"*"
+             */
+            bool etagMatches(const StringPiece &ifNoneMatch, const string &etag) {
+                if (ifNoneMatch == "*") {
+                    return true;
+                }
+                string value(ifNoneMatch.as_string());
+                return value.find(etag) != string::npos;
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+/*
+ *      小文件：内容读进data，fd < 0；大文件：data为空，fd是打开的文件。
+ */
+struct StaticFileHandler::Entry : noncopyable {
+    string key;
+    string dir;         // key所在的目录，相对root
+    string data;
+    int fd;
+    size_t size;
+    size_t cost;        // 计入cacheBytes的字节数
+    string etag;
+    string headers;     // 预先编码好的header行
+
+    Entry() : fd(-1), size(0), cost(0) {}
+
+    ~Entry() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+const size_t StaticFileHandler::kDefaultCacheBytes;
+const size_t StaticFileHandler::kDefaultMaxCachedFileSize;
+const size_t StaticFileHandler::kDefaultMaxEntries;
+
+StaticFileHandler::StaticFileHandler(EventLoop *loop,
+                                     const string &root,
+                                     size_t cacheBytes,
+                                     size_t maxCachedFileSize)
+        : loop_(loop),
+          root_(root.size() > 1 && root[root.size() - 1] == '/' ? root.substr(0, root.size() - 1) : root),
+          cacheBytes_(cacheBytes),
+          maxCachedFileSize_(maxCachedFileSize),
+          maxEntries_(kDefaultMaxEntries),
+          inotifyFd_(detail::createInotifyFd()),
+          inotifyChannel_(new Channel(loop, inotifyFd_)),
+          bytes_(0),
+          generation_(0) {
+    inotifyChannel_->setReadCallback(std::bind(&StaticFileHandler::handleInotify, this));
+    inotifyChannel_->enableReading();
+}
+
+StaticFileHandler::~StaticFileHandler() {
+    loop_->assertInLoopThread();
+    inotifyChannel_->disableAll();
+    inotifyChannel_->remove();
+    ::close(inotifyFd_);
+}
+
+size_t StaticFileHandler::numEntries() const {
+    MutexLockGuard lock(mutex_);
+    return lru_.size();
+}
+
+size_t StaticFileHandler::cachedBytes() const {
+    MutexLockGuard lock(mutex_);
+    return bytes_;
+}
+
+/*
+ *      命中时不访问磁盘：header和body都来自缓存项，应答持有缓存项直到发送完毕
+ */
+void StaticFileHandler::handle(const HttpRequest &req, HttpResponse *resp) {
+    if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead) {
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+        resp->addHeader("Allow", "GET, HEAD");
+        return;
+    }
+    string key;
+    if (!detail::normalizePath(req.path(), &key)) {
+        resp->setStatusCode(HttpResponse::k403Forbidden);
+        return;
+    }
+
+    EntryPtr entry(lookup(key));
+    if (entry) {
+        hits_.increment();
+    } else {
+        misses_.increment();
+        entry = load(key);
+        if (!entry) {
+            resp->setStatusCode(HttpResponse::k404NotFound);
+            return;
+        }
+    }
+
+    resp->addRawHeaders(entry->headers);
+    StringPiece ifNoneMatch = req.getHeader("If-None-Match");
+    if (!ifNoneMatch.empty() && detail::etagMatches(ifNoneMatch, entry->etag)) {
+        resp->setStatusCode(HttpResponse::k304NotModified);
+        return;
+    }
+    resp->setStatusCode(HttpResponse::k200Ok);
+    if (entry->fd >= 0) {
+        resp->setBodyFile(entry->fd, 0, entry->size, entry);
+    } else {
+        resp->setBodyView(entry->data, entry);
+    }
+}
+
+StaticFileHandler::EntryPtr StaticFileHandler::lookup(const string &key) {
+    MutexLockGuard lock(mutex_);
+    std::map<string, EntryList::iterator>::iterator it = cache_.find(key);
+    if (it == cache_.end()) {
+        return EntryPtr();
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return *it->second;
+}
+
+/*
+ *      未命中时加载文件。
+ *      先给目录加上watch再open()，之后对文件的修改一定会产生inotify事件；
+ *      加载期间如果处理过失效事件（generation_变了），加载的内容可能已经过期，这次照常使用但不放进缓存
+ */
+StaticFileHandler::EntryPtr StaticFileHandler::load(const string &key) {
+    EntryPtr entry(new Entry);
+    entry->key = key;
+    entry->dir = key.substr(0, key.rfind('/'));
+
+    int64_t generation = 0;
+    bool watched = false;
+    {
+        MutexLockGuard lock(mutex_);
+        generation = generation_;
+        watched = watchDirLocked(entry->dir);
+    }
+
+    string path(root_ + key);
+    int fd = detail::openBeneath(root_, key);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        MutexLockGuard lock(mutex_);
+        unwatchDirLocked(entry->dir);
+        return EntryPtr();
+    }
+
+    entry->size = static_cast<size_t>(st.st_size);
+    if (entry->size > maxCachedFileSize_) {
+        entry->fd = fd;
+    } else {
+        bool ok = detail::readFile(fd, entry->size, &entry->data);
+        ::close(fd);
+        if (!ok) {
+            LOG_SYSERR << "StaticFileHandler::load read " << path;
+            MutexLockGuard lock(mutex_);
+            unwatchDirLocked(entry->dir);
+            return EntryPtr();
+        }
+        entry->size = entry->data.size();
+        entry->cost = entry->size;
+    }
+
+    char buf[128];
+    snprintf(buf, sizeof buf, "\"%zx-%lx%09lx\"", entry->size,
+             static_cast<long>(st.st_mtim.tv_sec), static_cast<long>(st.st_mtim.tv_nsec));
+    entry->etag = buf;
+    entry->headers = "Content-Type: ";
+    entry->headers += detail::contentType(key);
+    entry->headers += "\r\nETag: ";
+    entry->headers += entry->etag;
+    struct tm tm;
+    ::gmtime_r(&st.st_mtime, &tm);
+    ::strftime(buf, sizeof buf, "\r\nLast-Modified: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+    entry->headers += buf;
+    entry->cost += entry->headers.size();
+
+    if (watched) {
+        insert(entry, generation);
+    }
+    return entry;
+}
+
+void StaticFileHandler::insert(const EntryPtr &entry, int64_t generation) {
+    MutexLockGuard lock(mutex_);
+    if (generation != generation_ || cache_.find(entry->key) != cache_.end()) {
+        // 加载期间文件或者目录可能变了（watch也可能被去掉了），或者其它线程已经放进了缓存
+        unwatchDirLocked(entry->dir);
+        return;
+    }
+    lru_.push_front(entry);
+    cache_[entry->key] = lru_.begin();
+    bytes_ += entry->cost;
+    for (string dir = entry->dir;; dir = detail::parentDir(dir)) {
+        ++dirs_[dir].refs;      // generation_没变，watchDirLocked()加上的watch都还在
+        if (dir.empty()) {
+            break;
+        }
+    }
+    while ((bytes_ > cacheBytes_ || lru_.size() > maxEntries_) && lru_.size() > 1) {
+        removeLocked(--lru_.end());
+    }
+}
+
+/*
+ *      只从缓存中删除，正在发送的应答仍然持有缓存项
+ */
+void StaticFileHandler::removeLocked(EntryList::iterator it) {
+    EntryPtr entry(*it);
+    cache_.erase(entry->key);
+    lru_.erase(it);
+    bytes_ -= entry->cost;
+    for (string dir = entry->dir;; dir = detail::parentDir(dir)) {
+        std::map<string, DirWatch>::iterator watch = dirs_.find(dir);
+        if (watch != dirs_.end() && watch->second.refs > 0) {
+            --watch->second.refs;
+        }
+        if (dir.empty()) {
+            break;
+        }
+    }
+    unwatchDirLocked(entry->dir);
+}
+
+/*
+ *      给dir和它到root的每一级上级目录都加上watch，上级目录被改名或删除时也能收到事件。
+ *      从root往下加，任何一级失败都把这次新加的watch去掉
+ */
+bool StaticFileHandler::watchDirLocked(const string &dir) {
+    size_t end = 0;
+    for (;;) {
+        string sub(dir, 0, end);
+        if (dirs_.find(sub) == dirs_.end()) {
+            string path(root_ + sub);
+            int wd = ::inotify_add_watch(inotifyFd_, path.c_str(), detail::kWatchMask);
+            if (wd < 0) {
+                if (errno != ENOENT && errno != ENOTDIR) {
+                    LOG_SYSERR << "StaticFileHandler::watchDirLocked " << path;
+                }
+                if (!sub.empty()) {
+                    unwatchDirLocked(detail::parentDir(sub));
+                }
+                return false;
+            }
+            DirWatch watch = {wd, 0};
+            dirs_[sub] = watch;
+            watchDirs_[wd] = sub;
+        }
+        if (end == dir.size()) {
+            return true;
+        }
+        end = dir.find('/', end + 1);
+        if (end == string::npos) {
+            end = dir.size();
+        }
+    }
+}
+
+/*
+ *      refs是目录及其子目录中缓存的文件数。从dir往上，没有缓存的文件了就去掉watch
+ */
+void StaticFileHandler::unwatchDirLocked(const string &dir) {
+    for (string sub = dir;; sub = detail::parentDir(sub)) {
+        std::map<string, DirWatch>::iterator it = dirs_.find(sub);
+        if (it != dirs_.end()) {
+            if (it->second.refs > 0) {
+                return;         // 上级目录的refs不会更小
+            }
+            ::inotify_rm_watch(inotifyFd_, it->second.wd);
+            watchDirs_.erase(it->second.wd);
+            dirs_.erase(it);
+        }
+        if (sub.empty()) {
+            return;
+        }
+    }
+}
+
+/*
+ *      inotify事件：
+ *      1. 目录中的文件变化，删除dir/name对应的缓存项
+ *      2. 目录本身被删除或移走，或者其中的子目录name被删除、移走、替换，删除整棵子树下所有的缓存项
+ *      3. 事件队列溢出，丢失了事件，清空缓存
+ */
+void StaticFileHandler::handleInotify() {
+    loop_->assertInLoopThread();
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = ::read(inotifyFd_, buf, sizeof buf);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN) {
+                LOG_SYSERR << "StaticFileHandler::handleInotify";
+            }
+            break;
+        }
+
+        MutexLockGuard lock(mutex_);
+        const struct inotify_event *event = NULL;
+        for (const char *p = buf; p < buf + n; p += sizeof(struct inotify_event) + event->len) {
+            event = reinterpret_cast<const struct inotify_event *>(p);
+            if (event->mask & IN_Q_OVERFLOW) {
+                LOG_WARN << "StaticFileHandler - inotify queue overflow, dropping all cached files";
+                while (!lru_.empty()) {
+                    removeLocked(lru_.begin());
+                }
+                ++generation_;
+                continue;
+            }
+            std::map<int, string>::iterator it = watchDirs_.find(event->wd);
+            if (it == watchDirs_.end()) {
+                continue;
+            }
+            string dir(it->second);
+            if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                invalidateDirLocked(dir);
+            } else if (event->len > 0 && (event->mask & IN_ISDIR)) {
+                invalidateDirLocked(dir + "/" + event->name);
+            } else if (event->len > 0) {
+                invalidateLocked(dir + "/" + event->name);
+            }
+        }
+    }
+}
+
+void StaticFileHandler::invalidateLocked(const string &key) {
+    ++generation_;
+    std::map<string, EntryList::iterator>::iterator it = cache_.find(key);
+    if (it != cache_.end()) {
+        invalidations_.increment();
+        LOG_DEBUG << "StaticFileHandler - invalidate " << key;
+        removeLocked(it->second);
+    }
+}
+
+/*
+ *      dir这个路径已经不是原来的目录了（目录被移走时对应的inode可能不再可达），
+ *      删除子树下所有缓存项，再去掉子树中正在加载的文件留下的watch（refs为0）
+ */
+void StaticFileHandler::invalidateDirLocked(const string &dir) {
+    ++generation_;
+    std::vector<EntryList::iterator> stale;
+    for (EntryList::iterator it = lru_.begin(); it != lru_.end(); ++it) {
+        if (detail::inSubtree((*it)->dir, dir)) {
+            stale.push_back(it);
+        }
+    }
+    invalidations_.add(static_cast<int64_t>(stale.size()));
+    for (EntryList::iterator it : stale) {
+        removeLocked(it);
+    }
+    for (std::map<string, DirWatch>::iterator it = dirs_.begin(); it != dirs_.end();) {
+        if (detail::inSubtree(it->first, dir)) {
+            ::inotify_rm_watch(inotifyFd_, it->second.wd);
+            watchDirs_.erase(it->second.wd);
+            dirs_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    if (!dir.empty()) {
+        unwatchDirLocked(detail::parentDir(dir));
+    }
+}
@@ -0,0 +1,134 @@
+//
+// Created by chen on 2022/11/27.
+//
+
+/*
+ *      StaticFileHandler：静态文件服务，带内容缓存
+ *
+ *      1. 缓存项按LRU淘汰，保存文件内容和预先编码好的header（Content-Type、ETag、Last-Modified），
+ *         命中时不访问磁盘，也不做系统调用：
+ *         a. 小文件（<= maxCachedFileSize）读进内存，body指向缓存项中的内容，由HttpServer和header一起writev()。
+ *            不用mmap()：文件被原地截断后，读映射区会触发SIGBUS。
+ *         b. 大文件只缓存打开的fd和header，body用sendfile()发送。
+ *      2. 失效由inotify驱动：缓存了文件的目录及其到root的各级上级目录都加上watch，inotify的fd由loop上的一个Channel监听，
+ *         目录中的文件被修改、移动、删除时，在loop线程中删除对应的缓存项；
+ *         某一级目录被改名、删除时，删除它下面所有的缓存项。下一次请求重新加载。
+ *      3. 缓存项是shared_ptr，应答通过owner持有它，被淘汰后内容和fd在应答发送完之后才释放。
+ *      4. 支持If-None-Match，ETag为"文件大小-修改时间"。
+ *      5. 不跟随root之下的符号链接（逐级openat() + O_NOFOLLOW），链接到root之外的文件返回404。
+ *
+ *      handle()可以在任意IO线程中调用，缓存由mutex保护。
+ */
+
+#ifndef MYMUDUO_STATICFILEHANDLER_H
+#define MYMUDUO_STATICFILEHANDLER_H
+
+#include "../../base/Atomic.h"
+#include "../../base/Mutex.h"
+#include "../../base/StringPiece.h"
+#include "../../base/Types.h"
+
+#include <list>
+#include <map>
+#include <memory>
+
+namespace muduo {
+    namespace net {
+
+        class Channel;
+
+        class EventLoop;
+
+        class HttpRequest;
+
+        class HttpResponse;
+
+        ///
+        /// Serves files under a root directory, with an LRU cache invalidated by inotify.
+        ///
+        /// Must be constructed and destructed in the loop thread, handle() is thread safe.
+        class StaticFileHandler : noncopyable {
+        public:
+            static const size_t kDefaultCacheBytes = 64 * 1024 * 1024;
+            static const size_t kDefaultMaxCachedFileSize = 1024 * 1024;
+            static const size_t kDefaultMaxEntries = 4096;
+
+            /// Files up to maxCachedFileSize are read into memory and count against cacheBytes,
+            /// larger ones keep an open fd and are sent with sendfile(2).
+            StaticFileHandler(EventLoop *loop,
+                              const string &root,
+                              size_t cacheBytes = kDefaultCacheBytes,
+                              size_t maxCachedFileSize = kDefaultMaxCachedFileSize);
+
+            ~StaticFileHandler();
+
+            /// Caps the number of cached files, and so the number of open fds.
+            void setMaxEntries(size_t n) { maxEntries_ = n; }
+
+            /// Fills resp for req, usable as HttpServer::HttpCallback.
+            void handle(const HttpRequest &req, HttpResponse *resp);
+
+            // 统计信息，可以在任意线程调用
+            size_t numEntries() const;
+
+            size_t cachedBytes() const;
+
+            int64_t numHits() { return hits_.get(); }
+
+            int64_t numMisses() { return misses_.get(); }
+
+            int64_t numInvalidations() { return invalidations_.get(); }
+
+        private:
+            struct Entry;
+            typedef std::shared_ptr<Entry> EntryPtr;
+            typedef std::list<EntryPtr> EntryList;      // 表头是最近使用的
+
+            struct DirWatch {
+                int wd;
+                int refs;       // 该目录及其子目录中缓存的文件数
+            };
+
+            EntryPtr lookup(const string &key);
+
+            EntryPtr load(const string &key);
+
+            void insert(const EntryPtr &entry, int64_t generation);
+
+            void removeLocked(EntryList::iterator it);
+
+            bool watchDirLocked(const string &dir);
+
+            void unwatchDirLocked(const string &dir);
+
+            void handleInotify();
+
+            void invalidateLocked(const string &key);
+
+            void invalidateDirLocked(const string &dir);
+
+            EventLoop *loop_;
+            const string root_;
+            const size_t cacheBytes_;
+            const size_t maxCachedFileSize_;
+            size_t maxEntries_;
+            const int inotifyFd_;
+            std::unique_ptr<Channel> inotifyChannel_;
+
+            mutable MutexLock mutex_;
+            EntryList lru_;
+            std::map<string, EntryList::iterator> cache_;
+            std::map<string, DirWatch> dirs_;       // 目录 -> watch
+            std::map<int, string> watchDirs_;       // wd -> 目录
+            size_t bytes_;
+            int64_t generation_;                    // 每次失效加一，见insert()
+
+            AtomicInt64 hits_;
+            AtomicInt64 misses_;
+            AtomicInt64 invalidations_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_STATICFILEHANDLER_H
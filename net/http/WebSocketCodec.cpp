@@ -0,0 +1,416 @@
+//
+// Created by chen on 2022/11/30.
+//
+
+#include "WebSocketCodec.h"
+
+#include "../Buffer.h"
+#include "../TcpConnection.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MUDUO_WEBSOCKET_X86 1
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            /*
+             *      从offset开始的mask key：第i个字节用key[(offset + i) % 4]
+             */
+            uint32_t rotatedMaskKey(const char *maskKey, size_t offset) {
+                char rotated[4];
+                for (size_t i = 0; i < 4; ++i) {
+                    rotated[i] = maskKey[(offset + i) & 3];
+                }
+                uint32_t key;
+                ::memcpy(&key, rotated, sizeof key);
+                return key;
+            }
+
+            /*
+             *      8字节一组异或，剩下不足8字节的逐字节处理。key是从data开始的mask key，按内存顺序
+             */
+            void maskTail(char *data, size_t len, uint32_t key) {
+                uint64_t key64 = (static_cast<uint64_t>(key) << 32) | key;
+                size_t i = 0;
+                for (; i + 8 <= len; i += 8) {
+                    uint64_t x;
+                    ::memcpy(&x, data + i, sizeof x);
+                    x ^= key64;
+                    ::memcpy(data + i, &x, sizeof x);
+                }
+                char keyBytes[4];
+                ::memcpy(keyBytes, &key, sizeof key);
+                for (; i < len; ++i) {
+                    data[i] = static_cast<char>(data[i] ^ keyBytes[i & 3]);
+                }
+            }
+
+            void maskScalar(char *data, size_t len, const char *maskKey, size_t offset) {
+                maskTail(data, len, rotatedMaskKey(maskKey, offset));
+            }
+
+#ifdef MUDUO_WEBSOCKET_X86
+
+            /*
+             *      每次16、32字节，都是4的倍数，处理完之后key的相位不变
+             */
+            void maskSse2(char *data, size_t len, const char *maskKey, size_t offset) {
+                uint32_t key = rotatedMaskKey(maskKey, offset);
+                __m128i k = _mm_set1_epi32(static_cast<int>(key));
+                size_t i = 0;
+                for (; i + 16 <= len; i += 16) {
+                    __m128i *p = reinterpret_cast<__m128i *>(data + i);
+                    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+                }
+                maskTail(data + i, len - i, key);
+            }
+
+            __attribute__((target("avx2")))
+            void maskAvx2(char *data, size_t len, const char *maskKey, size_t offset) {
+                uint32_t key = rotatedMaskKey(maskKey, offset);
+                __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+                size_t i = 0;
+                for (; i + 64 <= len; i += 64) {
+                    __m256i *p = reinterpret_cast<__m256i *>(data + i);
+                    _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+                    _mm256_storeu_si256(p + 1, _mm256_xor_si256(_mm256_loadu_si256(p + 1), k));
+                }
+                for (; i + 32 <= len; i += 32) {
+                    __m256i *p = reinterpret_cast<__m256i *>(data + i);
+                    _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+                }
+                if (i + 16 <= len) {
+                    __m128i *p = reinterpret_cast<__m128i *>(data + i);
+                    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), _mm256_castsi256_si128(k)));
+                    i += 16;
+                }
+                maskTail(data + i, len - i, key);
+            }
+
+#endif
+
+            bool kernelSupported(WebSocketCodec::MaskKernel kernel) {
+#ifdef MUDUO_WEBSOCKET_X86
+                switch (kernel) {
+                    case WebSocketCodec::kAvx2:
+                        __builtin_cpu_init();
+                        return __builtin_cpu_supports("avx2");
+                    case WebSocketCodec::kSse2:
+                        __builtin_cpu_init();
+                        return __builtin_cpu_supports("sse2");
+                    default:
+                        return true;
+                }
+#else
+                return kernel == WebSocketCodec::kScalar;
+#endif
+            }
+
+            void sha1Block(uint32_t h[5], const unsigned char *block) {
+                uint32_t w[80];
+                for (int i = 0; i < 16; ++i) {
+                    w[i] = static_cast<uint32_t>(block[i * 4]) << 24 | static_cast<uint32_t>(block[i * 4 + 1]) << 16 |
+                           static_cast<uint32_t>(block[i * 4 + 2]) << 8 | static_cast<uint32_t>(block[i * 4 + 3]);
+                }
+                for (int i = 16; i < 80; ++i) {
+                    uint32_t x = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+                    w[i] = (x << 1) | (x >> 31);
+                }
+                uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+                for (int i = 0; i < 80; ++i) {
+                    uint32_t f, k;
+                    if (i < 20) {
+                        f = (b & c) | (~b & d);
+                        k = 0x5A827999;
+                    } else if (i < 40) {
+                        f = b ^ c ^ d;
+                        k = 0x6ED9EBA1;
+                    } else if (i < 60) {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8F1BBCDC;
+                    } else {
+                        f = b ^ c ^ d;
+                        k = 0xCA62C1D6;
+                    }
+                    uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+                    e = d;
+                    d = c;
+                    c = (b << 30) | (b >> 2);
+                    b = a;
+                    a = t;
+                }
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+            }
+
+            /*
+             *      握手时用，只处理几十字节，不追求速度
+             */
+            void sha1(const string &message, unsigned char digest[20]) {
+                uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+                string padded(message);
+                padded.push_back(static_cast<char>(0x80));
+                while (padded.size() % 64 != 56) {
+                    padded.push_back('\0');
+                }
+                uint64_t bits = static_cast<uint64_t>(message.size()) * 8;
+                for (int i = 7; i >= 0; --i) {
+                    padded.push_back(static_cast<char>(bits >> (i * 8)));
+                }
+                for (size_t i = 0; i < padded.size(); i += 64) {
+                    sha1Block(h, reinterpret_cast<const unsigned char *>(padded.data() + i));
+                }
+                for (int i = 0; i < 20; ++i) {
+                    digest[i] = static_cast<unsigned char>(h[i / 4] >> (24 - (i % 4) * 8));
+                }
+            }
+
+            string base64Encode(const unsigned char *data, size_t len) {
+                static const char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+                string result;
+                result.reserve((len + 2) / 3 * 4);
+                for (size_t i = 0; i < len; i += 3) {
+                    uint32_t n = static_cast<uint32_t>(data[i]) << 16;
+                    if (i + 1 < len) n |= static_cast<uint32_t>(data[i + 1]) << 8;
+                    if (i + 2 < len) n |= data[i + 2];
+                    result.push_back(kTable[(n >> 18) & 63]);
+                    result.push_back(kTable[(n >> 12) & 63]);
+                    result.push_back(i + 1 < len ? kTable[(n >> 6) & 63] : '=');
+                    result.push_back(i + 2 < len ? kTable[n & 63] : '=');
+                }
+                return result;
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+const size_t WebSocketCodec::kMaxHeaderLen;
+const size_t WebSocketCodec::kMaxControlPayload;
+
+WebSocketCodec::MaskKernel WebSocketCodec::maskKernel_ = WebSocketCodec::kScalar;
+WebSocketCodec::MaskFunc WebSocketCodec::maskFunc_ = detail::maskScalar;
+
+namespace {
+    /*
+     *      程序启动时选择最快的实现
+     */
+    struct MaskKernelInitializer {
+        MaskKernelInitializer() {
+            WebSocketCodec::setMaskKernel(WebSocketCodec::bestMaskKernel());
+        }
+    };
+
+    MaskKernelInitializer maskKernelInitializer;
+}
+
+WebSocketCodec::MaskKernel WebSocketCodec::bestMaskKernel() {
+    if (detail::kernelSupported(kAvx2)) {
+        return kAvx2;
+    }
+    if (detail::kernelSupported(kSse2)) {
+        return kSse2;
+    }
+    return kScalar;
+}
+
+void WebSocketCodec::setMaskKernel(MaskKernel kernel) {
+    if (!detail::kernelSupported(kernel)) {
+        kernel = bestMaskKernel();
+    }
+    maskKernel_ = kernel;
+    switch (kernel) {
+#ifdef MUDUO_WEBSOCKET_X86
+        case kAvx2:
+            maskFunc_ = detail::maskAvx2;
+            break;
+        case kSse2:
+            maskFunc_ = detail::maskSse2;
+            break;
+#endif
+        default:
+            maskFunc_ = detail::maskScalar;
+            break;
+    }
+}
+
+const char *WebSocketCodec::maskKernelName(MaskKernel kernel) {
+    switch (kernel) {
+        case kAvx2:
+            return "avx2";
+        case kSse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+/*
+ *      payload长度：<= 125直接放在len7；126表示后面2字节；127表示后面8字节，最高位必须是0。
+ *      控制帧不能分片，payload不超过125字节
+ */
+WebSocketCodec::ParseResult WebSocketCodec::parseHeader(const char *data, size_t len, FrameHeader *header) {
+    if (len < 2) {
+        return kIncomplete;
+    }
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    if (p[0] & 0x70) {
+        return kError;      // 没有协商扩展，RSV必须是0
+    }
+    header->fin = (p[0] & 0x80) != 0;
+    int opcode = p[0] & 0x0F;
+    switch (opcode) {
+        case kContinuation:
+        case kText:
+        case kBinary:
+        case kClose:
+        case kPing:
+        case kPong:
+            header->opcode = static_cast<Opcode>(opcode);
+            break;
+        default:
+            return kError;
+    }
+    header->masked = (p[1] & 0x80) != 0;
+    uint64_t payloadLen = p[1] & 0x7F;
+    size_t headerLen = 2;
+    if (payloadLen == 126) {
+        if (len < 4) {
+            return kIncomplete;
+        }
+        payloadLen = static_cast<uint64_t>(p[2]) << 8 | p[3];
+        headerLen = 4;
+    } else if (payloadLen == 127) {
+        if (len < 10) {
+            return kIncomplete;
+        }
+        payloadLen = 0;
+        for (int i = 2; i < 10; ++i) {
+            payloadLen = payloadLen << 8 | p[i];
+        }
+        if (payloadLen >> 63) {
+            return kError;
+        }
+        headerLen = 10;
+    }
+    if (opcode >= kClose && (!header->fin || payloadLen > kMaxControlPayload)) {
+        return kError;
+    }
+    if (header->masked) {
+        if (len < headerLen + 4) {
+            return kIncomplete;
+        }
+        ::memcpy(header->maskKey, data + headerLen, 4);
+        headerLen += 4;
+    }
+    header->headerLen = headerLen;
+    header->payloadLen = payloadLen;
+    return kComplete;
+}
+
+void WebSocketCodec::appendHeader(Buffer *output, Opcode opcode, uint64_t payloadLen,
+                                  bool fin, const char *maskKey) {
+    unsigned char buf[kMaxHeaderLen];
+    size_t n = 0;
+    buf[n++] = static_cast<unsigned char>((fin ? 0x80 : 0) | opcode);
+    unsigned char maskBit = maskKey ? 0x80 : 0;
+    if (payloadLen < 126) {
+        buf[n++] = static_cast<unsigned char>(maskBit | payloadLen);
+    } else if (payloadLen <= 0xFFFF) {
+        buf[n++] = static_cast<unsigned char>(maskBit | 126);
+        buf[n++] = static_cast<unsigned char>(payloadLen >> 8);
+        buf[n++] = static_cast<unsigned char>(payloadLen);
+    } else {
+        buf[n++] = static_cast<unsigned char>(maskBit | 127);
+        for (int i = 7; i >= 0; --i) {
+            buf[n++] = static_cast<unsigned char>(payloadLen >> (i * 8));
+        }
+    }
+    if (maskKey) {
+        ::memcpy(buf + n, maskKey, 4);
+        n += 4;
+    }
+    output->append(buf, n);
+}
+
+void WebSocketCodec::appendFrame(Buffer *output, Opcode opcode, const StringPiece &payload,
+                                 bool fin, const char *maskKey) {
+    size_t len = static_cast<size_t>(payload.size());
+    appendHeader(output, opcode, len, fin, maskKey);
+    output->append(payload);
+    if (maskKey) {
+        mask(output->beginWrite() - len, len, maskKey);
+    }
+}
+
+void WebSocketCodec::send(const TcpConnectionPtr &conn, const StringPiece &payload, Opcode opcode) {
+    Buffer header;
+    appendHeader(&header, opcode, static_cast<uint64_t>(payload.size()));
+    conn->send(header.toStringPiece(), payload);
+}
+
+/*
+ *      8字节一组检查最高位，全是ASCII时跳过；否则按首字节确定长度，第二个字节的范围排除超长编码、代理区和超出U+10FFFF的码点
+ */
+bool WebSocketCodec::isValidUtf8(const char *data, size_t len) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = p + len;
+    while (p < end) {
+        if (end - p >= 8) {
+            uint64_t x;
+            ::memcpy(&x, p, sizeof x);
+            if ((x & 0x8080808080808080ULL) == 0) {
+                p += 8;
+                continue;
+            }
+        }
+        unsigned char c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+        int n;
+        unsigned char lo = 0x80;
+        unsigned char hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            n = 1;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            n = 2;
+            if (c == 0xE0) lo = 0xA0;
+            if (c == 0xED) hi = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 3;
+            if (c == 0xF0) lo = 0x90;
+            if (c == 0xF4) hi = 0x8F;
+        } else {
+            return false;
+        }
+        if (end - p <= n || p[1] < lo || p[1] > hi) {
+            return false;
+        }
+        for (int i = 2; i <= n; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        p += n + 1;
+    }
+    return true;
+}
+
+string WebSocketCodec::acceptKey(const StringPiece &key) {
+    unsigned char digest[20];
+    detail::sha1(key.as_string() + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+    return detail::base64Encode(digest, sizeof digest);
+}
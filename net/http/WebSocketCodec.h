@@ -0,0 +1,102 @@
+//
+// Created by chen on 2022/11/30.
+//
+
+/*
+ *      WebSocketCodec：WebSocket（RFC 6455）帧的解析和编码
+ *
+ *      1. 帧格式：|FIN RSV1-3 opcode|MASK len7|(len16 | len64)|(mask key 4)|payload|
+ *         parseHeader()只解析帧头，payload留在输入Buffer中，由调用者就地unmask，不拷贝。
+ *      2. mask()：payload与4字节mask key循环异或，masking和unmasking是同一个操作。
+ *         按CPU支持的指令集选择AVX2（每次32字节）、SSE2（每次16字节）或每次8字节的标量实现，
+ *         程序启动时检测一次。offset是data在整个payload中的位置，用于分段unmask。
+ *      3. 握手：Sec-WebSocket-Accept = base64(SHA1(Sec-WebSocket-Key + GUID))。
+ */
+
+#ifndef MYMUDUO_WEBSOCKETCODEC_H
+#define MYMUDUO_WEBSOCKETCODEC_H
+
+#include "../../base/StringPiece.h"
+#include "../../base/Types.h"
+#include "../Callbacks.h"
+
+namespace muduo {
+    namespace net {
+
+        class Buffer;
+
+        class WebSocketCodec {
+        public:
+            enum Opcode {
+                kContinuation = 0x0,
+                kText = 0x1,
+                kBinary = 0x2,
+                kClose = 0x8,
+                kPing = 0x9,
+                kPong = 0xA,
+            };
+
+            enum ParseResult { kIncomplete, kComplete, kError };
+
+            enum MaskKernel { kScalar, kSse2, kAvx2 };
+
+            static const size_t kMaxHeaderLen = 14;
+            static const size_t kMaxControlPayload = 125;
+
+            struct FrameHeader {
+                bool fin;
+                Opcode opcode;
+                bool masked;
+                char maskKey[4];
+                size_t headerLen;
+                uint64_t payloadLen;
+            };
+
+            /// Parses the frame header at the front of [data, data + len).
+            /// kError for reserved bits, unknown opcodes and malformed control frames.
+            static ParseResult parseHeader(const char *data, size_t len, FrameHeader *header);
+
+            /// Appends a frame header; maskKey is NULL for server frames.
+            static void appendHeader(Buffer *output, Opcode opcode, uint64_t payloadLen,
+                                     bool fin = true, const char *maskKey = NULL);
+
+            /// Appends a whole frame, masking a copy of payload if maskKey is not NULL.
+            static void appendFrame(Buffer *output, Opcode opcode, const StringPiece &payload,
+                                    bool fin = true, const char *maskKey = NULL);
+
+            /// Sends an unmasked frame, the payload is not copied into an intermediate Buffer.
+            static void send(const TcpConnectionPtr &conn, const StringPiece &payload, Opcode opcode = kText);
+
+            /// XORs data in place with maskKey, starting at byte offset of the payload.
+            static void mask(char *data, size_t len, const char *maskKey, size_t offset = 0) {
+                maskFunc_(data, len, maskKey, offset);
+            }
+
+            /// The best kernel supported by this CPU.
+            static MaskKernel bestMaskKernel();
+
+            static MaskKernel maskKernel() { return maskKernel_; }
+
+            /// For tests and benchmarks, falls back to the best supported kernel.
+            /// Not thread safe, call before any connection is established.
+            static void setMaskKernel(MaskKernel kernel);
+
+            static const char *maskKernelName(MaskKernel kernel);
+
+            /// Well-formed UTF-8 (RFC 3629): no overlong forms, surrogates or code points above U+10FFFF.
+            static bool isValidUtf8(const char *data, size_t len);
+
+            /// Sec-WebSocket-Accept for a Sec-WebSocket-Key.
+            static string acceptKey(const StringPiece &key);
+
+        private:
+            typedef void (*MaskFunc)(char *data, size_t len, const char *maskKey, size_t offset);
+
+            static MaskFunc maskFunc_;
+            static MaskKernel maskKernel_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_WEBSOCKETCODEC_H
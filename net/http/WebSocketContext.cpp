@@ -0,0 +1,131 @@
+//
+// Created by chen on 2022/11/30.
+//
+
+#include "WebSocketContext.h"
+
+#include "../../base/Logging.h"
+#include "../Buffer.h"
+#include "../TcpConnection.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t WebSocketContext::kDefaultMaxMessageSize;
+
+/*
+ *      帧头解析很便宜，帧不完整时下次从帧头重新解析；payload只在帧完整后unmask一次
+ */
+void WebSocketContext::onMessage(const TcpConnectionPtr &conn, Buffer *buf, const WebSocketCallback &cb) {
+    while (!closing_) {
+        WebSocketCodec::FrameHeader header;
+        WebSocketCodec::ParseResult result = WebSocketCodec::parseHeader(buf->peek(), buf->readableBytes(), &header);
+        if (result == WebSocketCodec::kIncomplete) {
+            return;
+        }
+        if (result == WebSocketCodec::kError || !header.masked) {
+            close(conn, kProtocolError);
+            break;
+        }
+        // 控制帧可以插在分片之间，不计入消息的大小
+        if (header.opcode < WebSocketCodec::kClose &&
+            header.payloadLen > maxMessageSize_ - (header.opcode == WebSocketCodec::kContinuation ? fragments_.size() : 0)) {
+            close(conn, kMessageTooBig);
+            break;
+        }
+        size_t payloadLen = static_cast<size_t>(header.payloadLen);
+        if (buf->readableBytes() < header.headerLen + payloadLen) {
+            return;
+        }
+        char *payload = buf->mutablePeek() + header.headerLen;
+        WebSocketCodec::mask(payload, payloadLen, header.maskKey);
+        StringPiece data(payload, static_cast<int>(payloadLen));
+
+        if (header.opcode >= WebSocketCodec::kClose) {
+            onControlFrame(conn, header.opcode, data);
+        } else if (header.opcode == WebSocketCodec::kContinuation) {
+            if (fragmentOpcode_ == WebSocketCodec::kContinuation) {
+                close(conn, kProtocolError);
+                break;
+            }
+            fragments_.append(payload, payloadLen);
+            if (header.fin) {
+                WebSocketCodec::Opcode opcode = fragmentOpcode_;
+                fragmentOpcode_ = WebSocketCodec::kContinuation;
+                string message;
+                message.swap(fragments_);
+                if (!deliver(conn, opcode, message, cb)) {
+                    break;
+                }
+            }
+        } else {
+            if (fragmentOpcode_ != WebSocketCodec::kContinuation) {
+                close(conn, kProtocolError);
+                break;
+            }
+            if (header.fin) {
+                if (!deliver(conn, header.opcode, data, cb)) {
+                    break;
+                }
+            } else {
+                fragmentOpcode_ = header.opcode;
+                fragments_.assign(payload, payloadLen);
+            }
+        }
+        buf->retrieve(header.headerLen + payloadLen);
+    }
+    buf->retrieveAll();     // 关闭之后收到的数据不再处理
+}
+
+bool WebSocketContext::deliver(const TcpConnectionPtr &conn, WebSocketCodec::Opcode opcode,
+                               const StringPiece &message, const WebSocketCallback &cb) {
+    if (opcode == WebSocketCodec::kText &&
+        !WebSocketCodec::isValidUtf8(message.data(), static_cast<size_t>(message.size()))) {
+        close(conn, kInvalidPayload);
+        return false;
+    }
+    cb(conn, opcode, message);
+    return true;
+}
+
+void WebSocketContext::onControlFrame(const TcpConnectionPtr &conn, WebSocketCodec::Opcode opcode,
+                                      const StringPiece &payload) {
+    switch (opcode) {
+        case WebSocketCodec::kPing:
+            WebSocketCodec::send(conn, payload, WebSocketCodec::kPong);
+            break;
+        case WebSocketCodec::kClose: {
+            if (payload.size() == 1) {
+                close(conn, kProtocolError);
+                break;
+            }
+            // 回复对方的状态码，没有状态码时回复空的close帧
+            Buffer frame;
+            WebSocketCodec::appendFrame(&frame, WebSocketCodec::kClose, StringPiece(payload.data(),
+                                                                                    payload.empty() ? 0 : 2));
+            conn->send(&frame);
+            conn->shutdown();
+            closing_ = true;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void WebSocketContext::close(const TcpConnectionPtr &conn, uint16_t code, const StringPiece &reason) {
+    if (closing_) {
+        return;
+    }
+    LOG_DEBUG << conn->name() << " websocket close " << code;
+    closing_ = true;
+    Buffer payload;
+    payload.appendInt16(static_cast<int16_t>(code));
+    payload.append(reason.data(), static_cast<size_t>(std::min<int>(reason.size(), 123)));
+    Buffer frame;
+    WebSocketCodec::appendFrame(&frame, WebSocketCodec::kClose, payload.toStringPiece());
+    conn->send(&frame);
+    conn->shutdown();
+}
@@ -0,0 +1,77 @@
+//
+// Created by chen on 2022/11/30.
+//
+
+/*
+ *      WebSocketContext：握手之后每个连接一个，处理收到的帧
+ *
+ *      1. 帧收完整后在inputBuffer中就地unmask；没有分片的消息直接把指向inputBuffer的StringPiece交给回调，不拷贝。
+ *         分片的消息拼接到fragments_，收到FIN帧后一起交给回调。分片之间可以插入控制帧。
+ *      2. ping自动回复pong，pong忽略。
+ *      3. 收到close：回复同样的状态码，然后shutdown()。close()主动关闭：发送close帧后shutdown()，之后收到的数据丢弃。
+ *      4. 协议错误（客户端帧没有mask、分片顺序不对等）以1002关闭，消息超过maxMessageSize以1009关闭，
+ *         文本消息不是合法的UTF-8时以1007关闭。控制帧不受maxMessageSize限制，parseHeader()已经限制在125字节以内。
+ */
+
+#ifndef MYMUDUO_WEBSOCKETCONTEXT_H
+#define MYMUDUO_WEBSOCKETCONTEXT_H
+
+#include "WebSocketCodec.h"
+
+#include "../../base/copyable.h"
+
+#include <functional>
+
+namespace muduo {
+    namespace net {
+
+        /// Called with a complete (possibly reassembled) text or binary message.
+        /// The message is valid only during the callback.
+        typedef std::function<void(const TcpConnectionPtr &,
+                                   WebSocketCodec::Opcode,
+                                   const StringPiece &)> WebSocketCallback;
+
+        class WebSocketContext : public muduo::copyable {
+        public:
+            enum CloseCode {
+                kNormalClosure = 1000,
+                kGoingAway = 1001,
+                kProtocolError = 1002,
+                kInvalidPayload = 1007,
+                kPolicyViolation = 1008,
+                kMessageTooBig = 1009,
+            };
+
+            static const size_t kDefaultMaxMessageSize = 64 * 1024 * 1024;
+
+            explicit WebSocketContext(size_t maxMessageSize = kDefaultMaxMessageSize)
+                    : maxMessageSize_(maxMessageSize),
+                      fragmentOpcode_(WebSocketCodec::kContinuation),
+                      closing_(false) {
+            }
+
+            /// Handles all complete frames in buf and retrieves them.
+            void onMessage(const TcpConnectionPtr &conn, Buffer *buf, const WebSocketCallback &cb);
+
+            /// Sends a close frame and shuts down the connection, in the loop thread of conn.
+            void close(const TcpConnectionPtr &conn, uint16_t code, const StringPiece &reason = StringPiece());
+
+            bool closing() const { return closing_; }
+
+        private:
+            void onControlFrame(const TcpConnectionPtr &conn, WebSocketCodec::Opcode opcode, const StringPiece &payload);
+
+            /// Checks text messages before the callback, false if the connection is being closed.
+            bool deliver(const TcpConnectionPtr &conn, WebSocketCodec::Opcode opcode, const StringPiece &message,
+                         const WebSocketCallback &cb);
+
+            size_t maxMessageSize_;
+            WebSocketCodec::Opcode fragmentOpcode_;     // kContinuation表示不在分片的消息中
+            string fragments_;
+            bool closing_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_WEBSOCKETCONTEXT_H
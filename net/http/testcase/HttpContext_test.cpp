@@ -0,0 +1,127 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+/*
+ *      HttpContext测试
+ *
+ *      1. 请求按任意位置切开，逐段到达，解析结果相同
+ *      2. 同一个Buffer中的流水线请求依次解析
+ *      3. Content-Length和chunked的body
+ *      4. 错误的请求，包括body长度有歧义的请求（重复的Content-Length，Content-Length和chunked同时出现）
+ *      5. 没有设置状态码的HttpResponse编码为200 OK
+ */
+
+#include "../HttpContext.h"
+#include "../HttpResponse.h"
+#include "../../Buffer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void testSplit() {
+    string request = "GET /index.html?a=1&b=2 HTTP/1.1\r\n"
+                     "Host: www.example.com\r\n"
+                     "User-Agent:  test \r\n"
+                     "Accept: */*\r\n"
+                     "\r\n";
+    for (size_t split = 0; split <= request.size(); ++split) {
+        HttpContext context;
+        Buffer input;
+        input.append(request.data(), split);
+        HttpContext::ParseResult result = context.parseRequest(&input, Timestamp::now());
+        if (split < request.size()) {
+            assert(result == HttpContext::kIncomplete);
+            input.append(request.data() + split, request.size() - split);
+            result = context.parseRequest(&input, Timestamp::now());
+        }
+        assert(result == HttpContext::kComplete);
+        const HttpRequest &req = context.request();
+        assert(req.method() == HttpRequest::kGet);
+        assert(req.getVersion() == HttpRequest::kHttp11);
+        assert(req.path() == "/index.html");
+        assert(req.query() == "a=1&b=2");
+        assert(req.getHeader("host") == "www.example.com");
+        assert(req.getHeader("User-Agent") == "test");
+        assert(req.getHeader("Accept-Encoding").empty());
+        assert(req.body().empty());
+        assert(context.requestLength() == request.size());
+    }
+    printf("split ok\n");
+}
+
+void testPipeline() {
+    Buffer input;
+    input.append("POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+                 "GET /b HTTP/1.0\r\n\r\n"
+                 "PUT /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "3\r\nabc\r\n"
+                 "A;ext=1\r\n0123456789\r\n"
+                 "0\r\nTrailer: x\r\n\r\n"
+                 "GET /d HTTP/1.1\r\nHost:");
+    HttpContext context;
+    std::vector<string> paths;
+    std::vector<string> bodies;
+    while (context.parseRequest(&input, Timestamp::now()) == HttpContext::kComplete) {
+        paths.push_back(context.request().path().as_string());
+        bodies.push_back(context.request().body().as_string());
+        input.retrieve(context.requestLength());
+        context.reset();
+    }
+    assert(paths.size() == 3);
+    assert(paths[0] == "/a" && bodies[0] == "hello");
+    assert(paths[1] == "/b" && bodies[1].empty());
+    assert(paths[2] == "/c" && bodies[2] == "abc0123456789");
+    assert(input.toStringPiece() == "GET /d HTTP/1.1\r\nHost:");
+    printf("pipeline ok\n");
+}
+
+void testError() {
+    const char *bad[] = {
+            "BREW /pot HTTP/1.1\r\n\r\n",
+            "GET /x HTTP/2.0\r\n\r\n",
+            "GET /x\r\n\r\n",
+            "GET /x HTTP/1.1\r\nno colon\r\n\r\n",
+            "GET /x HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+            "POST /x HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+            "POST /x HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\nhello!",
+            "POST /x HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\nhello",
+            "POST /x HTTP/1.1\r\nContent-Length: 5, 5\r\n\r\nhello",
+            "POST /x HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+            "POST /x HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 0\r\n\r\n0\r\n\r\n",
+    };
+    for (const char *req : bad) {
+        HttpContext context;
+        Buffer input;
+        input.append(req);
+        assert(context.parseRequest(&input, Timestamp::now()) == HttpContext::kError);
+    }
+
+    // header太长
+    HttpContext context;
+    Buffer input;
+    input.append("GET / HTTP/1.1\r\n");
+    input.append("X: " + string(HttpContext::kMaxHeaderSize, 'x'));
+    assert(context.parseRequest(&input, Timestamp::now()) == HttpContext::kError);
+    printf("error ok\n");
+}
+
+void testDefaultStatus() {
+    HttpResponse resp(false);
+    resp.setBody("hi");
+    Buffer output;
+    resp.appendHeadersToBuffer(&output);
+    assert(output.retrieveAllAsString().compare(0, 17, "HTTP/1.1 200 OK\r\n") == 0);
+    printf("default status ok\n");
+}
+
+int main() {
+    testSplit();
+    testPipeline();
+    testError();
+    testDefaultStatus();
+    printf("all passed\n");
+}
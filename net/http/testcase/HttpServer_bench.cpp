@@ -0,0 +1,116 @@
+//
+// Created by chen on 2022/11/26.
+//
+
+/*
+ *      HttpServer压测，类似wrk：同一进程内用MultiClient发起请求
+ *
+ *      每条连接保持depth个流水线请求在路上，收到几个应答就再发几个请求，运行若干秒后统计每秒请求数，
+ *      以及平均到每个服务端IO线程（一个核）的每秒请求数。
+ *
+ *      用法：httpserver_bench [服务端线程数] [连接数] [流水线深度] [秒数] [body字节数]
+ *      客户端使用同样多的线程，机器的核数最好不少于两倍的服务端线程数。
+ */
+
+#include "../../../base/Logging.h"
+#include "../../EventLoop.h"
+#include "../../MultiClient.h"
+#include "../HttpRequest.h"
+#include "../HttpResponse.h"
+#include "../HttpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const string kRequest = "GET /hello HTTP/1.1\r\nHost: bench\r\n\r\n";
+string g_body;
+string g_requests;          // depth个请求
+size_t g_responseSize = 0;
+AtomicInt64 g_responses;
+
+void onRequest(const HttpRequest &req, HttpResponse *resp) {
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setContentType("text/plain");
+    resp->setBodyView(g_body);
+}
+
+void onClientConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        conn->setTcpNoDelay(true);
+        conn->send(g_requests);
+    }
+}
+
+/*
+ *      所有应答一样长，按长度数出收到了几个
+ */
+void onClientMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    size_t n = buf->readableBytes() / g_responseSize;
+    if (n > 0) {
+        buf->retrieve(n * g_responseSize);
+        g_responses.add(static_cast<int64_t>(n));
+        // 在路上的请求不超过depth个，所以n <= depth
+        conn->send(g_requests.data(), static_cast<int>(n * kRequest.size()));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 1;
+    int numConns = argc > 2 ? atoi(argv[2]) : 100;
+    int depth = argc > 3 ? atoi(argv[3]) : 1;
+    double seconds = argc > 4 ? atof(argv[4]) : 5.0;
+    int bodySize = argc > 5 ? atoi(argv[5]) : 5;
+    Logger::setLogLevel(Logger::ERROR);
+
+    g_body.assign(static_cast<size_t>(bodySize), 'x');
+    for (int i = 0; i < depth; ++i) {
+        g_requests += kRequest;
+    }
+    {
+        HttpResponse resp(false);
+        onRequest(HttpRequest(), &resp);
+        Buffer buf;
+        resp.appendHeadersToBuffer(&buf);
+        g_responseSize = buf.readableBytes() + g_body.size();
+    }
+
+    EventLoop loop;
+    InetAddress listenAddr("127.0.0.1", 19983);
+    HttpServer server(&loop, listenAddr, "HttpBench");
+    server.setHttpCallback(onRequest);
+    server.setThreadNum(threads);
+    server.start();
+
+    MultiClient client(&loop, "wrk");
+    client.setThreadNum(threads);
+    client.setConnectionCallback(onClientConnection);
+    client.setMessageCallback(onClientMessage);
+    for (int i = 0; i < numConns; ++i) {
+        client.addPeer(listenAddr);
+    }
+    client.start();
+
+    // 预热1秒后开始计数
+    int64_t startCount = 0;
+    Timestamp start;
+    loop.runAfter(1.0, [&]() {
+        startCount = g_responses.get();
+        start = Timestamp::now();
+    });
+    loop.runAfter(1.0 + seconds, [&]() {
+        int64_t count = g_responses.get() - startCount;
+        double elapsed = timeDifference(Timestamp::now(), start);
+        double qps = static_cast<double>(count) / elapsed;
+        printf("%d server threads, %d connections, pipeline %d, body %d bytes\n",
+               threads, numConns, depth, bodySize);
+        printf("%.0f requests/sec, %.0f requests/sec per server thread\n", qps, qps / std::max(threads, 1));
+        Logger::setLogLevel(Logger::FATAL);     // 退出时服务端还在写已经关闭的连接
+        loop.quit();
+    });
+    loop.loop();
+}
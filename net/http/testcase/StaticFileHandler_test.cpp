@@ -0,0 +1,285 @@
+//
+// Created by chen on 2022/11/27.
+//
+
+/*
+ *      StaticFileHandler测试
+ *
+ *      1. 未命中/命中、ETag和304、路径检查、404
+ *      2. 不跟随root之下的符号链接：指向root之外的文件和目录、指向root之内的文件都返回404；root本身可以是符号链接
+ *      3. 大文件不映射，以文件作为body
+ *      4. 用rename()替换文件后，inotify使缓存失效，之后读到新内容
+ *      5. 文件被原地截断后，之前的应答仍然持有完整的内容
+ *      6. 上级目录被改名后，其下的缓存项失效
+ *      7. 通过HttpServer请求：大文件用sendfile()发送，流水线的下一个应答排在文件之后
+ */
+
+#include "../../../base/Thread.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../HttpContext.h"
+#include "../HttpResponse.h"
+#include "../HttpServer.h"
+#include "../StaticFileHandler.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kBigSize = 2 * 1024 * 1024 + 123;
+const uint16_t kPort = 19984;
+
+string g_dir;
+
+void writeFile(const string &name, const string &content) {
+    string path = g_dir + name;
+    FILE *fp = ::fopen(path.c_str(), "w");
+    assert(fp);
+    ::fwrite(content.data(), 1, content.size(), fp);
+    ::fclose(fp);
+}
+
+string bigContent() {
+    string content(kBigSize, '\0');
+    for (size_t i = 0; i < kBigSize; ++i) {
+        content[i] = static_cast<char>('a' + i % 26);
+    }
+    return content;
+}
+
+struct Result {
+    HttpResponse resp;
+    string headers;
+
+    Result() : resp(false) {}
+};
+
+Result get(StaticFileHandler *handler, const string &path, const string &extraHeaders = "") {
+    Buffer input;
+    input.append("GET " + path + " HTTP/1.1\r\n" + extraHeaders + "\r\n");
+    HttpContext context;
+    HttpContext::ParseResult parsed = context.parseRequest(&input, Timestamp::now());
+    assert(parsed == HttpContext::kComplete);
+    (void) parsed;
+    Result result;
+    handler->handle(context.request(), &result.resp);
+    Buffer output;
+    result.resp.appendHeadersToBuffer(&output);
+    result.headers = output.retrieveAllAsString();
+    return result;
+}
+
+string etagOf(const string &headers) {
+    size_t start = headers.find("ETag: ");
+    assert(start != string::npos);
+    start += 6;
+    return headers.substr(start, headers.find("\r\n", start) - start);
+}
+
+void testCache(StaticFileHandler *handler) {
+    Result r = get(handler, "/");
+    assert(r.resp.statusCode() == HttpResponse::k200Ok);
+    assert(r.resp.body() == "hello");
+    assert(r.headers.find("Content-Type: text/html") != string::npos);
+    assert(r.headers.find("Last-Modified: ") != string::npos);
+    assert(handler->numMisses() == 1 && handler->numHits() == 0);
+
+    r = get(handler, "/./index.html");
+    assert(r.resp.body() == "hello");
+    assert(handler->numMisses() == 1 && handler->numHits() == 1);
+
+    string etag = etagOf(r.headers);
+    r = get(handler, "/index.html", "If-None-Match: " + etag + "\r\n");
+    assert(r.resp.statusCode() == HttpResponse::k304NotModified);
+    assert(r.resp.body().empty());
+    r = get(handler, "/index.html", "If-None-Match: \"0-0\"\r\n");
+    assert(r.resp.statusCode() == HttpResponse::k200Ok);
+
+    r = get(handler, "/sub/a%2etxt");
+    assert(r.resp.body() == "sub file");
+    assert(r.headers.find("Content-Type: text/plain") != string::npos);
+
+    assert(get(handler, "/../etc/passwd").resp.statusCode() == HttpResponse::k403Forbidden);
+    assert(get(handler, "/sub/%2e%2e/%2e%2e/x").resp.statusCode() == HttpResponse::k403Forbidden);
+    assert(get(handler, "/nope.html").resp.statusCode() == HttpResponse::k404NotFound);
+    assert(get(handler, "/sub").resp.statusCode() == HttpResponse::k404NotFound);
+
+    r = get(handler, "/big.bin");
+    assert(r.resp.hasBodyFile());
+    assert(r.resp.bodyFileLength() == kBigSize);
+    assert(r.headers.find("Content-Length: " + std::to_string(kBigSize)) != string::npos);
+    assert(handler->numEntries() == 3);
+    assert(handler->cachedBytes() > 13 && handler->cachedBytes() < 4096);
+    printf("cache ok\n");
+}
+
+void testSymlink(EventLoop *loop) {
+    string outside = g_dir + "_outside";
+    ::mkdir(outside.c_str(), 0755);
+    FILE *fp = ::fopen((outside + "/secret.txt").c_str(), "w");
+    assert(fp);
+    ::fputs("secret", fp);
+    ::fclose(fp);
+    int ret = ::symlink((outside + "/secret.txt").c_str(), (g_dir + "/secret.txt").c_str());
+    ret |= ::symlink(outside.c_str(), (g_dir + "/outside").c_str());
+    ret |= ::symlink("index.html", (g_dir + "/index-link.html").c_str());
+    ret |= ::symlink(g_dir.c_str(), (outside + "/root-link").c_str());
+    assert(ret == 0);
+    (void) ret;
+
+    {
+        StaticFileHandler handler(loop, g_dir);
+        assert(get(&handler, "/secret.txt").resp.statusCode() == HttpResponse::k404NotFound);
+        assert(get(&handler, "/outside/secret.txt").resp.statusCode() == HttpResponse::k404NotFound);
+        assert(get(&handler, "/sub/../outside/secret.txt").resp.statusCode() == HttpResponse::k403Forbidden);
+        assert(get(&handler, "/index-link.html").resp.statusCode() == HttpResponse::k404NotFound);
+        assert(get(&handler, "/sub/a.txt").resp.body() == "sub file");
+    }
+    {
+        StaticFileHandler handler(loop, outside + "/root-link");
+        assert(get(&handler, "/sub/a.txt").resp.body() == "sub file");
+    }
+
+    ::unlink((outside + "/root-link").c_str());
+    ::unlink((g_dir + "/index-link.html").c_str());
+    ::unlink((g_dir + "/outside").c_str());
+    ::unlink((g_dir + "/secret.txt").c_str());
+    ::unlink((outside + "/secret.txt").c_str());
+    ::rmdir(outside.c_str());
+    printf("symlink ok\n");
+}
+
+void testTruncate(StaticFileHandler *handler) {
+    writeFile("/trunc.txt", "will be truncated");
+    Result r = get(handler, "/trunc.txt");
+    assert(get(handler, "/trunc.txt").resp.body() == "will be truncated");
+    int ret = ::truncate((g_dir + "/trunc.txt").c_str(), 0);
+    assert(ret == 0);
+    (void) ret;
+    assert(r.resp.body() == "will be truncated");
+    ::unlink((g_dir + "/trunc.txt").c_str());
+    printf("truncate ok\n");
+}
+
+/*
+ *      缓存/deep/dir/b.txt之后把/deep改名，再建一个新的/deep/dir/b.txt
+ */
+void testAncestorRename(EventLoop *loop, StaticFileHandler *handler) {
+    ::mkdir((g_dir + "/deep").c_str(), 0755);
+    ::mkdir((g_dir + "/deep/dir").c_str(), 0755);
+    writeFile("/deep/dir/b.txt", "old");
+    assert(get(handler, "/deep/dir/b.txt").resp.body() == "old");
+
+    int ret = ::rename((g_dir + "/deep").c_str(), (g_dir + "/deep.old").c_str());
+    ret |= ::mkdir((g_dir + "/deep").c_str(), 0755);
+    ret |= ::mkdir((g_dir + "/deep/dir").c_str(), 0755);
+    assert(ret == 0);
+    (void) ret;
+    writeFile("/deep/dir/b.txt", "new");
+    loop->runAfter(0.1, [&]() {
+        assert(get(handler, "/deep/dir/b.txt").resp.body() == "new");
+        loop->quit();
+    });
+    loop->loop();
+
+    ::unlink((g_dir + "/deep/dir/b.txt").c_str());
+    ::unlink((g_dir + "/deep.old/dir/b.txt").c_str());
+    ::rmdir((g_dir + "/deep/dir").c_str());
+    ::rmdir((g_dir + "/deep.old/dir").c_str());
+    ::rmdir((g_dir + "/deep").c_str());
+    ::rmdir((g_dir + "/deep.old").c_str());
+    printf("ancestor rename ok\n");
+}
+
+/*
+ *      阻塞的客户端：发送两个流水线请求，读到对方关闭连接为止
+ */
+void clientThread(EventLoop *loop, bool *ok) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int ret = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr);
+    assert(ret == 0);
+    (void) ret;
+    string request = "GET /big.bin HTTP/1.1\r\n\r\n"
+                     "GET / HTTP/1.1\r\nConnection: close\r\n\r\n";
+    ssize_t nw = ::write(fd, request.data(), request.size());
+    assert(nw == static_cast<ssize_t>(request.size()));
+    (void) nw;
+
+    string received;
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        received.append(buf, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    size_t headerEnd = received.find("\r\n\r\n");
+    size_t secondStart = headerEnd + 4 + kBigSize;
+    *ok = received.compare(0, 15, "HTTP/1.1 200 OK") == 0 &&
+          received.size() > secondStart &&
+          received.compare(headerEnd + 4, kBigSize, bigContent()) == 0 &&
+          received.compare(secondStart, 15, "HTTP/1.1 200 OK") == 0 &&
+          received.compare(received.size() - 6, 6, "world!") == 0;
+    loop->queueInLoop(std::bind(&EventLoop::quit, loop));
+}
+
+int main() {
+    char dirTemplate[] = "/tmp/staticfile_test_XXXXXX";
+    char *dir = ::mkdtemp(dirTemplate);
+    assert(dir);
+    g_dir = dir;
+    ::mkdir((g_dir + "/sub").c_str(), 0755);
+    writeFile("/index.html", "hello");
+    writeFile("/sub/a.txt", "sub file");
+    writeFile("/big.bin", bigContent());
+
+    EventLoop loop;
+    StaticFileHandler handler(&loop, g_dir + "/", 1024 * 1024, 64 * 1024);
+    testCache(&handler);
+    testSymlink(&loop);
+
+    // 先写到临时文件再rename()，inotify事件由loop处理
+    writeFile("/index.html.tmp", "world!");
+    ::rename((g_dir + "/index.html.tmp").c_str(), (g_dir + "/index.html").c_str());
+    loop.runAfter(0.1, [&]() {
+        assert(handler.numInvalidations() == 1);
+        Result r = get(&handler, "/");
+        assert(r.resp.body() == "world!");
+        printf("invalidate ok\n");
+        loop.quit();
+    });
+    loop.loop();
+    testTruncate(&handler);
+    testAncestorRename(&loop, &handler);
+
+    HttpServer server(&loop, InetAddress("127.0.0.1", kPort), "StaticFileServer");
+    server.setHttpCallback(std::bind(&StaticFileHandler::handle, &handler, _1, _2));
+    server.start();
+    bool ok = false;
+    Thread client(std::bind(clientThread, &loop, &ok), "client");
+    client.start();
+    loop.loop();
+    client.join();
+    assert(ok);
+    printf("sendfile ok\n");
+
+    ::unlink((g_dir + "/index.html").c_str());
+    ::unlink((g_dir + "/sub/a.txt").c_str());
+    ::unlink((g_dir + "/big.bin").c_str());
+    ::rmdir((g_dir + "/sub").c_str());
+    ::rmdir(g_dir.c_str());
+}
@@ -0,0 +1,238 @@
+//
+// Created by chen on 2022/11/30.
+//
+
+/*
+ *      WebSocket压测
+ *
+ *      1. mask：各个实现在不同长度的payload上的吞吐量（GB/s），数据在L1/L2中时差别最明显
+ *      2. 端到端：同一进程内的HttpServer和客户端，客户端连续发送预先mask好的帧，
+ *         服务端在inputBuffer中就地unmask后交给回调，统计每秒消息数和MB/s。
+ *         每一组结束时发送一个"sync"消息，服务端回复后说明之前的帧都已处理完。
+ *
+ *      用法：websocket_bench [每组秒数]
+ */
+
+#include "../../../base/Logging.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../../TcpClient.h"
+#include "../HttpServer.h"
+#include "../WebSocketCodec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kMaskKey[4] = {0x12, 0x34, 0x56, 0x78};
+const size_t kMaskSizes[] = {16, 125, 1024, 16 * 1024, 64 * 1024, 1024 * 1024};
+const size_t kFrameSizes[] = {16, 125, 1024, 16 * 1024, 64 * 1024};
+const size_t kBatchBytes = 256 * 1024;
+
+std::vector<WebSocketCodec::MaskKernel> supportedKernels() {
+    std::vector<WebSocketCodec::MaskKernel> kernels;
+    const WebSocketCodec::MaskKernel all[] = {WebSocketCodec::kScalar, WebSocketCodec::kSse2,
+                                              WebSocketCodec::kAvx2};
+    for (WebSocketCodec::MaskKernel kernel : all) {
+        if (kernel <= WebSocketCodec::bestMaskKernel()) {
+            kernels.push_back(kernel);
+        }
+    }
+    return kernels;
+}
+
+void benchMask(double seconds) {
+    printf("%10s", "bytes");
+    for (WebSocketCodec::MaskKernel kernel : supportedKernels()) {
+        printf(" %10s", WebSocketCodec::maskKernelName(kernel));
+    }
+    printf("   (GB/s)\n");
+    for (size_t size : kMaskSizes) {
+        string data(size, 'x');
+        printf("%10zu", size);
+        for (WebSocketCodec::MaskKernel kernel : supportedKernels()) {
+            WebSocketCodec::setMaskKernel(kernel);
+            int64_t bytes = 0;
+            Timestamp start = Timestamp::now();
+            double elapsed = 0;
+            while (elapsed < seconds) {
+                for (int i = 0; i < 64; ++i) {
+                    WebSocketCodec::mask(&data[0], size, kMaskKey);
+                }
+                bytes += static_cast<int64_t>(size) * 64;
+                elapsed = timeDifference(Timestamp::now(), start);
+            }
+            printf(" %10.2f", static_cast<double>(bytes) / elapsed / 1e9);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    WebSocketCodec::setMaskKernel(WebSocketCodec::bestMaskKernel());
+}
+
+class EndToEnd : noncopyable {
+public:
+    EndToEnd(EventLoop *loop, const InetAddress &addr, double seconds)
+            : loop_(loop),
+              client_(loop, addr, "WebSocketBenchClient"),
+              seconds_(seconds),
+              phase_(0),
+              handshaken_(false),
+              syncing_(false),
+              frames_(0),
+              framesPerBatch_(0) {
+        client_.setConnectionCallback(std::bind(&EndToEnd::onConnection, this, _1));
+        client_.setMessageCallback(std::bind(&EndToEnd::onMessage, this, _1, _2));
+        client_.setWriteCompleteCallback(std::bind(&EndToEnd::onWriteComplete, this, _1));
+        for (WebSocketCodec::MaskKernel kernel : supportedKernels()) {
+            for (size_t size : kFrameSizes) {
+                phases_.push_back(std::make_pair(kernel, size));
+            }
+        }
+    }
+
+    void start() {
+        printf("%10s %10s %12s %10s\n", "kernel", "bytes", "msgs/sec", "MB/s");
+        client_.connect();
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn) {
+        if (!conn->connected()) {
+            // 等服务端的连接也关闭后再退出
+            loop_->runAfter(0.2, std::bind(&EventLoop::quit, loop_));
+            return;
+        }
+        conn_ = conn;
+        conn->send("GET / HTTP/1.1\r\n"
+                   "Upgrade: websocket\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                   "Sec-WebSocket-Version: 13\r\n"
+                   "\r\n");
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf) {
+        if (!handshaken_) {
+            const char *crlf = buf->findCRLF();
+            // 101应答没有body，找到空行即可
+            const char *end = NULL;
+            while (crlf && !end) {
+                if (crlf + 4 <= buf->beginWrite() && ::memcmp(crlf, "\r\n\r\n", 4) == 0) {
+                    end = crlf + 4;
+                }
+                crlf = buf->findCRLF(crlf + 2);
+            }
+            if (!end) {
+                return;
+            }
+            buf->retrieveUntil(end);
+            handshaken_ = true;
+            startPhase();
+        }
+        WebSocketCodec::FrameHeader header;
+        while (WebSocketCodec::parseHeader(buf->peek(), buf->readableBytes(), &header) == WebSocketCodec::kComplete &&
+               buf->readableBytes() >= header.headerLen + header.payloadLen) {
+            buf->retrieve(header.headerLen + static_cast<size_t>(header.payloadLen));
+            if (header.opcode == WebSocketCodec::kText) {
+                finishPhase();
+            } else if (header.opcode == WebSocketCodec::kClose) {
+                conn->shutdown();
+            }
+        }
+    }
+
+    void startPhase() {
+        if (phase_ == phases_.size()) {
+            Buffer close;
+            WebSocketCodec::appendFrame(&close, WebSocketCodec::kClose, StringPiece("\x03\xe8", 2), true, kMaskKey);
+            conn_->send(&close);
+            return;
+        }
+        // 只在两组之间切换实现，这时服务端没有待处理的帧
+        WebSocketCodec::setMaskKernel(phases_[phase_].first);
+        size_t size = phases_[phase_].second;
+        string payload(size, 'x');
+        Buffer batch;
+        framesPerBatch_ = 0;
+        do {
+            WebSocketCodec::appendFrame(&batch, WebSocketCodec::kBinary, payload, true, kMaskKey);
+            ++framesPerBatch_;
+        } while (batch.readableBytes() < kBatchBytes);
+        batch_ = batch.retrieveAllAsString();
+        frames_ = 0;
+        syncing_ = false;
+        start_ = Timestamp::now();
+        sendBatch();
+    }
+
+    void sendBatch() {
+        frames_ += framesPerBatch_;
+        conn_->send(batch_);
+    }
+
+    void onWriteComplete(const TcpConnectionPtr &) {
+        if (!handshaken_ || syncing_ || phase_ == phases_.size()) {
+            return;
+        }
+        if (timeDifference(Timestamp::now(), start_) < seconds_) {
+            sendBatch();
+        } else {
+            syncing_ = true;
+            Buffer sync;
+            WebSocketCodec::appendFrame(&sync, WebSocketCodec::kText, "sync", true, kMaskKey);
+            conn_->send(&sync);
+        }
+    }
+
+    void finishPhase() {
+        double elapsed = timeDifference(Timestamp::now(), start_);
+        size_t size = phases_[phase_].second;
+        printf("%10s %10zu %12.0f %10.1f\n", WebSocketCodec::maskKernelName(phases_[phase_].first), size,
+               static_cast<double>(frames_) / elapsed,
+               static_cast<double>(frames_) * static_cast<double>(size) / elapsed / 1e6);
+        fflush(stdout);
+        ++phase_;
+        startPhase();
+    }
+
+    EventLoop *loop_;
+    TcpClient client_;
+    TcpConnectionPtr conn_;
+    const double seconds_;
+    std::vector<std::pair<WebSocketCodec::MaskKernel, size_t>> phases_;
+    size_t phase_;
+    bool handshaken_;
+    bool syncing_;
+    int64_t frames_;
+    int64_t framesPerBatch_;
+    string batch_;
+    Timestamp start_;
+};
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    Logger::setLogLevel(Logger::WARN);
+    printf("best mask kernel: %s\n", WebSocketCodec::maskKernelName(WebSocketCodec::bestMaskKernel()));
+    benchMask(seconds / 4);
+
+    EventLoop loop;
+    InetAddress addr("127.0.0.1", 19992);
+    HttpServer server(&loop, addr, "WebSocketBench");
+    server.setThreadNum(1);
+    server.setWebSocketCallback([](const TcpConnectionPtr &conn, WebSocketCodec::Opcode opcode,
+                                   const StringPiece &message) {
+        if (opcode == WebSocketCodec::kText) {
+            WebSocketCodec::send(conn, message);
+        }
+    });
+    server.start();
+
+    EndToEnd bench(&loop, addr, seconds);
+    bench.start();
+    loop.loop();
+}
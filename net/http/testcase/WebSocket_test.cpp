@@ -0,0 +1,252 @@
+//
+// Created by chen on 2022/11/30.
+//
+
+/*
+ *      WebSocket测试
+ *
+ *      1. Sec-WebSocket-Accept使用RFC 6455中的例子
+ *      2. 各个mask实现和逐字节异或的结果相同，覆盖各种长度和起始offset
+ *      3. 帧头的三种长度编码、不完整的帧头、非法的帧头
+ *      4. UTF-8检查：合法的多字节字符，超长编码、代理区、超出U+10FFFF、截断的序列
+ *      5. 通过HttpServer握手，和握手请求一起发送：分片的文本消息（中间插入ping）、较大的二进制消息、close，
+ *         检查101应答、pong、回显的消息和close应答的顺序
+ *      6. 消息大小限制为100字节：90字节的分片之间插入一个比剩余额度大的ping，仍然回复pong；
+ *         拼起来正好100字节的消息正常回显；之后不是UTF-8的文本消息以1007关闭
+ */
+
+#include "../../../base/Logging.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../../TcpClient.h"
+#include "../HttpRequest.h"
+#include "../HttpServer.h"
+#include "../WebSocketCodec.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const char kMaskKey[4] = {0x37, static_cast<char>(0xfa), 0x21, 0x3d};
+
+void testAcceptKey() {
+    assert(WebSocketCodec::acceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    printf("accept key ok\n");
+}
+
+void testMask() {
+    const WebSocketCodec::MaskKernel kernels[] = {WebSocketCodec::kScalar, WebSocketCodec::kSse2,
+                                                  WebSocketCodec::kAvx2};
+    WebSocketCodec::MaskKernel best = WebSocketCodec::bestMaskKernel();
+    string data(300, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(rand());
+    }
+    for (WebSocketCodec::MaskKernel kernel : kernels) {
+        WebSocketCodec::setMaskKernel(kernel);
+        for (size_t len = 0; len <= data.size(); ++len) {
+            for (size_t offset = 0; offset < 4; ++offset) {
+                string masked(data, 0, len);
+                WebSocketCodec::mask(&masked[0], len, kMaskKey, offset);
+                for (size_t i = 0; i < len; ++i) {
+                    assert(masked[i] == static_cast<char>(data[i] ^ kMaskKey[(offset + i) % 4]));
+                }
+            }
+        }
+        printf("mask %s ok\n", WebSocketCodec::maskKernelName(WebSocketCodec::maskKernel()));
+    }
+    WebSocketCodec::setMaskKernel(best);
+}
+
+void testHeader() {
+    const uint64_t lens[] = {0, 125, 126, 65535, 65536, 1ULL << 40};
+    for (uint64_t len : lens) {
+        for (int masked = 0; masked < 2; ++masked) {
+            Buffer buf;
+            WebSocketCodec::appendHeader(&buf, WebSocketCodec::kBinary, len, masked == 0, masked ? kMaskKey : NULL);
+            WebSocketCodec::FrameHeader header;
+            for (size_t n = 0; n < buf.readableBytes(); ++n) {
+                assert(WebSocketCodec::parseHeader(buf.peek(), n, &header) == WebSocketCodec::kIncomplete);
+            }
+            assert(WebSocketCodec::parseHeader(buf.peek(), buf.readableBytes(), &header) == WebSocketCodec::kComplete);
+            assert(header.opcode == WebSocketCodec::kBinary);
+            assert(header.fin == (masked == 0));
+            assert(header.masked == (masked == 1));
+            assert(!masked || ::memcmp(header.maskKey, kMaskKey, 4) == 0);
+            assert(header.headerLen == buf.readableBytes());
+            assert(header.payloadLen == len);
+        }
+    }
+
+    const char *bad[] = {
+            "\xc1\x00",         // RSV1
+            "\x83\x00",         // 保留的opcode
+            "\x09\x00",         // 分片的ping
+            "\x89\x7e\x00\x7e", // 超过125字节的ping
+            "\x82\x7f\x80\x00\x00\x00\x00\x00\x00\x00",
+    };
+    const size_t badLens[] = {2, 2, 2, 4, 10};
+    for (size_t i = 0; i < sizeof bad / sizeof bad[0]; ++i) {
+        WebSocketCodec::FrameHeader header;
+        assert(WebSocketCodec::parseHeader(bad[i], badLens[i], &header) == WebSocketCodec::kError);
+        (void) header;
+    }
+    printf("header ok\n");
+}
+
+void testUtf8() {
+    const char *valid[] = {"", "hello", "\xc3\xa9t\xc3\xa9", "\xe4\xb8\xad\xe6\x96\x87", "\xf0\x9f\x98\x80",
+                           "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf", "0123456789abcdef\xc2\x80"};
+    const char *invalid[] = {"\x80", "\xc0\xaf", "\xc1\xbf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf0\x80\x80\xaf",
+                             "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff", "\xe4\xb8", "0123456789abcdef\xc3"};
+    for (const char *str : valid) {
+        assert(WebSocketCodec::isValidUtf8(str, strlen(str)));
+    }
+    for (const char *str : invalid) {
+        assert(!WebSocketCodec::isValidUtf8(str, strlen(str)));
+    }
+    printf("utf8 ok\n");
+}
+
+struct Frame {
+    WebSocketCodec::Opcode opcode;
+    string payload;
+};
+
+/*
+ *      握手请求和frames一起发送，返回服务端在关闭连接之前发来的全部数据
+ */
+string exchange(const std::vector<Frame> &frames, size_t maxMessageSize) {
+    EventLoop loop;
+    InetAddress addr("127.0.0.1", 19991);
+    HttpServer server(&loop, addr, "WebSocketTest");
+    server.setThreadNum(1);
+    server.setWebSocketMaxMessageSize(maxMessageSize);
+    server.setWebSocketCallback([](const TcpConnectionPtr &conn, WebSocketCodec::Opcode opcode,
+                                   const StringPiece &message) {
+        WebSocketCodec::send(conn, message, opcode);
+    });
+    server.setWebSocketOpenCallback([](const TcpConnectionPtr &, const HttpRequest &req) {
+        return req.path() == "/ws";
+    });
+    server.start();
+
+    // 服务端回复close后shutdown()，客户端读到0字节时连接关闭
+    string received;
+    TcpClient client(&loop, addr, "WebSocketTestClient");
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            Buffer request;
+            request.append("GET /ws HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: keep-alive, Upgrade\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                           "Sec-WebSocket-Version: 13\r\n"
+                           "\r\n");
+            for (size_t i = 0; i < frames.size(); ++i) {
+                // 数据帧后面（跳过插入的控制帧）是continuation时不是最后一个分片
+                bool fin = true;
+                if (frames[i].opcode < WebSocketCodec::kClose) {
+                    for (size_t j = i + 1; j < frames.size(); ++j) {
+                        if (frames[j].opcode == WebSocketCodec::kContinuation) {
+                            fin = false;
+                            break;
+                        } else if (frames[j].opcode < WebSocketCodec::kClose) {
+                            break;
+                        }
+                    }
+                }
+                WebSocketCodec::appendFrame(&request, frames[i].opcode, frames[i].payload, fin, kMaskKey);
+            }
+            conn->send(&request);
+        } else {
+            loop.runAfter(0.1, std::bind(&EventLoop::quit, &loop));
+        }
+    });
+    client.setMessageCallback([&received](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+        received += buf->retrieveAllAsString();
+    });
+    client.connect();
+    loop.runAfter(5.0, []() {
+        printf("timeout\n");
+        abort();
+    });
+    loop.loop();
+    return received;
+}
+
+/*
+ *      101应答之后依次是expected中的帧
+ */
+void verify(const string &received, const std::vector<Frame> &expected) {
+    size_t headerEnd = received.find("\r\n\r\n");
+    assert(headerEnd != string::npos);
+    string response = received.substr(0, headerEnd + 4);
+    assert(response.find("HTTP/1.1 101 Switching Protocols\r\n") == 0);
+    assert(response.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != string::npos);
+
+    size_t offset = headerEnd + 4;
+    for (const Frame &frame : expected) {
+        WebSocketCodec::FrameHeader header;
+        WebSocketCodec::ParseResult result = WebSocketCodec::parseHeader(received.data() + offset,
+                                                                         received.size() - offset, &header);
+        assert(result == WebSocketCodec::kComplete);
+        assert(header.fin && !header.masked && header.opcode == frame.opcode);
+        assert(received.compare(offset + header.headerLen, static_cast<size_t>(header.payloadLen), frame.payload) == 0);
+        offset += header.headerLen + static_cast<size_t>(header.payloadLen);
+        (void) result;
+    }
+    assert(offset == received.size());
+}
+
+const string kClose1000("\x03\xe8", 2);
+
+void testEcho() {
+    string binary(70000, '\0');
+    for (size_t i = 0; i < binary.size(); ++i) {
+        binary[i] = static_cast<char>(i * 7);
+    }
+    std::vector<Frame> frames = {{WebSocketCodec::kText, "Hel"},
+                                 {WebSocketCodec::kPing, "p"},
+                                 {WebSocketCodec::kContinuation, "lo"},
+                                 {WebSocketCodec::kBinary, binary},
+                                 {WebSocketCodec::kClose, kClose1000}};
+    std::vector<Frame> expected = {{WebSocketCodec::kPong, "p"},
+                                   {WebSocketCodec::kText, "Hello"},
+                                   {WebSocketCodec::kBinary, binary},
+                                   {WebSocketCodec::kClose, kClose1000}};
+    verify(exchange(frames, WebSocketContext::kDefaultMaxMessageSize), expected);
+    printf("websocket ok\n");
+}
+
+void testLimits() {
+    const string ping(20, 'p');
+    std::vector<Frame> frames = {{WebSocketCodec::kText, string(90, 'a')},
+                                 {WebSocketCodec::kPing, ping},
+                                 {WebSocketCodec::kContinuation, string(10, 'b')},
+                                 {WebSocketCodec::kText, "bad \xc0\xaf"},
+                                 {WebSocketCodec::kText, "never echoed"}};
+    std::vector<Frame> expected = {{WebSocketCodec::kPong, ping},
+                                   {WebSocketCodec::kText, string(90, 'a') + string(10, 'b')},
+                                   {WebSocketCodec::kClose, string("\x03\xef", 2)}};
+    verify(exchange(frames, 100), expected);
+    printf("message size and utf8 limits ok\n");
+}
+
+int main() {
+    testAcceptKey();
+    testMask();
+    testHeader();
+    testUtf8();
+
+    Logger::setLogLevel(Logger::WARN);
+    testEcho();
+    testLimits();
+}
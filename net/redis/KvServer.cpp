@@ -0,0 +1,465 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+#include "KvServer.h"
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../EventLoopThreadPool.h"
+#include "RespCodec.h"
+
+#include <strings.h>
+
+#include <deque>
+#include <unordered_map>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            enum KvCommand { kUnknown, kPing, kEcho, kGet, kSet, kDel, kMGet, kExists, kConfig, kCommand };
+
+            enum KvOpType { kOpGet, kOpSet, kOpDel, kOpExists };
+
+            KvCommand lookupCommand(const StringPiece &name) {
+                static const struct {
+                    const char *name;
+                    KvCommand command;
+                } kCommands[] = {
+                        {"GET",     kGet},
+                        {"SET",     kSet},
+                        {"MGET",    kMGet},
+                        {"DEL",     kDel},
+                        {"EXISTS",  kExists},
+                        {"PING",    kPing},
+                        {"ECHO",    kEcho},
+                        {"CONFIG",  kConfig},
+                        {"COMMAND", kCommand},
+                };
+                for (const auto &c : kCommands) {
+                    if (static_cast<size_t>(name.size()) == ::strlen(c.name) &&
+                        ::strncasecmp(name.data(), c.name, static_cast<size_t>(name.size())) == 0) {
+                        return c.command;
+                    }
+                }
+                return kUnknown;
+            }
+
+            // FNV-1a
+            uint32_t hashKey(const StringPiece &key) {
+                uint32_t h = 2166136261u;
+                for (int i = 0; i < key.size(); ++i) {
+                    h ^= static_cast<uint8_t>(key[i]);
+                    h *= 16777619u;
+                }
+                return h;
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+/*
+ *      只在loop线程中访问
+ */
+struct KvServer::Shard : noncopyable {
+    EventLoop *loop;
+    std::unordered_map<string, string> data;
+
+    explicit Shard(EventLoop *l) : loop(l) {}
+
+    void apply(Op *op);
+};
+
+/*
+ *      投递到其它分片执行的一个key操作，执行结果也写在里面
+ */
+struct KvServer::Op {
+    int type;
+    uint64_t seq;       // 所属命令的槽位
+    int index;          // 是命令中的第几个key
+    bool found;         // GET/EXISTS找到了，DEL删除了
+    string key;
+    string value;       // SET的值，GET的结果
+};
+
+void KvServer::Shard::apply(Op *op) {
+    switch (op->type) {
+        case detail::kOpGet: {
+            std::unordered_map<string, string>::const_iterator it = data.find(op->key);
+            op->found = it != data.end();
+            if (op->found) {
+                op->value = it->second;
+            }
+            break;
+        }
+        case detail::kOpSet:
+            data[op->key].swap(op->value);
+            op->found = true;
+            break;
+        case detail::kOpDel:
+            op->found = data.erase(op->key) > 0;
+            break;
+        default:
+            op->found = data.find(op->key) != data.end();
+            break;
+    }
+}
+
+/*
+ *      一个连接的状态，只在连接所在的loop中访问
+ *
+ *      slots_是还不能发送的应答，第一个槽位的序号是firstSeq_。
+ *      本地的命令在没有槽位时直接编码进output_；有槽位时也要排队，保证应答的顺序
+ */
+class KvServer::Session : noncopyable,
+                          public std::enable_shared_from_this<Session> {
+public:
+    Session(KvServer *server, const TcpConnectionPtr &conn, int shard)
+            : server_(server),
+              conn_(conn),
+              loop_(conn->getLoop()),
+              shardIndex_(shard),
+              shard_(server->shards_[static_cast<size_t>(shard)].get()),
+              batches_(server->shards_.size()),
+              firstSeq_(0),
+              closing_(false) {
+    }
+
+    void onMessage(Buffer *buf);
+
+    /// Results from another shard, in the session's loop.
+    static void complete(const std::weak_ptr<Session> &weakSession, const std::shared_ptr<OpBatch> &ops);
+
+private:
+    struct Slot {
+        int command;
+        int waiting;            // 还没返回的key操作
+        int64_t count;          // DEL/EXISTS
+        std::vector<std::pair<bool, string>> values;    // GET/MGET
+        string reply;           // 已经编码好的应答
+    };
+
+    void execute(const std::vector<StringPiece> &args);
+
+    void executeLocal(detail::KvCommand command, const std::vector<StringPiece> &args);
+
+    void reply(const Buffer &encoded);
+
+    void fill(Slot *slot, Op *op);
+
+    void flush();
+
+    KvServer *server_;
+    std::weak_ptr<TcpConnection> conn_;
+    EventLoop *loop_;
+    const int shardIndex_;
+    Shard *shard_;
+    std::vector<std::shared_ptr<OpBatch>> batches_;    // 本次onMessage()要投递给各个分片的操作
+    std::deque<Slot> slots_;
+    uint64_t firstSeq_;
+    Buffer output_;
+    bool closing_;
+};
+
+/*
+ *      用指针扫过所有完整的命令，最后一次retrieve()；跨分片的操作攒到最后，每个分片投递一次
+ */
+void KvServer::Session::onMessage(Buffer *buf) {
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *p = begin;
+    std::vector<StringPiece> args;
+    size_t consumed = 0;
+    RespCodec::ParseResult result;
+    while (!closing_ &&
+           (result = RespCodec::parseCommand(p, static_cast<size_t>(end - p), &args, &consumed))
+           != RespCodec::kIncomplete) {
+        if (result == RespCodec::kError) {
+            Buffer error;
+            RespCodec::appendError(&error, "ERR Protocol error");
+            reply(error);
+            closing_ = true;
+            p = end;
+            break;
+        }
+        p += consumed;
+        if (!args.empty()) {
+            execute(args);
+        }
+    }
+    buf->retrieve(static_cast<size_t>(p - begin));
+
+    std::weak_ptr<Session> weakThis(shared_from_this());
+    for (size_t i = 0; i < batches_.size(); ++i) {
+        if (batches_[i]) {
+            server_->shards_[i]->loop->runInLoop(
+                    std::bind(&KvServer::runBatch, server_, static_cast<int>(i), batches_[i], loop_, weakThis));
+            batches_[i].reset();
+        }
+    }
+    flush();
+}
+
+void KvServer::Session::execute(const std::vector<StringPiece> &args) {
+    detail::KvCommand command = detail::lookupCommand(args[0]);
+    size_t argc = args.size();
+    bool keyed = command == detail::kGet || command == detail::kSet || command == detail::kDel ||
+                 command == detail::kMGet || command == detail::kExists;
+    if (!keyed || argc < 2 || (command == detail::kGet && argc != 2) || (command == detail::kSet && argc != 3)) {
+        // 不涉及key的命令和错误，不在热路径上
+        Buffer encoded(64);
+        if (command == detail::kPing && argc == 1) {
+            RespCodec::appendSimpleString(&encoded, "PONG");
+        } else if ((command == detail::kPing && argc == 2) || (command == detail::kEcho && argc == 2)) {
+            RespCodec::appendBulkString(&encoded, args[1]);
+        } else if (command == detail::kConfig || command == detail::kCommand) {
+            RespCodec::appendArrayHeader(&encoded, 0);
+        } else if (command == detail::kUnknown) {
+            RespCodec::appendError(&encoded, "ERR unknown command '" + args[0].as_string() + "'");
+        } else {
+            RespCodec::appendError(&encoded, "ERR wrong number of arguments for '" + args[0].as_string() + "' command");
+        }
+        reply(encoded);
+        return;
+    }
+
+    // SET只有一个key，其它命令的参数都是key
+    size_t keyEnd = command == detail::kSet ? 2 : argc;
+    bool allLocal = true;
+    for (size_t i = 1; i < keyEnd && allLocal; ++i) {
+        allLocal = server_->shardOf(args[i]) == shardIndex_;
+    }
+    if (allLocal && slots_.empty()) {
+        executeLocal(command, args);
+        return;
+    }
+
+    slots_.push_back(Slot());
+    Slot &slot = slots_.back();
+    slot.command = command;
+    slot.waiting = 0;
+    slot.count = 0;
+    if (command == detail::kGet || command == detail::kMGet) {
+        slot.values.resize(keyEnd - 1);
+    }
+    int type = command == detail::kSet ? detail::kOpSet :
+               command == detail::kDel ? detail::kOpDel :
+               command == detail::kExists ? detail::kOpExists : detail::kOpGet;
+    uint64_t seq = firstSeq_ + slots_.size() - 1;
+    for (size_t i = 1; i < keyEnd; ++i) {
+        Op op;
+        op.type = type;
+        op.seq = seq;
+        op.index = static_cast<int>(i - 1);
+        op.found = false;
+        op.key = args[i].as_string();
+        if (command == detail::kSet) {
+            op.value = args[2].as_string();
+        }
+        int shard = server_->shardOf(args[i]);
+        ++slot.waiting;
+        if (shard == shardIndex_) {
+            shard_->apply(&op);
+            fill(&slot, &op);
+        } else {
+            std::shared_ptr<OpBatch> &batch = batches_[static_cast<size_t>(shard)];
+            if (!batch) {
+                batch.reset(new OpBatch);
+            }
+            batch->push_back(std::move(op));
+        }
+    }
+}
+
+/*
+ *      所有key都在本地分片，并且前面没有排队的应答：直接编码进output_，不拷贝key和value以外的东西
+ */
+void KvServer::Session::executeLocal(detail::KvCommand command, const std::vector<StringPiece> &args) {
+    std::unordered_map<string, string> &data = shard_->data;
+    switch (command) {
+        case detail::kGet: {
+            std::unordered_map<string, string>::const_iterator it = data.find(args[1].as_string());
+            if (it != data.end()) {
+                RespCodec::appendBulkString(&output_, it->second);
+            } else {
+                RespCodec::appendNullBulkString(&output_);
+            }
+            break;
+        }
+        case detail::kSet:
+            data[args[1].as_string()].assign(args[2].data(), static_cast<size_t>(args[2].size()));
+            RespCodec::appendSimpleString(&output_, "OK");
+            break;
+        case detail::kMGet:
+            RespCodec::appendArrayHeader(&output_, static_cast<int64_t>(args.size() - 1));
+            for (size_t i = 1; i < args.size(); ++i) {
+                std::unordered_map<string, string>::const_iterator it = data.find(args[i].as_string());
+                if (it != data.end()) {
+                    RespCodec::appendBulkString(&output_, it->second);
+                } else {
+                    RespCodec::appendNullBulkString(&output_);
+                }
+            }
+            break;
+        default: {
+            int64_t count = 0;
+            for (size_t i = 1; i < args.size(); ++i) {
+                if (command == detail::kDel) {
+                    count += static_cast<int64_t>(data.erase(args[i].as_string()));
+                } else {
+                    count += static_cast<int64_t>(data.count(args[i].as_string()));
+                }
+            }
+            RespCodec::appendInteger(&output_, count);
+            break;
+        }
+    }
+}
+
+/*
+ *      不涉及key的应答，前面有排队的应答时也要排队
+ */
+void KvServer::Session::reply(const Buffer &encoded) {
+    if (slots_.empty()) {
+        output_.append(encoded.peek(), encoded.readableBytes());
+    } else {
+        slots_.push_back(Slot());
+        Slot &slot = slots_.back();
+        slot.command = detail::kUnknown;
+        slot.waiting = 0;
+        slot.count = 0;
+        slot.reply.assign(encoded.peek(), encoded.readableBytes());
+    }
+}
+
+void KvServer::Session::fill(Slot *slot, Op *op) {
+    --slot->waiting;
+    if (slot->command == detail::kGet || slot->command == detail::kMGet) {
+        std::pair<bool, string> &value = slot->values[static_cast<size_t>(op->index)];
+        value.first = op->found;
+        value.second.swap(op->value);
+    } else if (op->found && (slot->command == detail::kDel || slot->command == detail::kExists)) {
+        ++slot->count;
+    }
+}
+
+void KvServer::Session::complete(const std::weak_ptr<Session> &weakSession, const std::shared_ptr<OpBatch> &ops) {
+    SessionPtr session(weakSession.lock());
+    if (!session) {
+        return;     // 连接已经关闭
+    }
+    for (Op &op : *ops) {
+        assert(op.seq >= session->firstSeq_);
+        session->fill(&session->slots_[static_cast<size_t>(op.seq - session->firstSeq_)], &op);
+    }
+    session->flush();
+}
+
+/*
+ *      按顺序编码已经完成的槽位，然后一次send()
+ */
+void KvServer::Session::flush() {
+    while (!slots_.empty() && slots_.front().waiting == 0) {
+        Slot &slot = slots_.front();
+        switch (slot.command) {
+            case detail::kGet:
+            case detail::kMGet:
+                if (slot.command == detail::kMGet) {
+                    RespCodec::appendArrayHeader(&output_, static_cast<int64_t>(slot.values.size()));
+                }
+                for (const auto &value : slot.values) {
+                    if (value.first) {
+                        RespCodec::appendBulkString(&output_, value.second);
+                    } else {
+                        RespCodec::appendNullBulkString(&output_);
+                    }
+                }
+                break;
+            case detail::kSet:
+                RespCodec::appendSimpleString(&output_, "OK");
+                break;
+            case detail::kDel:
+            case detail::kExists:
+                RespCodec::appendInteger(&output_, slot.count);
+                break;
+            default:
+                output_.append(slot.reply);
+                break;
+        }
+        slots_.pop_front();
+        ++firstSeq_;
+    }
+
+    TcpConnectionPtr conn(conn_.lock());
+    if (!conn) {
+        output_.retrieveAll();
+        return;
+    }
+    if (output_.readableBytes() > 0) {
+        conn->send(&output_);
+    }
+    if (closing_ && slots_.empty()) {
+        conn->shutdown();
+    }
+}
+
+KvServer::KvServer(EventLoop *loop,
+                   const InetAddress &listenAddr,
+                   const string &name,
+                   TcpServer::Option option)
+        : server_(loop, listenAddr, name, option) {
+    server_.setConnectionCallback(
+            std::bind(&KvServer::onConnection, this, _1));
+    server_.setMessageCallback(
+            std::bind(&KvServer::onMessage, this, _1, _2, _3));
+}
+
+KvServer::~KvServer() {
+}
+
+/*
+ *      IO线程启动后才知道有哪些loop；start()在loop线程中调用，第一个连接在本函数返回之后才会到来
+ */
+void KvServer::start() {
+    getLoop()->assertInLoopThread();
+    LOG_WARN << "KvServer[" << server_.name()
+             << "] starts listening on " << server_.ipPort();
+    server_.start();
+    std::vector<EventLoop *> loops(server_.threadPool()->getAllLoops());
+    for (size_t i = 0; i < loops.size(); ++i) {
+        shards_.emplace_back(new Shard(loops[i]));
+        loopShards_[loops[i]] = static_cast<int>(i);
+    }
+}
+
+void KvServer::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        conn->setTcpNoDelay(true);
+        std::map<EventLoop *, int>::const_iterator it = loopShards_.find(conn->getLoop());
+        assert(it != loopShards_.end());
+        conn->setContext(SessionPtr(new Session(this, conn, it->second)));
+    }
+}
+
+void KvServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    SessionPtr *session = boost::any_cast<SessionPtr>(conn->getMutableContext());
+    (*session)->onMessage(buf);
+}
+
+void KvServer::runBatch(int shard, const std::shared_ptr<OpBatch> &ops,
+                        EventLoop *sessionLoop, const std::weak_ptr<Session> &session) {
+    Shard *s = shards_[static_cast<size_t>(shard)].get();
+    for (Op &op : *ops) {
+        s->apply(&op);
+    }
+    sessionLoop->runInLoop(std::bind(&Session::complete, session, ops));
+}
+
+int KvServer::shardOf(const StringPiece &key) const {
+    return static_cast<int>(detail::hashKey(key) % shards_.size());
+}
@@ -0,0 +1,79 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+/*
+ *      KvServer：按loop分片的内存KV服务器，使用RESP协议，可以用redis-cli、redis-benchmark访问
+ *
+ *      1. 每个IO loop拥有一个分片，只在自己的线程中访问，不加锁。key按hash分到各个分片。
+ *      2. 命令涉及的key都属于本连接所在loop的分片时，直接执行并编码应答；
+ *         否则把一次onMessage()中属于同一个分片的key操作打包，runInLoop()投递给那个分片的loop执行，
+ *         结果再投递回连接所在的loop。一批流水线命令对每个其它分片最多一次跨线程投递。
+ *      3. 应答按命令的顺序返回：等待其它分片的命令占一个槽位，前面的槽位都完成后才编码发送，
+ *         后面的命令即使是本地的也排在槽位后面。
+ *      4. 支持PING、ECHO、GET、SET、DEL、MGET、EXISTS，redis-benchmark启动时发送的CONFIG GET返回空数组。
+ */
+
+#ifndef MYMUDUO_KVSERVER_H
+#define MYMUDUO_KVSERVER_H
+
+#include "../TcpServer.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        ///
+        /// In-memory key-value server speaking RESP, sharded per IO loop.
+        ///
+        class KvServer : noncopyable {
+        public:
+            KvServer(EventLoop *loop,
+                     const InetAddress &listenAddr,
+                     const string &name,
+                     TcpServer::Option option = TcpServer::kNoReusePort);
+
+            ~KvServer();  // force out-line dtor, for std::unique_ptr members.
+
+            EventLoop *getLoop() const { return server_.getLoop(); }
+
+            /// One shard per IO loop, or a single shard in the base loop for 0.
+            void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+            /// Must be called in the loop thread.
+            void start();
+
+        private:
+            class Session;
+
+            struct Shard;
+
+            struct Op;
+
+            typedef std::vector<Op> OpBatch;
+            typedef std::shared_ptr<Session> SessionPtr;
+
+            void onConnection(const TcpConnectionPtr &conn);
+
+            void onMessage(const TcpConnectionPtr &conn,
+                           Buffer *buf,
+                           Timestamp receiveTime);
+
+            /// Runs in the loop of shard, then hands the results back to the session's loop.
+            void runBatch(int shard, const std::shared_ptr<OpBatch> &ops,
+                          EventLoop *sessionLoop, const std::weak_ptr<Session> &session);
+
+            int shardOf(const StringPiece &key) const;
+
+            TcpServer server_;
+            std::vector<std::unique_ptr<Shard>> shards_;    // start()之后只读
+            std::map<EventLoop *, int> loopShards_;         // loop -> 分片
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_KVSERVER_H
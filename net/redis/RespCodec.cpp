@@ -0,0 +1,230 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+#include "RespCodec.h"
+
+#include "../Buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo {
+    namespace net {
+        namespace detail {
+
+            /*
+             *      解析"<整数>\r\n"，p指向类型前缀之后。成功时next指向下一行
+             */
+            RespCodec::ParseResult parseLineInteger(const char *p, const char *end, int64_t *value,
+                                                    const char **next) {
+                const int kMaxDigits = 18;
+                const char *cr = static_cast<const char *>(::memchr(p, '\r', static_cast<size_t>(end - p)));
+                if (cr == NULL) {
+                    return end - p > kMaxDigits + 1 ? RespCodec::kError : RespCodec::kIncomplete;
+                }
+                if (cr + 1 == end) {
+                    return RespCodec::kIncomplete;
+                }
+                if (cr[1] != '\n') {
+                    return RespCodec::kError;
+                }
+                bool negative = p < cr && *p == '-';
+                if (negative) {
+                    ++p;
+                }
+                if (p == cr || cr - p > kMaxDigits) {
+                    return RespCodec::kError;
+                }
+                int64_t x = 0;
+                for (; p < cr; ++p) {
+                    if (*p < '0' || *p > '9') {
+                        return RespCodec::kError;
+                    }
+                    x = x * 10 + (*p - '0');
+                }
+                *value = negative ? -x : x;
+                *next = cr + 2;
+                return RespCodec::kComplete;
+            }
+
+            /*
+             *      inline命令：一行，以空格或tab分隔，行尾的\r可有可无
+             */
+            RespCodec::ParseResult parseInline(const char *data, size_t len,
+                                               std::vector<StringPiece> *args, size_t *consumed) {
+                const char *nl = static_cast<const char *>(::memchr(data, '\n', len));
+                if (nl == NULL) {
+                    return len > RespCodec::kMaxInlineLen ? RespCodec::kError : RespCodec::kIncomplete;
+                }
+                const char *lineEnd = nl > data && nl[-1] == '\r' ? nl - 1 : nl;
+                const char *p = data;
+                while (p < lineEnd) {
+                    while (p < lineEnd && (*p == ' ' || *p == '\t')) {
+                        ++p;
+                    }
+                    const char *start = p;
+                    while (p < lineEnd && *p != ' ' && *p != '\t') {
+                        ++p;
+                    }
+                    if (p > start) {
+                        args->push_back(StringPiece(start, static_cast<int>(p - start)));
+                    }
+                }
+                *consumed = static_cast<size_t>(nl + 1 - data);
+                return RespCodec::kComplete;
+            }
+
+            RespCodec::ParseResult skipReply(const char *p, const char *end, const char **next) {
+                if (p == end) {
+                    return RespCodec::kIncomplete;
+                }
+                int64_t n = 0;
+                RespCodec::ParseResult result;
+                switch (*p) {
+                    case '+':
+                    case '-':
+                    case ':': {
+                        const char *cr = static_cast<const char *>(::memchr(p, '\r', static_cast<size_t>(end - p)));
+                        if (cr == NULL || cr + 1 == end) {
+                            return RespCodec::kIncomplete;
+                        }
+                        *next = cr + 2;
+                        return cr[1] == '\n' ? RespCodec::kComplete : RespCodec::kError;
+                    }
+                    case '$':
+                        result = parseLineInteger(p + 1, end, &n, &p);
+                        if (result != RespCodec::kComplete || n < 0) {
+                            *next = p;
+                            return result;
+                        }
+                        if (end - p < n + 2) {
+                            return RespCodec::kIncomplete;
+                        }
+                        *next = p + n + 2;
+                        return RespCodec::kComplete;
+                    case '*':
+                        result = parseLineInteger(p + 1, end, &n, &p);
+                        for (int64_t i = 0; result == RespCodec::kComplete && i < n; ++i) {
+                            result = skipReply(p, end, &p);
+                        }
+                        *next = p;
+                        return result;
+                    default:
+                        return RespCodec::kError;
+                }
+            }
+
+        }  // namespace detail
+    }  // namespace net
+}  // namespace muduo
+
+const int64_t RespCodec::kMaxArgs;
+const int64_t RespCodec::kMaxBulkLen;
+const size_t RespCodec::kMaxInlineLen;
+
+/*
+ *      bulk string按长度跳过，不扫描内容
+ */
+RespCodec::ParseResult RespCodec::parseCommand(const char *data, size_t len,
+                                               std::vector<StringPiece> *args, size_t *consumed) {
+    args->clear();
+    if (len == 0) {
+        return kIncomplete;
+    }
+    if (data[0] != '*') {
+        return detail::parseInline(data, len, args, consumed);
+    }
+
+    const char *end = data + len;
+    const char *p = data;
+    int64_t n = 0;
+    ParseResult result = detail::parseLineInteger(data + 1, end, &n, &p);
+    if (result != kComplete) {
+        return result;
+    }
+    if (n > kMaxArgs) {
+        return kError;
+    }
+    for (int64_t i = 0; i < n; ++i) {
+        if (p == end) {
+            return kIncomplete;
+        }
+        if (*p != '$') {
+            return kError;
+        }
+        int64_t bulkLen = 0;
+        result = detail::parseLineInteger(p + 1, end, &bulkLen, &p);
+        if (result != kComplete) {
+            return result;
+        }
+        if (bulkLen < 0 || bulkLen > kMaxBulkLen) {
+            return kError;
+        }
+        if (end - p < bulkLen + 2) {
+            return kIncomplete;
+        }
+        if (p[bulkLen] != '\r' || p[bulkLen + 1] != '\n') {
+            return kError;
+        }
+        args->push_back(StringPiece(p, static_cast<int>(bulkLen)));
+        p += bulkLen + 2;
+    }
+    *consumed = static_cast<size_t>(p - data);
+    return kComplete;
+}
+
+RespCodec::ParseResult RespCodec::parseReply(const char *data, size_t len, size_t *consumed) {
+    const char *next = data;
+    ParseResult result = detail::skipReply(data, data + len, &next);
+    if (result == kComplete) {
+        *consumed = static_cast<size_t>(next - data);
+    }
+    return result;
+}
+
+void RespCodec::appendSimpleString(Buffer *output, const StringPiece &s) {
+    output->append("+", 1);
+    output->append(s);
+    output->append("\r\n", 2);
+}
+
+void RespCodec::appendError(Buffer *output, const StringPiece &message) {
+    output->append("-", 1);
+    output->append(message);
+    output->append("\r\n", 2);
+}
+
+void RespCodec::appendInteger(Buffer *output, int64_t x) {
+    char buf[32];
+    int n = snprintf(buf, sizeof buf, ":%lld\r\n", static_cast<long long>(x));
+    output->append(buf, static_cast<size_t>(n));
+}
+
+void RespCodec::appendBulkString(Buffer *output, const StringPiece &s) {
+    char buf[32];
+    int n = snprintf(buf, sizeof buf, "$%d\r\n", s.size());
+    output->append(buf, static_cast<size_t>(n));
+    output->append(s);
+    output->append("\r\n", 2);
+}
+
+void RespCodec::appendNullBulkString(Buffer *output) {
+    output->append("$-1\r\n", 5);
+}
+
+void RespCodec::appendArrayHeader(Buffer *output, int64_t n) {
+    char buf[32];
+    int len = snprintf(buf, sizeof buf, "*%lld\r\n", static_cast<long long>(n));
+    output->append(buf, static_cast<size_t>(len));
+}
+
+void RespCodec::appendCommand(Buffer *output, const std::vector<StringPiece> &args) {
+    appendArrayHeader(output, static_cast<int64_t>(args.size()));
+    for (const StringPiece &arg : args) {
+        appendBulkString(output, arg);
+    }
+}
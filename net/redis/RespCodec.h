@@ -0,0 +1,65 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+/*
+ *      RespCodec：RESP2（Redis协议）的解析和编码
+ *
+ *      1. 命令是bulk string组成的数组：*<n>\r\n $<len>\r\n<data>\r\n ...，
+ *         也支持redis-cli手工输入时用的inline命令（一行，以空白分隔）。
+ *      2. parseCommand()不拷贝，参数是指向输入Buffer的StringPiece；一次只解析一个命令，
+ *         调用者用指针扫过流水线中所有完整的命令，最后一次retrieve()。
+ *         不完整的命令下次从头解析，已知长度的bulk string直接跳过，不会逐字节重复扫描。
+ *      3. 编码直接追加到输出Buffer。
+ */
+
+#ifndef MYMUDUO_RESPCODEC_H
+#define MYMUDUO_RESPCODEC_H
+
+#include "../../base/StringPiece.h"
+#include "../../base/Types.h"
+
+#include <vector>
+
+namespace muduo {
+    namespace net {
+
+        class Buffer;
+
+        class RespCodec {
+        public:
+            enum ParseResult { kIncomplete, kComplete, kError };
+
+            static const int64_t kMaxArgs = 1024 * 1024;
+            static const int64_t kMaxBulkLen = 512 * 1024 * 1024;
+            static const size_t kMaxInlineLen = 64 * 1024;
+
+            /// Parses the command at the front of [data, data + len).
+            /// On kComplete, args point into data and consumed is the command length;
+            /// args may be empty for an empty command, which should be skipped.
+            static ParseResult parseCommand(const char *data, size_t len,
+                                            std::vector<StringPiece> *args, size_t *consumed);
+
+            /// Skips one reply of any type, for clients counting replies.
+            static ParseResult parseReply(const char *data, size_t len, size_t *consumed);
+
+            static void appendSimpleString(Buffer *output, const StringPiece &s);
+
+            static void appendError(Buffer *output, const StringPiece &message);
+
+            static void appendInteger(Buffer *output, int64_t x);
+
+            static void appendBulkString(Buffer *output, const StringPiece &s);
+
+            static void appendNullBulkString(Buffer *output);
+
+            static void appendArrayHeader(Buffer *output, int64_t n);
+
+            /// Encodes a command as an array of bulk strings.
+            static void appendCommand(Buffer *output, const std::vector<StringPiece> &args);
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_RESPCODEC_H
@@ -0,0 +1,199 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+/*
+ *      KvServer压测：同一进程内分别启动1、2、4个分片（IO loop）的KvServer，依次压测
+ *
+ *      每条连接一次发出depth个流水线命令（GET/SET混合，key在keyspace中随机），
+ *      收齐depth个应答后再发下一批，统计每秒命令数和每批往返延迟的p50、p99。
+ *      机器的核数少于分片数时，多分片只能体现跨线程投递的开销。
+ *
+ *      用法：kvserver_bench [连接数] [流水线深度] [每组秒数] [value字节数] [SET百分比] [keyspace]
+ */
+
+#include "../../../base/Logging.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../../TcpClient.h"
+#include "../KvServer.h"
+#include "../RespCodec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kLoopCounts[] = {1, 2, 4};
+const uint16_t kBasePort = 19988;
+
+class Bench : noncopyable {
+public:
+    Bench(EventLoop *loop, int numConns, int depth, double seconds, int valueSize, int setPercent, int keyspace)
+            : loop_(loop),
+              numConns_(numConns),
+              depth_(depth),
+              seconds_(seconds),
+              value_(static_cast<size_t>(valueSize), 'x'),
+              setPercent_(setPercent),
+              keyspace_(keyspace),
+              level_(0),
+              running_(false),
+              connected_(0),
+              busy_(0) {
+    }
+
+    void start() {
+        printf("%8s %12s %10s %10s\n", "shards", "ops/sec", "p50(us)", "p99(us)");
+        startLevel();
+    }
+
+private:
+    struct ConnState {
+        TcpConnectionPtr conn;
+        int pending;
+        Timestamp sent;
+        unsigned seed;
+    };
+
+    void startLevel() {
+        if (level_ == static_cast<int>(sizeof kLoopCounts / sizeof kLoopCounts[0])) {
+            loop_->quit();
+            return;
+        }
+        InetAddress addr("127.0.0.1", static_cast<uint16_t>(kBasePort + level_));
+        clients_.clear();
+        states_.assign(static_cast<size_t>(numConns_), ConnState());
+        latencies_.clear();
+        connected_ = 0;
+        for (int i = 0; i < numConns_; ++i) {
+            clients_.emplace_back(new TcpClient(loop_, addr, "KvBenchClient"));
+            clients_.back()->setConnectionCallback(std::bind(&Bench::onConnection, this, i, _1));
+            clients_.back()->setMessageCallback(std::bind(&Bench::onMessage, this, i, _1, _2));
+            clients_.back()->connect();
+        }
+    }
+
+    void onConnection(int index, const TcpConnectionPtr &conn) {
+        if (!conn->connected()) {
+            return;
+        }
+        conn->setTcpNoDelay(true);
+        ConnState &state = states_[static_cast<size_t>(index)];
+        state.conn = conn;
+        state.seed = static_cast<unsigned>(index + 1);
+        if (++connected_ == numConns_) {
+            running_ = true;
+            busy_ = numConns_;
+            loop_->runAfter(seconds_, [this]() { running_ = false; });
+            for (ConnState &s : states_) {
+                issue(&s);
+            }
+        }
+    }
+
+    void issue(ConnState *state) {
+        Buffer request;
+        char key[32];
+        for (int i = 0; i < depth_; ++i) {
+            int n = snprintf(key, sizeof key, "key:%d", rand_r(&state->seed) % keyspace_);
+            StringPiece keyPiece(key, n);
+            if (rand_r(&state->seed) % 100 < setPercent_) {
+                RespCodec::appendCommand(&request, {"SET", keyPiece, value_});
+            } else {
+                RespCodec::appendCommand(&request, {"GET", keyPiece});
+            }
+        }
+        state->pending = depth_;
+        state->sent = Timestamp::now();
+        state->conn->send(&request);
+    }
+
+    void onMessage(int index, const TcpConnectionPtr &, Buffer *buf) {
+        ConnState &state = states_[static_cast<size_t>(index)];
+        const char *p = buf->peek();
+        size_t len = buf->readableBytes();
+        size_t consumed = 0;
+        while (state.pending > 0 && RespCodec::parseReply(p, len, &consumed) == RespCodec::kComplete) {
+            p += consumed;
+            len -= consumed;
+            --state.pending;
+        }
+        buf->retrieve(buf->readableBytes() - len);
+        if (state.pending > 0) {
+            return;
+        }
+        latencies_.push_back(static_cast<int>(Timestamp::now().microSecondsSinceEpoch() -
+                                              state.sent.microSecondsSinceEpoch()));
+        if (running_) {
+            issue(&state);
+        } else if (--busy_ == 0) {
+            report();
+            // 等连接正常关闭后再开始下一组
+            for (const auto &client : clients_) {
+                client->disconnect();
+            }
+            ++level_;
+            loop_->runAfter(0.2, std::bind(&Bench::startLevel, this));
+        }
+    }
+
+    void report() {
+        size_t n = latencies_.size();
+        int p50 = 0;
+        int p99 = 0;
+        if (n > 0) {
+            std::nth_element(latencies_.begin(), latencies_.begin() + n / 2, latencies_.end());
+            p50 = latencies_[n / 2];
+            std::nth_element(latencies_.begin(), latencies_.begin() + n * 99 / 100, latencies_.end());
+            p99 = latencies_[n * 99 / 100];
+        }
+        printf("%8d %12.0f %10d %10d\n", kLoopCounts[level_],
+               static_cast<double>(n) * depth_ / seconds_, p50, p99);
+        fflush(stdout);
+    }
+
+    EventLoop *loop_;
+    const int numConns_;
+    const int depth_;
+    const double seconds_;
+    const string value_;
+    const int setPercent_;
+    const int keyspace_;
+    int level_;
+    bool running_;
+    int connected_;
+    int busy_;
+    std::vector<std::unique_ptr<TcpClient>> clients_;
+    std::vector<ConnState> states_;
+    std::vector<int> latencies_;
+};
+
+int main(int argc, char *argv[]) {
+    int numConns = argc > 1 ? atoi(argv[1]) : 16;
+    int depth = argc > 2 ? atoi(argv[2]) : 16;
+    double seconds = argc > 3 ? atof(argv[3]) : 2.0;
+    int valueSize = argc > 4 ? atoi(argv[4]) : 32;
+    int setPercent = argc > 5 ? atoi(argv[5]) : 20;
+    int keyspace = argc > 6 ? atoi(argv[6]) : 100000;
+    Logger::setLogLevel(Logger::WARN);
+    printf("%d connections, pipeline depth %d, value %d bytes, %d%% SET, keyspace %d\n",
+           numConns, depth, valueSize, setPercent, keyspace);
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<KvServer>> servers;
+    for (size_t i = 0; i < sizeof kLoopCounts / sizeof kLoopCounts[0]; ++i) {
+        InetAddress addr("127.0.0.1", static_cast<uint16_t>(kBasePort + i));
+        servers.emplace_back(new KvServer(&loop, addr, "KvBenchServer"));
+        servers.back()->setThreadNum(kLoopCounts[i]);
+        servers.back()->start();
+    }
+
+    Bench bench(&loop, numConns, depth, seconds, valueSize, setPercent, keyspace);
+    bench.start();
+    loop.loop();
+}
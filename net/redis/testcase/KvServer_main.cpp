@@ -0,0 +1,31 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+/*
+ *      KvServer示例，可以用redis-cli、redis-benchmark访问
+ *
+ *      用法：kvserver [端口] [IO线程数]
+ *      例如：redis-benchmark -p 6379 -t get,set -P 16 -c 50 --threads 2
+ */
+
+#include "../../../base/Logging.h"
+#include "../../EventLoop.h"
+#include "../KvServer.h"
+
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int main(int argc, char *argv[]) {
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 6379);
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    LOG_INFO << "kvserver listening on port " << port << " with " << threads << " shards";
+
+    EventLoop loop;
+    KvServer server(&loop, InetAddress(port), "KvServer");
+    server.setThreadNum(threads);
+    server.start();
+    loop.loop();
+}
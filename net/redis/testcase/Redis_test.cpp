@@ -0,0 +1,188 @@
+//
+// Created by chen on 2022/11/29.
+//
+
+/*
+ *      RespCodec和KvServer测试
+ *
+ *      1. 命令按任意位置切开，逐段到达，解析结果相同
+ *      2. 流水线中的数组命令和inline命令
+ *      3. 格式错误的命令、各种类型的应答
+ *      4. KvServer有4个分片，一批流水线命令中的key分布在各个分片，应答的顺序和命令一致
+ */
+
+#include "../../../base/Logging.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../../TcpClient.h"
+#include "../KvServer.h"
+#include "../RespCodec.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+typedef std::vector<StringPiece> Args;
+
+void testSplit() {
+    const char kCommand[] = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$10\r\nva\r\nl\0ue!!\r\n";
+    string command(kCommand, sizeof kCommand - 1);
+    Args args;
+    size_t consumed = 0;
+    for (size_t split = 0; split < command.size(); ++split) {
+        RespCodec::ParseResult result = RespCodec::parseCommand(command.data(), split, &args, &consumed);
+        assert(result == RespCodec::kIncomplete);
+        (void) result;
+    }
+    RespCodec::ParseResult result = RespCodec::parseCommand(command.data(), command.size(), &args, &consumed);
+    assert(result == RespCodec::kComplete);
+    assert(consumed == command.size());
+    assert(args.size() == 3);
+    assert(args[0] == "SET" && args[1] == "key");
+    assert(args[2] == StringPiece("va\r\nl\0ue!!", 10));
+    (void) result;
+    printf("split ok\n");
+}
+
+void testPipeline() {
+    Buffer buf;
+    buf.append("*2\r\n$3\r\nGET\r\n$1\r\na\r\n"
+               "PING\r\n"
+               "  SET  b   c \n"
+               "\r\n"
+               "*0\r\n"
+               "*1\r\n$4\r\nPI");
+    const char *p = buf.peek();
+    const char *end = p + buf.readableBytes();
+    std::vector<Args> commands;
+    Args args;
+    size_t consumed = 0;
+    while (RespCodec::parseCommand(p, static_cast<size_t>(end - p), &args, &consumed) == RespCodec::kComplete) {
+        p += consumed;
+        commands.push_back(args);
+    }
+    assert(commands.size() == 5);
+    assert(commands[0].size() == 2 && commands[0][0] == "GET" && commands[0][1] == "a");
+    assert(commands[1].size() == 1 && commands[1][0] == "PING");
+    assert(commands[2].size() == 3 && commands[2][0] == "SET" && commands[2][1] == "b" && commands[2][2] == "c");
+    assert(commands[3].empty() && commands[4].empty());
+    assert(StringPiece(p, static_cast<int>(end - p)) == "*1\r\n$4\r\nPI");
+    printf("pipeline ok\n");
+}
+
+void testErrors() {
+    const char *bad[] = {
+            "*1\r\n$3\r\nGETX\r\n",     // 长度不对
+            "*x\r\n",
+            "*1\r\n:3\r\n",
+            "*1\r\n$-1\r\n",
+            "*1\r\n$99999999999999999999\r\n",
+    };
+    Args args;
+    size_t consumed = 0;
+    for (const char *command : bad) {
+        assert(RespCodec::parseCommand(command, ::strlen(command), &args, &consumed) == RespCodec::kError);
+    }
+    string longInline(RespCodec::kMaxInlineLen + 1, 'x');
+    assert(RespCodec::parseCommand(longInline.data(), longInline.size(), &args, &consumed) == RespCodec::kError);
+
+    string replies = "+OK\r\n-ERR x\r\n:42\r\n$-1\r\n$3\r\nabc\r\n*2\r\n$1\r\na\r\n*1\r\n:1\r\n*-1\r\n";
+    size_t offset = 0;
+    int count = 0;
+    while (RespCodec::parseReply(replies.data() + offset, replies.size() - offset, &consumed) == RespCodec::kComplete) {
+        offset += consumed;
+        ++count;
+    }
+    assert(count == 7 && offset == replies.size());
+    assert(RespCodec::parseReply("*2\r\n:1\r\n", 8, &consumed) == RespCodec::kIncomplete);
+    assert(RespCodec::parseReply("?", 1, &consumed) == RespCodec::kError);
+    (void) count;
+    printf("errors ok\n");
+}
+
+string g_expected;
+string g_received;
+
+void appendCommand(Buffer *buf, const Args &args) {
+    RespCodec::appendCommand(buf, args);
+}
+
+void onConnection(const TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+        return;
+    }
+    const int kKeys = 100;
+    Buffer request;
+    Buffer expected;
+    std::vector<string> keys;
+    for (int i = 0; i < kKeys; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    for (int i = 0; i < kKeys; ++i) {
+        string value = "value" + std::to_string(i);
+        appendCommand(&request, {"SET", keys[static_cast<size_t>(i)], value});
+        RespCodec::appendSimpleString(&expected, "OK");
+        // 本地和远程的命令交错，检查顺序
+        appendCommand(&request, {"GET", keys[static_cast<size_t>(i)]});
+        RespCodec::appendBulkString(&expected, value);
+        appendCommand(&request, {"PING"});
+        RespCodec::appendSimpleString(&expected, "PONG");
+    }
+    Args mget;
+    mget.push_back("MGET");
+    RespCodec::appendArrayHeader(&expected, kKeys + 1);
+    for (int i = 0; i < kKeys; ++i) {
+        mget.push_back(keys[static_cast<size_t>(i)]);
+        RespCodec::appendBulkString(&expected, "value" + std::to_string(i));
+    }
+    mget.push_back("nokey");
+    RespCodec::appendNullBulkString(&expected);
+    appendCommand(&request, mget);
+
+    appendCommand(&request, {"DEL", "key1", "key2", "nokey"});
+    RespCodec::appendInteger(&expected, 2);
+    appendCommand(&request, {"EXISTS", "key1", "key3", "key4"});
+    RespCodec::appendInteger(&expected, 2);
+    appendCommand(&request, {"GET", "key1"});
+    RespCodec::appendNullBulkString(&expected);
+    appendCommand(&request, {"GET"});
+    RespCodec::appendError(&expected, "ERR wrong number of arguments for 'GET' command");
+    appendCommand(&request, {"FOO"});
+    RespCodec::appendError(&expected, "ERR unknown command 'FOO'");
+    request.append("ECHO hi\r\n");
+    RespCodec::appendBulkString(&expected, "hi");
+
+    g_expected = expected.retrieveAllAsString();
+    conn->send(&request);
+}
+
+void onMessage(EventLoop *loop, const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    g_received += buf->retrieveAllAsString();
+    if (g_received.size() >= g_expected.size()) {
+        assert(g_received == g_expected);
+        printf("kvserver ok\n");
+        conn->shutdown();
+        loop->runAfter(0.1, std::bind(&EventLoop::quit, loop));
+    }
+}
+
+int main() {
+    testSplit();
+    testPipeline();
+    testErrors();
+
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    InetAddress addr("127.0.0.1", 19987);
+    KvServer server(&loop, addr, "KvTestServer");
+    server.setThreadNum(4);
+    server.start();
+
+    TcpClient client(&loop, addr, "KvTestClient");
+    client.setConnectionCallback(onConnection);
+    client.setMessageCallback(std::bind(onMessage, &loop, _1, _2, _3));
+    client.connect();
+    loop.loop();
+}
@@ -0,0 +1,169 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+#include "RpcClient.h"
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+RpcClient::RpcClient(EventLoop *loop, const InetAddress &serverAddr, const string &name)
+        : loop_(loop),
+          client_(loop, serverAddr, name),
+          nextRequestId_(1),
+          dispatching_(false) {
+    client_.setConnectionCallback(
+            std::bind(&RpcClient::onConnection, this, _1));
+    client_.setMessageCallback(
+            std::bind(&RpcClient::onMessage, this, _1, _2, _3));
+}
+
+/*
+ *      未完成的调用直接丢弃，不再调用回调；连接的回调换成默认的，之后不会再回到this
+ */
+RpcClient::~RpcClient() {
+    loop_->assertInLoopThread();
+    for (const auto &call : pending_) {
+        if (call.second.hasDeadline) {
+            loop_->cancel(call.second.timer);
+        }
+    }
+    if (connection_) {
+        connection_->setConnectionCallback(defaultConnectionCallback);
+        connection_->setMessageCallback(defaultMessageCallback);
+    }
+}
+
+/*
+ *      call() --> callInLoop()
+ */
+void RpcClient::call(uint16_t methodId, const StringPiece &request, double timeoutSeconds,
+                     const ResponseCallback &cb) {
+    if (loop_->isInLoopThread()) {
+        callInLoop(methodId, request, timeoutSeconds, cb);
+    } else {
+        loop_->runInLoop(
+                std::bind(&RpcClient::callString, this, methodId, request.as_string(), timeoutSeconds, cb));
+    }
+}
+
+void RpcClient::callString(uint16_t methodId, const string &request, double timeoutSeconds,
+                           const ResponseCallback &cb) {
+    callInLoop(methodId, request, timeoutSeconds, cb);
+}
+
+void RpcClient::callInLoop(uint16_t methodId, const StringPiece &request, double timeoutSeconds,
+                           const ResponseCallback &cb) {
+    loop_->assertInLoopThread();
+    if (!connection_ || !connection_->connected()) {
+        // 不在调用者的栈上回调
+        loop_->queueInLoop(std::bind(cb, kRpcDisconnected, StringPiece()));
+        return;
+    }
+
+    uint32_t requestId = nextRequestId_++;
+    PendingCall &call = pending_[requestId];
+    call.callback = cb;
+    call.hasDeadline = timeoutSeconds > 0;
+    if (call.hasDeadline) {
+        call.timer = loop_->runAfter(timeoutSeconds, std::bind(&RpcClient::onTimeout, this, requestId));
+    }
+
+    RpcHeader header = {RpcCodec::kRequest, 0, methodId, requestId};
+    RpcCodec::append(&outgoing_, header, request);
+    if (!dispatching_) {
+        flush();
+    }
+}
+
+void RpcClient::flush() {
+    if (outgoing_.readableBytes() > 0) {
+        connection_->send(&outgoing_);
+    }
+}
+
+void RpcClient::onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        connection_ = conn;
+    } else {
+        connection_.reset();
+        outgoing_.retrieveAll();
+        failAll(kRpcDisconnected);
+    }
+    if (connectionCallback_) {
+        connectionCallback_(conn);
+    }
+}
+
+/*
+ *      应答可能乱序，按requestId找到对应的调用；找不到的是已经超时的调用，丢弃。
+ *      回调期间发起的新调用攒在outgoing_里，最后一次flush()
+ */
+void RpcClient::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *p = begin;
+    RpcHeader header;
+    StringPiece payload;
+    size_t messageLen = 0;
+    RpcCodec::ParseResult result;
+    dispatching_ = true;
+    while ((result = RpcCodec::parse(p, static_cast<size_t>(end - p), &header, &payload, &messageLen))
+           == RpcCodec::kComplete) {
+        p += messageLen;
+        if (header.type != RpcCodec::kResponse) {
+            result = RpcCodec::kError;
+            break;
+        }
+        std::map<uint32_t, PendingCall>::iterator it = pending_.find(header.requestId);
+        if (it == pending_.end()) {
+            continue;
+        }
+        if (it->second.hasDeadline) {
+            loop_->cancel(it->second.timer);
+        }
+        ResponseCallback cb;
+        cb.swap(it->second.callback);
+        pending_.erase(it);
+        cb(static_cast<RpcStatus>(header.status), payload);
+    }
+    dispatching_ = false;
+
+    if (result == RpcCodec::kError) {
+        LOG_ERROR << "RpcClient::onMessage [" << conn->name() << "] - bad message";
+        buf->retrieveAll();
+        conn->forceClose();
+        return;
+    }
+    buf->retrieve(static_cast<size_t>(p - begin));
+    if (connection_) {
+        flush();
+    }
+}
+
+void RpcClient::onTimeout(uint32_t requestId) {
+    std::map<uint32_t, PendingCall>::iterator it = pending_.find(requestId);
+    if (it != pending_.end()) {
+        ResponseCallback cb;
+        cb.swap(it->second.callback);
+        pending_.erase(it);
+        cb(kRpcTimeout, StringPiece());
+    }
+}
+
+/*
+ *      回调中可能发起新的调用，先把pending_换出来
+ */
+void RpcClient::failAll(RpcStatus status) {
+    std::map<uint32_t, PendingCall> calls;
+    calls.swap(pending_);
+    for (auto &call : calls) {
+        if (call.second.hasDeadline) {
+            loop_->cancel(call.second.timer);
+        }
+        call.second.callback(status, StringPiece());
+    }
+}
@@ -0,0 +1,94 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+/*
+ *      RpcClient：基于TcpClient的RPC客户端，一条连接上多路复用
+ *
+ *      1. 每个调用分配一个requestId，记在pending_里，应答按requestId找到对应的回调，可以乱序到达。
+ *      2. deadline：每个调用用loop的runAfter()定一个定时器，先到期就以kRpcTimeout结束调用，
+ *         之后到达的应答直接丢弃；应答先到就cancel()定时器。
+ *      3. 在应答回调中发起的调用先攒在outgoing_里，这一批应答处理完之后一次send()，
+ *         闭环的调用方（收到应答再发下一个）不会每个调用一次write()。
+ *      4. 连接断开时，所有未完成的调用以kRpcDisconnected结束；未连接时发起的调用也一样。
+ */
+
+#ifndef MYMUDUO_RPCCLIENT_H
+#define MYMUDUO_RPCCLIENT_H
+
+#include "../TcpClient.h"
+#include "../TimerId.h"
+#include "RpcCodec.h"
+
+#include <map>
+
+namespace muduo {
+    namespace net {
+
+        ///
+        /// RPC client, many calls in flight on one connection.
+        ///
+        /// Must be destructed in the loop thread.
+        class RpcClient : noncopyable {
+        public:
+            /// response is valid only during the callback.
+            typedef std::function<void(RpcStatus, StringPiece response)> ResponseCallback;
+
+            RpcClient(EventLoop *loop, const InetAddress &serverAddr, const string &name);
+
+            ~RpcClient();
+
+            EventLoop *getLoop() const { return loop_; }
+
+            void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+
+            void enableRetry() { client_.enableRetry(); }
+
+            void connect() { client_.connect(); }
+
+            void disconnect() { client_.disconnect(); }
+
+            /// Thread safe, cb runs in the loop thread.
+            /// timeoutSeconds <= 0 means no deadline.
+            void call(uint16_t methodId, const StringPiece &request, double timeoutSeconds, const ResponseCallback &cb);
+
+            /// Calls in flight, in loop thread.
+            size_t numPending() const { return pending_.size(); }
+
+        private:
+            struct PendingCall {
+                ResponseCallback callback;
+                TimerId timer;
+                bool hasDeadline;
+            };
+
+            void callInLoop(uint16_t methodId, const StringPiece &request, double timeoutSeconds,
+                            const ResponseCallback &cb);
+
+            void callString(uint16_t methodId, const string &request, double timeoutSeconds,
+                            const ResponseCallback &cb);
+
+            void onConnection(const TcpConnectionPtr &conn);
+
+            void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+            void onTimeout(uint32_t requestId);
+
+            void flush();
+
+            void failAll(RpcStatus status);
+
+            EventLoop *loop_;
+            TcpClient client_;
+            ConnectionCallback connectionCallback_;
+            TcpConnectionPtr connection_;           // 在client_之前析构
+            uint32_t nextRequestId_;
+            std::map<uint32_t, PendingCall> pending_;
+            Buffer outgoing_;
+            bool dispatching_;                      // 正在onMessage()中调用应答回调
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_RPCCLIENT_H
@@ -0,0 +1,77 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+#include "RpcCodec.h"
+
+#include "../Buffer.h"
+
+#include <endian.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t RpcCodec::kLengthLen;
+const size_t RpcCodec::kHeaderLen;
+const size_t RpcCodec::kMaxPayloadSize;
+
+const char *muduo::net::rpcStatusToString(RpcStatus status) {
+    switch (status) {
+        case kRpcOk:
+            return "OK";
+        case kRpcNoMethod:
+            return "NoMethod";
+        case kRpcError:
+            return "Error";
+        case kRpcTimeout:
+            return "Timeout";
+        case kRpcDisconnected:
+            return "Disconnected";
+        default:
+            return "Unknown";
+    }
+}
+
+RpcCodec::ParseResult RpcCodec::parse(const char *data, size_t len,
+                                      RpcHeader *header, StringPiece *payload, size_t *messageLen) {
+    if (len < kLengthLen) {
+        return kIncomplete;
+    }
+    uint32_t length;
+    ::memcpy(&length, data, sizeof length);
+    length = be32toh(length);
+    if (length < kHeaderLen || length - kHeaderLen > kMaxPayloadSize) {
+        return kError;
+    }
+    if (len - kLengthLen < length) {
+        return kIncomplete;
+    }
+
+    const char *p = data + kLengthLen;
+    header->type = static_cast<uint8_t>(p[0]);
+    header->status = static_cast<uint8_t>(p[1]);
+    uint16_t methodId;
+    ::memcpy(&methodId, p + 2, sizeof methodId);
+    header->methodId = be16toh(methodId);
+    uint32_t requestId;
+    ::memcpy(&requestId, p + 4, sizeof requestId);
+    header->requestId = be32toh(requestId);
+    *payload = StringPiece(p + kHeaderLen, static_cast<int>(length - kHeaderLen));
+    *messageLen = kLengthLen + length;
+    return kComplete;
+}
+
+void RpcCodec::append(Buffer *output, const RpcHeader &header, const StringPiece &payload) {
+    char buf[kLengthLen + kHeaderLen];
+    uint32_t length = htobe32(static_cast<uint32_t>(kHeaderLen + static_cast<size_t>(payload.size())));
+    ::memcpy(buf, &length, sizeof length);
+    buf[4] = static_cast<char>(header.type);
+    buf[5] = static_cast<char>(header.status);
+    uint16_t methodId = htobe16(header.methodId);
+    ::memcpy(buf + 6, &methodId, sizeof methodId);
+    uint32_t requestId = htobe32(header.requestId);
+    ::memcpy(buf + 8, &requestId, sizeof requestId);
+    output->append(buf, sizeof buf);
+    output->append(payload);
+}
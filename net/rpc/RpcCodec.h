@@ -0,0 +1,69 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+/*
+ *      RPC消息格式（整数都是网络字节序）：
+ *
+ *      | length(4) | type(1) | status(1) | methodId(2) | requestId(4) | payload |
+ *
+ *      1. length是length之后的字节数，即8字节的RPC头加上payload。
+ *      2. requestId由客户端分配，服务端原样带回，客户端用它把应答对应到请求，所以应答可以乱序到达，
+ *         一条连接上可以同时有很多个请求。
+ *      3. status只在应答中有意义，kRpcError时payload是错误信息。
+ *
+ *      parse()不拷贝payload，而是指向输入Buffer；append()把消息追加到输出Buffer，
+ *      多个消息攒在一个Buffer里一次发送。
+ */
+
+#ifndef MYMUDUO_RPCCODEC_H
+#define MYMUDUO_RPCCODEC_H
+
+#include "../../base/StringPiece.h"
+#include "../../base/Types.h"
+
+namespace muduo {
+    namespace net {
+
+        class Buffer;
+
+        enum RpcStatus {
+            kRpcOk = 0,
+            kRpcNoMethod,       // 服务端没有注册这个methodId
+            kRpcError,          // handler返回false
+            kRpcTimeout,        // 客户端：超过了deadline
+            kRpcDisconnected,   // 客户端：连接断开或者还没有建立
+        };
+
+        const char *rpcStatusToString(RpcStatus status);
+
+        struct RpcHeader {
+            uint8_t type;
+            uint8_t status;
+            uint16_t methodId;
+            uint32_t requestId;
+        };
+
+        class RpcCodec {
+        public:
+            enum MessageType { kRequest = 0, kResponse = 1 };
+
+            enum ParseResult { kIncomplete, kComplete, kError };
+
+            static const size_t kLengthLen = 4;
+            static const size_t kHeaderLen = 8;
+            static const size_t kMaxPayloadSize = 64 * 1024 * 1024;
+
+            /// Parses the message at the front of [data, data + len).
+            /// On kComplete, payload points into data and messageLen is the bytes consumed.
+            static ParseResult parse(const char *data, size_t len,
+                                     RpcHeader *header, StringPiece *payload, size_t *messageLen);
+
+            /// Appends a complete message to output.
+            static void append(Buffer *output, const RpcHeader &header, const StringPiece &payload);
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_RPCCODEC_H
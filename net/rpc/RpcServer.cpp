@@ -0,0 +1,95 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+#include "RpcServer.h"
+
+#include "../../base/Logging.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+RpcServer::RpcServer(EventLoop *loop,
+                     const InetAddress &listenAddr,
+                     const string &name,
+                     TcpServer::Option option)
+        : server_(loop, listenAddr, name, option),
+          pool_(name + "Worker"),
+          workerThreads_(0) {
+    server_.setMessageCallback(
+            std::bind(&RpcServer::onMessage, this, _1, _2, _3));
+}
+
+void RpcServer::registerMethod(uint16_t methodId, const MethodHandler &handler, DispatchMode mode) {
+    Method method = {handler, mode};
+    methods_[methodId] = method;
+}
+
+void RpcServer::start() {
+    LOG_WARN << "RpcServer[" << server_.name()
+             << "] starts listening on " << server_.ipPort();
+    if (workerThreads_ > 0) {
+        pool_.start(workerThreads_);
+    }
+    server_.start();
+}
+
+/*
+ *      用指针扫过所有完整的请求，最后一次retrieve()，payload指向buf。
+ *      kInLoop的应答写进output，最后一次send()；kInThreadPool的请求拷贝一份交给工作线程
+ */
+void RpcServer::onMessage(const TcpConnectionPtr &conn,
+                          Buffer *buf,
+                          Timestamp) {
+    const char *begin = buf->peek();
+    const char *end = begin + buf->readableBytes();
+    const char *p = begin;
+    Buffer output;
+    Buffer response;
+    RpcHeader header;
+    StringPiece payload;
+    size_t messageLen = 0;
+    RpcCodec::ParseResult result;
+    while ((result = RpcCodec::parse(p, static_cast<size_t>(end - p), &header, &payload, &messageLen))
+           == RpcCodec::kComplete) {
+        p += messageLen;
+        if (header.type != RpcCodec::kRequest) {
+            result = RpcCodec::kError;
+            break;
+        }
+        header.type = RpcCodec::kResponse;
+        std::map<uint16_t, Method>::const_iterator it = methods_.find(header.methodId);
+        if (it == methods_.end()) {
+            header.status = kRpcNoMethod;
+            RpcCodec::append(&output, header, StringPiece());
+        } else if (it->second.mode == kInThreadPool && workerThreads_ > 0) {
+            pool_.run(std::bind(&RpcServer::runInPool, this, conn, &it->second, header, payload.as_string()));
+        } else {
+            bool ok = it->second.handler(payload, &response);
+            header.status = static_cast<uint8_t>(ok ? kRpcOk : kRpcError);
+            RpcCodec::append(&output, header, response.toStringPiece());
+            response.retrieveAll();
+        }
+    }
+
+    if (output.readableBytes() > 0) {
+        conn->send(&output);
+    }
+    if (result == RpcCodec::kError) {
+        LOG_ERROR << "RpcServer::onMessage [" << conn->name() << "] - bad message";
+        buf->retrieveAll();
+        conn->forceClose();
+        return;
+    }
+    buf->retrieve(static_cast<size_t>(p - begin));
+}
+
+void RpcServer::runInPool(const TcpConnectionPtr &conn, const Method *method, RpcHeader header,
+                          const string &request) {
+    Buffer response;
+    bool ok = method->handler(request, &response);
+    header.status = static_cast<uint8_t>(ok ? kRpcOk : kRpcError);
+    Buffer output;
+    RpcCodec::append(&output, header, response.toStringPiece());
+    conn->send(&output);
+}
@@ -0,0 +1,77 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+/*
+ *      RpcServer：基于TcpServer的RPC服务端
+ *
+ *      1. handler按methodId注册，每个方法可以选择在IO线程中直接执行（kInLoop，适合不阻塞的短操作），
+ *         或者交给ThreadPool执行（kInThreadPool，适合会阻塞或耗时的操作，不拖慢同一个loop上的其它连接）。
+ *      2. 一次onMessage()处理inputBuffer中所有完整的请求，kInLoop的应答攒在一个Buffer里最后一次send()。
+ *      3. kInThreadPool的应答在工作线程中完成后立即发送，和其它应答的顺序无关，客户端按requestId分发。
+ *      4. 格式错误的消息视为协议错误，关闭连接。
+ */
+
+#ifndef MYMUDUO_RPCSERVER_H
+#define MYMUDUO_RPCSERVER_H
+
+#include "../../base/ThreadPool.h"
+#include "../TcpServer.h"
+#include "RpcCodec.h"
+
+#include <map>
+
+namespace muduo {
+    namespace net {
+
+        ///
+        /// RPC server dispatching requests to registered handlers by method id.
+        ///
+        class RpcServer : noncopyable {
+        public:
+            /// request is valid only during the call. Fills response and returns true,
+            /// or returns false to reply kRpcError with response as the error message.
+            typedef std::function<bool(const StringPiece &request, Buffer *response)> MethodHandler;
+
+            enum DispatchMode { kInLoop, kInThreadPool };
+
+            RpcServer(EventLoop *loop,
+                      const InetAddress &listenAddr,
+                      const string &name,
+                      TcpServer::Option option = TcpServer::kNoReusePort);
+
+            EventLoop *getLoop() const { return server_.getLoop(); }
+
+            /// IO threads, same as TcpServer::setThreadNum().
+            void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+            /// Threads running kInThreadPool handlers, default 0 runs them in the IO thread.
+            void setWorkerThreadNum(int numThreads) { workerThreads_ = numThreads; }
+
+            /// Not thread safe, register before calling start().
+            void registerMethod(uint16_t methodId, const MethodHandler &handler, DispatchMode mode = kInLoop);
+
+            void start();
+
+        private:
+            struct Method {
+                MethodHandler handler;
+                DispatchMode mode;
+            };
+
+            void onMessage(const TcpConnectionPtr &conn,
+                           Buffer *buf,
+                           Timestamp receiveTime);
+
+            void runInPool(const TcpConnectionPtr &conn, const Method *method, RpcHeader header, const string &request);
+
+            TcpServer server_;
+            std::map<uint16_t, Method> methods_;    // start()之后只读
+            ThreadPool pool_;
+            int workerThreads_;
+        };
+
+    }  // namespace net
+}  // namespace muduo
+
+#endif //MYMUDUO_RPCSERVER_H
@@ -0,0 +1,159 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+/*
+ *      RPC压测：同一进程内的RpcServer和RpcClient
+ *
+ *      在不同的并发度下（同时在路上的调用数，平均分到各条连接），每收到一个应答就发起下一个调用，
+ *      运行若干秒，统计每秒调用数和延迟的p50、p99。
+ *
+ *      用法：rpc_bench [服务端线程数] [连接数] [每个并发度的秒数] [payload字节数] [inloop|pool]
+ */
+
+#include "../../../base/Logging.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../RpcClient.h"
+#include "../RpcServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kLevels[] = {1, 16, 64, 256};
+const uint16_t kEcho = 1;
+
+bool echo(const StringPiece &request, Buffer *response) {
+    response->append(request);
+    return true;
+}
+
+class Bench : noncopyable {
+public:
+    Bench(EventLoop *loop, std::vector<std::unique_ptr<RpcClient>> *clients, const string &payload, double seconds)
+            : loop_(loop),
+              clients_(clients),
+              payload_(payload),
+              seconds_(seconds),
+              level_(0),
+              running_(false),
+              outstanding_(0),
+              errors_(0) {
+    }
+
+    void start() {
+        printf("%12s %12s %10s %10s %8s\n", "concurrency", "calls/sec", "p50(us)", "p99(us)", "errors");
+        startLevel();
+    }
+
+private:
+    void startLevel() {
+        if (level_ == static_cast<int>(sizeof kLevels / sizeof kLevels[0])) {
+            // 等连接正常关闭后再退出
+            for (const auto &client : *clients_) {
+                client->disconnect();
+            }
+            loop_->runAfter(0.2, std::bind(&EventLoop::quit, loop_));
+            return;
+        }
+        latencies_.clear();
+        errors_ = 0;
+        running_ = true;
+        loop_->runAfter(seconds_, [this]() { running_ = false; });
+        for (int i = 0; i < kLevels[level_]; ++i) {
+            issue(i);
+        }
+    }
+
+    void issue(int slot) {
+        ++outstanding_;
+        RpcClient *client = (*clients_)[static_cast<size_t>(slot) % clients_->size()].get();
+        client->call(kEcho, payload_, 1.0,
+                     std::bind(&Bench::onResponse, this, slot, Timestamp::now(), _1, _2));
+    }
+
+    void onResponse(int slot, Timestamp sent, RpcStatus status, StringPiece) {
+        --outstanding_;
+        if (status == kRpcOk) {
+            latencies_.push_back(static_cast<int>(Timestamp::now().microSecondsSinceEpoch() -
+                                                  sent.microSecondsSinceEpoch()));
+        } else {
+            ++errors_;
+        }
+        if (running_) {
+            issue(slot);
+        } else if (outstanding_ == 0) {
+            report();
+            ++level_;
+            startLevel();
+        }
+    }
+
+    void report() {
+        size_t n = latencies_.size();
+        int p50 = 0;
+        int p99 = 0;
+        if (n > 0) {
+            std::nth_element(latencies_.begin(), latencies_.begin() + n / 2, latencies_.end());
+            p50 = latencies_[n / 2];
+            std::nth_element(latencies_.begin(), latencies_.begin() + n * 99 / 100, latencies_.end());
+            p99 = latencies_[n * 99 / 100];
+        }
+        printf("%12d %12.0f %10d %10d %8d\n", kLevels[level_], static_cast<double>(n) / seconds_, p50, p99, errors_);
+    }
+
+    EventLoop *loop_;
+    std::vector<std::unique_ptr<RpcClient>> *clients_;
+    const string payload_;
+    const double seconds_;
+    int level_;
+    bool running_;
+    int outstanding_;
+    int errors_;
+    std::vector<int> latencies_;
+};
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 1;
+    int numConns = argc > 2 ? atoi(argv[2]) : 4;
+    double seconds = argc > 3 ? atof(argv[3]) : 2.0;
+    int payloadSize = argc > 4 ? atoi(argv[4]) : 32;
+    bool pool = argc > 5 && ::strcmp(argv[5], "pool") == 0;
+    Logger::setLogLevel(Logger::WARN);
+
+    EventLoop loop;
+    InetAddress addr("127.0.0.1", 19986);
+    RpcServer server(&loop, addr, "RpcBench");
+    server.setThreadNum(threads);
+    if (pool) {
+        server.setWorkerThreadNum(threads);
+    }
+    server.registerMethod(kEcho, echo, pool ? RpcServer::kInThreadPool : RpcServer::kInLoop);
+    server.start();
+    printf("%d server threads, %d connections, payload %d bytes, handler %s\n",
+           threads, numConns, payloadSize, pool ? "in thread pool" : "in loop");
+
+    std::vector<std::unique_ptr<RpcClient>> clients;
+    Bench bench(&loop, &clients, string(static_cast<size_t>(payloadSize), 'x'), seconds);
+    int connected = 0;
+    for (int i = 0; i < numConns; ++i) {
+        clients.emplace_back(new RpcClient(&loop, addr, "RpcBenchClient"));
+        clients.back()->setConnectionCallback([&](const TcpConnectionPtr &conn) {
+            if (conn->connected()) {
+                conn->setTcpNoDelay(true);
+                if (++connected == numConns) {
+                    bench.start();
+                }
+            }
+        });
+        clients.back()->connect();
+    }
+    loop.loop();
+}
@@ -0,0 +1,114 @@
+//
+// Created by chen on 2022/11/28.
+//
+
+/*
+ *      RpcServer/RpcClient测试
+ *
+ *      1. IO线程中执行的echo
+ *      2. 线程池中执行的调用，后发的先完成，应答乱序到达
+ *      3. 超过deadline的调用以kRpcTimeout结束，之后到达的应答被丢弃
+ *      4. 没有注册的方法、handler返回false
+ *      5. 断开连接后的调用以kRpcDisconnected结束
+ */
+
+#include "../../../base/Logging.h"
+#include "../../Buffer.h"
+#include "../../EventLoop.h"
+#include "../RpcClient.h"
+#include "../RpcServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+enum { kEcho = 1, kSleep = 2, kFail = 3, kMissing = 99 };
+
+bool echo(const StringPiece &request, Buffer *response) {
+    response->append(request);
+    return true;
+}
+
+/*
+ *      request是睡眠的毫秒数
+ */
+bool sleepFor(const StringPiece &request, Buffer *response) {
+    ::usleep(static_cast<useconds_t>(atoi(request.as_string().c_str()) * 1000));
+    response->append(request);
+    return true;
+}
+
+bool fail(const StringPiece &, Buffer *response) {
+    response->append("bad input");
+    return false;
+}
+
+EventLoop *g_loop;
+RpcClient *g_client;
+std::vector<string> g_completed;
+
+void expect(const string &name, RpcStatus expected, const string &expectedResponse,
+            RpcStatus status, StringPiece response) {
+    printf("%s: %s %s\n", name.c_str(), rpcStatusToString(status), response.as_string().c_str());
+    assert(status == expected);
+    assert(response == expectedResponse);
+    (void) expected;
+    g_completed.push_back(name);
+}
+
+void onConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        g_client->call(kEcho, "hello", 1.0, std::bind(expect, "echo", kRpcOk, "hello", _1, _2));
+        g_client->call(kSleep, "100", 1.0, std::bind(expect, "slow", kRpcOk, "100", _1, _2));
+        g_client->call(kSleep, "10", 1.0, std::bind(expect, "fast", kRpcOk, "10", _1, _2));
+        g_client->call(kSleep, "300", 0.05, std::bind(expect, "deadline", kRpcTimeout, "", _1, _2));
+        g_client->call(kMissing, "", 1.0, std::bind(expect, "missing", kRpcNoMethod, "", _1, _2));
+        g_client->call(kFail, "x", 1.0, std::bind(expect, "fail", kRpcError, "bad input", _1, _2));
+        assert(g_client->numPending() == 6);
+
+        // 等超时调用的应答到达并被丢弃
+        g_loop->runAfter(0.5, []() {
+            assert(g_completed.size() == 6);
+            assert(g_client->numPending() == 0);
+            std::vector<string>::iterator fast = std::find(g_completed.begin(), g_completed.end(), "fast");
+            std::vector<string>::iterator slow = std::find(g_completed.begin(), g_completed.end(), "slow");
+            assert(fast < slow);
+            (void) fast;
+            (void) slow;
+            g_client->disconnect();
+        });
+    } else {
+        g_client->call(kEcho, "hello", 1.0, [](RpcStatus status, StringPiece) {
+            assert(status == kRpcDisconnected);
+            (void) status;
+            printf("all ok\n");
+            g_loop->quit();
+        });
+    }
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    g_loop = &loop;
+    InetAddress addr("127.0.0.1", 19985);
+
+    RpcServer server(&loop, addr, "RpcTestServer");
+    server.setWorkerThreadNum(2);
+    server.registerMethod(kEcho, echo);
+    server.registerMethod(kSleep, sleepFor, RpcServer::kInThreadPool);
+    server.registerMethod(kFail, fail);
+    server.start();
+
+    RpcClient client(&loop, addr, "RpcTestClient");
+    g_client = &client;
+    client.setConnectionCallback(onConnection);
+    client.connect();
+    loop.loop();
+}
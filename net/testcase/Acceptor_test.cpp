@@ -0,0 +1,82 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      Acceptor批量accept测试
+ *
+ *      loop开始之前先建立20条连接（内核已经完成握手，都在listen队列中），
+ *      loop的第一次可读事件应该一次把它们全部accept出来，交给一次NewConnectionsCallback。
+ *      测试程序自己定义accept4()，在第3次和第7次调用时分别返回ECONNABORTED和EINTR，这两个错误不能结束这一批。
+ */
+
+#include "../../base/Logging.h"
+#include "../Acceptor.h"
+#include "../EventLoop.h"
+#include "../SocketsOps.h"
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_acceptCalls = 0;
+
+extern "C" int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags) {
+    typedef int (*Accept4Func)(int, struct sockaddr *, socklen_t *, int);
+    static Accept4Func realAccept4 = reinterpret_cast<Accept4Func>(::dlsym(RTLD_NEXT, "accept4"));
+    ++g_acceptCalls;
+    if (g_acceptCalls == 3) {
+        errno = ECONNABORTED;
+        return -1;
+    }
+    if (g_acceptCalls == 7) {
+        errno = EINTR;
+        return -1;
+    }
+    return realAccept4(sockfd, addr, addrlen, flags);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    const int kConnections = 20;
+    EventLoop loop;
+    InetAddress addr("127.0.0.1", 19994);
+    Acceptor acceptor(&loop, addr, false);
+    acceptor.setMaxAcceptsPerEvent(64);
+    std::vector<size_t> batches;
+    acceptor.setNewConnectionsCallback([&](const Acceptor::AcceptedConnectionList &accepted) {
+        batches.push_back(accepted.size());
+        for (const AcceptedConnection &conn : accepted) {
+            sockets::close(conn.sockfd);
+        }
+    });
+    acceptor.listen();
+
+    std::vector<int> clients;
+    for (int i = 0; i < kConnections; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int ret = ::connect(fd, addr.getSockAddr(), addr.addrLength());
+        assert(ret == 0);
+        (void) ret;
+        clients.push_back(fd);
+    }
+
+    loop.runAfter(0.2, [&loop]() { loop.quit(); });
+    loop.loop();
+    printf("batches: %zu, first batch: %zu, accept4 calls: %d\n",
+           batches.size(), batches.empty() ? 0 : batches[0], g_acceptCalls);
+    assert(batches.size() == 1);
+    assert(batches[0] == static_cast<size_t>(kConnections));
+    assert(g_acceptCalls == kConnections + 3);     // 两次错误，最后一次EAGAIN
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
@@ -0,0 +1,130 @@
+//
+// Created by chen on 2022/11/23.
+//
+
+/*
+ *      ConnectionPool测试，服务端和连接池在同一个loop中
+ *
+ *      1. addBackend()之后建立minConnections条热备连接
+ *      2. acquire()选择outstanding最少的连接，都忙时扩容，不超过maxConnections
+ *      3. 服务端关闭连接后TcpClient重连，连接数恢复
+ *      4. 不存在的后端以空指针回调
+ */
+
+#include "../../base/Logging.h"
+#include "../ConnectionPool.h"
+#include "../EventLoop.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <set>
+
+using namespace muduo;
+using namespace muduo::net;
+
+ConnectionPool *g_pool = NULL;
+std::vector<TcpConnectionPtr> g_serverConns;
+int g_step = 0;
+
+void onServerConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        g_serverConns.push_back(conn);
+    } else {
+        for (size_t i = 0; i < g_serverConns.size(); ++i) {
+            if (g_serverConns[i] == conn) {
+                g_serverConns.erase(g_serverConns.begin() + i);
+                break;
+            }
+        }
+    }
+}
+
+void onEcho(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    conn->send(buf);
+}
+
+void step(EventLoop *loop, const InetAddress &addr) {
+    ++g_step;
+    if (g_step == 1) {
+        printf("warm connections: %d\n", g_pool->numConnected(addr));
+        assert(g_pool->numConnected(addr) == 2);
+
+        std::set<TcpConnection *> used;
+        std::vector<TcpConnectionPtr> leased;
+        for (int i = 0; i < 4; ++i) {
+            TcpConnectionPtr conn = g_pool->tryAcquire(addr);
+            assert(conn);
+            used.insert(get_pointer(conn));
+            leased.push_back(conn);
+        }
+        // 4个请求平均分到两条连接上
+        assert(used.size() == 2);
+        assert(g_pool->numOutstanding(addr) == 4);
+        for (const TcpConnectionPtr &conn : leased) {
+            g_pool->release(conn);
+        }
+        assert(g_pool->numOutstanding(addr) == 0);
+
+        // 两条连接都忙，触发扩容
+        TcpConnectionPtr c1 = g_pool->tryAcquire(addr);
+        TcpConnectionPtr c2 = g_pool->tryAcquire(addr);
+        TcpConnectionPtr c3 = g_pool->tryAcquire(addr);
+        assert(c1 != c2);
+        g_pool->release(c1);
+        g_pool->release(c2);
+        g_pool->release(c3);
+    } else if (g_step == 2) {
+        printf("after scale up: %d\n", g_pool->numConnected(addr));
+        assert(g_pool->numConnected(addr) == 3);
+
+        g_pool->acquire(InetAddress(1), [](const TcpConnectionPtr &conn) { assert(!conn); });
+
+        // 服务端关掉所有连接，由TcpClient重连
+        std::vector<TcpConnectionPtr> conns(g_serverConns);
+        for (const TcpConnectionPtr &conn : conns) {
+            conn->forceClose();
+        }
+    } else if (g_step == 3) {
+        // 重连的间隔是0.5秒
+        printf("after reconnect: %d\n", g_pool->numConnected(addr));
+        assert(g_pool->numConnected(addr) == 3);
+        g_pool->acquire(addr, [](const TcpConnectionPtr &conn) {
+            assert(conn);
+            conn->send("ping");
+        });
+    } else {
+        delete g_pool;
+        g_pool = NULL;
+        loop->runAfter(0.2, [loop]() { loop->quit(); });
+        return;
+    }
+    loop->runAfter(1.0, std::bind(step, loop, addr));
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    InetAddress addr("127.0.0.1", 19981);
+    TcpServer server(&loop, addr, "PoolServer");
+    server.setConnectionCallback(onServerConnection);
+    server.setMessageCallback(onEcho);
+    server.start();
+
+    int echoed = 0;
+    g_pool = new ConnectionPool(&loop, "pool");
+    g_pool->setMinConnections(2);
+    g_pool->setMaxConnections(3);
+    g_pool->setMessageCallback([&echoed](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        echoed += static_cast<int>(buf->readableBytes());
+        buf->retrieveAll();
+        g_pool->release(conn);
+    });
+    g_pool->addBackend(addr);
+
+    loop.runAfter(0.5, std::bind(step, &loop, addr));
+    loop.loop();
+    assert(echoed == 4);
+    printf("all passed\n");
+}
@@ -0,0 +1,195 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      TcpServer::setPlaceByIncomingCpu() / setThreadCpuAffinity()测试
+ *
+ *      测试机器的CPU可能很少，测试程序自己定义下面几个函数：
+ *      sched_getaffinity()报告CPU 0~3都可用；pthread_setaffinity_np()只记录每个IO线程被绑定的CPU；
+ *      getsockopt(SO_INCOMING_CPU)按g_mode返回真实值、指定的CPU或者ENOPROTOOPT（内核不支持）。
+ *
+ *      1. 3个IO线程依次绑定在CPU 0、1、2上
+ *      2. 真实的SO_INCOMING_CPU是一个可用的CPU，连接落在这个CPU对应的loop上
+ *      3. CPU 0~2的连接落在绑定在该CPU上的loop；没有绑定loop的CPU 3和超出范围的CPU 7固定映射到 cpu % 3
+ *      4. 不支持SO_INCOMING_CPU时退化为round-robin，3条连接落在3个不同的loop上
+ */
+
+#include "../../base/Logging.h"
+#include "../../base/Mutex.h"
+#include "../EventLoop.h"
+#include "../EventLoopThreadPool.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kNumCpus = 4;
+const int kNumThreads = 3;
+const int kFakeCpus[] = {0, 1, 2, 3, 7};
+const size_t kNumFake = sizeof kFakeCpus / sizeof kFakeCpus[0];
+
+enum Mode { kReal, kFake, kUnsupported };
+Mode g_mode = kReal;
+int g_fakeCpu = 0;
+int g_lastCpu = -1;             // 最近一次getsockopt(SO_INCOMING_CPU)的结果
+
+__thread int t_pinnedCpu = -1;
+
+extern "C" int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t *mask) {
+    CPU_ZERO_S(cpusetsize, mask);
+    for (int cpu = 0; cpu < kNumCpus; ++cpu) {
+        CPU_SET_S(cpu, cpusetsize, mask);
+    }
+    return 0;
+}
+
+extern "C" int pthread_setaffinity_np(pthread_t thread, size_t cpusetsize, const cpu_set_t *cpuset) {
+    assert(pthread_equal(thread, ::pthread_self()));
+    assert(CPU_COUNT_S(cpusetsize, cpuset) == 1);
+    for (int cpu = 0; cpu < kNumCpus; ++cpu) {
+        if (CPU_ISSET_S(cpu, cpusetsize, cpuset)) {
+            t_pinnedCpu = cpu;
+        }
+    }
+    return 0;
+}
+
+extern "C" int getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *optlen) {
+    typedef int (*GetsockoptFunc)(int, int, int, void *, socklen_t *);
+    static GetsockoptFunc realGetsockopt = reinterpret_cast<GetsockoptFunc>(::dlsym(RTLD_NEXT, "getsockopt"));
+#ifdef SO_INCOMING_CPU
+    if (level == SOL_SOCKET && optname == SO_INCOMING_CPU && g_mode != kReal) {
+        if (g_mode == kUnsupported) {
+            errno = ENOPROTOOPT;
+            return -1;
+        }
+        *static_cast<int *>(optval) = g_fakeCpu;
+        g_lastCpu = g_fakeCpu;
+        return 0;
+    }
+#endif
+    int ret = realGetsockopt(sockfd, level, optname, optval, optlen);
+#ifdef SO_INCOMING_CPU
+    if (level == SOL_SOCKET && optname == SO_INCOMING_CPU && ret == 0) {
+        g_lastCpu = *static_cast<int *>(optval);
+    }
+#endif
+    return ret;
+}
+
+MutexLock g_mutex;
+std::map<EventLoop *, int> g_pinned;        // IO线程的loop --> 绑定的CPU
+std::vector<EventLoop *> g_placed;          // 按建立的顺序，每条连接所在的loop
+
+std::vector<int> g_clients;
+InetAddress g_serverAddr("127.0.0.1", 19996);
+
+void connectOne() {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int ret = ::connect(fd, g_serverAddr.getSockAddr(), g_serverAddr.addrLength());
+    assert(ret == 0);
+    (void) ret;
+    g_clients.push_back(fd);
+}
+
+EventLoop *placed(size_t i) {
+    MutexLockGuard lock(g_mutex);
+    assert(i < g_placed.size());
+    return g_placed[i];
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    TcpServer server(&loop, g_serverAddr, "IncomingCpuServer");
+    server.setThreadNum(kNumThreads);
+    server.setThreadCpuAffinity(true);
+    server.setPlaceByIncomingCpu(true);
+    server.setThreadInitCallback([](EventLoop *ioLoop) {
+        MutexLockGuard lock(g_mutex);
+        g_pinned[ioLoop] = t_pinnedCpu;
+    });
+    server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            MutexLockGuard lock(g_mutex);
+            g_placed.push_back(conn->getLoop());
+        }
+    });
+    server.start();
+
+    // 1. 绑定
+    std::vector<EventLoop *> loops = server.threadPool()->getAllLoops();
+    assert(loops.size() == static_cast<size_t>(kNumThreads));
+    for (int i = 0; i < kNumThreads; ++i) {
+        assert(g_pinned[loops[static_cast<size_t>(i)]] == i);
+    }
+    printf("pinned ok\n");
+
+    // 每隔0.1秒建立一条连接，连接在下一次loop迭代中被accept
+    double when = 0.1;
+    loop.runAfter(when, []() { connectOne(); });
+    for (size_t i = 0; i < kNumFake; ++i) {
+        when += 0.1;
+        loop.runAfter(when, [i]() {
+            g_mode = kFake;
+            g_fakeCpu = kFakeCpus[i];
+            connectOne();
+        });
+    }
+    for (int i = 0; i < kNumThreads; ++i) {
+        when += 0.1;
+        loop.runAfter(when, []() {
+            g_mode = kUnsupported;
+            connectOne();
+        });
+    }
+    loop.runAfter(when + 0.2, [&]() { loop.quit(); });
+
+    // 2. 真实的SO_INCOMING_CPU，在第一条假连接之前检查
+    loop.runAfter(0.15, [&]() {
+#ifdef SO_INCOMING_CPU
+        assert(g_lastCpu >= 0);
+        EventLoop *expected = server.threadPool()->getLoopForCpu(g_lastCpu);
+        assert(placed(0) == expected);
+        printf("real incoming cpu %d ok\n", g_lastCpu);
+#else
+        printf("SO_INCOMING_CPU is not supported\n");
+#endif
+    });
+    loop.loop();
+
+    // 3. 指定的CPU
+    assert(g_placed.size() == 1 + kNumFake + kNumThreads);
+    assert(placed(1) == loops[0]);
+    assert(placed(2) == loops[1]);
+    assert(placed(3) == loops[2]);
+    assert(placed(4) == loops[3 % kNumThreads]);
+    assert(placed(5) == loops[7 % kNumThreads]);
+    printf("placed by incoming cpu ok\n");
+
+    // 4. round-robin
+    std::set<EventLoop *> roundRobin;
+    for (size_t i = 1 + kNumFake; i < g_placed.size(); ++i) {
+        roundRobin.insert(placed(i));
+    }
+    assert(roundRobin.size() == static_cast<size_t>(kNumThreads));
+    printf("round-robin fallback ok\n");
+
+    for (int fd : g_clients) {
+        ::close(fd);
+    }
+}
@@ -0,0 +1,102 @@
+//
+// Created by chen on 2022/11/25.
+//
+
+/*
+ *      LengthHeaderCodec测试，不需要网络：编码后的数据按任意长度切开喂给onMessage()
+ *
+ *      1. 各种长度头宽度和字节序都能还原出原来的帧（包括空帧）
+ *      2. 一次onMessage()处理所有完整的帧，不完整的留在Buffer中
+ *      3. 超过maxFrameSize的长度调用ErrorCallback
+ */
+
+#include "../LengthHeaderCodec.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+std::vector<string> g_frames;
+
+void onFrame(const TcpConnectionPtr &, StringPiece frame, Timestamp) {
+    g_frames.push_back(frame.as_string());
+}
+
+void testRoundTrip(int headerLen, LengthHeaderCodec::ByteOrder byteOrder) {
+    LengthHeaderCodec codec(onFrame, headerLen, byteOrder);
+    std::vector<string> messages = {"hello", "", string(200, 'x'), "world"};
+
+    Buffer wire;
+    for (const string &msg : messages) {
+        Buffer buf;
+        buf.append(msg);
+        bool ok = codec.encode(&buf);
+        assert(ok);
+        assert(buf.readableBytes() == msg.size() + static_cast<size_t>(headerLen));
+        wire.append(buf.peek(), buf.readableBytes());
+    }
+    string data = wire.retrieveAllAsString();
+
+    // 每次喂7个字节，模拟分多次到达
+    g_frames.clear();
+    Buffer input;
+    for (size_t i = 0; i < data.size(); i += 7) {
+        input.append(data.data() + i, std::min<size_t>(7, data.size() - i));
+        codec.onMessage(TcpConnectionPtr(), &input, Timestamp::now());
+    }
+    assert(input.readableBytes() == 0);
+    assert(g_frames == messages);
+
+    // 一次全部到达
+    g_frames.clear();
+    input.append(data);
+    codec.onMessage(TcpConnectionPtr(), &input, Timestamp::now());
+    assert(g_frames == messages);
+    printf("headerLen %d %s ok\n", headerLen, byteOrder == LengthHeaderCodec::kBigEndian ? "big" : "little");
+}
+
+void testPartial() {
+    LengthHeaderCodec codec(onFrame);
+    Buffer buf;
+    buf.append("abc", 3);
+    codec.encode(&buf);
+    buf.append("\0\0\0\5ab", 6);   // 第二帧只到了一部分
+    g_frames.clear();
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp::now());
+    assert(g_frames.size() == 1 && g_frames[0] == "abc");
+    assert(buf.readableBytes() == 6);
+    buf.append("cde", 3);
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp::now());
+    assert(g_frames.size() == 2 && g_frames[1] == "abcde");
+}
+
+void testTooLarge() {
+    LengthHeaderCodec codec(onFrame, 2, LengthHeaderCodec::kBigEndian, 100);
+    uint64_t badLength = 0;
+    codec.setErrorCallback([&badLength](const TcpConnectionPtr &, uint64_t length) { badLength = length; });
+    Buffer buf;
+    buf.append("\x01\x00", 2);
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp::now());
+    assert(badLength == 256);
+    assert(buf.readableBytes() == 0);
+
+    Buffer big;
+    big.append(string(101, 'y'));
+    assert(!codec.encode(&big));
+
+    LengthHeaderCodec narrow(onFrame, 1);
+    assert(narrow.maxFrameSize() == 255);
+}
+
+int main() {
+    const int widths[] = {1, 2, 4, 8};
+    for (int w : widths) {
+        testRoundTrip(w, LengthHeaderCodec::kBigEndian);
+        testRoundTrip(w, LengthHeaderCodec::kLittleEndian);
+    }
+    testPartial();
+    testTooLarge();
+    printf("all passed\n");
+}
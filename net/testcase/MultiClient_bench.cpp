@@ -0,0 +1,90 @@
+//
+// Created by chen on 2022/11/24.
+//
+
+/*
+ *      MultiClient压测：同一进程内的TcpServer接受连接
+ *
+ *      1. MultiClient按给定速率建立N条连接，统计用时
+ *      2. 服务端一次性断开所有连接，客户端经过时间轮（退避+抖动）重连，统计全部恢复的用时
+ *
+ *      用法：multiclient_bench [连接数] [每秒连接数] [线程数]
+ *      每条连接在本进程中占两个fd，注意ulimit -n
+ */
+
+#include "../../base/Logging.h"
+#include "../../base/Mutex.h"
+#include "../EventLoop.h"
+#include "../MultiClient.h"
+#include "../TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+MutexLock g_mutex;
+std::vector<TcpConnectionPtr> g_serverConns;
+
+void onServerConnection(const TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+        MutexLockGuard lock(g_mutex);
+        g_serverConns.push_back(conn);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int numConns = argc > 1 ? atoi(argv[1]) : 5000;
+    int rate = argc > 2 ? atoi(argv[2]) : 20000;
+    int threads = argc > 3 ? atoi(argv[3]) : 2;
+    Logger::setLogLevel(Logger::WARN);
+
+    EventLoop loop;
+    InetAddress listenAddr("127.0.0.1", 19982);
+    TcpServer server(&loop, listenAddr, "BenchServer");
+    server.setThreadNum(threads);
+    server.setConnectionCallback(onServerConnection);
+    server.start();
+
+    MultiClient client(&loop, "bench");
+    client.setThreadNum(threads);
+    client.setConnectRate(rate);
+    client.enableRetry();
+    client.setRetryDelay(0.5, 5.0);
+    client.setRetryJitter(0.5);
+    for (int i = 0; i < numConns; ++i) {
+        client.addPeer(listenAddr);
+    }
+
+    Timestamp start = Timestamp::now();
+    int phase = 0;
+    int64_t attempts = 0;
+    client.start();
+    loop.runEvery(0.01, [&]() {
+        if (phase == 0 && client.numConnected() == numConns) {
+            printf("connected %d in %.3f s, %lld attempts, rate %d/s\n", numConns,
+                   timeDifference(Timestamp::now(), start),
+                   static_cast<long long>(client.numAttempts()), rate);
+            std::vector<TcpConnectionPtr> conns;
+            {
+                MutexLockGuard lock(g_mutex);
+                conns.swap(g_serverConns);
+            }
+            attempts = client.numAttempts();
+            start = Timestamp::now();
+            for (const TcpConnectionPtr &conn : conns) {
+                conn->forceClose();
+            }
+            phase = 1;
+        } else if (phase == 1 && client.numConnected() == 0) {
+            phase = 2;
+        } else if (phase == 2 && client.numConnected() == numConns) {
+            printf("reconnected %d in %.3f s, %lld attempts\n", numConns,
+                   timeDifference(Timestamp::now(), start),
+                   static_cast<long long>(client.numAttempts() - attempts));
+            loop.quit();
+        }
+    });
+    loop.loop();
+}
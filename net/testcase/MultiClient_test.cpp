@@ -0,0 +1,102 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      MultiClient构造/连接/析构测试
+ *
+ *      1. 2个IO线程上建立50条连接，全部建立后析构MultiClient：连接被销毁，服务端看到所有连接断开
+ *      2. 开启重连，对端端口没有监听（8个对端）：析构时还有重连定时器和握手中的连接
+ *      3. 析构之后loop继续运行一段时间，IO线程中不能再有访问MultiClient的回调（用-fsanitize=address检查）
+ */
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../MultiClient.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kNumPeers = 50;
+const int kNumRetryingPeers = 8;
+
+AtomicInt32 g_serverConnected;
+AtomicInt32 g_clientUp;
+AtomicInt32 g_clientDown;
+
+void testConnected() {
+    EventLoop loop;
+    InetAddress listenAddr("127.0.0.1", 19997);
+    TcpServer server(&loop, listenAddr, "MultiClientServer");
+    server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            g_serverConnected.increment();
+        } else {
+            g_serverConnected.decrement();
+        }
+    });
+    server.start();
+
+    std::unique_ptr<MultiClient> client(new MultiClient(&loop, "client"));
+    client->setThreadNum(2);
+    client->enableRetry();
+    client->setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            g_clientUp.increment();
+        } else {
+            g_clientDown.increment();
+        }
+    });
+    for (int i = 0; i < kNumPeers; ++i) {
+        client->addPeer(listenAddr);
+    }
+    client->start();
+
+    loop.runEvery(0.05, [&]() {
+        if (client && client->numConnected() == kNumPeers && g_serverConnected.get() == kNumPeers) {
+            client.reset();
+            assert(g_clientUp.get() == kNumPeers);
+            assert(g_clientDown.get() == kNumPeers);
+            loop.runAfter(0.5, [&loop]() { loop.quit(); });
+        }
+    });
+    loop.runAfter(5.0, []() {
+        printf("timeout\n");
+        abort();
+    });
+    loop.loop();
+    assert(!client);
+    assert(g_serverConnected.get() == 0);
+    printf("connected and destroyed ok\n");
+}
+
+void testRetrying() {
+    EventLoop loop;
+    std::unique_ptr<MultiClient> client(new MultiClient(&loop, "retrying"));
+    client->setThreadNum(2);
+    client->enableRetry();
+    client->setRetryDelay(0.1, 0.2);
+    for (int i = 0; i < kNumRetryingPeers; ++i) {
+        client->addPeer(InetAddress("127.0.0.1", 19998));     // 没有监听，连接被拒绝
+    }
+    client->start();
+
+    loop.runAfter(0.5, [&]() {
+        assert(client->numAttempts() > kNumRetryingPeers);
+        client.reset();
+    });
+    loop.runAfter(1.0, [&loop]() { loop.quit(); });
+    loop.loop();
+    printf("retrying and destroyed ok\n");
+}
+
+int main() {
+    Logger::setLogLevel(Logger::ERROR);
+    testConnected();
+    testRetrying();
+}
@@ -0,0 +1,144 @@
+//
+// Created by chen on 2022/11/22.
+//
+
+/*
+ *      Resolver测试，只依赖/etc/hosts中的localhost，不需要访问外部DNS
+ *
+ *      1. 数字IP直接返回
+ *      2. localhost解析成功，并发的同名请求只查询一次，之后命中缓存
+ *      3. 不存在的主机名（.invalid保留域名）解析失败，失败结果也被缓存
+ *      4. 过期的项被删除，再次解析时重新查询
+ *      5. 缓存项数有上限，按LRU淘汰
+ *      6. TcpClient直接使用主机名连接
+ */
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../Resolver.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_pending = 0;
+
+void expect(EventLoop *loop, bool expectOk, uint16_t expectPort, bool ok, const InetAddress &addr) {
+    printf("%s %s\n", ok ? "resolved" : "failed", ok ? addr.toIpPort().c_str() : "");
+    assert(ok == expectOk);
+    if (ok) {
+        assert(addr.port() == expectPort);
+    }
+    if (--g_pending == 0) {
+        loop->quit();
+    }
+}
+
+void testResolver() {
+    EventLoop loop;
+    Resolver resolver(2, 60.0, 60.0);
+
+    g_pending = 5;
+    resolver.resolve(&loop, "127.0.0.1", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    resolver.resolve(&loop, "localhost", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    resolver.resolve(&loop, "localhost", 8080, std::bind(expect, &loop, true, 8080, _1, _2));
+    resolver.resolve(&loop, "localhost", 443, std::bind(expect, &loop, true, 443, _1, _2));
+    resolver.resolve(&loop, "no-such-host.invalid", 80, std::bind(expect, &loop, false, 80, _1, _2));
+    loop.loop();
+    assert(resolver.lookups() == 2);        // localhost的三个请求合并成一次查询（或者命中缓存）
+    assert(resolver.cacheSize() == 2);
+
+    g_pending = 2;
+    resolver.resolve(&loop, "localhost", 22, std::bind(expect, &loop, true, 22, _1, _2));
+    resolver.resolve(&loop, "no-such-host.invalid", 80, std::bind(expect, &loop, false, 80, _1, _2));
+    loop.loop();
+    assert(resolver.lookups() == 2);
+    assert(resolver.cacheHits() >= 2);
+
+    InetAddress addr;
+    assert(resolver.resolveFromCache("localhost", 9, &addr));
+    assert(addr.port() == 9);
+    assert(!resolver.resolveFromCache("no-such-host.invalid", 9, &addr));
+}
+
+void testExpiry() {
+    EventLoop loop;
+    Resolver resolver(2, 0.2, 0.2);
+
+    g_pending = 1;
+    resolver.resolve(&loop, "localhost", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    loop.loop();
+    assert(resolver.cacheSize() == 1);
+
+    ::usleep(300 * 1000);
+    InetAddress addr;
+    assert(!resolver.resolveFromCache("localhost", 80, &addr));
+    assert(resolver.cacheSize() == 0);      // 过期的项在查找时被删除
+    assert(resolver.cacheEvictions() == 1);
+
+    g_pending = 1;
+    resolver.resolve(&loop, "localhost", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    loop.loop();
+    assert(resolver.lookups() == 2);        // 过期后重新查询
+    assert(resolver.cacheSize() == 1);
+}
+
+// /etc/hosts中的名字不区分大小写，三种写法是三个不同的缓存项，都不需要访问DNS
+void testEviction() {
+    EventLoop loop;
+    Resolver resolver(2, 60.0, 60.0, 2);
+
+    g_pending = 1;
+    resolver.resolve(&loop, "localhost", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    loop.loop();
+    g_pending = 1;
+    resolver.resolve(&loop, "LOCALHOST", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    loop.loop();
+
+    // 使用localhost，LOCALHOST成为最久没有使用的项
+    InetAddress addr;
+    assert(resolver.resolveFromCache("localhost", 80, &addr));
+
+    g_pending = 1;
+    resolver.resolve(&loop, "Localhost", 80, std::bind(expect, &loop, true, 80, _1, _2));
+    loop.loop();
+    assert(resolver.lookups() == 3);
+    assert(resolver.cacheSize() == 2);
+    assert(resolver.cacheEvictions() == 1);
+    assert(!resolver.resolveFromCache("LOCALHOST", 80, &addr));
+    assert(resolver.resolveFromCache("localhost", 80, &addr));
+    assert(resolver.resolveFromCache("Localhost", 80, &addr));
+}
+
+void testTcpClient() {
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(23458, true), "server");
+    server.start();
+
+    TcpClient client(&loop, "localhost", 23458, "client");
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        printf("client %s %s\n", conn->peerAddress().toIpPort().c_str(), conn->connected() ? "UP" : "DOWN");
+        assert(conn->peerAddress().port() == 23458);
+        if (conn->connected()) {
+            client.disconnect();
+        } else {
+            loop.quit();
+        }
+    });
+    client.connect();
+    loop.loop();
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    testResolver();
+    testExpiry();
+    testEviction();
+    testTcpClient();
+    printf("all tests passed\n");
+}
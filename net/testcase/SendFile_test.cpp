@@ -0,0 +1,128 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      TcpConnection::sendFile()测试
+ *
+ *      客户端连接后先不读。服务端sendFile()一个8MB的文件，对方不读所以文件发不完，
+ *      之后send()的2MB数据排在文件后面（PendingFile::after）：
+ *      1. 这部分数据计入高水位，超过1MB时触发highWaterMarkCallback，并且只触发一次
+ *      2. 客户端读到的数据顺序是文件在前、send()的数据在后
+ */
+
+#include "../../base/Logging.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kFileSize = 8 * 1024 * 1024;
+const size_t kSendSize = 2 * 1024 * 1024;
+const size_t kChunk = 64 * 1024;
+const size_t kHighWaterMark = 1024 * 1024;
+
+std::atomic<int> g_highWater(0);
+std::atomic<size_t> g_highWaterBytes(0);
+
+char fileByte(size_t i) { return static_cast<char>('a' + i % 26); }
+
+char sendByte(size_t i) { return static_cast<char>('0' + i % 10); }
+
+string createFile() {
+    char path[] = "/tmp/sendfile_test_XXXXXX";
+    int fd = ::mkstemp(path);
+    assert(fd >= 0);
+    string content(kFileSize, '\0');
+    for (size_t i = 0; i < kFileSize; ++i) {
+        content[i] = fileByte(i);
+    }
+    ssize_t n = ::write(fd, content.data(), content.size());
+    assert(n == static_cast<ssize_t>(kFileSize));
+    (void) n;
+    ::close(fd);
+    return path;
+}
+
+void onConnection(const string &path, const TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+        return;
+    }
+    conn->setHighWaterMarkCallback([](const TcpConnectionPtr &, size_t bytes) {
+        ++g_highWater;
+        g_highWaterBytes = bytes;
+    }, kHighWaterMark);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    assert(fd >= 0);
+    conn->sendFile(fd, 0, kFileSize);
+    ::close(fd);
+
+    string chunk(kChunk, '\0');
+    for (size_t pos = 0; pos < kSendSize; pos += kChunk) {
+        for (size_t i = 0; i < kChunk; ++i) {
+            chunk[i] = sendByte(pos + i);
+        }
+        conn->send(chunk);
+    }
+    conn->shutdown();
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    string path = createFile();
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    InetAddress addr("127.0.0.1", 19999);
+    std::unique_ptr<TcpServer> server;
+    loop->runInLoop([&] {
+        server.reset(new TcpServer(loop, addr, "SendFileServer"));
+        server->setConnectionCallback(std::bind(onConnection, path, _1));
+        server->start();
+    });
+    ::usleep(100 * 1000);
+
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int rcvbuf = 64 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, static_cast<socklen_t>(sizeof rcvbuf));
+    int ret = ::connect(fd, addr.getSockAddr(), addr.addrLength());
+    assert(ret == 0);
+    (void) ret;
+
+    // 1. 不读，send()的数据全部排在文件后面
+    ::usleep(300 * 1000);
+    printf("high water callbacks: %d, bytes: %zu\n", g_highWater.load(), g_highWaterBytes.load());
+    assert(g_highWater == 1);
+    assert(g_highWaterBytes >= kHighWaterMark);
+
+    // 2. 顺序
+    char buf[64 * 1024];
+    size_t total = 0;
+    ssize_t n = 0;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            size_t pos = total + static_cast<size_t>(i);
+            assert(buf[i] == (pos < kFileSize ? fileByte(pos) : sendByte(pos - kFileSize)));
+        }
+        total += static_cast<size_t>(n);
+    }
+    assert(total == kFileSize + kSendSize);
+    assert(g_highWater == 1);
+    printf("received %zu bytes in order\n", total);
+    ::close(fd);
+
+    loop->runInLoop([&] { server.reset(); });
+    ::usleep(100 * 1000);
+    ::unlink(path.c_str());
+}
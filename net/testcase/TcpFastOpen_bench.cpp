@@ -0,0 +1,139 @@
+//
+// Created by chen on 2022/11/22.
+//
+
+/*
+ *      TCP Fast Open 的 "connect + 第一个请求" 延迟
+ *
+ *      服务端是开启了TCP_FASTOPEN的echo TcpServer，运行在EventLoopThread中。
+ *      客户端每一轮新建一个TcpClient，从connect()开始计时，连接建立后发送一个请求，收到回显后停止计时并断开，
+ *      分别在关闭/开启TCP Fast Open的情况下统计平均延迟和p99。
+ *
+ *      loopback上也需要打开服务端的TFO：sysctl -w net.ipv4.tcp_fastopen=3
+ *
+ *      usage: tcpfastopen_bench [rounds]
+ */
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+class FastOpenBench : noncopyable {
+public:
+    FastOpenBench(EventLoop *loop, const InetAddress &serverAddr, bool fastOpen, int rounds)
+            : loop_(loop),
+              serverAddr_(serverAddr),
+              fastOpen_(fastOpen),
+              rounds_(rounds) {
+        latencies_.reserve(rounds);
+    }
+
+    void start() {
+        start_ = Timestamp::now();
+        client_.reset(new TcpClient(loop_, serverAddr_, "bench"));
+        if (fastOpen_) {
+            client_->enableTcpFastOpen();
+        }
+        client_->setConnectionCallback(
+                std::bind(&FastOpenBench::onConnection, this, _1));
+        client_->setMessageCallback(
+                std::bind(&FastOpenBench::onMessage, this, _1, _2, _3));
+        client_->connect();
+    }
+
+    void report() {
+        std::sort(latencies_.begin(), latencies_.end());
+        double sum = 0;
+        for (double l: latencies_) {
+            sum += l;
+        }
+        printf("fastopen %-3s %6zu rounds  avg %8.2f us  p50 %8.2f us  p99 %8.2f us\n",
+               fastOpen_ ? "on" : "off", latencies_.size(),
+               sum / static_cast<double>(latencies_.size()),
+               latencies_[latencies_.size() / 2],
+               latencies_[latencies_.size() * 99 / 100]);
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            conn->setTcpNoDelay(true);
+            conn->send(kRequest);
+        } else {
+            // 不能在TcpClient自己的回调里析构它
+            loop_->queueInLoop(std::bind(&FastOpenBench::next, this));
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        if (buf->readableBytes() >= kRequest.size()) {
+            latencies_.push_back(timeDifference(Timestamp::now(), start_) * 1e6);
+            buf->retrieveAll();
+            conn->forceClose();
+        }
+    }
+
+    void next() {
+        client_.reset();
+        if (static_cast<int>(latencies_.size()) < rounds_) {
+            start();
+        } else {
+            loop_->quit();
+        }
+    }
+
+    static const string kRequest;
+
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    const bool fastOpen_;
+    const int rounds_;
+    Timestamp start_;
+    std::unique_ptr<TcpClient> client_;
+    std::vector<double> latencies_;     // 单位: us
+};
+
+const string FastOpenBench::kRequest = "GET /ping\r\n\r\n";
+
+void onServerMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    conn->send(buf);
+}
+
+int main(int argc, char *argv[]) {
+    Logger::setLogLevel(Logger::WARN);
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    InetAddress serverAddr(23457, true);
+
+    EventLoopThread serverThread;
+    EventLoop *serverLoop = serverThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    serverLoop->runInLoop([&] {
+        server.reset(new TcpServer(serverLoop, serverAddr, "echo"));
+        server->setTcpFastOpen(128);
+        server->setMessageCallback(onServerMessage);
+        server->start();
+    });
+    ::usleep(100 * 1000);
+
+    for (int fastOpen = 0; fastOpen < 2; ++fastOpen) {
+        EventLoop loop;
+        FastOpenBench bench(&loop, serverAddr, fastOpen != 0, rounds);
+        bench.start();
+        loop.loop();
+        bench.report();
+    }
+
+    serverLoop->runInLoop([&] { server.reset(); });
+    ::usleep(100 * 1000);
+}
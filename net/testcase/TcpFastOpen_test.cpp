@@ -0,0 +1,110 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      TcpClient::enableTcpFastOpen()测试
+ *
+ *      测试程序自己定义connect()：开启了TCP_FASTOPEN_CONNECT的socket再打开TCP_FASTOPEN_NO_COOKIE，
+ *      这样不需要先拿到服务端的cookie，connect()也会推迟握手（内核要开启客户端TFO，net.ipv4.tcp_fastopen的第0位）。
+ *
+ *      1. 服务端先说话：客户端在连接回调中不发送数据，仍然能完成握手并收到服务端的消息，localAddress()已经绑定了端口
+ *      2. 客户端先说话：连接回调中发送的请求随SYN发出，收到回显
+ */
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+#ifndef TCP_FASTOPEN_NO_COOKIE
+#define TCP_FASTOPEN_NO_COOKIE 34
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_deferred = 0;         // 推迟了握手的connect()次数
+
+extern "C" int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
+    typedef int (*ConnectFunc)(int, const struct sockaddr *, socklen_t);
+    static ConnectFunc realConnect = reinterpret_cast<ConnectFunc>(::dlsym(RTLD_NEXT, "connect"));
+    bool fastOpen = false;
+#ifdef TCP_FASTOPEN_CONNECT
+    int optval = 0;
+    socklen_t optlen = static_cast<socklen_t>(sizeof optval);
+    if (::getsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &optval, &optlen) == 0 && optval) {
+        fastOpen = true;
+        int on = 1;
+        ::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_NO_COOKIE, &on, static_cast<socklen_t>(sizeof on));
+    }
+#endif
+    int ret = realConnect(sockfd, addr, addrlen);
+    if (fastOpen && ret == 0) {
+        ++g_deferred;
+    }
+    return ret;
+}
+
+// 服务端连接建立后先发送greeting，之后echo收到的数据
+string run(const InetAddress &addr, const string &greeting, const string &request) {
+    EventLoop loop;
+    TcpServer server(&loop, addr, "FastOpenServer");
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected() && !greeting.empty()) {
+            conn->send(greeting);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf);
+    });
+    server.start();
+
+    TcpClient client(&loop, addr, "FastOpenClient");
+    client.enableTcpFastOpen();
+    string received;
+    const string expected = greeting + request;
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            assert(conn->localAddress().port() != 0);
+            if (!request.empty()) {
+                conn->send(request);
+            }
+        }
+    });
+    client.setMessageCallback([&](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+        received += buf->retrieveAllAsString();
+        if (received.size() >= expected.size()) {
+            client.disconnect();
+            loop.runAfter(0.1, [&loop]() { loop.quit(); });
+        }
+    });
+    client.connect();
+    loop.runAfter(5.0, [&received]() {
+        printf("timeout, received '%s'\n", received.c_str());
+        abort();
+    });
+    loop.loop();
+    return received;
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    InetAddress addr("127.0.0.1", 19995);
+
+    // 1. 服务端先说话
+    assert(run(addr, "220 ready\r\n", "") == "220 ready\r\n");
+    printf("server speaks first ok, deferred connects: %d\n", g_deferred);
+
+    // 2. 客户端先说话
+    assert(run(addr, "", "GET /ping\r\n\r\n") == "GET /ping\r\n\r\n");
+    printf("client speaks first ok, deferred connects: %d\n", g_deferred);
+}
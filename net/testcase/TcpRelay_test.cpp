@@ -0,0 +1,196 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      TcpConnection::relayTo()测试
+ *
+ *      测试线程用阻塞socket连接服务端，服务端把第一条连接relay给第二条连接。
+ *      IO线程数为0时两条连接在同一个loop，走splice；为2时在不同的loop，走拷贝。
+ *
+ *      1. 32MB数据原样到达，接收方先停0.5秒不读：源连接停止读，目的连接的outputBuffer不超过4MB
+ *      2. 再次relayTo()第三条连接：之后的数据只到第三条连接
+ *      3. 目的连接断开后，源连接的数据交给messageCallback；两条连接都关闭后服务端没有剩下的连接
+ */
+
+#include "../../base/Logging.h"
+#include "../../base/Mutex.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kTotalBytes = 32 * 1024 * 1024;
+const size_t kBufferLimit = 4 * 1024 * 1024;
+
+MutexLock g_mutex;
+std::vector<TcpConnectionPtr> g_conns;      // 按连接建立的顺序
+int g_connected = 0;
+size_t g_messageBytes = 0;                  // 没有relay时messageCallback收到的字节数
+bool g_overflow = false;                    // 目的连接的outputBuffer超过了kBufferLimit
+
+int connectTo(const InetAddress &addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd >= 0);
+    int rcvbuf = 64 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, static_cast<socklen_t>(sizeof rcvbuf));
+    int ret = ::connect(fd, addr.getSockAddr(), addr.addrLength());
+    assert(ret == 0);
+    (void) ret;
+    return fd;
+}
+
+// 等到服务端建立了n条连接
+TcpConnectionPtr waitForConnection(size_t n) {
+    for (int i = 0; i < 500; ++i) {
+        {
+            MutexLockGuard lock(g_mutex);
+            if (g_conns.size() >= n) {
+                return g_conns[n - 1];
+            }
+        }
+        ::usleep(10 * 1000);
+    }
+    abort();
+}
+
+void writeAll(int fd, size_t first, size_t len) {
+    char buf[64 * 1024];
+    for (size_t pos = first; pos < first + len;) {
+        size_t n = std::min(sizeof buf, first + len - pos);
+        for (size_t i = 0; i < n; ++i) {
+            buf[i] = static_cast<char>((pos + i) % 251);
+        }
+        ssize_t nw = ::write(fd, buf, n);
+        assert(nw > 0);
+        pos += static_cast<size_t>(nw);
+    }
+}
+
+void readAll(int fd, size_t first, size_t len) {
+    char buf[64 * 1024];
+    for (size_t pos = first; pos < first + len;) {
+        ssize_t n = ::read(fd, buf, std::min(sizeof buf, first + len - pos));
+        assert(n > 0);
+        for (ssize_t i = 0; i < n; ++i) {
+            assert(buf[i] == static_cast<char>((pos + static_cast<size_t>(i)) % 251));
+        }
+        pos += static_cast<size_t>(n);
+    }
+}
+
+size_t messageBytes() {
+    MutexLockGuard lock(g_mutex);
+    return g_messageBytes;
+}
+
+bool readable(int fd, int timeoutMs) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return ::poll(&pfd, 1, timeoutMs) > 0;
+}
+
+void test(int numThreads) {
+    g_conns.clear();
+    g_connected = 0;
+    g_messageBytes = 0;
+    g_overflow = false;
+
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    InetAddress addr("127.0.0.1", 19993);
+    std::unique_ptr<TcpServer> server;
+    loop->runInLoop([&] {
+        server.reset(new TcpServer(loop, addr, "RelayServer"));
+        server->setThreadNum(numThreads);
+        server->setConnectionCallback([](const TcpConnectionPtr &conn) {
+            MutexLockGuard lock(g_mutex);
+            if (conn->connected()) {
+                conn->setHighWaterMarkCallback([](const TcpConnectionPtr &, size_t) { g_overflow = true; },
+                                               kBufferLimit);
+                g_conns.push_back(conn);
+                ++g_connected;
+            } else {
+                --g_connected;
+            }
+        });
+        server->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+            MutexLockGuard lock(g_mutex);
+            g_messageBytes += buf->readableBytes();
+            buf->retrieveAll();
+        });
+        server->start();
+    });
+    ::usleep(100 * 1000);
+
+    int source = connectTo(addr);
+    TcpConnectionPtr sourceConn = waitForConnection(1);
+    int sink = connectTo(addr);
+    TcpConnectionPtr sinkConn = waitForConnection(2);
+    sourceConn->relayTo(sinkConn);
+    ::usleep(100 * 1000);
+
+    // 1. 背压
+    Thread writer(std::bind(writeAll, source, 0, kTotalBytes));
+    writer.start();
+    ::usleep(500 * 1000);
+    readAll(sink, 0, kTotalBytes);
+    writer.join();
+    assert(!g_overflow);
+    printf("threads %d: relayed %zu bytes, destination buffer stayed below %zu\n",
+           numThreads, kTotalBytes, kBufferLimit);
+
+    // 2. 换一个目的连接
+    int sink2 = connectTo(addr);
+    TcpConnectionPtr sink2Conn = waitForConnection(3);
+    sourceConn->relayTo(sink2Conn);
+    ::usleep(100 * 1000);
+    writeAll(source, 0, 1024 * 1024);
+    readAll(sink2, 0, 1024 * 1024);
+    assert(!readable(sink, 100));
+    printf("threads %d: rebound\n", numThreads);
+
+    // 3. 目的连接断开
+    ::close(sink2);
+    ::usleep(100 * 1000);
+    writeAll(source, 0, 1000);
+    for (int i = 0; i < 100 && messageBytes() < 1000; ++i) {
+        ::usleep(10 * 1000);
+    }
+    assert(messageBytes() == 1000);
+    ::close(source);
+    ::close(sink);
+    sourceConn.reset();
+    sinkConn.reset();
+    sink2Conn.reset();
+    {
+        MutexLockGuard lock(g_mutex);
+        g_conns.clear();
+    }
+    ::usleep(200 * 1000);
+    {
+        MutexLockGuard lock(g_mutex);
+        assert(g_connected == 0);
+    }
+    printf("threads %d: teardown ok\n", numThreads);
+
+    loop->runInLoop([&] { server.reset(); });
+    ::usleep(100 * 1000);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::ERROR);
+    test(0);
+    test(2);
+}
@@ -0,0 +1,148 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      UdpSocket批量收发测试，发送端和接收端在同一个loop中
+ *
+ *      测试程序自己定义sendmmsg()，覆盖libc的版本，用来记录每次发送的个数、模拟只发出一部分和EAGAIN：
+ *      1. 同一轮迭代send()100个datagram：batch满时发送64个，迭代末尾发送剩下的36个；接收端用recvmmsg()一次收多个
+ *      2. sendmmsg()每次只发出10个：剩下的继续发送，顺序不变
+ *      3. EAGAIN：datagram留在batch中等待可写事件，batch满了以后的datagram被丢弃并计数
+ *      4. 在别的线程调用send()和flush()
+ */
+
+#include "../../base/Logging.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../UdpSocket.h"
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+std::vector<unsigned int> g_sendCalls;     // 每次sendmmsg()的vlen
+unsigned int g_sendLimit = 0;              // 非0时每次最多发出的个数
+bool g_sendAgain = false;                  // true时返回EAGAIN
+int g_maxReceived = 0;                     // 一次recvmmsg()收到的最多个数
+
+extern "C" int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+    typedef int (*SendmmsgFunc)(int, struct mmsghdr *, unsigned int, int);
+    static SendmmsgFunc realSendmmsg = reinterpret_cast<SendmmsgFunc>(::dlsym(RTLD_NEXT, "sendmmsg"));
+    g_sendCalls.push_back(vlen);
+    if (g_sendAgain) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (g_sendLimit > 0 && vlen > g_sendLimit) {
+        vlen = g_sendLimit;
+    }
+    return realSendmmsg(sockfd, msgvec, vlen, flags);
+}
+
+extern "C" int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                        struct timespec *timeout) {
+    typedef int (*RecvmmsgFunc)(int, struct mmsghdr *, unsigned int, int, struct timespec *);
+    static RecvmmsgFunc realRecvmmsg = reinterpret_cast<RecvmmsgFunc>(::dlsym(RTLD_NEXT, "recvmmsg"));
+    int n = realRecvmmsg(sockfd, msgvec, vlen, flags, timeout);
+    if (n > g_maxReceived) {
+        g_maxReceived = n;
+    }
+    return n;
+}
+
+std::vector<int> g_received;
+UdpSocketPtr g_sender;
+InetAddress g_receiverAddr("127.0.0.1", 19991);
+
+void sendNumbers(int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        char buf[16];
+        int n = snprintf(buf, sizeof buf, "%d", i);
+        g_sender->send(buf, static_cast<size_t>(n), g_receiverAddr);
+    }
+}
+
+void checkReceived(int count) {
+    assert(g_received.size() == static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        assert(g_received[static_cast<size_t>(i)] == i);
+    }
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    UdpSocketPtr receiver(new UdpSocket(&loop, g_receiverAddr, false));
+    receiver->setMessageCallback([](UdpSocket *, const char *data, size_t len, const InetAddress &, Timestamp) {
+        g_received.push_back(atoi(string(data, len).c_str()));
+    });
+    receiver->start();
+    g_sender.reset(new UdpSocket(&loop, InetAddress("127.0.0.1", 19992), false));
+    g_sender->start();
+
+    // 1. 满batch和迭代末尾的部分batch
+    loop.runAfter(0.1, []() {
+        g_sendCalls.clear();
+        sendNumbers(0, 100);
+        assert(g_sendCalls.size() == 1 && g_sendCalls[0] == UdpSocket::kMaxBatch);
+    });
+    loop.runAfter(0.3, []() {
+        assert(g_sendCalls.size() == 2 && g_sendCalls[1] == 36);
+        checkReceived(100);
+        assert(g_maxReceived > 1);
+        printf("batch ok, largest recvmmsg %d\n", g_maxReceived);
+
+        // 2. 每次只发出一部分
+        g_sendCalls.clear();
+        g_sendLimit = 10;
+        sendNumbers(100, 30);
+    });
+    loop.runAfter(0.5, []() {
+        assert(g_sendCalls.size() == 3);
+        checkReceived(130);
+        g_sendLimit = 0;
+        printf("partial batch ok\n");
+
+        // 3. EAGAIN：先放进5个，再放进70个，batch只有64个位置
+        g_sendAgain = true;
+        sendNumbers(130, 5);
+    });
+    loop.runAfter(0.7, []() {
+        checkReceived(130);
+        sendNumbers(135, 70);
+        assert(g_sender->droppedDatagrams() == 11);
+        g_sendAgain = false;            // 下一次可写事件把batch发出去
+    });
+    loop.runAfter(0.9, []() {
+        checkReceived(194);
+        printf("EAGAIN ok, %lld dropped\n", static_cast<long long>(g_sender->droppedDatagrams()));
+    });
+
+    // 4. 别的线程调用send()和flush()
+    Thread thread([]() {
+        ::usleep(1000 * 1000);
+        char buf[16];
+        int n = snprintf(buf, sizeof buf, "%d", 194);
+        g_sender->send(buf, static_cast<size_t>(n), g_receiverAddr);
+        g_sender->flush();
+    });
+    thread.start();
+    loop.runAfter(1.3, [&loop]() {
+        checkReceived(195);
+        printf("flush from other thread ok\n");
+        loop.quit();
+    });
+    loop.loop();
+    thread.join();
+    g_sender.reset();
+    receiver.reset();
+}
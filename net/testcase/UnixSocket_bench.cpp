@@ -0,0 +1,106 @@
+//
+// Created by chen on 2022/11/21.
+//
+
+/*
+ *      AF_UNIX 与 loopback TCP 的ping-pong延迟对比
+ *
+ *      服务端是运行在EventLoopThread中的echo TcpServer，
+ *      客户端用阻塞socket发送一个消息、等待回显，重复若干次，统计平均延迟和p99。
+ *
+ *      usage: unixsocket_bench [message_size] [round_trips]
+ */
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../SocketsOps.h"
+#include "../TcpServer.h"
+
+#include <algorithm>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    conn->send(buf);
+}
+
+// 阻塞地读满len个字节
+bool readn(int fd, char *buf, size_t len) {
+    size_t nread = 0;
+    while (nread < len) {
+        ssize_t n = ::read(fd, buf + nread, len - nread);
+        if (n <= 0) {
+            return false;
+        }
+        nread += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void bench(const char *name, const InetAddress &serverAddr, size_t messageSize, int roundTrips) {
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+    std::unique_ptr<TcpServer> server;
+    loop->runInLoop([&] {
+        server.reset(new TcpServer(loop, serverAddr, name));
+        server->setMessageCallback(onMessage);
+        server->start();
+    });
+    ::usleep(100 * 1000);
+
+    int sockfd = ::socket(serverAddr.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0 || ::connect(sockfd, serverAddr.getSockAddr(), serverAddr.addrLength()) < 0) {
+        LOG_SYSFATAL << "connect " << serverAddr.toIpPort();
+    }
+    if (serverAddr.family() != AF_UNIX) {
+        int on = 1;
+        ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, static_cast<socklen_t>(sizeof on));
+    }
+
+    std::string message(messageSize, 'x');
+    std::vector<char> reply(messageSize);
+    std::vector<double> latencies;      // 单位: us
+    latencies.reserve(roundTrips);
+    for (int i = 0; i < roundTrips; ++i) {
+        Timestamp start(Timestamp::now());
+        if (::write(sockfd, message.data(), message.size()) != static_cast<ssize_t>(message.size()) ||
+            !readn(sockfd, reply.data(), reply.size())) {
+            LOG_SYSFATAL << "ping-pong " << serverAddr.toIpPort();
+        }
+        latencies.push_back(timeDifference(Timestamp::now(), start) * 1e6);
+    }
+    ::close(sockfd);
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double l: latencies) {
+        sum += l;
+    }
+    printf("%-6s %6zu bytes  %8d round trips  avg %8.2f us  p50 %8.2f us  p99 %8.2f us\n",
+           name, messageSize, roundTrips,
+           sum / roundTrips,
+           latencies[latencies.size() / 2],
+           latencies[latencies.size() * 99 / 100]);
+
+    // TcpServer必须在它的loop线程中析构
+    loop->runInLoop([&] { server.reset(); });
+    ::usleep(100 * 1000);
+}
+
+int main(int argc, char *argv[]) {
+    Logger::setLogLevel(Logger::WARN);
+    size_t messageSize = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 64;
+    int roundTrips = argc > 2 ? atoi(argv[2]) : 100000;
+
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/unixsocket_bench.%d.sock", ::getpid());
+    bench("unix", UnixAddress(path), messageSize, roundTrips);
+    bench("tcp", InetAddress(23456, true), messageSize, roundTrips);
+}
@@ -0,0 +1,110 @@
+//
+// Created by chen on 2022/12/09.
+//
+
+/*
+ *      AF_UNIX stream socket测试
+ *
+ *      1. UnixAddress拷贝后路径不变，地址长度到路径末尾的'\0'为止；抽象命名空间的地址以'\0'开头，长度不包括结尾
+ *      2. accept()/getsockname()的结果按实际长度构造，没有绑定地址的对端路径为空
+ *      3. TcpServer监听UnixAddress，TcpClient连接后echo一个消息。路径超过sockaddr_in6的大小时两端的地址也是完整的路径；
+ *         抽象命名空间同样可以使用，并且不会留下socket文件
+ */
+
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void testAddress(const string &path) {
+    UnixAddress addr(path);
+    InetAddress copy = addr;
+    assert(copy.family() == AF_UNIX);
+    assert(copy.path() == path);
+    assert(!copy.isAbstractUnix());
+    assert(copy.toIpPort() == "unix:" + path);
+    assert(copy.port() == 0);
+    assert(addr.addrLength() == offsetof(struct sockaddr_un, sun_path) + path.size() + 1);
+
+    UnixAddress abstractAddr("muduo.test", true);
+    assert(abstractAddr.isAbstractUnix());
+    assert(abstractAddr.path() == string("\0muduo.test", 11));
+    assert(abstractAddr.toIpPort() == "unix:@muduo.test");
+    assert(abstractAddr.addrLength() == offsetof(struct sockaddr_un, sun_path) + 11);
+
+    struct sockaddr_un unnamed;
+    memset(&unnamed, 0, sizeof unnamed);
+    unnamed.sun_family = AF_UNIX;
+    InetAddress peer(reinterpret_cast<const struct sockaddr *>(&unnamed),
+                     static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path)));
+    assert(peer.family() == AF_UNIX);
+    assert(peer.path().empty() && !peer.isAbstractUnix());
+    printf("address ok\n");
+}
+
+void testEcho(const UnixAddress &addr) {
+    EventLoop loop;
+    const string path = addr.path();
+    TcpServer server(&loop, addr, "UnixServer");
+    bool serverConnected = false;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            assert(conn->localAddress().path() == path);
+            assert(conn->peerAddress().family() == AF_UNIX);
+            assert(conn->peerAddress().path().empty());
+            serverConnected = true;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        conn->send(buf);
+    });
+    server.start();
+
+    TcpClient client(&loop, addr, "UnixClient");
+    string received;
+    client.setConnectionCallback([&](const TcpConnectionPtr &conn) {
+        if (conn->connected()) {
+            assert(conn->peerAddress().path() == path);
+            conn->send("hello unix");
+        }
+    });
+    client.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        received += buf->retrieveAllAsString();
+        if (received == "hello unix") {
+            client.disconnect();
+            loop.runAfter(0.1, [&loop]() { loop.quit(); });
+        }
+    });
+    client.connect();
+    loop.runAfter(5.0, []() {
+        printf("timeout\n");
+        abort();
+    });
+    loop.loop();
+    assert(serverConnected);
+    assert(received == "hello unix");
+    printf("echo %s ok\n", addr.toIpPort().c_str());
+}
+
+int main() {
+    Logger::setLogLevel(Logger::WARN);
+    char path[64];
+    snprintf(path, sizeof path, "/tmp/unixsocket_test.%d.sock", ::getpid());
+    assert(strlen(path) > sizeof(struct sockaddr_in6));
+    testAddress(path);
+    testEcho(UnixAddress(path));
+    assert(::access(path, F_OK) != 0);      // Acceptor析构时删除socket文件
+
+    char name[64];
+    snprintf(name, sizeof name, "unixsocket_test.%d", ::getpid());
+    testEcho(UnixAddress(name, true));
+    assert(::access(name, F_OK) != 0);
+}